@@ -0,0 +1,354 @@
+/*
+Allocating memory is not free: malloc may take a lock shared with other threads (glibc's arenas lessen, but do not remove, such
+contention), touches its own bookkeeping and may end up in a system call (brk or mmap). Lessons allocate in several places, such as
+a row at a time in MatrixMultiplication.c or a block per thread in ThreadsWithLocalStorage.c, and whatever is allocated on every
+run is paid for on every run. The allocation tracker counts, per thread and per lesson:
+    ·Allocations (malloc, calloc, realloc, aligned_alloc, posix_memalign and memalign calls) and frees.
+    ·Requested bytes.
+    ·Live bytes (allocated and not freed yet) and their peak.
+
+To do so, the allocation functions are interposed: this file defines functions named malloc, free and so on, which the linker picks
+instead of the C library's ones (for every caller, the C library itself included), and which call glibc's actual allocator through
+the names it exports for this very purpose (__libc_malloc and so on). While tracking is disabled, they just forward calls.
+
+Interposing is opt-in, selected at build time through ALLOCATION_TRACKING (-DALLOCATION_TRACKING=1), as it cannot coexist with
+tools that replace the allocator themselves: AddressSanitizer and ThreadSanitizer interpose malloc and free as well, and mixing
+their blocks with glibc's ones crashes the program at startup. Builds without it just refuse --allocations.
+
+Live bytes are measured with malloc_usable_size, both when allocating and when freeing, so that the figures always match no matter
+which thread frees a block. Requested bytes may be a bit smaller than usable ones.
+
+Counting must cost as little as possible, or the tracker would distort what it measures. Thus, counters are kept per thread, written
+by their thread only, so no lock is taken and no cache line bounces between CPUs. A thread's counters are registered (under a mutex)
+when it first allocates, and are kept once the thread ends, so that totals can be computed at any time by summing every thread's
+counters up. Just live bytes are kept process-wide as well (by means of an atomic addition per call), as the peak of their sum is not
+the sum of their peaks.
+
+A lesson allocating nothing once warmed up would show no allocations at all in its benchmark samples (see Benchmark.c).
+*/
+
+/********* Include statements *********/
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <malloc.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "OwnedCounter.h"
+#include "AllocationTracker.h"
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+typedef struct ALLOCATION_THREAD_COUNTERS
+{
+    struct ALLOCATION_THREAD_COUNTERS*  next            ;
+    pid_t                               tid             ;
+    const char*                         label           ;   // Lesson running when the thread first allocated.
+    atomic_ullong                       allocations     ;
+    atomic_ullong                       frees           ;
+    atomic_ullong                       bytes           ;
+    atomic_llong                        live_bytes      ;
+    atomic_llong                        peak_live_bytes ;
+} ALLOCATION_THREAD_COUNTERS;
+
+/**************************************/
+
+/********* Private variables **********/
+
+static atomic_int                                   tracking_enabled;
+static const char* _Atomic                          current_label;
+static ALLOCATION_THREAD_COUNTERS* _Atomic          counters_list;
+static atomic_llong                                 live_bytes;
+static atomic_llong                                 peak_live_bytes;
+
+#if ALLOCATION_TRACKING
+static pthread_mutex_t                              counters_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local ALLOCATION_THREAD_COUNTERS*    thread_counters;
+#endif
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+#if ALLOCATION_TRACKING
+extern void*                        __libc_malloc(size_t size);
+extern void*                        __libc_calloc(size_t members_num, size_t size);
+extern void*                        __libc_realloc(void* ptr, size_t size);
+extern void*                        __libc_memalign(size_t alignment, size_t size);
+extern void                         __libc_free(void* ptr);
+
+static ALLOCATION_THREAD_COUNTERS*  getThreadCounters();
+static void                         updateLiveBytes(long long change);
+static void                         recordAllocation(void* ptr, size_t size);
+static void                         recordFree(void* ptr);
+#endif
+
+/**************************************/
+
+/******** Function definitions ********/
+
+#if ALLOCATION_TRACKING
+// Counters are allocated straight from glibc, as allocating through malloc would call back into the tracker.
+static ALLOCATION_THREAD_COUNTERS* getThreadCounters()
+{
+    if(thread_counters != NULL)
+        return thread_counters;
+
+    ALLOCATION_THREAD_COUNTERS* counters = (ALLOCATION_THREAD_COUNTERS*)__libc_calloc(1, sizeof(ALLOCATION_THREAD_COUNTERS));
+
+    if(counters == NULL)
+        return NULL;
+
+    counters->tid   = (pid_t)syscall(SYS_gettid);
+    counters->label = atomic_load(&current_label);
+
+    pthread_mutex_lock(&counters_lock);
+    counters->next = atomic_load(&counters_list);
+    atomic_store(&counters_list, counters);
+    pthread_mutex_unlock(&counters_lock);
+
+    thread_counters = counters;
+
+    return counters;
+}
+
+static void updateLiveBytes(long long change)
+{
+    ALLOCATION_THREAD_COUNTERS* counters = getThreadCounters();
+
+    if(counters != NULL)
+    {
+        long long thread_live = atomic_load_explicit(&counters->live_bytes, memory_order_relaxed) + change;
+
+        atomic_store_explicit(&counters->live_bytes, thread_live, memory_order_relaxed);
+
+        if(thread_live > atomic_load_explicit(&counters->peak_live_bytes, memory_order_relaxed))
+            atomic_store_explicit(&counters->peak_live_bytes, thread_live, memory_order_relaxed);
+    }
+
+    long long live = atomic_fetch_add_explicit(&live_bytes, change, memory_order_relaxed) + change;
+    long long peak = atomic_load_explicit(&peak_live_bytes, memory_order_relaxed);
+
+    while(live > peak && !atomic_compare_exchange_weak_explicit(&peak_live_bytes, &peak, live, memory_order_relaxed, memory_order_relaxed))
+        ;
+}
+
+static void recordAllocation(void* ptr, size_t size)
+{
+    if(ptr == NULL || !atomic_load_explicit(&tracking_enabled, memory_order_relaxed))
+        return;
+
+    ALLOCATION_THREAD_COUNTERS* counters = getThreadCounters();
+
+    if(counters != NULL)
+    {
+        ownedCounterAdd(&counters->allocations, 1);
+        ownedCounterAdd(&counters->bytes, size);
+    }
+
+    updateLiveBytes((long long)malloc_usable_size(ptr));
+}
+
+// Must be called before the block is actually freed, while its size can still be read.
+static void recordFree(void* ptr)
+{
+    if(ptr == NULL || !atomic_load_explicit(&tracking_enabled, memory_order_relaxed))
+        return;
+
+    ALLOCATION_THREAD_COUNTERS* counters = getThreadCounters();
+
+    if(counters != NULL)
+        ownedCounterAdd(&counters->frees, 1);
+
+    updateLiveBytes(-(long long)malloc_usable_size(ptr));
+}
+
+void* malloc(size_t size)
+{
+    void* ptr = __libc_malloc(size);
+    recordAllocation(ptr, size);
+
+    return ptr;
+}
+
+void* calloc(size_t members_num, size_t size)
+{
+    void* ptr = __libc_calloc(members_num, size);
+    recordAllocation(ptr, members_num * size);
+
+    return ptr;
+}
+
+// Counted as freeing the old block and allocating a new one, even if the block is resized in place.
+void* realloc(void* ptr, size_t size)
+{
+    if(ptr == NULL || !atomic_load_explicit(&tracking_enabled, memory_order_relaxed))
+    {
+        void* new_ptr = __libc_realloc(ptr, size);
+        recordAllocation(new_ptr, size);
+
+        return new_ptr;
+    }
+
+    size_t old_size = malloc_usable_size(ptr);
+    void* new_ptr = __libc_realloc(ptr, size);
+
+    // If resizing fails, the old block is left untouched. A size of 0 frees it.
+    if(new_ptr == NULL && size != 0)
+        return NULL;
+
+    ALLOCATION_THREAD_COUNTERS* counters = getThreadCounters();
+
+    if(counters != NULL)
+        ownedCounterAdd(&counters->frees, 1);
+
+    updateLiveBytes(-(long long)old_size);
+    recordAllocation(new_ptr, size);
+
+    return new_ptr;
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+    void* ptr = __libc_memalign(alignment, size);
+    recordAllocation(ptr, size);
+
+    return ptr;
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size)
+{
+    if(alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0)
+        return EINVAL;
+
+    void* new_ptr = memalign(alignment, size);
+
+    if(new_ptr == NULL)
+        return ENOMEM;
+
+    *ptr = new_ptr;
+
+    return 0;
+}
+
+void free(void* ptr)
+{
+    recordFree(ptr);
+    __libc_free(ptr);
+}
+#endif
+
+// Blocks allocated while tracking is disabled are not seen when freed, and vice versa, so live bytes are only meaningful for
+// allocations made while tracking. Returns -1 if tracking is asked for but has not been compiled in.
+int allocationTrackerEnable(int enabled)
+{
+    if(enabled && !ALLOCATION_TRACKING)
+        return -1;
+
+    atomic_store(&tracking_enabled, (enabled ? 1 : 0));
+
+    return 0;
+}
+
+int allocationTrackerIsEnabled()
+{
+    return atomic_load(&tracking_enabled);
+}
+
+// Threads allocating for the first time from now on are put under "label", which is meant to be the running lesson.
+void allocationTrackerSetLabel(const char* label)
+{
+    atomic_store(&current_label, label);
+}
+
+// Sums every thread's counters up. Threads allocating meanwhile may or may not be accounted for.
+void allocationTrackerGetTotals(ALLOCATION_STATS* stats)
+{
+    if(stats == NULL)
+        return;
+
+    memset(stats, 0, sizeof(ALLOCATION_STATS));
+
+    for(ALLOCATION_THREAD_COUNTERS* counters = atomic_load(&counters_list); counters != NULL; counters = counters->next)
+    {
+        stats->allocations  += atomic_load_explicit(&counters->allocations  , memory_order_relaxed);
+        stats->frees        += atomic_load_explicit(&counters->frees        , memory_order_relaxed);
+        stats->bytes        += atomic_load_explicit(&counters->bytes        , memory_order_relaxed);
+    }
+
+    stats->live_bytes       = atomic_load(&live_bytes);
+    stats->peak_live_bytes  = atomic_load(&peak_live_bytes);
+}
+
+// The peak restarts from the current live bytes, so that each lesson's peak can be told apart.
+void allocationTrackerResetPeak()
+{
+    atomic_store(&peak_live_bytes, atomic_load(&live_bytes));
+}
+
+// Counters made between two totals. The peak is given relative to the live bytes in "before", and is meaningful if the peak was reset
+// when "before" was taken.
+void allocationTrackerGetDifference(const ALLOCATION_STATS* before, const ALLOCATION_STATS* after, ALLOCATION_STATS* difference)
+{
+    if(before == NULL || after == NULL || difference == NULL)
+        return;
+
+    difference->allocations     = after->allocations - before->allocations  ;
+    difference->frees           = after->frees - before->frees              ;
+    difference->bytes           = after->bytes - before->bytes              ;
+    difference->live_bytes      = after->live_bytes - before->live_bytes    ;
+    difference->peak_live_bytes = after->peak_live_bytes - before->live_bytes;
+}
+
+void allocationTrackerPrint(FILE* stream, const char* name, const ALLOCATION_STATS* stats)
+{
+    if(stream == NULL || stats == NULL)
+        return;
+
+    fprintf(stream, "%s: %llu allocation(s), %llu free(s), %llu bytes requested, peak live %lld bytes, %lld bytes still live\r\n",
+            name                    ,
+            stats->allocations      ,
+            stats->frees            ,
+            stats->bytes            ,
+            stats->peak_live_bytes  ,
+            stats->live_bytes       );
+}
+
+// A line per thread which ever allocated while tracking, most recent first. Live bytes are the ones allocated by the thread minus
+// the ones it freed, wherever they were allocated.
+void allocationTrackerPrintThreads(FILE* stream)
+{
+    if(stream == NULL)
+        return;
+
+    for(ALLOCATION_THREAD_COUNTERS* counters = atomic_load(&counters_list); counters != NULL; counters = counters->next)
+    {
+        ALLOCATION_STATS stats =
+        {
+            .allocations        = atomic_load_explicit(&counters->allocations       , memory_order_relaxed),
+            .frees              = atomic_load_explicit(&counters->frees             , memory_order_relaxed),
+            .bytes              = atomic_load_explicit(&counters->bytes             , memory_order_relaxed),
+            .live_bytes         = atomic_load_explicit(&counters->live_bytes        , memory_order_relaxed),
+            .peak_live_bytes    = atomic_load_explicit(&counters->peak_live_bytes   , memory_order_relaxed),
+        };
+
+        char name[64];
+        snprintf(name, sizeof(name), "    thread %d (%s)", (int)counters->tid, (counters->label != NULL ? counters->label : "main"));
+
+        allocationTrackerPrint(stream, name, &stats);
+    }
+}
+
+/**************************************/
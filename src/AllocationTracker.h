@@ -0,0 +1,45 @@
+#ifndef ALLOCATION_TRACKER_H
+#define ALLOCATION_TRACKER_H
+
+/********* Include statements *********/
+
+#include <stdio.h>
+
+/**************************************/
+
+/********** Define statements *********/
+
+// Selected at build time (-DALLOCATION_TRACKING=1). Otherwise, the allocation functions are not interposed and nothing is counted.
+#ifndef ALLOCATION_TRACKING
+#define ALLOCATION_TRACKING     0
+#endif
+
+/**************************************/
+
+/********** Type definitions **********/
+
+typedef struct
+{
+    unsigned long long  allocations     ;   // malloc, calloc, realloc and aligned allocation calls.
+    unsigned long long  frees           ;
+    unsigned long long  bytes           ;   // Requested bytes.
+    long long           live_bytes      ;   // Usable bytes allocated and not freed yet. Negative if earlier blocks were freed.
+    long long           peak_live_bytes ;
+} ALLOCATION_STATS;
+
+/**************************************/
+
+/********* Function prototypes ********/
+
+int     allocationTrackerEnable(int enabled);
+int     allocationTrackerIsEnabled();
+void    allocationTrackerSetLabel(const char* label);
+void    allocationTrackerGetTotals(ALLOCATION_STATS* stats);
+void    allocationTrackerResetPeak();
+void    allocationTrackerGetDifference(const ALLOCATION_STATS* before, const ALLOCATION_STATS* after, ALLOCATION_STATS* difference);
+void    allocationTrackerPrint(FILE* stream, const char* name, const ALLOCATION_STATS* stats);
+void    allocationTrackerPrintThreads(FILE* stream);
+
+/**************************************/
+
+#endif
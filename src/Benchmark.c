@@ -0,0 +1,876 @@
+/*
+Printing clock() values, as done in some of the lessons, says little about how a piece of threaded code performs. To measure a
+lesson, it is run several times in a row: a few warm-up runs first (so that caches, page tables and the thread stacks cache of
+glibc are already populated) and then the measured runs. For each measured run, the following is recorded:
+    ·Wall time: elapsed time according to CLOCK_MONOTONIC, which is not affected by changes in the system's date.
+    ·CPU time: user and system time consumed by every thread in the process, retrieved by using getrusage(RUSAGE_SELF, ...).
+    ·Context switches: voluntary ones (a thread blocked on a lock, a sleep or I/O) and involuntary ones (the scheduler preempted
+    a thread), also taken from getrusage.
+    ·Maximum resident set size: peak memory used by the process so far (it can only grow between runs).
+
+getrusage works at process level, so the figures above include every thread created by the lesson, as long as nothing else runs
+in the process in the meantime.
+
+Each run is executed within a dedicated thread, so that lessons calling pthread_exit (such as ThreadsDetachment.c) end that thread
+instead of the main one. Lessons print a lot, which would distort the measurements, so standard output is redirected to /dev/null
+while benchmarking. The report is written to the original standard output, retrievable by using benchmarkGetReportStream.
+
+If enabled through benchmarkEnablePerfCounters, hardware and software performance counters (see PerfCounters.c) are opened with
+process scope right before each run, so they count the lesson's threads as well, and reported along with the timings. Likewise,
+if allocation tracking is enabled (see AllocationTracker.c), the allocations made by each run are reported: a lesson which does not
+allocate in its steady state shows none once warmed up.
+
+Wall times are summarized by their median and its confidence interval, once outliers are discarded (see BenchmarkStatistics.c).
+If a target is given through benchmarkSetAdaptiveRepetitions, lessons keep on being run after the requested iterations until the
+confidence interval is narrow enough (or the maximum number of iterations is reached), so noisy lessons get more samples than
+stable ones.
+
+Finally, measurements are less noisy if threads are not moved around CPUs. benchmarkPinCPUs restricts the process (and therefore
+every thread created afterwards) to the given CPUs by using sched_setaffinity. Note that pinning a multithreaded lesson to fewer
+CPUs than threads it runs changes how it behaves.
+
+Lessons that know how much work they do (such as increments or multiply-adds) report it as work units, so that their throughput
+is reported as well. Results of a lesson measured with different numbers of threads form a throughput curve, which is fitted by
+benchmarkFitScalability to tell what keeps the lesson from scaling (see ScalabilityModel.c).
+*/
+
+/********* Include statements *********/
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "ThreadColors.h"
+#include "ThreadCreationStatus.h"
+#include "VirtualTime.h"
+#include "Benchmark.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define NULL_DEVICE_PATH    "/dev/null"
+#define NS_PER_SEC          1000000000ULL
+#define NS_PER_USEC         1000ULL
+#define CPU_LIST_SEPARATORS ","
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+typedef struct
+{
+    unsigned long long  min     ;
+    unsigned long long  max     ;
+    double              mean    ;
+} BENCHMARK_SUMMARY;
+
+/**************************************/
+
+/********* Private variables **********/
+
+static int          saved_stdout_fd = -1;
+static FILE*        report_stream;
+static int          perf_counters_enabled;
+static double       target_ci;                  // Relative half width of the median's confidence interval. 0 to disable.
+static unsigned int max_adaptive_iterations;
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static unsigned long long   getMonotonicTimeNs();
+static unsigned long long   timevalToNs(struct timeval* tv);
+static int                  runLessonOnce(void (*test_function)(void), BENCHMARK_SAMPLE* sample);
+static int                  computeWallTimeStatistics(BENCHMARK_RESULT* result);
+static int                  addCPURange(cpu_set_t* cpu_set, const char* range);
+static void                 printJSONString(FILE* stream, const char* text);
+static BENCHMARK_SUMMARY    summarizeSamples(const BENCHMARK_SAMPLE* samples, unsigned int samples_num, unsigned long long (*get_value)(const BENCHMARK_SAMPLE*));
+static unsigned long long   getWallTime(const BENCHMARK_SAMPLE* sample);
+static unsigned long long   getCPUTime(const BENCHMARK_SAMPLE* sample);
+static unsigned long long   getVoluntaryContextSwitches(const BENCHMARK_SAMPLE* sample);
+static unsigned long long   getInvoluntaryContextSwitches(const BENCHMARK_SAMPLE* sample);
+static void                 printJSONSummary(FILE* stream, const char* key, BENCHMARK_SUMMARY summary);
+static void                 printJSONParameters(FILE* stream, const LESSON_PARAMETERS* parameters);
+static void                 printJSONPerfCounters(FILE* stream, const BENCHMARK_SAMPLE* samples, unsigned int samples_num);
+static void                 printJSONSamplePerfCounters(FILE* stream, const PERF_COUNTER_VALUES* values);
+static unsigned long long   getAllocations(const BENCHMARK_SAMPLE* sample);
+static unsigned long long   getAllocatedBytes(const BENCHMARK_SAMPLE* sample);
+static unsigned long long   getPeakLiveBytes(const BENCHMARK_SAMPLE* sample);
+static unsigned long long   getRetainedBytes(const BENCHMARK_SAMPLE* sample);
+static void                 printJSONAllocations(FILE* stream, const BENCHMARK_SAMPLE* samples, unsigned int samples_num);
+static void                 printJSONStatistics(FILE* stream, const BENCHMARK_STATISTICS* statistics);
+static void                 printJSONComparison(FILE* stream, const BENCHMARK_COMPARISON* comparison);
+static int                  isSameScalabilityCurve(const BENCHMARK_RESULT* result, const BENCHMARK_SCALABILITY* scalability);
+static void                 printJSONScalability(FILE* stream, const BENCHMARK_SCALABILITY* scalability);
+
+/**************************************/
+
+/******** Function definitions ********/
+
+static unsigned long long getMonotonicTimeNs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((unsigned long long)now.tv_sec * NS_PER_SEC + (unsigned long long)now.tv_nsec);
+}
+
+static unsigned long long timevalToNs(struct timeval* tv)
+{
+    return ((unsigned long long)tv->tv_sec * NS_PER_SEC + (unsigned long long)tv->tv_usec * NS_PER_USEC);
+}
+
+static int runLessonOnce(void (*test_function)(void), BENCHMARK_SAMPLE* sample)
+{
+    struct rusage usage_before, usage_after;
+    PERF_COUNTER_GROUP perf_counter_group;
+    PERF_COUNTER_VALUES perf_counter_values = {0};
+    ALLOCATION_STATS allocations_before, allocations_after;
+
+    // Counters are opened before the runner thread is created, so that it (and every thread it creates) inherits them.
+    int use_perf_counters = (perf_counters_enabled && sample != NULL);
+
+    if(use_perf_counters)
+    {
+        perfCountersOpen(&perf_counter_group, PERF_COUNTER_SCOPE_PROCESS);
+        perfCountersStart(&perf_counter_group);
+    }
+
+    allocationTrackerGetTotals(&allocations_before);
+    allocationTrackerResetPeak();
+
+    getrusage(RUSAGE_SELF, &usage_before);
+    unsigned long long start = getMonotonicTimeNs();
+
+    if(checkThreadCreationStatus( virtualTimeRunOnThread(test_function) ))
+    {
+        if(use_perf_counters)
+            perfCountersClose(&perf_counter_group);
+
+        return -1;
+    }
+
+    unsigned long long end = getMonotonicTimeNs();
+    getrusage(RUSAGE_SELF, &usage_after);
+    allocationTrackerGetTotals(&allocations_after);
+
+    if(use_perf_counters)
+    {
+        perfCountersStop(&perf_counter_group, &perf_counter_values);
+        perfCountersClose(&perf_counter_group);
+    }
+
+    if(sample == NULL)
+        return 0;
+
+    sample->perf_counters                   = perf_counter_values;
+    allocationTrackerGetDifference(&allocations_before, &allocations_after, &sample->allocations);
+
+    sample->wall_time_ns                    = end - start;
+    sample->user_time_ns                    = timevalToNs(&usage_after.ru_utime) - timevalToNs(&usage_before.ru_utime);
+    sample->system_time_ns                  = timevalToNs(&usage_after.ru_stime) - timevalToNs(&usage_before.ru_stime);
+    sample->voluntary_context_switches      = usage_after.ru_nvcsw  - usage_before.ru_nvcsw;
+    sample->involuntary_context_switches    = usage_after.ru_nivcsw - usage_before.ru_nivcsw;
+    sample->max_rss_kb                      = usage_after.ru_maxrss;
+
+    return 0;
+}
+
+// Flags outlying samples and summarizes the rest.
+static int computeWallTimeStatistics(BENCHMARK_RESULT* result)
+{
+    if(result->iterations == 0)
+        return -1;
+
+    double wall_times[result->iterations];
+    int outliers[result->iterations];
+
+    for(unsigned int sample_idx = 0; sample_idx < result->iterations; sample_idx++)
+        wall_times[sample_idx] = (double)result->samples[sample_idx].wall_time_ns;
+
+    if(benchmarkStatisticsCompute(wall_times, result->iterations, &result->wall_time_statistics, outliers) < 0)
+        return -1;
+
+    for(unsigned int sample_idx = 0; sample_idx < result->iterations; sample_idx++)
+        result->samples[sample_idx].outlier = outliers[sample_idx];
+
+    return 0;
+}
+
+// Ranges are given as "N" or "N-M".
+static int addCPURange(cpu_set_t* cpu_set, const char* range)
+{
+    char* end;
+    unsigned long first = strtoul(range, &end, 10);
+    unsigned long last = first;
+
+    if(end == range)
+        return -1;
+
+    if(*end == '-')
+    {
+        const char* last_text = end + 1;
+        last = strtoul(last_text, &end, 10);
+
+        if(end == last_text)
+            return -1;
+    }
+
+    if(*end != 0 || last < first || last >= CPU_SETSIZE)
+        return -1;
+
+    for(unsigned long cpu = first; cpu <= last; cpu++)
+        CPU_SET(cpu, cpu_set);
+
+    return 0;
+}
+
+void benchmarkEnablePerfCounters(int enabled)
+{
+    perf_counters_enabled = enabled;
+}
+
+// After the requested iterations, keep on measuring until the median's confidence interval is within +-target_relative_ci (0.02
+// for +-2%) or max_iterations samples have been taken. A target of 0 disables adaptive repetitions.
+void benchmarkSetAdaptiveRepetitions(double target_relative_ci, unsigned int max_iterations)
+{
+    target_ci = target_relative_ci;
+    max_adaptive_iterations = max_iterations;
+}
+
+// Restricts the process to the CPUs in the list (such as "2" or "0-3,6"). If no list is given, the current CPU is used.
+int benchmarkPinCPUs(const char* cpu_list)
+{
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+
+    if(cpu_list == NULL || *cpu_list == 0)
+    {
+        int current_cpu = sched_getcpu();
+
+        if(current_cpu < 0)
+            return -1;
+
+        CPU_SET(current_cpu, &cpu_set);
+    }
+    else
+    {
+        char list[strlen(cpu_list) + 1];
+        strcpy(list, cpu_list);
+
+        char* save_ptr;
+
+        for(char* range = strtok_r(list, CPU_LIST_SEPARATORS, &save_ptr); range != NULL; range = strtok_r(NULL, CPU_LIST_SEPARATORS, &save_ptr))
+            if(addCPURange(&cpu_set, range) < 0)
+                return -1;
+    }
+
+    return sched_setaffinity(0, sizeof(cpu_set), &cpu_set);
+}
+
+// Redirect standard output to /dev/null. Anything printed afterwards (even by threads outliving a lesson) is discarded.
+int benchmarkSuppressOutput()
+{
+    if(saved_stdout_fd >= 0)
+        return 0;
+
+    fflush(stdout);
+
+    int null_fd = open(NULL_DEVICE_PATH, O_WRONLY);
+
+    if(null_fd < 0)
+        return -1;
+
+    saved_stdout_fd = dup(STDOUT_FILENO);
+
+    if(saved_stdout_fd < 0 || dup2(null_fd, STDOUT_FILENO) < 0)
+    {
+        close(null_fd);
+        return -1;
+    }
+
+    close(null_fd);
+
+    return 0;
+}
+
+void benchmarkRestoreOutput()
+{
+    if(saved_stdout_fd < 0)
+        return;
+
+    fflush(stdout);
+
+    if(report_stream != NULL)
+    {
+        fclose(report_stream);
+        report_stream = NULL;
+    }
+
+    dup2(saved_stdout_fd, STDOUT_FILENO);
+    close(saved_stdout_fd);
+    saved_stdout_fd = -1;
+}
+
+// Stream pointing to the actual standard output, even while lessons' output is being suppressed.
+FILE* benchmarkGetReportStream()
+{
+    if(saved_stdout_fd < 0)
+        return stdout;
+
+    if(report_stream == NULL)
+        report_stream = fdopen(dup(saved_stdout_fd), "w");
+
+    return (report_stream != NULL ? report_stream : stdout);
+}
+
+int benchmarkRunLesson(const char* name, const char* description, void (*test_function)(void), unsigned int warmup, unsigned int iterations, BENCHMARK_RESULT* result)
+{
+    if(test_function == NULL || result == NULL)
+        return -1;
+
+    memset(result, 0, sizeof(BENCHMARK_RESULT));
+
+    unsigned int capacity = (iterations ? iterations : 1);
+
+    result->samples = (BENCHMARK_SAMPLE*)calloc(capacity, sizeof(BENCHMARK_SAMPLE));
+
+    if(result->samples == NULL)
+        return -1;
+
+    result->name        = name          ;
+    result->description = description   ;
+    result->warmup      = warmup        ;
+
+    getLessonParameters(&result->parameters);
+
+    for(unsigned int run_idx = 0; run_idx < warmup; run_idx++)
+        if(runLessonOnce(test_function, NULL) < 0)
+            return -1;
+
+    for(unsigned int run_idx = 0; ; run_idx++)
+    {
+        // Once the requested iterations are done, go on just while the confidence interval is too wide.
+        if(run_idx >= iterations)
+        {
+            if(target_ci <= 0.0 || run_idx >= max_adaptive_iterations)
+                break;
+
+            if(computeWallTimeStatistics(result) == 0 && benchmarkStatisticsRelativeCI(&result->wall_time_statistics) <= target_ci)
+                break;
+        }
+
+        if(run_idx >= capacity)
+        {
+            BENCHMARK_SAMPLE* samples = (BENCHMARK_SAMPLE*)realloc(result->samples, 2 * capacity * sizeof(BENCHMARK_SAMPLE));
+
+            if(samples == NULL)
+                return -1;
+
+            result->samples = samples;
+            capacity *= 2;
+        }
+
+        if(runLessonOnce(test_function, &result->samples[run_idx]) < 0)
+            return -1;
+
+        ++result->iterations;
+    }
+
+    computeWallTimeStatistics(result);
+
+    return 0;
+}
+
+void benchmarkFreeResult(BENCHMARK_RESULT* result)
+{
+    if(result == NULL)
+        return;
+
+    free(result->samples);
+    result->samples = NULL;
+    result->iterations = 0;
+}
+
+// Copies wall times (ns) of samples that are not outliers into "values", which must fit every sample. Returns how many were copied.
+int benchmarkGetKeptWallTimes(const BENCHMARK_RESULT* result, double* values)
+{
+    int values_num = 0;
+
+    for(unsigned int sample_idx = 0; sample_idx < result->iterations; sample_idx++)
+        if(!result->samples[sample_idx].outlier)
+            values[values_num++] = (double)result->samples[sample_idx].wall_time_ns;
+
+    return values_num;
+}
+
+// Work units per second, taken from the median wall time. Returns 0 if the lesson's work is unknown.
+double benchmarkGetThroughput(const BENCHMARK_RESULT* result)
+{
+    if(result == NULL || result->work_units == 0 || result->wall_time_statistics.median <= 0.0)
+        return 0.0;
+
+    return (double)result->work_units * NS_PER_SEC / result->wall_time_statistics.median;
+}
+
+// Results belong to the same curve if they come from the same lesson, and their parameters only differ in the number of threads.
+static int isSameScalabilityCurve(const BENCHMARK_RESULT* result, const BENCHMARK_SCALABILITY* scalability)
+{
+    unsigned int set_mask = result->parameters.set_mask & ~(1U << LESSON_PARAM_THREADS);
+
+    if(strcmp(result->name, scalability->name) != 0 || set_mask != scalability->parameters.set_mask)
+        return 0;
+
+    for(int param_id = 0; param_id < LESSON_PARAMS_NUM; param_id++)
+        if((set_mask & (1U << param_id)) && result->parameters.values[param_id] != scalability->parameters.values[param_id])
+            return 0;
+
+    return 1;
+}
+
+// Groups results whose number of threads was explicitly given (as in a threads sweep) into throughput curves, and fits them (see
+// ScalabilityModel.c). Curves with fewer than two points are left out. Returns the number of curves, or -1 on error.
+int benchmarkFitScalability(const BENCHMARK_RESULT* results, unsigned int results_num, BENCHMARK_SCALABILITY** scalability)
+{
+    if(results == NULL || scalability == NULL)
+        return -1;
+
+    *scalability = (BENCHMARK_SCALABILITY*)calloc((results_num ? results_num : 1), sizeof(BENCHMARK_SCALABILITY));
+
+    if(*scalability == NULL)
+        return -1;
+
+    unsigned int curves_num = 0;
+
+    for(unsigned int result_idx = 0; result_idx < results_num; result_idx++)
+    {
+        const BENCHMARK_RESULT* result = &results[result_idx];
+        double throughput = benchmarkGetThroughput(result);
+
+        if(throughput <= 0.0 || !(result->parameters.set_mask & (1U << LESSON_PARAM_THREADS)))
+            continue;
+
+        BENCHMARK_SCALABILITY* curve = NULL;
+
+        for(unsigned int curve_idx = 0; curve_idx < curves_num && curve == NULL; curve_idx++)
+            if(isSameScalabilityCurve(result, &(*scalability)[curve_idx]))
+                curve = &(*scalability)[curve_idx];
+
+        if(curve == NULL)
+        {
+            curve = &(*scalability)[curves_num++];
+            curve->name = result->name;
+            curve->parameters = result->parameters;
+            curve->parameters.set_mask &= ~(1U << LESSON_PARAM_THREADS);
+            curve->parameters.values[LESSON_PARAM_THREADS] = 0;
+            curve->points = (SCALABILITY_POINT*)calloc(results_num, sizeof(SCALABILITY_POINT));
+
+            if(curve->points == NULL)
+            {
+                benchmarkFreeScalability(*scalability, curves_num);
+                *scalability = NULL;
+                return -1;
+            }
+        }
+
+        curve->points[curve->points_num].concurrency = (double)result->parameters.values[LESSON_PARAM_THREADS];
+        curve->points[curve->points_num].throughput = throughput;
+        ++curve->points_num;
+    }
+
+    // Drop curves that cannot be fitted at all.
+    unsigned int kept_num = 0;
+
+    for(unsigned int curve_idx = 0; curve_idx < curves_num; curve_idx++)
+    {
+        BENCHMARK_SCALABILITY* curve = &(*scalability)[curve_idx];
+
+        if(curve->points_num < 2)
+        {
+            free(curve->points);
+            continue;
+        }
+
+        scalabilityModelFit(curve->points, curve->points_num, &curve->fit);
+        (*scalability)[kept_num++] = *curve;
+    }
+
+    return (int)kept_num;
+}
+
+void benchmarkFreeScalability(BENCHMARK_SCALABILITY* scalability, unsigned int scalability_num)
+{
+    if(scalability == NULL)
+        return;
+
+    for(unsigned int curve_idx = 0; curve_idx < scalability_num; curve_idx++)
+        free(scalability[curve_idx].points);
+
+    free(scalability);
+}
+
+static void printJSONString(FILE* stream, const char* text)
+{
+    fputc('"', stream);
+
+    for(const char* c = (text ? text : ""); *c; c++)
+    {
+        if(*c == '"' || *c == '\\')
+            fprintf(stream, "\\%c", *c);
+        else if((unsigned char)*c < 0x20)
+            fprintf(stream, "\\u%04x", *c);
+        else
+            fputc(*c, stream);
+    }
+
+    fputc('"', stream);
+}
+
+static BENCHMARK_SUMMARY summarizeSamples(const BENCHMARK_SAMPLE* samples, unsigned int samples_num, unsigned long long (*get_value)(const BENCHMARK_SAMPLE*))
+{
+    BENCHMARK_SUMMARY summary = {0};
+
+    for(unsigned int i = 0; i < samples_num; i++)
+    {
+        unsigned long long value = get_value(&samples[i]);
+
+        if(i == 0 || value < summary.min)
+            summary.min = value;
+
+        if(i == 0 || value > summary.max)
+            summary.max = value;
+
+        summary.mean += (double)value / samples_num;
+    }
+
+    return summary;
+}
+
+static unsigned long long getWallTime(const BENCHMARK_SAMPLE* sample)
+{
+    return sample->wall_time_ns;
+}
+
+static unsigned long long getCPUTime(const BENCHMARK_SAMPLE* sample)
+{
+    return sample->user_time_ns + sample->system_time_ns;
+}
+
+static unsigned long long getVoluntaryContextSwitches(const BENCHMARK_SAMPLE* sample)
+{
+    return (unsigned long long)sample->voluntary_context_switches;
+}
+
+static unsigned long long getInvoluntaryContextSwitches(const BENCHMARK_SAMPLE* sample)
+{
+    return (unsigned long long)sample->involuntary_context_switches;
+}
+
+static void printJSONSummary(FILE* stream, const char* key, BENCHMARK_SUMMARY summary)
+{
+    fprintf(stream, "      \"%s\": { \"min\": %llu, \"mean\": %.1f, \"max\": %llu },\n", key, summary.min, summary.mean, summary.max);
+}
+
+// Only parameters explicitly given are printed, since the rest take each lesson's own default value.
+static void printJSONParameters(FILE* stream, const LESSON_PARAMETERS* parameters)
+{
+    int first = 1;
+
+    fprintf(stream, "      \"parameters\": {");
+
+    for(int param_id = 0; param_id < LESSON_PARAMS_NUM; param_id++)
+    {
+        if(!(parameters->set_mask & (1U << param_id)))
+            continue;
+
+        fprintf(stream, "%s \"%s\": %lu", (first ? "" : ","), getLessonParameterName((LESSON_PARAM_ID)param_id), parameters->values[param_id]);
+        first = 0;
+    }
+
+    fprintf(stream, " },\n");
+}
+
+// Counters unavailable in the current environment are reported as null. Derived ratios are computed from the summed counts.
+static void printJSONPerfCounters(FILE* stream, const BENCHMARK_SAMPLE* samples, unsigned int samples_num)
+{
+    unsigned long long totals[PERF_COUNTERS_NUM] = {0};
+    unsigned int available_mask = (samples_num ? 0xFFFFFFFFU : 0);
+
+    fprintf(stream, "      \"perf_counters\": {");
+
+    for(unsigned int i = 0; i < samples_num; i++)
+        available_mask &= samples[i].perf_counters.available_mask;
+
+    for(int counter_id = 0; counter_id < PERF_COUNTERS_NUM; counter_id++)
+    {
+        fprintf(stream, "%s \"%s\": ", (counter_id ? "," : ""), perfCounterGetName((PERF_COUNTER_ID)counter_id));
+
+        if(!(available_mask & (1U << counter_id)))
+        {
+            fprintf(stream, "null");
+            continue;
+        }
+
+        BENCHMARK_SUMMARY summary = {0};
+
+        for(unsigned int i = 0; i < samples_num; i++)
+        {
+            unsigned long long value = samples[i].perf_counters.values[counter_id];
+
+            if(i == 0 || value < summary.min)
+                summary.min = value;
+
+            if(i == 0 || value > summary.max)
+                summary.max = value;
+
+            summary.mean += (double)value / samples_num;
+            totals[counter_id] += value;
+        }
+
+        fprintf(stream, "{ \"min\": %llu, \"mean\": %.1f, \"max\": %llu }", summary.min, summary.mean, summary.max);
+    }
+
+    unsigned int ipc_mask = (1U << PERF_COUNTER_CYCLES) | (1U << PERF_COUNTER_INSTRUCTIONS);
+    unsigned int llc_mask = (1U << PERF_COUNTER_LLC_MISSES) | (1U << PERF_COUNTER_INSTRUCTIONS);
+
+    if((available_mask & ipc_mask) == ipc_mask && totals[PERF_COUNTER_CYCLES] != 0)
+        fprintf(stream, ", \"ipc\": %.3f", (double)totals[PERF_COUNTER_INSTRUCTIONS] / totals[PERF_COUNTER_CYCLES]);
+    else
+        fprintf(stream, ", \"ipc\": null");
+
+    if((available_mask & llc_mask) == llc_mask && totals[PERF_COUNTER_INSTRUCTIONS] != 0)
+        fprintf(stream, ", \"llc_misses_per_kilo_instruction\": %.3f", 1000.0 * totals[PERF_COUNTER_LLC_MISSES] / totals[PERF_COUNTER_INSTRUCTIONS]);
+    else
+        fprintf(stream, ", \"llc_misses_per_kilo_instruction\": null");
+
+    fprintf(stream, " },\n");
+}
+
+static void printJSONSamplePerfCounters(FILE* stream, const PERF_COUNTER_VALUES* values)
+{
+    for(int counter_id = 0; counter_id < PERF_COUNTERS_NUM; counter_id++)
+    {
+        if(values->available_mask & (1U << counter_id))
+            fprintf(stream, ", \"%s\": %llu", perfCounterGetName((PERF_COUNTER_ID)counter_id), values->values[counter_id]);
+        else
+            fprintf(stream, ", \"%s\": null", perfCounterGetName((PERF_COUNTER_ID)counter_id));
+    }
+}
+
+static unsigned long long getAllocations(const BENCHMARK_SAMPLE* sample)
+{
+    return sample->allocations.allocations;
+}
+
+static unsigned long long getAllocatedBytes(const BENCHMARK_SAMPLE* sample)
+{
+    return sample->allocations.bytes;
+}
+
+static unsigned long long getPeakLiveBytes(const BENCHMARK_SAMPLE* sample)
+{
+    return (sample->allocations.peak_live_bytes > 0 ? (unsigned long long)sample->allocations.peak_live_bytes : 0);
+}
+
+// Bytes allocated by the run and not freed by the end of it (such as by threads outliving the lesson).
+static unsigned long long getRetainedBytes(const BENCHMARK_SAMPLE* sample)
+{
+    return (sample->allocations.live_bytes > 0 ? (unsigned long long)sample->allocations.live_bytes : 0);
+}
+
+static void printJSONAllocations(FILE* stream, const BENCHMARK_SAMPLE* samples, unsigned int samples_num)
+{
+    BENCHMARK_SUMMARY summaries[] =
+    {
+        summarizeSamples(samples, samples_num, getAllocations   ),
+        summarizeSamples(samples, samples_num, getAllocatedBytes),
+        summarizeSamples(samples, samples_num, getPeakLiveBytes ),
+        summarizeSamples(samples, samples_num, getRetainedBytes ),
+    };
+    const char* keys[] = { "calls", "bytes", "peak_live_bytes", "retained_bytes" };
+
+    fprintf(stream, "      \"allocations\": {");
+
+    for(unsigned int summary_idx = 0; summary_idx < sizeof(summaries) / sizeof(summaries[0]); summary_idx++)
+        fprintf(stream, "%s \"%s\": { \"min\": %llu, \"mean\": %.1f, \"max\": %llu }",
+                (summary_idx ? "," : "")        ,
+                keys[summary_idx]               ,
+                summaries[summary_idx].min      ,
+                summaries[summary_idx].mean     ,
+                summaries[summary_idx].max      );
+
+    fprintf(stream, " },\n");
+}
+
+static void printJSONStatistics(FILE* stream, const BENCHMARK_STATISTICS* statistics)
+{
+    fprintf(stream, "      \"wall_time_statistics\": { \"median\": %.1f, \"ci95_low\": %.1f, \"ci95_high\": %.1f, \"relative_ci\": %.4f, \"kept\": %u, \"outliers\": %u },\n",
+            statistics->median                                      ,
+            statistics->ci_low                                      ,
+            statistics->ci_high                                     ,
+            benchmarkStatisticsRelativeCI(statistics)               ,
+            statistics->kept_num                                    ,
+            statistics->samples_num - statistics->kept_num          );
+}
+
+static void printJSONComparison(FILE* stream, const BENCHMARK_COMPARISON* comparison)
+{
+    if(!comparison->available)
+    {
+        fprintf(stream, "      \"baseline\": null,\n");
+        return;
+    }
+
+    fprintf(stream, "      \"baseline\": { \"median\": %.1f, \"change\": %.4f, \"z_score\": %.3f, \"regression\": %s, \"improvement\": %s },\n",
+            comparison->baseline_median                     ,
+            comparison->change_ratio                        ,
+            comparison->z_score                             ,
+            (comparison->regression ? "true" : "false")     ,
+            (comparison->improvement ? "true" : "false")    );
+}
+
+static void printJSONScalability(FILE* stream, const BENCHMARK_SCALABILITY* scalability)
+{
+    const SCALABILITY_FIT* fit = &scalability->fit;
+
+    fprintf(stream, "    {\n      \"name\": ");
+    printJSONString(stream, scalability->name);
+    fprintf(stream, ",\n");
+
+    printJSONParameters(stream, &scalability->parameters);
+
+    fprintf(stream, "      \"points\": [");
+
+    for(unsigned int point_idx = 0; point_idx < scalability->points_num; point_idx++)
+        fprintf(stream, "%s { \"threads\": %.0f, \"throughput_per_s\": %.3f }",
+                (point_idx ? "," : "")                          ,
+                scalability->points[point_idx].concurrency      ,
+                scalability->points[point_idx].throughput       );
+
+    fprintf(stream, " ],\n");
+
+    if(fit->amdahl.available)
+    {
+        fprintf(stream, "      \"amdahl\": { \"sigma\": %.6f, \"r_squared\": %.4f, \"max_speedup\": ", fit->amdahl.sigma, fit->amdahl.r_squared);
+
+        if(fit->amdahl.sigma > 0.0)
+            fprintf(stream, "%.3f },\n", 1.0 / fit->amdahl.sigma);
+        else
+            fprintf(stream, "null },\n");
+    }
+    else
+        fprintf(stream, "      \"amdahl\": null,\n");
+
+    if(fit->usl.available)
+    {
+        fprintf(stream, "      \"usl\": { \"sigma\": %.6f, \"kappa\": %.8f, \"r_squared\": %.4f, ", fit->usl.sigma, fit->usl.kappa, fit->usl.r_squared);
+
+        if(fit->peak_concurrency > 0.0)
+            fprintf(stream, "\"peak_threads\": %.2f, \"peak_throughput_per_s\": %.3f },\n", fit->peak_concurrency, fit->peak_throughput);
+        else
+            fprintf(stream, "\"peak_threads\": null, \"peak_throughput_per_s\": null },\n");
+    }
+    else
+        fprintf(stream, "      \"usl\": null,\n");
+
+    if(fit->amdahl.available)
+        fprintf(stream, "      \"limited_by\": \"%s\"\n", scalabilityModelGetLimitName(fit->limit));
+    else
+        fprintf(stream, "      \"limited_by\": null\n");
+
+    fprintf(stream, "    }");
+}
+
+// Scalability curves are optional (NULL if none were fitted).
+void benchmarkPrintJSON(FILE* stream, const BENCHMARK_RESULT* results, unsigned int results_num, const BENCHMARK_SCALABILITY* scalability, unsigned int scalability_num)
+{
+    if(stream == NULL)
+        return;
+
+    fprintf(stream, "{\n  \"lessons\": [\n");
+
+    for(unsigned int result_idx = 0; result_idx < results_num; result_idx++)
+    {
+        const BENCHMARK_RESULT* result = &results[result_idx];
+
+        fprintf(stream, "    {\n      \"name\": ");
+        printJSONString(stream, result->name);
+        fprintf(stream, ",\n      \"description\": ");
+        printJSONString(stream, result->description);
+        fprintf(stream, ",\n      \"warmup\": %u,\n      \"iterations\": %u,\n", result->warmup, result->iterations);
+
+        printJSONParameters(stream, &result->parameters);
+
+        printJSONSummary(stream, "wall_time_ns"                 , summarizeSamples(result->samples, result->iterations, getWallTime                     ));
+        printJSONSummary(stream, "cpu_time_ns"                  , summarizeSamples(result->samples, result->iterations, getCPUTime                      ));
+        printJSONSummary(stream, "voluntary_context_switches"   , summarizeSamples(result->samples, result->iterations, getVoluntaryContextSwitches     ));
+        printJSONSummary(stream, "involuntary_context_switches" , summarizeSamples(result->samples, result->iterations, getInvoluntaryContextSwitches   ));
+        fprintf(stream, "      \"max_rss_kb\": %ld,\n", (result->iterations ? result->samples[result->iterations - 1].max_rss_kb : 0));
+
+        printJSONStatistics(stream, &result->wall_time_statistics);
+        printJSONComparison(stream, &result->comparison);
+
+        if(result->work_units > 0)
+            fprintf(stream, "      \"work_units\": %llu,\n      \"throughput_per_s\": %.3f,\n", result->work_units, benchmarkGetThroughput(result));
+        else
+            fprintf(stream, "      \"work_units\": null,\n      \"throughput_per_s\": null,\n");
+
+        if(perf_counters_enabled)
+            printJSONPerfCounters(stream, result->samples, result->iterations);
+
+        if(allocationTrackerIsEnabled())
+            printJSONAllocations(stream, result->samples, result->iterations);
+
+        fprintf(stream, "      \"samples\": [\n");
+
+        for(unsigned int sample_idx = 0; sample_idx < result->iterations; sample_idx++)
+        {
+            const BENCHMARK_SAMPLE* sample = &result->samples[sample_idx];
+
+            fprintf(stream, "        { \"wall_time_ns\": %llu, \"user_time_ns\": %llu, \"system_time_ns\": %llu, "
+                            "\"voluntary_context_switches\": %ld, \"involuntary_context_switches\": %ld, \"max_rss_kb\": %ld",
+                    sample->wall_time_ns                    ,
+                    sample->user_time_ns                    ,
+                    sample->system_time_ns                  ,
+                    sample->voluntary_context_switches      ,
+                    sample->involuntary_context_switches    ,
+                    sample->max_rss_kb                      );
+
+            if(perf_counters_enabled)
+                printJSONSamplePerfCounters(stream, &sample->perf_counters);
+
+            if(allocationTrackerIsEnabled())
+                fprintf(stream, ", \"allocations\": %llu, \"allocated_bytes\": %llu, \"peak_live_bytes\": %lld",
+                        sample->allocations.allocations     ,
+                        sample->allocations.bytes           ,
+                        sample->allocations.peak_live_bytes );
+
+            fprintf(stream, ", \"outlier\": %s", (sample->outlier ? "true" : "false"));
+
+            fprintf(stream, " }%s\n", (sample_idx + 1 < result->iterations ? "," : ""));
+        }
+
+        fprintf(stream, "      ]\n    }%s\n", (result_idx + 1 < results_num ? "," : ""));
+    }
+
+    fprintf(stream, "  ],\n  \"scalability\": [\n");
+
+    for(unsigned int curve_idx = 0; curve_idx < scalability_num && scalability != NULL; curve_idx++)
+    {
+        printJSONScalability(stream, &scalability[curve_idx]);
+        fprintf(stream, "%s\n", (curve_idx + 1 < scalability_num ? "," : ""));
+    }
+
+    fprintf(stream, "  ]\n}\n");
+    fflush(stream);
+}
+
+/**************************************/
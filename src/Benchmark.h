@@ -0,0 +1,72 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+/********* Include statements *********/
+
+#include <stdio.h>
+#include "LessonParameters.h"
+#include "PerfCounters.h"
+#include "AllocationTracker.h"
+#include "BenchmarkStatistics.h"
+#include "ScalabilityModel.h"
+
+/**************************************/
+
+/********** Type definitions **********/
+
+typedef struct
+{
+    unsigned long long  wall_time_ns                    ;
+    unsigned long long  user_time_ns                    ;
+    unsigned long long  system_time_ns                  ;
+    long                voluntary_context_switches      ;
+    long                involuntary_context_switches    ;
+    long                max_rss_kb                      ;
+    PERF_COUNTER_VALUES perf_counters                   ;   // Only filled in if enabled through benchmarkEnablePerfCounters.
+    ALLOCATION_STATS    allocations                     ;   // Only filled in if allocation tracking is enabled.
+    int                 outlier                         ;   // Set if the wall time was discarded as an outlier.
+} BENCHMARK_SAMPLE;
+
+typedef struct
+{
+    const char*             name                    ;
+    const char*             description             ;
+    unsigned int            warmup                  ;
+    unsigned int            iterations              ;
+    LESSON_PARAMETERS       parameters              ;   // Lesson parameters in use while the lesson was measured.
+    BENCHMARK_SAMPLE*       samples                 ;
+    BENCHMARK_STATISTICS    wall_time_statistics    ;
+    BENCHMARK_COMPARISON    comparison              ;   // Only filled in if compared against a baseline.
+    unsigned long long      work_units              ;   // Work done by each run of the lesson, 0 if unknown.
+} BENCHMARK_RESULT;
+
+typedef struct
+{
+    const char*         name        ;
+    LESSON_PARAMETERS   parameters  ;   // Parameters shared by every point, but the number of threads.
+    unsigned int        points_num  ;
+    SCALABILITY_POINT*  points      ;
+    SCALABILITY_FIT     fit         ;   // Models are flagged as not available if they could not be fitted.
+} BENCHMARK_SCALABILITY;
+
+/**************************************/
+
+/********* Function prototypes ********/
+
+void    benchmarkEnablePerfCounters(int enabled);
+void    benchmarkSetAdaptiveRepetitions(double target_relative_ci, unsigned int max_iterations);
+int     benchmarkPinCPUs(const char* cpu_list);
+int     benchmarkSuppressOutput();
+void    benchmarkRestoreOutput();
+FILE*   benchmarkGetReportStream();
+int     benchmarkRunLesson(const char* name, const char* description, void (*test_function)(void), unsigned int warmup, unsigned int iterations, BENCHMARK_RESULT* result);
+void    benchmarkFreeResult(BENCHMARK_RESULT* result);
+int     benchmarkGetKeptWallTimes(const BENCHMARK_RESULT* result, double* values);
+double  benchmarkGetThroughput(const BENCHMARK_RESULT* result);
+int     benchmarkFitScalability(const BENCHMARK_RESULT* results, unsigned int results_num, BENCHMARK_SCALABILITY** scalability);
+void    benchmarkFreeScalability(BENCHMARK_SCALABILITY* scalability, unsigned int scalability_num);
+void    benchmarkPrintJSON(FILE* stream, const BENCHMARK_RESULT* results, unsigned int results_num, const BENCHMARK_SCALABILITY* scalability, unsigned int scalability_num);
+
+/**************************************/
+
+#endif
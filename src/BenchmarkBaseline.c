@@ -0,0 +1,233 @@
+/*
+Benchmark results can be saved as a baseline, so that later runs (after changing a lesson, the compiler flags or the machine's
+settings) are compared against it. The baseline is a plain text file with a line per lesson and set of parameters:
+
+matrix threads=4 mat-dim=64<TAB>20<TAB>1523411 1498230 ...
+
+Where:
+    ·The key is the lesson's name followed by the parameters explicitly given, so that each sweep point is compared against the
+    very same point in the baseline.
+    ·Then, the number of samples and their wall times (in nanoseconds). Just the samples kept after discarding outliers are saved.
+
+Whole sample sets are stored rather than just their medians, as deciding whether a lesson got slower requires comparing both
+distributions (see BenchmarkStatistics.c).
+*/
+
+/********* Include statements *********/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "BenchmarkStatistics.h"
+#include "BenchmarkBaseline.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define BASELINE_HEADER         "# Benchmark baseline: lesson [parameters] <TAB> samples <TAB> wall times (ns)"
+#define BASELINE_LINE_MAX_SIZE  65536
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static int parseBaselineLine(char* line, BENCHMARK_BASELINE_ENTRY* entry);
+
+/**************************************/
+
+/******** Function definitions ********/
+
+void benchmarkBaselineGetKey(const BENCHMARK_RESULT* result, char* key, size_t key_size)
+{
+    int len = snprintf(key, key_size, "%s", result->name);
+
+    for(int param_id = 0; param_id < LESSON_PARAMS_NUM && len > 0 && (size_t)len < key_size; param_id++)
+    {
+        if(!(result->parameters.set_mask & (1U << param_id)))
+            continue;
+
+        len += snprintf(key + len, key_size - len, " %s=%lu", getLessonParameterName((LESSON_PARAM_ID)param_id), result->parameters.values[param_id]);
+    }
+}
+
+static int parseBaselineLine(char* line, BENCHMARK_BASELINE_ENTRY* entry)
+{
+    char* save_ptr;
+    char* key = strtok_r(line, "\t", &save_ptr);
+    char* values_num = strtok_r(NULL, "\t", &save_ptr);
+    char* values = strtok_r(NULL, "\t\r\n", &save_ptr);
+
+    if(key == NULL || values_num == NULL || values == NULL || strlen(key) >= sizeof(entry->key))
+        return -1;
+
+    strcpy(entry->key, key);
+    entry->values_num = (unsigned int)strtoul(values_num, NULL, 10);
+
+    if(entry->values_num == 0)
+        return -1;
+
+    entry->values = (double*)malloc(entry->values_num * sizeof(double));
+
+    if(entry->values == NULL)
+        return -1;
+
+    for(unsigned int i = 0; i < entry->values_num; i++)
+    {
+        char* end;
+        entry->values[i] = strtod(values, &end);
+
+        if(end == values)
+        {
+            free(entry->values);
+            entry->values = NULL;
+            return -1;
+        }
+
+        values = end;
+    }
+
+    return 0;
+}
+
+int benchmarkBaselineLoad(const char* path, BENCHMARK_BASELINE* baseline)
+{
+    if(path == NULL || baseline == NULL)
+        return -1;
+
+    memset(baseline, 0, sizeof(BENCHMARK_BASELINE));
+
+    FILE* file = fopen(path, "r");
+
+    if(file == NULL)
+        return -1;
+
+    char* line = (char*)malloc(BASELINE_LINE_MAX_SIZE);
+
+    if(line == NULL)
+    {
+        fclose(file);
+        return -1;
+    }
+
+    while(fgets(line, BASELINE_LINE_MAX_SIZE, file) != NULL)
+    {
+        if(line[0] == '#' || line[0] == '\n')
+            continue;
+
+        BENCHMARK_BASELINE_ENTRY entry;
+
+        if(parseBaselineLine(line, &entry) < 0)
+            continue;
+
+        BENCHMARK_BASELINE_ENTRY* entries = (BENCHMARK_BASELINE_ENTRY*)realloc(baseline->entries, (baseline->entries_num + 1) * sizeof(BENCHMARK_BASELINE_ENTRY));
+
+        if(entries == NULL)
+        {
+            free(entry.values);
+            break;
+        }
+
+        baseline->entries = entries;
+        baseline->entries[baseline->entries_num++] = entry;
+    }
+
+    free(line);
+    fclose(file);
+
+    return 0;
+}
+
+int benchmarkBaselineSave(const char* path, const BENCHMARK_RESULT* results, unsigned int results_num)
+{
+    if(path == NULL || results == NULL)
+        return -1;
+
+    FILE* file = fopen(path, "w");
+
+    if(file == NULL)
+        return -1;
+
+    fprintf(file, "%s\n", BASELINE_HEADER);
+
+    for(unsigned int result_idx = 0; result_idx < results_num; result_idx++)
+    {
+        const BENCHMARK_RESULT* result = &results[result_idx];
+        char key[BENCHMARK_BASELINE_KEY_MAX_SIZE];
+
+        benchmarkBaselineGetKey(result, key, sizeof(key));
+        fprintf(file, "%s\t%u\t", key, result->wall_time_statistics.kept_num);
+
+        int first = 1;
+
+        for(unsigned int sample_idx = 0; sample_idx < result->iterations; sample_idx++)
+        {
+            if(result->samples[sample_idx].outlier)
+                continue;
+
+            fprintf(file, "%s%llu", (first ? "" : " "), result->samples[sample_idx].wall_time_ns);
+            first = 0;
+        }
+
+        fprintf(file, "\n");
+    }
+
+    return (fclose(file) == 0 ? 0 : -1);
+}
+
+const BENCHMARK_BASELINE_ENTRY* benchmarkBaselineFind(const BENCHMARK_BASELINE* baseline, const char* key)
+{
+    if(baseline == NULL || key == NULL)
+        return NULL;
+
+    for(unsigned int entry_idx = 0; entry_idx < baseline->entries_num; entry_idx++)
+        if(strcmp(baseline->entries[entry_idx].key, key) == 0)
+            return &baseline->entries[entry_idx];
+
+    return NULL;
+}
+
+// Fills each result's comparison in. Returns the number of regressions found.
+int benchmarkBaselineCompare(const BENCHMARK_BASELINE* baseline, BENCHMARK_RESULT* results, unsigned int results_num, double threshold)
+{
+    int regressions_num = 0;
+
+    for(unsigned int result_idx = 0; result_idx < results_num; result_idx++)
+    {
+        BENCHMARK_RESULT* result = &results[result_idx];
+        char key[BENCHMARK_BASELINE_KEY_MAX_SIZE];
+
+        memset(&result->comparison, 0, sizeof(BENCHMARK_COMPARISON));
+        benchmarkBaselineGetKey(result, key, sizeof(key));
+
+        const BENCHMARK_BASELINE_ENTRY* entry = benchmarkBaselineFind(baseline, key);
+
+        if(entry == NULL || result->iterations == 0)
+            continue;
+
+        double current[result->iterations];
+        unsigned int current_num = benchmarkGetKeptWallTimes(result, current);
+
+        benchmarkStatisticsCompare(current, current_num, entry->values, entry->values_num, threshold, &result->comparison);
+
+        if(result->comparison.regression)
+            ++regressions_num;
+    }
+
+    return regressions_num;
+}
+
+void benchmarkBaselineFree(BENCHMARK_BASELINE* baseline)
+{
+    if(baseline == NULL)
+        return;
+
+    for(unsigned int entry_idx = 0; entry_idx < baseline->entries_num; entry_idx++)
+        free(baseline->entries[entry_idx].values);
+
+    free(baseline->entries);
+    baseline->entries = NULL;
+    baseline->entries_num = 0;
+}
+
+/**************************************/
@@ -0,0 +1,45 @@
+#ifndef BENCHMARK_BASELINE_H
+#define BENCHMARK_BASELINE_H
+
+/********* Include statements *********/
+
+#include <stddef.h>
+#include "Benchmark.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define BENCHMARK_BASELINE_KEY_MAX_SIZE 256
+
+/**************************************/
+
+/********** Type definitions **********/
+
+typedef struct
+{
+    char            key[BENCHMARK_BASELINE_KEY_MAX_SIZE]    ;   // Lesson name followed by explicitly given parameters.
+    unsigned int    values_num                              ;
+    double*         values                                  ;   // Wall times (ns) of the samples kept in the baseline run.
+} BENCHMARK_BASELINE_ENTRY;
+
+typedef struct
+{
+    unsigned int                entries_num ;
+    BENCHMARK_BASELINE_ENTRY*   entries     ;
+} BENCHMARK_BASELINE;
+
+/**************************************/
+
+/********* Function prototypes ********/
+
+void                            benchmarkBaselineGetKey(const BENCHMARK_RESULT* result, char* key, size_t key_size);
+int                             benchmarkBaselineLoad(const char* path, BENCHMARK_BASELINE* baseline);
+int                             benchmarkBaselineSave(const char* path, const BENCHMARK_RESULT* results, unsigned int results_num);
+const BENCHMARK_BASELINE_ENTRY* benchmarkBaselineFind(const BENCHMARK_BASELINE* baseline, const char* key);
+int                             benchmarkBaselineCompare(const BENCHMARK_BASELINE* baseline, BENCHMARK_RESULT* results, unsigned int results_num, double threshold);
+void                            benchmarkBaselineFree(BENCHMARK_BASELINE* baseline);
+
+/**************************************/
+
+#endif
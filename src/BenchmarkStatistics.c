@@ -0,0 +1,266 @@
+/*
+A single measurement says little: timings of a threaded lesson change from run to run because of scheduling, caches, frequency
+scaling or anything else running on the machine. Their distribution is rarely normal (it usually has a long tail towards slower
+runs), so the statistics below make no assumption about its shape:
+    ·Outliers: samples beyond the Tukey fences (1.5 times the interquartile range below the first quartile or above the third one)
+    are discarded. They are usually caused by something external to the lesson, such as another process being scheduled.
+    ·Median: the middle value of the kept samples, far less sensitive to the long tail than the mean.
+    ·Confidence interval for the median: if samples are sorted, the number of them below the actual median follows a binomial
+    distribution B(n, 0.5). Thus, the order statistics around n/2 at a distance of 1.96 * sqrt(n) / 2 enclose the actual median
+    with a 95% confidence.
+    ·Mann-Whitney U test: tells whether a set of samples tends to be greater than another one by ranking both sets together. It
+    is used to decide whether a lesson got slower than in a baseline run. A difference is only flagged if it is both significant
+    (one-sided, 99% confidence) and greater than a relative threshold, so that tiny yet consistent changes are not reported.
+
+No math library is required: square roots are computed by Newton's method.
+*/
+
+/********* Include statements *********/
+
+#include <stdlib.h>
+#include <string.h>
+#include "BenchmarkStatistics.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define OUTLIER_IQR_FACTOR      1.5
+#define CI_Z_95                 1.96
+#define SIGNIFICANCE_Z_99       2.326   // One-sided.
+#define MIN_SAMPLES_FOR_CI      6
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+typedef struct
+{
+    double  value   ;
+    int     group   ;
+} RANKED_VALUE;
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static int      compareDoubles(const void* a, const void* b);
+static int      compareRankedValues(const void* a, const void* b);
+static double   squareRoot(double value);
+static double   getQuantile(const double* sorted, unsigned int sorted_num, double quantile);
+
+/**************************************/
+
+/******** Function definitions ********/
+
+static int compareDoubles(const void* a, const void* b)
+{
+    double value_a = *((const double*)a);
+    double value_b = *((const double*)b);
+
+    return (value_a < value_b ? -1 : (value_a > value_b ? 1 : 0));
+}
+
+static int compareRankedValues(const void* a, const void* b)
+{
+    return compareDoubles(&((const RANKED_VALUE*)a)->value, &((const RANKED_VALUE*)b)->value);
+}
+
+static double squareRoot(double value)
+{
+    if(value <= 0.0)
+        return 0.0;
+
+    double root = (value > 1.0 ? value / 2.0 : 1.0);
+
+    for(int i = 0; i < 64; i++)
+    {
+        double next = 0.5 * (root + value / root);
+
+        if(next == root)
+            break;
+
+        root = next;
+    }
+
+    return root;
+}
+
+// Linear interpolation between closest ranks.
+static double getQuantile(const double* sorted, unsigned int sorted_num, double quantile)
+{
+    double position = quantile * (sorted_num - 1);
+    unsigned int lower = (unsigned int)position;
+
+    if(lower + 1 >= sorted_num)
+        return sorted[sorted_num - 1];
+
+    return sorted[lower] + (position - lower) * (sorted[lower + 1] - sorted[lower]);
+}
+
+// If given, outliers[i] is set to 1 for every sample discarded as an outlier, and to 0 otherwise.
+int benchmarkStatisticsCompute(const double* values, unsigned int values_num, BENCHMARK_STATISTICS* statistics, int* outliers)
+{
+    if(values == NULL || statistics == NULL || values_num == 0)
+        return -1;
+
+    memset(statistics, 0, sizeof(BENCHMARK_STATISTICS));
+
+    double* sorted = (double*)malloc(values_num * sizeof(double));
+
+    if(sorted == NULL)
+        return -1;
+
+    memcpy(sorted, values, values_num * sizeof(double));
+    qsort(sorted, values_num, sizeof(double), compareDoubles);
+
+    double first_quartile = getQuantile(sorted, values_num, 0.25);
+    double third_quartile = getQuantile(sorted, values_num, 0.75);
+    double iqr = third_quartile - first_quartile;
+
+    statistics->samples_num = values_num;
+    statistics->lower_fence = first_quartile - OUTLIER_IQR_FACTOR * iqr;
+    statistics->upper_fence = third_quartile + OUTLIER_IQR_FACTOR * iqr;
+
+    // Kept samples are moved to the beginning of the sorted array, which stays sorted.
+    unsigned int kept_num = 0;
+
+    for(unsigned int i = 0; i < values_num; i++)
+    {
+        int is_outlier = (values[i] < statistics->lower_fence || values[i] > statistics->upper_fence);
+
+        if(outliers != NULL)
+            outliers[i] = is_outlier;
+
+        if(!(sorted[i] < statistics->lower_fence || sorted[i] > statistics->upper_fence))
+            sorted[kept_num++] = sorted[i];
+    }
+
+    statistics->kept_num = kept_num;
+    statistics->median = getQuantile(sorted, kept_num, 0.5);
+
+    // Too few samples to exclude any of them from the interval.
+    if(kept_num < MIN_SAMPLES_FOR_CI)
+    {
+        statistics->ci_low  = sorted[0];
+        statistics->ci_high = sorted[kept_num - 1];
+        free(sorted);
+        return 0;
+    }
+
+    double half_width = CI_Z_95 * squareRoot((double)kept_num) / 2.0;
+    int low_rank  = (int)(kept_num / 2.0 - half_width);         // 1-based ranks, rounded outwards.
+    int high_rank = (int)(kept_num / 2.0 + half_width + 1.0);
+
+    if(low_rank < 1)
+        low_rank = 1;
+
+    if(high_rank > (int)kept_num)
+        high_rank = kept_num;
+
+    statistics->ci_low  = sorted[low_rank - 1];
+    statistics->ci_high = sorted[high_rank - 1];
+
+    free(sorted);
+
+    return 0;
+}
+
+// Half the width of the median's confidence interval, relative to the median.
+double benchmarkStatisticsRelativeCI(const BENCHMARK_STATISTICS* statistics)
+{
+    if(statistics == NULL || statistics->median <= 0.0)
+        return 0.0;
+
+    return (statistics->ci_high - statistics->ci_low) / 2.0 / statistics->median;
+}
+
+// Normal approximation (with continuity and ties correction) of the U statistic for "a" being greater than "b".
+double benchmarkStatisticsMannWhitneyZ(const double* values_a, unsigned int values_a_num, const double* values_b, unsigned int values_b_num)
+{
+    unsigned int total_num = values_a_num + values_b_num;
+
+    if(values_a == NULL || values_b == NULL || values_a_num == 0 || values_b_num == 0)
+        return 0.0;
+
+    RANKED_VALUE* ranked = (RANKED_VALUE*)malloc(total_num * sizeof(RANKED_VALUE));
+
+    if(ranked == NULL)
+        return 0.0;
+
+    for(unsigned int i = 0; i < values_a_num; i++)
+        ranked[i] = (RANKED_VALUE){ .value = values_a[i], .group = 0 };
+
+    for(unsigned int i = 0; i < values_b_num; i++)
+        ranked[values_a_num + i] = (RANKED_VALUE){ .value = values_b[i], .group = 1 };
+
+    qsort(ranked, total_num, sizeof(RANKED_VALUE), compareRankedValues);
+
+    double rank_sum_a = 0.0;
+    double ties_correction = 0.0;
+
+    // Tied values get the average of the ranks they span.
+    for(unsigned int first = 0; first < total_num; )
+    {
+        unsigned int last = first;
+
+        while(last + 1 < total_num && ranked[last + 1].value == ranked[first].value)
+            ++last;
+
+        double average_rank = (first + last) / 2.0 + 1.0;
+        double ties = last - first + 1;
+
+        for(unsigned int i = first; i <= last; i++)
+            if(ranked[i].group == 0)
+                rank_sum_a += average_rank;
+
+        ties_correction += ties * ties * ties - ties;
+        first = last + 1;
+    }
+
+    free(ranked);
+
+    double u_a = rank_sum_a - values_a_num * (values_a_num + 1) / 2.0;
+    double mean = values_a_num * (double)values_b_num / 2.0;
+    double variance = values_a_num * (double)values_b_num / 12.0 * ((total_num + 1) - ties_correction / (total_num * (total_num - 1.0)));
+
+    if(variance <= 0.0)
+        return 0.0;
+
+    double difference = u_a - mean;
+
+    if(difference > 0.5)
+        difference -= 0.5;
+    else if(difference < -0.5)
+        difference += 0.5;
+    else
+        difference = 0.0;
+
+    return difference / squareRoot(variance);
+}
+
+// "threshold" is the minimum relative change for a significant difference to be flagged (0.05 for 5%).
+void benchmarkStatisticsCompare(const double* current, unsigned int current_num, const double* baseline, unsigned int baseline_num, double threshold, BENCHMARK_COMPARISON* comparison)
+{
+    if(comparison == NULL)
+        return;
+
+    memset(comparison, 0, sizeof(BENCHMARK_COMPARISON));
+
+    BENCHMARK_STATISTICS current_statistics, baseline_statistics;
+
+    if(benchmarkStatisticsCompute(current, current_num, &current_statistics, NULL) < 0 || benchmarkStatisticsCompute(baseline, baseline_num, &baseline_statistics, NULL) < 0)
+        return;
+
+    comparison->available       = 1;
+    comparison->baseline_median = baseline_statistics.median;
+    comparison->z_score         = benchmarkStatisticsMannWhitneyZ(current, current_num, baseline, baseline_num);
+
+    if(baseline_statistics.median > 0.0)
+        comparison->change_ratio = (current_statistics.median - baseline_statistics.median) / baseline_statistics.median;
+
+    comparison->regression  = (comparison->z_score >  SIGNIFICANCE_Z_99 && comparison->change_ratio >  threshold);
+    comparison->improvement = (comparison->z_score < -SIGNIFICANCE_Z_99 && comparison->change_ratio < -threshold);
+}
+
+/**************************************/
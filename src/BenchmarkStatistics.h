@@ -0,0 +1,38 @@
+#ifndef BENCHMARK_STATISTICS_H
+#define BENCHMARK_STATISTICS_H
+
+/********** Type definitions **********/
+
+typedef struct
+{
+    unsigned int    samples_num ;
+    unsigned int    kept_num    ;   // Samples within the outlier fences.
+    double          lower_fence ;
+    double          upper_fence ;
+    double          median      ;
+    double          ci_low      ;   // Confidence interval for the median, computed from kept samples.
+    double          ci_high     ;
+} BENCHMARK_STATISTICS;
+
+typedef struct
+{
+    int     available       ;   // Set if the baseline included the same lesson and parameters.
+    double  baseline_median ;
+    double  change_ratio    ;   // (current median - baseline median) / baseline median.
+    double  z_score         ;   // Mann-Whitney z score, positive if current samples tend to be greater.
+    int     regression      ;
+    int     improvement     ;
+} BENCHMARK_COMPARISON;
+
+/**************************************/
+
+/********* Function prototypes ********/
+
+int     benchmarkStatisticsCompute(const double* values, unsigned int values_num, BENCHMARK_STATISTICS* statistics, int* outliers);
+double  benchmarkStatisticsRelativeCI(const BENCHMARK_STATISTICS* statistics);
+double  benchmarkStatisticsMannWhitneyZ(const double* values_a, unsigned int values_a_num, const double* values_b, unsigned int values_b_num);
+void    benchmarkStatisticsCompare(const double* current, unsigned int current_num, const double* baseline, unsigned int baseline_num, double threshold, BENCHMARK_COMPARISON* comparison);
+
+/**************************************/
+
+#endif
@@ -0,0 +1,586 @@
+/*
+Shared state has been either a single variable guarded by a single mutex (ThreadsWithMutex.c) or kept per thread (thread-local
+storage, ThreadsWithLocalStorage.c). Lookup tables shared by many threads, mostly read and now and then written, call for something
+in between: a hash map which many threads can use at once.
+
+CONCURRENT_HASH_MAP* concurrentHashMapCreate(unsigned int initial_capacity)
+int concurrentHashMapGet(CONCURRENT_HASH_MAP* map, unsigned long long key, unsigned long long* value)
+int concurrentHashMapPut(CONCURRENT_HASH_MAP* map, unsigned long long key, unsigned long long value)
+int concurrentHashMapRemove(CONCURRENT_HASH_MAP* map, unsigned long long key)
+
+Keys and values are 64-bit integers (or pointers, cast), and CONCURRENT_HASH_MAP_EMPTY_KEY cannot be used as a key. The map is an
+open addressing table (linear probing): every key goes to the first free slot from the one its hash points to, and each slot holds
+a key, a value and whether the key is present.
+
+Reads take no lock at all. Slots are only ever given a key once (removing a key just marks it as not present, leaving the key where
+it was), so a reader probing the table can never miss a key because it was moved meanwhile, and every field is read and written
+atomically, so it never sees half-written ones either.
+
+Writes lock one out of a fixed set of mutexes (lock striping), chosen by the key's hash: writes to different keys hardly ever wait
+for each other, while writes to the same key are serialized. Free slots are claimed through compare-and-swap, since writers of
+different stripes may go for the same slot.
+
+Once three quarters of the slots hold keys (removed ones included, as they lengthen probes just as much), a new table is allocated,
+and keys are moved into it a few slots at a time by every later write (incremental resizing), so that no single write pays for
+moving the whole table. Just present keys are moved, so the new table is twice as large only if present keys take more than half of
+that load. Otherwise, it is just as large: a map whose keys keep being added and removed has its removed keys cleaned up rather than
+growing for good.
+    ·Readers look in the old table first, then in the new one. A key is written to the new table before being marked as not present
+    in the old one, so a reader not finding it in the old table finds it in the new one.
+    ·Writers write to the new table only, and mark the key as not present in the old one, so it is not moved over their write.
+    ·Only swapping tables makes writers stop, for as long as it takes to lock every stripe. Readers never stop: one which may have
+    looked into a table which was being replaced meanwhile just looks again.
+
+Swapping tables locks every stripe plus the resize lock at once, so there are 32 stripes: few enough for ThreadSanitizer's deadlock
+detector, which follows at most 64 locks held by the same thread, and still far more than threads writing at once.
+
+Readers may still be looking into a table once every key has been moved out of it, so it cannot be freed right away. Threads
+looking into tables without a stripe locked protect them with hazard pointers (see HazardPointers.c). Tables which have been
+replaced are kept in a list of the map's own, and freed once no hazard pointer protects them, which is checked whenever a table is
+replaced. Whatever is left is freed along with the map, without touching what other structures have retired.
+*/
+
+/********* Include statements *********/
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include "HazardPointers.h"
+#include "ConcurrentHashMap.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define LOCK_STRIPES_NUM        32
+#define MIN_CAPACITY            16
+#define MAX_LOAD_NUMERATOR      3       // Tables are resized once 3/4 of their slots hold keys.
+#define MAX_LOAD_DENOMINATOR    4
+#define MIGRATION_BATCH         16      // Slots moved by every write while resizing.
+#define CURRENT_TABLE_HAZARD    0
+#define OLD_TABLE_HAZARD        1
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+typedef struct
+{
+    atomic_ullong   key     ;
+    atomic_ullong   value   ;
+    atomic_int      present ;
+} CONCURRENT_HASH_MAP_SLOT;
+
+typedef struct CONCURRENT_HASH_MAP_TABLE
+{
+    CONCURRENT_HASH_MAP_SLOT*           slots       ;
+    unsigned int                        capacity    ;   // Always a power of two.
+    atomic_uint                         used        ;   // Slots holding a key, present or not.
+    atomic_uint                         migrate_next;   // Next slot to be moved into the next table.
+    atomic_uint                         migrated    ;   // Slots already moved into the next table.
+    struct CONCURRENT_HASH_MAP_TABLE*   next_retired;   // Next table in the map's list of replaced ones.
+} CONCURRENT_HASH_MAP_TABLE;
+
+struct CONCURRENT_HASH_MAP
+{
+    pthread_mutex_t                         stripes[LOCK_STRIPES_NUM]   ;
+    pthread_mutex_t                         resize_lock                 ;
+    _Atomic(CONCURRENT_HASH_MAP_TABLE*)     current                     ;
+    _Atomic(CONCURRENT_HASH_MAP_TABLE*)     old                         ;   // Table being moved into the current one, or NULL.
+    CONCURRENT_HASH_MAP_TABLE*              retired                     ;   // Replaced tables not freed yet, under resize_lock.
+    atomic_ullong                           size                        ;
+    atomic_uint                             resizes                     ;
+};
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static unsigned long long           hashKey(unsigned long long key);
+static pthread_mutex_t*             getStripe(CONCURRENT_HASH_MAP* map, unsigned long long key);
+static CONCURRENT_HASH_MAP_TABLE*   createTable(unsigned int capacity);
+static void                         freeTable(CONCURRENT_HASH_MAP_TABLE* table);
+static void                         freeRetiredTables(CONCURRENT_HASH_MAP* map);
+static int                          isOverloaded(CONCURRENT_HASH_MAP_TABLE* table);
+static unsigned int                 getNextCapacity(CONCURRENT_HASH_MAP* map, CONCURRENT_HASH_MAP_TABLE* table);
+static CONCURRENT_HASH_MAP_SLOT*    findSlot(CONCURRENT_HASH_MAP_TABLE* table, unsigned long long key);
+static int                          lookUp(CONCURRENT_HASH_MAP_TABLE* table, unsigned long long key, unsigned long long* value);
+static int                          storeInTable(CONCURRENT_HASH_MAP_TABLE* table, unsigned long long key, unsigned long long value);
+static int                          markAbsent(CONCURRENT_HASH_MAP_TABLE* table, unsigned long long key);
+static int                          migrateTableSlots(CONCURRENT_HASH_MAP* map, CONCURRENT_HASH_MAP_TABLE* old, unsigned int slots_num);
+static void                         migrateSlots(CONCURRENT_HASH_MAP* map, unsigned int slots_num);
+static void                         resizeIfNeeded(CONCURRENT_HASH_MAP* map);
+
+/**************************************/
+
+/******** Function definitions ********/
+
+// SplitMix64's finalizer, so that keys which are close to each other are spread over the whole table.
+static unsigned long long hashKey(unsigned long long key)
+{
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+
+    return key;
+}
+
+// Stripes are picked by the hash's upper bits, while slots are picked by its lower ones.
+static pthread_mutex_t* getStripe(CONCURRENT_HASH_MAP* map, unsigned long long key)
+{
+    return &map->stripes[(hashKey(key) >> 32) % LOCK_STRIPES_NUM];
+}
+
+static CONCURRENT_HASH_MAP_TABLE* createTable(unsigned int capacity)
+{
+    CONCURRENT_HASH_MAP_TABLE* table = (CONCURRENT_HASH_MAP_TABLE*)calloc(1, sizeof(CONCURRENT_HASH_MAP_TABLE));
+
+    if(table == NULL)
+        return NULL;
+
+    // Zeroed memory makes every slot empty (CONCURRENT_HASH_MAP_EMPTY_KEY) and not present.
+    table->slots = (CONCURRENT_HASH_MAP_SLOT*)calloc(capacity, sizeof(CONCURRENT_HASH_MAP_SLOT));
+
+    if(table->slots == NULL)
+    {
+        free(table);
+        return NULL;
+    }
+
+    table->capacity = capacity;
+
+    return table;
+}
+
+static void freeTable(CONCURRENT_HASH_MAP_TABLE* table)
+{
+    free(table->slots);
+    free(table);
+}
+
+// Must be called with the resize lock taken. Frees every replaced table no thread protects anymore.
+static void freeRetiredTables(CONCURRENT_HASH_MAP* map)
+{
+    CONCURRENT_HASH_MAP_TABLE** link = &map->retired;
+
+    while(*link != NULL)
+    {
+        CONCURRENT_HASH_MAP_TABLE* table = *link;
+
+        if(hazardPointerIsProtected(table))
+        {
+            link = &table->next_retired;
+            continue;
+        }
+
+        *link = table->next_retired;
+        freeTable(table);
+    }
+}
+
+// Removed keys count as well, since they keep on lengthening probes until the table is replaced.
+static int isOverloaded(CONCURRENT_HASH_MAP_TABLE* table)
+{
+    return ((unsigned long long)atomic_load(&table->used) * MAX_LOAD_DENOMINATOR >= (unsigned long long)table->capacity * MAX_LOAD_NUMERATOR);
+}
+
+// Just present keys are moved into the next table, so it only needs to be larger if they take more than half of the maximum load.
+// Must be called with no table being moved, so that the map's size is the number of keys present in "table".
+static unsigned int getNextCapacity(CONCURRENT_HASH_MAP* map, CONCURRENT_HASH_MAP_TABLE* table)
+{
+    unsigned long long present = atomic_load(&map->size);
+
+    if(present * MAX_LOAD_DENOMINATOR * 2 < (unsigned long long)table->capacity * MAX_LOAD_NUMERATOR)
+        return table->capacity;
+
+    return table->capacity * 2;
+}
+
+// Returns the slot holding the key, or NULL if it reaches an empty slot (or probes the whole table) first.
+static CONCURRENT_HASH_MAP_SLOT* findSlot(CONCURRENT_HASH_MAP_TABLE* table, unsigned long long key)
+{
+    unsigned int mask = table->capacity - 1;
+    unsigned int slot_idx = (unsigned int)hashKey(key) & mask;
+
+    for(unsigned int probe = 0; probe < table->capacity; probe++)
+    {
+        CONCURRENT_HASH_MAP_SLOT* slot = &table->slots[(slot_idx + probe) & mask];
+        unsigned long long slot_key = atomic_load_explicit(&slot->key, memory_order_acquire);
+
+        if(slot_key == key)
+            return slot;
+
+        if(slot_key == CONCURRENT_HASH_MAP_EMPTY_KEY)
+            return NULL;
+    }
+
+    return NULL;
+}
+
+// Returns 1 if the key is present, in which case its value is stored in "value" (if not NULL).
+static int lookUp(CONCURRENT_HASH_MAP_TABLE* table, unsigned long long key, unsigned long long* value)
+{
+    CONCURRENT_HASH_MAP_SLOT* slot = findSlot(table, key);
+
+    if(slot == NULL || !atomic_load_explicit(&slot->present, memory_order_acquire))
+        return 0;
+
+    if(value != NULL)
+        *value = atomic_load_explicit(&slot->value, memory_order_acquire);
+
+    return 1;
+}
+
+// Must be called with the key's stripe locked. Returns 1 if the key was added, 0 if it was just updated, -1 if the table is full.
+static int storeInTable(CONCURRENT_HASH_MAP_TABLE* table, unsigned long long key, unsigned long long value)
+{
+    unsigned int mask = table->capacity - 1;
+    unsigned int slot_idx = (unsigned int)hashKey(key) & mask;
+
+    for(unsigned int probe = 0; probe < table->capacity; probe++)
+    {
+        CONCURRENT_HASH_MAP_SLOT* slot = &table->slots[(slot_idx + probe) & mask];
+        unsigned long long slot_key = atomic_load_explicit(&slot->key, memory_order_acquire);
+
+        // Writers of other stripes may be claiming the same free slot for their own keys.
+        if(slot_key == CONCURRENT_HASH_MAP_EMPTY_KEY)
+        {
+            if(!atomic_compare_exchange_strong(&slot->key, &slot_key, key))
+            {
+                if(slot_key != key)
+                    continue;
+            }
+            else
+                atomic_fetch_add(&table->used, 1);
+        }
+        else if(slot_key != key)
+            continue;
+
+        atomic_store_explicit(&slot->value, value, memory_order_release);
+
+        // The value is written before the key is told to be present, so readers never see a present key without its value.
+        return !atomic_exchange_explicit(&slot->present, 1, memory_order_acq_rel);
+    }
+
+    return -1;
+}
+
+// Must be called with the key's stripe locked. Returns 1 if the key was present.
+static int markAbsent(CONCURRENT_HASH_MAP_TABLE* table, unsigned long long key)
+{
+    CONCURRENT_HASH_MAP_SLOT* slot = findSlot(table, key);
+
+    if(slot == NULL)
+        return 0;
+
+    return atomic_exchange_explicit(&slot->present, 0, memory_order_acq_rel);
+}
+
+// Moves up to "slots_num" slots of "old" into the current table. Returns 1 if this call moved the last slots, in which case the old
+// table is not published anymore, and has been added to the map's retired tables.
+static int migrateTableSlots(CONCURRENT_HASH_MAP* map, CONCURRENT_HASH_MAP_TABLE* old, unsigned int slots_num)
+{
+    // Counters belong to the table being moved, so a thread which loaded a table whose moving is over meanwhile gets no slots.
+    if(atomic_load(&old->migrate_next) >= old->capacity)
+        return 0;
+
+    // While tables are being swapped, the old table is published before the new one, so both may still be the same one. Moving
+    // slots then would move them into their own table, and mark them as not present.
+    CONCURRENT_HASH_MAP_TABLE* current = atomic_load(&map->current);
+
+    if(current == old)
+        return 0;
+
+    // The current table cannot be replaced before the old one is done with, which this thread's batch keeps from happening.
+    unsigned int first_slot = atomic_fetch_add(&old->migrate_next, slots_num);
+
+    if(first_slot >= old->capacity)
+        return 0;
+
+    unsigned int last_slot = (first_slot + slots_num < old->capacity ? first_slot + slots_num : old->capacity);
+
+    for(unsigned int slot_idx = first_slot; slot_idx < last_slot; slot_idx++)
+    {
+        CONCURRENT_HASH_MAP_SLOT* slot = &old->slots[slot_idx];
+        unsigned long long key = atomic_load_explicit(&slot->key, memory_order_acquire);
+
+        if(key == CONCURRENT_HASH_MAP_EMPTY_KEY)
+            continue;
+
+        // Keys still present in the old table have not been written since resizing started, as writers mark them as not present.
+        pthread_mutex_t* stripe = getStripe(map, key);
+        pthread_mutex_lock(stripe);
+
+        if(atomic_load_explicit(&slot->present, memory_order_acquire))
+        {
+            storeInTable(current, key, atomic_load_explicit(&slot->value, memory_order_acquire));
+            atomic_store_explicit(&slot->present, 0, memory_order_release);
+        }
+
+        pthread_mutex_unlock(stripe);
+    }
+
+    if(atomic_fetch_add(&old->migrated, last_slot - first_slot) + (last_slot - first_slot) != old->capacity)
+        return 0;
+
+    // The last batch to end is done with the old table. Writers use it with their stripe locked, so every stripe is locked before
+    // it stops being published.
+    pthread_mutex_lock(&map->resize_lock);
+
+    for(int stripe_idx = 0; stripe_idx < LOCK_STRIPES_NUM; stripe_idx++)
+        pthread_mutex_lock(&map->stripes[stripe_idx]);
+
+    atomic_store(&map->old, NULL);
+
+    for(int stripe_idx = LOCK_STRIPES_NUM - 1; stripe_idx >= 0; stripe_idx--)
+        pthread_mutex_unlock(&map->stripes[stripe_idx]);
+
+    old->next_retired = map->retired;
+    map->retired = old;
+
+    pthread_mutex_unlock(&map->resize_lock);
+
+    return 1;
+}
+
+// Moves up to "slots_num" slots of the old table (if any) into the current one. No stripe may be locked by the caller, since every
+// slot is moved with its key's stripe locked.
+static void migrateSlots(CONCURRENT_HASH_MAP* map, unsigned int slots_num)
+{
+    // Other threads may end moving the table and retire it meanwhile, so it is protected until this thread is done with it.
+    CONCURRENT_HASH_MAP_TABLE* old = (CONCURRENT_HASH_MAP_TABLE*)hazardPointerProtect(OLD_TABLE_HAZARD, (void* _Atomic*)&map->old);
+    int done = (old != NULL && migrateTableSlots(map, old, slots_num));
+
+    hazardPointerClear(OLD_TABLE_HAZARD);
+
+    // Freed right away if nobody else is looking into it anymore, as tables are large.
+    if(done)
+    {
+        pthread_mutex_lock(&map->resize_lock);
+        freeRetiredTables(map);
+        pthread_mutex_unlock(&map->resize_lock);
+    }
+}
+
+// Swapping tables needs every stripe locked, so that no writer is halfway through a write to the table being replaced. Stripes are
+// always locked in the same order, and writers never hold more than one, so this cannot deadlock.
+static void resizeIfNeeded(CONCURRENT_HASH_MAP* map)
+{
+    CONCURRENT_HASH_MAP_TABLE* current = (CONCURRENT_HASH_MAP_TABLE*)hazardPointerProtect(CURRENT_TABLE_HAZARD, (void* _Atomic*)&map->current);
+    int overloaded = isOverloaded(current);
+
+    hazardPointerClear(CURRENT_TABLE_HAZARD);
+
+    if(!overloaded)
+        return;
+
+    // A previous resize still going on is finished first, waiting for other writers to end the batches they are moving.
+    while(atomic_load(&map->old) != NULL)
+    {
+        migrateSlots(map, MIGRATION_BATCH);
+        sched_yield();
+    }
+
+    // Tables are only swapped and retired with the resize lock taken, so the current one cannot be freed while it is held.
+    pthread_mutex_lock(&map->resize_lock);
+
+    freeRetiredTables(map);
+    current = atomic_load(&map->current);
+
+    if(atomic_load(&map->old) != NULL || !isOverloaded(current))
+    {
+        pthread_mutex_unlock(&map->resize_lock);
+        return;
+    }
+
+    CONCURRENT_HASH_MAP_TABLE* next = createTable(getNextCapacity(map, current));
+
+    if(next == NULL)
+    {
+        pthread_mutex_unlock(&map->resize_lock);
+        return;
+    }
+
+    for(int stripe_idx = 0; stripe_idx < LOCK_STRIPES_NUM; stripe_idx++)
+        pthread_mutex_lock(&map->stripes[stripe_idx]);
+
+    // The old table is published before the new one, so that readers seeing the new table see the old one as well.
+    atomic_store(&map->old, current);
+    atomic_store(&map->current, next);
+    atomic_fetch_add(&map->resizes, 1);
+
+    for(int stripe_idx = LOCK_STRIPES_NUM - 1; stripe_idx >= 0; stripe_idx--)
+        pthread_mutex_unlock(&map->stripes[stripe_idx]);
+
+    pthread_mutex_unlock(&map->resize_lock);
+}
+
+// The capacity is rounded up to a power of two. Returns NULL if the map could not be allocated.
+CONCURRENT_HASH_MAP* concurrentHashMapCreate(unsigned int initial_capacity)
+{
+    unsigned int capacity = MIN_CAPACITY;
+
+    while(capacity < initial_capacity && capacity < (1U << 31))
+        capacity *= 2;
+
+    CONCURRENT_HASH_MAP* map = (CONCURRENT_HASH_MAP*)calloc(1, sizeof(CONCURRENT_HASH_MAP));
+
+    if(map == NULL)
+        return NULL;
+
+    CONCURRENT_HASH_MAP_TABLE* table = createTable(capacity);
+
+    if(table == NULL)
+    {
+        free(map);
+        return NULL;
+    }
+
+    for(int stripe_idx = 0; stripe_idx < LOCK_STRIPES_NUM; stripe_idx++)
+        pthread_mutex_init(&map->stripes[stripe_idx], NULL);
+
+    pthread_mutex_init(&map->resize_lock, NULL);
+    atomic_store(&map->current, table);
+    atomic_store(&map->old, NULL);
+
+    return map;
+}
+
+// No other thread may be using the map anymore, so every table it still has is freed, protected or not.
+void concurrentHashMapDestroy(CONCURRENT_HASH_MAP* map)
+{
+    if(map == NULL)
+        return;
+
+    CONCURRENT_HASH_MAP_TABLE* old = atomic_load(&map->old);
+
+    freeTable(atomic_load(&map->current));
+
+    // A table still being moved has not been retired yet.
+    if(old != NULL)
+        freeTable(old);
+
+    while(map->retired != NULL)
+    {
+        CONCURRENT_HASH_MAP_TABLE* retired = map->retired;
+
+        map->retired = retired->next_retired;
+        freeTable(retired);
+    }
+
+    for(int stripe_idx = 0; stripe_idx < LOCK_STRIPES_NUM; stripe_idx++)
+        pthread_mutex_destroy(&map->stripes[stripe_idx]);
+
+    pthread_mutex_destroy(&map->resize_lock);
+    free(map);
+}
+
+// Returns 1 if the key is present (its value being stored in "value", if not NULL), 0 if it is not, and -1 on invalid input.
+// Takes no lock, and uses the calling thread's hazard pointers.
+int concurrentHashMapGet(CONCURRENT_HASH_MAP* map, unsigned long long key, unsigned long long* value)
+{
+    if(map == NULL || key == CONCURRENT_HASH_MAP_EMPTY_KEY)
+        return -1;
+
+    while(1)
+    {
+        CONCURRENT_HASH_MAP_TABLE* current = (CONCURRENT_HASH_MAP_TABLE*)hazardPointerProtect(CURRENT_TABLE_HAZARD, (void* _Atomic*)&map->current);
+        CONCURRENT_HASH_MAP_TABLE* old = (CONCURRENT_HASH_MAP_TABLE*)hazardPointerProtect(OLD_TABLE_HAZARD, (void* _Atomic*)&map->old);
+
+        int found = ((old != NULL && old != current && lookUp(old, key, value)) || lookUp(current, key, value));
+
+        // Tables were swapped meanwhile, so the key may have been moved away from the ones looked into.
+        if(found || atomic_load(&map->current) == current)
+        {
+            hazardPointerClear(CURRENT_TABLE_HAZARD);
+            hazardPointerClear(OLD_TABLE_HAZARD);
+
+            return found;
+        }
+    }
+}
+
+// Adds the key or updates its value. Returns 0 on success, -1 on invalid input or if the key could not be stored.
+int concurrentHashMapPut(CONCURRENT_HASH_MAP* map, unsigned long long key, unsigned long long value)
+{
+    if(map == NULL || key == CONCURRENT_HASH_MAP_EMPTY_KEY)
+        return -1;
+
+    resizeIfNeeded(map);
+
+    pthread_mutex_t* stripe = getStripe(map, key);
+    pthread_mutex_lock(stripe);
+
+    CONCURRENT_HASH_MAP_TABLE* current = atomic_load(&map->current);
+    CONCURRENT_HASH_MAP_TABLE* old = atomic_load(&map->old);
+
+    // Written to the current table before being marked as not present in the old one (see lookUp's callers).
+    int added = storeInTable(current, key, value);
+
+    if(added >= 0 && old != NULL && markAbsent(old, key))
+        added = 0;
+
+    if(added > 0)
+        atomic_fetch_add(&map->size, 1);
+
+    pthread_mutex_unlock(stripe);
+
+    migrateSlots(map, MIGRATION_BATCH);
+
+    return (added < 0 ? -1 : 0);
+}
+
+// Returns 1 if the key was removed, 0 if it was not present, and -1 on invalid input.
+int concurrentHashMapRemove(CONCURRENT_HASH_MAP* map, unsigned long long key)
+{
+    if(map == NULL || key == CONCURRENT_HASH_MAP_EMPTY_KEY)
+        return -1;
+
+    pthread_mutex_t* stripe = getStripe(map, key);
+    pthread_mutex_lock(stripe);
+
+    CONCURRENT_HASH_MAP_TABLE* current = atomic_load(&map->current);
+    CONCURRENT_HASH_MAP_TABLE* old = atomic_load(&map->old);
+
+    int removed = markAbsent(current, key);
+
+    if(old != NULL)
+        removed |= markAbsent(old, key);
+
+    if(removed)
+        atomic_fetch_sub(&map->size, 1);
+
+    pthread_mutex_unlock(stripe);
+
+    migrateSlots(map, MIGRATION_BATCH);
+
+    return removed;
+}
+
+unsigned long long concurrentHashMapGetSize(CONCURRENT_HASH_MAP* map)
+{
+    return (map != NULL ? atomic_load(&map->size) : 0);
+}
+
+unsigned int concurrentHashMapGetCapacity(CONCURRENT_HASH_MAP* map)
+{
+    if(map == NULL)
+        return 0;
+
+    CONCURRENT_HASH_MAP_TABLE* current = (CONCURRENT_HASH_MAP_TABLE*)hazardPointerProtect(CURRENT_TABLE_HAZARD, (void* _Atomic*)&map->current);
+    unsigned int capacity = current->capacity;
+
+    hazardPointerClear(CURRENT_TABLE_HAZARD);
+
+    return capacity;
+}
+
+unsigned int concurrentHashMapGetResizes(CONCURRENT_HASH_MAP* map)
+{
+    return (map != NULL ? atomic_load(&map->resizes) : 0);
+}
+
+/**************************************/
@@ -0,0 +1,29 @@
+#ifndef CONCURRENT_HASH_MAP_H
+#define CONCURRENT_HASH_MAP_H
+
+/********** Define statements *********/
+
+#define CONCURRENT_HASH_MAP_EMPTY_KEY   0ULL    // Reserved: marks empty slots, so it cannot be used as a key.
+
+/**************************************/
+
+/********** Type definitions **********/
+
+typedef struct CONCURRENT_HASH_MAP CONCURRENT_HASH_MAP;
+
+/**************************************/
+
+/********* Function prototypes ********/
+
+CONCURRENT_HASH_MAP*    concurrentHashMapCreate(unsigned int initial_capacity);
+void                    concurrentHashMapDestroy(CONCURRENT_HASH_MAP* map);
+int                     concurrentHashMapGet(CONCURRENT_HASH_MAP* map, unsigned long long key, unsigned long long* value);
+int                     concurrentHashMapPut(CONCURRENT_HASH_MAP* map, unsigned long long key, unsigned long long value);
+int                     concurrentHashMapRemove(CONCURRENT_HASH_MAP* map, unsigned long long key);
+unsigned long long      concurrentHashMapGetSize(CONCURRENT_HASH_MAP* map);
+unsigned int            concurrentHashMapGetCapacity(CONCURRENT_HASH_MAP* map);
+unsigned int            concurrentHashMapGetResizes(CONCURRENT_HASH_MAP* map);
+
+/**************************************/
+
+#endif
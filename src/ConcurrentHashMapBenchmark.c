@@ -0,0 +1,251 @@
+/*
+A lookup table shared by many threads is usually guarded by a single mutex, which makes every lookup wait for every other one,
+even though lookups do not change anything. The concurrent hash map (see ConcurrentHashMap.c) lets lookups take no lock at all, and
+writes lock just one out of many stripes:
+
+int concurrentHashMapGet(CONCURRENT_HASH_MAP* map, unsigned long long key, unsigned long long* value)
+int concurrentHashMapPut(CONCURRENT_HASH_MAP* map, unsigned long long key, unsigned long long value)
+int concurrentHashMapRemove(CONCURRENT_HASH_MAP* map, unsigned long long key)
+
+This lesson has a number of threads run a mix of lookups, insertions and removals on random keys, and measures how many operations
+per second they get through together. The same is done for:
+    ·The concurrent map as it is.
+    ·The same map with every operation made under a single global mutex, as if it were any other shared variable.
+
+Each comparison is run with a growing number of threads (1, 2, 4, ... up to the "threads" lesson parameter, or the available CPUs)
+and for different read ratios (95%, 80% and 50% of lookups). Maps start small and with a quarter of the keys inserted, so they are
+resized while being used. After each run, the number of keys which can be looked up is checked against the map's size.
+
+With a global mutex, adding threads makes no difference (or makes things worse, as threads keep waiting for each other and moving
+the lock's cache line around), whatever the mix. With the concurrent map, operations scale with the number of threads, most of all
+when they are mostly lookups. The number of operations per thread is the "iterations" lesson parameter.
+*/
+
+/********* Include statements *********/
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <stdio.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include "ThreadColors.h"
+#include "ThreadCreationStatus.h"
+#include "ThreadTracer.h"
+#include "ConcurrentHashMap.h"
+#include "LatencyHistogram.h"
+#include "LessonParameters.h"
+#include "ConcurrentHashMapBenchmark.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define DEFAULT_OPERATIONS_PER_THREAD   200000
+#define MAX_BENCHMARK_THREADS           64
+#define KEY_RANGE                       4096    // Keys go from 1 to KEY_RANGE.
+#define INITIAL_CAPACITY                16
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+typedef struct
+{
+    CONCURRENT_HASH_MAP*    map             ;
+    pthread_mutex_t*        global_lock     ;   // NULL to use the map as it is.
+    atomic_int*             start           ;   // Set once every thread has been created, so that they all start at once.
+    unsigned int            read_percent    ;
+    unsigned long           operations_num  ;
+    unsigned long long      seed            ;
+    unsigned long long      checksum        ;   // Sum of values looked up, so that lookups are not optimized away.
+} BENCHMARK_THREAD_DATA;
+
+/**************************************/
+
+/********* Private variables **********/
+
+static const unsigned int read_percents[] = { 95, 80, 50 };
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static unsigned long long   nextRandom(unsigned long long* state);
+static void*                benchmarkRoutine(void* arg);
+static double               runBenchmark(unsigned int threads_num, unsigned int read_percent, unsigned long operations_num, int use_global_lock);
+static unsigned int         getAvailableCPUs();
+
+/**************************************/
+
+/******** Function definitions ********/
+
+// xorshift64: rand() takes a lock of its own, which would be measured along with the map.
+static unsigned long long nextRandom(unsigned long long* state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+
+    return *state;
+}
+
+static void* benchmarkRoutine(void* arg)
+{
+    BENCHMARK_THREAD_DATA* data = (BENCHMARK_THREAD_DATA*)arg;
+    unsigned long long value;
+
+    while(!atomic_load(data->start))
+        sched_yield();
+
+    for(unsigned long op_idx = 0; op_idx < data->operations_num; op_idx++)
+    {
+        unsigned long long random = nextRandom(&data->seed);
+        unsigned long long key = (random >> 8) % KEY_RANGE + 1;
+        unsigned int dice = (unsigned int)(random & 0xFF) * 100 / 256;
+
+        if(data->global_lock != NULL)
+            pthread_mutex_lock(data->global_lock);
+
+        // Writes are split evenly between insertions and removals, so the number of keys stays about the same.
+        if(dice < data->read_percent)
+        {
+            if(concurrentHashMapGet(data->map, key, &value) == 1)
+                data->checksum += value;
+        }
+        else if(dice % 2 == 0)
+            concurrentHashMapPut(data->map, key, key * 2);
+        else
+            concurrentHashMapRemove(data->map, key);
+
+        if(data->global_lock != NULL)
+            pthread_mutex_unlock(data->global_lock);
+    }
+
+    return NULL;
+}
+
+// Returns millions of operations per second, or a negative value on failure.
+static double runBenchmark(unsigned int threads_num, unsigned int read_percent, unsigned long operations_num, int use_global_lock)
+{
+    pthread_t threads[MAX_BENCHMARK_THREADS];
+    BENCHMARK_THREAD_DATA threads_data[MAX_BENCHMARK_THREADS];
+    pthread_mutex_t global_lock;
+    atomic_int start = 0;
+    CONCURRENT_HASH_MAP* map = concurrentHashMapCreate(INITIAL_CAPACITY);
+
+    if(map == NULL)
+        return -1.0;
+
+    for(unsigned long long key = 1; key <= KEY_RANGE / 4; key++)
+        concurrentHashMapPut(map, key * 4, key * 8);
+
+    pthread_mutex_init(&global_lock, NULL);
+
+    unsigned int created_num = 0;
+
+    for(; created_num < threads_num; created_num++)
+    {
+        threads_data[created_num] = (BENCHMARK_THREAD_DATA)
+        {
+            .map            = map                                       ,
+            .global_lock    = (use_global_lock ? &global_lock : NULL)   ,
+            .start          = &start                                    ,
+            .read_percent   = read_percent                              ,
+            .operations_num = operations_num                            ,
+            .seed           = 0x9E3779B97F4A7C15ULL * (created_num + 1) ,
+            .checksum       = 0                                         ,
+        };
+
+        if(checkThreadCreationStatus( TRACED_THREAD_CREATE(&threads[created_num], NULL, benchmarkRoutine, &threads_data[created_num]) ))
+            break;
+    }
+
+    // If not every thread could be created, the ones which were are let go with no operations to do.
+    if(created_num < threads_num)
+        for(unsigned int thread_idx = 0; thread_idx < created_num; thread_idx++)
+            threads_data[thread_idx].operations_num = 0;
+
+    unsigned long long start_ns = latencyHistogramGetTimeNs();
+
+    atomic_store(&start, 1);
+
+    for(unsigned int thread_idx = 0; thread_idx < created_num; thread_idx++)
+        pthread_join(threads[thread_idx], NULL);
+
+    unsigned long long elapsed_ns = latencyHistogramGetTimeNs() - start_ns;
+
+    // Every key which can be looked up must have been counted once, whatever the order operations were made in.
+    unsigned long long found_num = 0;
+
+    for(unsigned long long key = 1; key <= KEY_RANGE; key++)
+        found_num += (concurrentHashMapGet(map, key, NULL) == 1);
+
+    if(found_num != concurrentHashMapGetSize(map))
+        printf("%sInconsistent map: %llu key(s) found, %llu counted.%s\r\n", PRINT_COLOR_RED, found_num, concurrentHashMapGetSize(map), PRINT_COLOR_RESET);
+
+    pthread_mutex_destroy(&global_lock);
+    concurrentHashMapDestroy(map);
+
+    if(created_num < threads_num || elapsed_ns == 0)
+        return -1.0;
+
+    return (double)operations_num * threads_num * 1000.0 / (double)elapsed_ns;
+}
+
+static unsigned int getAvailableCPUs()
+{
+    cpu_set_t cpu_set;
+
+    if(sched_getaffinity(0, sizeof(cpu_set), &cpu_set) < 0)
+        return 1;
+
+    int cpus_num = CPU_COUNT(&cpu_set);
+
+    return (cpus_num > 0 ? (unsigned int)cpus_num : 1);
+}
+
+void exampleConcurrentHashMap()
+{
+    // The number of operations per thread and the largest number of threads can be given as lesson parameters (see
+    // LessonParameters.c). Threads go up to one per available CPU otherwise.
+    unsigned long operations_num = getLessonParameter(LESSON_PARAM_ITERATIONS, DEFAULT_OPERATIONS_PER_THREAD);
+    unsigned int max_threads = (unsigned int)getLessonParameter(LESSON_PARAM_THREADS, getAvailableCPUs());
+
+    if(max_threads < 1)
+        max_threads = 1;
+
+    if(max_threads > MAX_BENCHMARK_THREADS)
+        max_threads = MAX_BENCHMARK_THREADS;
+
+    printf("%s%lu operation(s) per thread on %d keys, in millions of operations per second.%s\r\n",
+            PRINT_COLOR_GREEN   ,
+            operations_num      ,
+            KEY_RANGE           ,
+            PRINT_COLOR_RESET   );
+
+    for(unsigned int mix_idx = 0; mix_idx < sizeof(read_percents) / sizeof(read_percents[0]); mix_idx++)
+    {
+        printf("%s%u%% lookups:%s\r\n", PRINT_COLOR_YELLOW, read_percents[mix_idx], PRINT_COLOR_RESET);
+        printf("\tThreads\tGlobal mutex\tConcurrent map\tSpeedup\r\n");
+
+        for(unsigned int threads_num = 1; ; threads_num = (threads_num * 2 < max_threads ? threads_num * 2 : max_threads))
+        {
+            double global_mops = runBenchmark(threads_num, read_percents[mix_idx], operations_num, 1);
+            double concurrent_mops = runBenchmark(threads_num, read_percents[mix_idx], operations_num, 0);
+
+            if(global_mops < 0 || concurrent_mops < 0)
+            {
+                printf("%sCould not run the benchmark, so the procedure cannot go on.%s\r\n", PRINT_COLOR_RED, PRINT_COLOR_RESET);
+                return;
+            }
+
+            printf("\t%u\t%12.2f\t%14.2f\t%6.2fx\r\n", threads_num, global_mops, concurrent_mops, concurrent_mops / global_mops);
+
+            if(threads_num == max_threads)
+                break;
+        }
+    }
+}
+
+/**************************************/
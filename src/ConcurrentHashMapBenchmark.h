@@ -0,0 +1,10 @@
+#ifndef CONCURRENT_HASH_MAP_BENCHMARK_H
+#define CONCURRENT_HASH_MAP_BENCHMARK_H
+
+/********* Function prototypes ********/
+
+void exampleConcurrentHashMap();
+
+/**************************************/
+
+#endif
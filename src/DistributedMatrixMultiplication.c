@@ -0,0 +1,643 @@
+/*
+The matrix lessons multiply matrices with threads sharing memory. Clusters multiply them with nodes which share nothing: each node
+owns some blocks of the matrices, and has to receive from other nodes whatever else it needs, as messages. This lesson runs such
+an algorithm with processes standing in for nodes: every node is a process created with fork, and nodes talk to each other through
+UNIX domain sockets only, as they would through a network.
+
+The algorithm is SUMMA (Scalable Universal Matrix Multiplication Algorithm). Nodes are laid out as a square grid, and every matrix
+is split into as many square blocks, node (i, j) owning blocks A(i, j), B(i, j) and C(i, j). C(i, j) is the sum of A(i, k) *
+B(k, j) over every k, so the multiplication takes as many steps as the grid has columns. At step k:
+    ·Every node in grid column k sends its block of A (a panel) to the other nodes in its row.
+    ·Every node in grid row k sends its block of B to the other nodes in its column.
+    ·Every node adds the product of the panels it got to its block of C.
+
+Nodes send and receive at once, polling every socket they are using (poll), so that no pair of nodes can end up waiting for each
+other to read. Even then, a node doing it all in turn sits idle while panels come in. Communication and computation are overlapped
+by having a second thread in each node receive the panels of the next step while the first one multiplies the current ones. Panels
+go to one of two slots (double buffering), and a couple of semaphores per slot tell each thread when a slot can be multiplied or
+refilled.
+
+Matrices are created by the parent process and scattered to the nodes through shared memory, which stands for loading them from
+storage, and blocks of C are gathered back the same way. After an untimed warm-up run on a single node, the lesson runs grids of
+1, 4, 9 and 16 nodes (as long as they fit within the "threads" lesson parameter), with and without overlapping, and checks every
+result against a serial multiplication. Matrices are "mat-dim" elements wide, rounded up so that every grid splits them in whole
+blocks.
+
+Being local processes, nodes share the machine's CPUs: on a single CPU, more nodes just add communication, while on a real cluster
+every node would bring its own CPU. Time spent waiting for panels tells how much of the run communication takes, either way.
+*/
+
+/********* Include statements *********/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include "ThreadColors.h"
+#include "ThreadCreationStatus.h"
+#include "ThreadTracer.h"
+#include "LatencyHistogram.h"
+#include "LessonParameters.h"
+#include "DistributedMatrixMultiplication.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+// Default values, which can be overridden through lesson parameters (see LessonParameters.c).
+#define DEFAULT_MAT_DIM     384
+#define DEFAULT_MAX_NODES   16
+
+#define MAX_GRID_DIM        4
+#define MAX_NODES           (MAX_GRID_DIM * MAX_GRID_DIM)
+#define DIM_MULTIPLE        12      // Least common multiple of every grid dimension, so that every grid splits matrices evenly.
+#define PANEL_SLOTS         2
+#define MIN_MAT_VAL         0
+#define MAX_MAT_VAL         10
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+// Written by every node into shared memory, for the parent to report.
+typedef struct
+{
+    unsigned long long  compute_ns  ;   // Time spent multiplying panels.
+    unsigned long long  wait_ns     ;   // Time the multiplying thread spent waiting for panels to arrive.
+} SUMMA_NODE_STATS;
+
+typedef struct
+{
+    const int*          mat_A                           ;   // Shared with every node, which copies its own blocks out of it.
+    const int*          mat_B                           ;
+    int*                mat_C                           ;   // Every node copies its block of C into it once done.
+    SUMMA_NODE_STATS*   stats                           ;
+    unsigned int        dim                             ;
+    unsigned int        grid_dim                        ;   // Nodes per row and column of the grid.
+    unsigned int        block_dim                       ;
+    int                 overlap                         ;
+    int                 sockets[MAX_NODES][MAX_NODES]   ;   // sockets[a][b] is node a's end of the socket it shares with b.
+} SUMMA_GRID;
+
+typedef struct
+{
+    const SUMMA_GRID*   grid                        ;
+    unsigned int        node_idx                    ;
+    unsigned int        row                         ;
+    unsigned int        col                         ;
+    int*                block_A                     ;
+    int*                block_B                     ;
+    int*                block_C                     ;
+    int*                panels_A[PANEL_SLOTS]       ;
+    int*                panels_B[PANEL_SLOTS]       ;
+    sem_t               panels_ready[PANEL_SLOTS]   ;   // Posted once a slot holds the panels of a step.
+    sem_t               slots_free[PANEL_SLOTS]     ;   // Posted once a slot's panels have been multiplied.
+    int                 comm_status                 ;   // Set to -1 by the communication thread if a transfer failed.
+} SUMMA_NODE;
+
+typedef struct
+{
+    int             fd      ;
+    unsigned char*  data    ;
+    size_t          size    ;
+    size_t          done    ;
+    int             sending ;
+} PANEL_TRANSFER;
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static unsigned int nodeIndex(const SUMMA_GRID* grid, unsigned int row, unsigned int col);
+static void         multiplyAddBlock(const int* block_A, const int* block_B, int* block_C, unsigned int block_dim);
+static void         addTransfer(PANEL_TRANSFER* transfers, unsigned int* transfers_num, int fd, void* data, size_t size, int sending);
+static int          runTransfers(PANEL_TRANSFER* transfers, unsigned int transfers_num);
+static int          exchangePanels(SUMMA_NODE* node, unsigned int step, int* panel_A, int* panel_B);
+static void*        communicationRoutine(void* arg);
+static int          runSteps(SUMMA_NODE* node, SUMMA_NODE_STATS* stats);
+static int          runNode(const SUMMA_GRID* grid, unsigned int node_idx);
+static int          openSockets(SUMMA_GRID* grid);
+static void         closeSockets(SUMMA_GRID* grid, int keep_node_idx);
+static pid_t        forkNode();
+static int          runGrid(SUMMA_GRID* grid, const int* mat_expected, unsigned long long* elapsed_ns);
+
+/**************************************/
+
+/******** Function definitions ********/
+
+static unsigned int nodeIndex(const SUMMA_GRID* grid, unsigned int row, unsigned int col)
+{
+    return row * grid->grid_dim + col;
+}
+
+// Accumulated in i-k-j order, so that the innermost loop walks rows of B and C sequentially.
+static void multiplyAddBlock(const int* block_A, const int* block_B, int* block_C, unsigned int block_dim)
+{
+    for(unsigned int row = 0; row < block_dim; row++)
+    {
+        int* row_C = &block_C[(size_t)row * block_dim];
+
+        for(unsigned int k = 0; k < block_dim; k++)
+        {
+            int value_A = block_A[(size_t)row * block_dim + k];
+            const int* row_B = &block_B[(size_t)k * block_dim];
+
+            for(unsigned int col = 0; col < block_dim; col++)
+                row_C[col] += value_A * row_B[col];
+        }
+    }
+}
+
+static void addTransfer(PANEL_TRANSFER* transfers, unsigned int* transfers_num, int fd, void* data, size_t size, int sending)
+{
+    PANEL_TRANSFER* transfer = &transfers[(*transfers_num)++];
+
+    transfer->fd        = fd                    ;
+    transfer->data      = (unsigned char*)data  ;
+    transfer->size      = size                  ;
+    transfer->done      = 0                     ;
+    transfer->sending   = sending               ;
+}
+
+// Moves every transfer forward as its socket allows, so that a node never blocks on a peer which is itself blocked on sending to
+// someone else. Returns 0 once every transfer is done, -1 if a peer is gone or a socket failed.
+static int runTransfers(PANEL_TRANSFER* transfers, unsigned int transfers_num)
+{
+    struct pollfd poll_fds[2 * MAX_GRID_DIM];
+    unsigned int pending_idx[2 * MAX_GRID_DIM];
+
+    for(;;)
+    {
+        unsigned int pending_num = 0;
+
+        for(unsigned int transfer_idx = 0; transfer_idx < transfers_num; transfer_idx++)
+        {
+            if(transfers[transfer_idx].done == transfers[transfer_idx].size)
+                continue;
+
+            poll_fds[pending_num].fd        = transfers[transfer_idx].fd                            ;
+            poll_fds[pending_num].events    = (transfers[transfer_idx].sending ? POLLOUT : POLLIN)  ;
+            poll_fds[pending_num].revents   = 0                                                     ;
+            pending_idx[pending_num++]      = transfer_idx                                          ;
+        }
+
+        if(pending_num == 0)
+            return 0;
+
+        if(poll(poll_fds, pending_num, -1) < 0)
+        {
+            if(errno == EINTR)
+                continue;
+
+            return -1;
+        }
+
+        for(unsigned int poll_idx = 0; poll_idx < pending_num; poll_idx++)
+        {
+            if(poll_fds[poll_idx].revents == 0)
+                continue;
+
+            PANEL_TRANSFER* transfer = &transfers[pending_idx[poll_idx]];
+            ssize_t moved;
+
+            size_t left = transfer->size - transfer->done;
+
+            if(transfer->sending)
+                moved = send(transfer->fd, transfer->data + transfer->done, left, MSG_DONTWAIT | MSG_NOSIGNAL);
+            else
+                moved = recv(transfer->fd, transfer->data + transfer->done, left, MSG_DONTWAIT);
+
+            if(moved > 0)
+                transfer->done += (size_t)moved;
+            else if(moved == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+                return -1;
+        }
+    }
+}
+
+// Gets the panels of A and B a step multiplies: the node's own blocks if it is the one sending them, or the ones sent by the
+// nodes in column "step" of its row and row "step" of its column otherwise.
+static int exchangePanels(SUMMA_NODE* node, unsigned int step, int* panel_A, int* panel_B)
+{
+    const SUMMA_GRID* grid = node->grid;
+    size_t panel_size = (size_t)grid->block_dim * grid->block_dim * sizeof(int);
+    const int* sockets = grid->sockets[node->node_idx];
+    PANEL_TRANSFER transfers[2 * MAX_GRID_DIM];
+    unsigned int transfers_num = 0;
+
+    if(node->col == step)
+    {
+        memcpy(panel_A, node->block_A, panel_size);
+
+        for(unsigned int col = 0; col < grid->grid_dim; col++)
+            if(col != node->col)
+                addTransfer(transfers, &transfers_num, sockets[nodeIndex(grid, node->row, col)], panel_A, panel_size, 1);
+    }
+    else
+        addTransfer(transfers, &transfers_num, sockets[nodeIndex(grid, node->row, step)], panel_A, panel_size, 0);
+
+    if(node->row == step)
+    {
+        memcpy(panel_B, node->block_B, panel_size);
+
+        for(unsigned int row = 0; row < grid->grid_dim; row++)
+            if(row != node->row)
+                addTransfer(transfers, &transfers_num, sockets[nodeIndex(grid, row, node->col)], panel_B, panel_size, 1);
+    }
+    else
+        addTransfer(transfers, &transfers_num, sockets[nodeIndex(grid, step, node->col)], panel_B, panel_size, 0);
+
+    return runTransfers(transfers, transfers_num);
+}
+
+// Fills slots with the panels of every step in turn, while the node's main thread multiplies the ones filled before. If a
+// transfer fails, the remaining steps are still marked as ready, so that the main thread finds out instead of waiting forever.
+static void* communicationRoutine(void* arg)
+{
+    SUMMA_NODE* node = (SUMMA_NODE*)arg;
+
+    for(unsigned int step = 0; step < node->grid->grid_dim; step++)
+    {
+        unsigned int slot = step % PANEL_SLOTS;
+
+        if(node->comm_status == 0)
+        {
+            TRACED_SEM_WAIT(&node->slots_free[slot]);
+
+            if(exchangePanels(node, step, node->panels_A[slot], node->panels_B[slot]) < 0)
+                node->comm_status = -1;
+        }
+
+        TRACED_SEM_POST(&node->panels_ready[slot]);
+    }
+
+    return NULL;
+}
+
+static int runSteps(SUMMA_NODE* node, SUMMA_NODE_STATS* stats)
+{
+    const SUMMA_GRID* grid = node->grid;
+    pthread_t comm_thread;
+
+    if(grid->overlap && checkThreadCreationStatus( TRACED_THREAD_CREATE(&comm_thread, NULL, communicationRoutine, node) ) < 0)
+        return -1;
+
+    int status = 0;
+
+    for(unsigned int step = 0; step < grid->grid_dim && status == 0; step++)
+    {
+        unsigned int slot = (grid->overlap ? step % PANEL_SLOTS : 0);
+        unsigned long long wait_start_ns = latencyHistogramGetTimeNs();
+
+        if(grid->overlap)
+        {
+            TRACED_SEM_WAIT(&node->panels_ready[slot]);
+            status = node->comm_status;
+        }
+        else
+            status = exchangePanels(node, step, node->panels_A[slot], node->panels_B[slot]);
+
+        unsigned long long compute_start_ns = latencyHistogramGetTimeNs();
+
+        stats->wait_ns += compute_start_ns - wait_start_ns;
+
+        if(status < 0)
+            break;
+
+        multiplyAddBlock(node->panels_A[slot], node->panels_B[slot], node->block_C, grid->block_dim);
+        stats->compute_ns += latencyHistogramGetTimeNs() - compute_start_ns;
+
+        if(grid->overlap)
+            TRACED_SEM_POST(&node->slots_free[slot]);
+    }
+
+    // The main thread only stops early once the communication thread failed, which then goes through every step without waiting.
+    if(grid->overlap)
+        pthread_join(comm_thread, NULL);
+
+    return status;
+}
+
+// Run by every node process: scatters its blocks in, runs every step and gathers its block of C out. Returns the exit status.
+static int runNode(const SUMMA_GRID* grid, unsigned int node_idx)
+{
+    SUMMA_NODE node;
+    size_t block_elements = (size_t)grid->block_dim * grid->block_dim;
+    int status = EXIT_FAILURE;
+
+    memset(&node, 0, sizeof(node));
+
+    node.grid       = grid                          ;
+    node.node_idx   = node_idx                      ;
+    node.row        = node_idx / grid->grid_dim     ;
+    node.col        = node_idx % grid->grid_dim     ;
+    node.block_A    = (int*)malloc(block_elements * sizeof(int));
+    node.block_B    = (int*)malloc(block_elements * sizeof(int));
+    node.block_C    = (int*)calloc(block_elements, sizeof(int));
+
+    int allocated = (node.block_A != NULL && node.block_B != NULL && node.block_C != NULL);
+
+    for(unsigned int slot = 0; slot < PANEL_SLOTS; slot++)
+    {
+        node.panels_A[slot] = (int*)malloc(block_elements * sizeof(int));
+        node.panels_B[slot] = (int*)malloc(block_elements * sizeof(int));
+
+        allocated = allocated && node.panels_A[slot] != NULL && node.panels_B[slot] != NULL;
+
+        sem_init(&node.panels_ready[slot], 0, 0);
+        sem_init(&node.slots_free[slot], 0, 1);
+    }
+
+    if(allocated)
+    {
+        size_t first_element = (size_t)node.row * grid->block_dim * grid->dim + (size_t)node.col * grid->block_dim;
+        size_t row_size = grid->block_dim * sizeof(int);
+
+        for(unsigned int row = 0; row < grid->block_dim; row++)
+        {
+            size_t block_offset = (size_t)row * grid->block_dim;
+            size_t mat_offset = first_element + (size_t)row * grid->dim;
+
+            memcpy(&node.block_A[block_offset], &grid->mat_A[mat_offset], row_size);
+            memcpy(&node.block_B[block_offset], &grid->mat_B[mat_offset], row_size);
+        }
+
+        if(runSteps(&node, &grid->stats[node_idx]) == 0)
+        {
+            for(unsigned int row = 0; row < grid->block_dim; row++)
+                memcpy(&grid->mat_C[first_element + (size_t)row * grid->dim], &node.block_C[row * grid->block_dim], row_size);
+
+            status = EXIT_SUCCESS;
+        }
+    }
+
+    for(unsigned int slot = 0; slot < PANEL_SLOTS; slot++)
+    {
+        sem_destroy(&node.slots_free[slot]);
+        sem_destroy(&node.panels_ready[slot]);
+        free(node.panels_B[slot]);
+        free(node.panels_A[slot]);
+    }
+
+    free(node.block_C);
+    free(node.block_B);
+    free(node.block_A);
+
+    return status;
+}
+
+// Only nodes sharing a row or a column ever talk to each other, so only those get a socket.
+static int openSockets(SUMMA_GRID* grid)
+{
+    unsigned int nodes_num = grid->grid_dim * grid->grid_dim;
+
+    for(unsigned int node_a = 0; node_a < MAX_NODES; node_a++)
+        for(unsigned int node_b = 0; node_b < MAX_NODES; node_b++)
+            grid->sockets[node_a][node_b] = -1;
+
+    for(unsigned int node_a = 0; node_a < nodes_num; node_a++)
+    {
+        for(unsigned int node_b = node_a + 1; node_b < nodes_num; node_b++)
+        {
+            int pair[2];
+
+            if(node_a / grid->grid_dim != node_b / grid->grid_dim && node_a % grid->grid_dim != node_b % grid->grid_dim)
+                continue;
+
+            if(socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0)
+            {
+                closeSockets(grid, -1);
+                return -1;
+            }
+
+            grid->sockets[node_a][node_b] = pair[0];
+            grid->sockets[node_b][node_a] = pair[1];
+        }
+    }
+
+    return 0;
+}
+
+// Closes every socket end but the ones belonging to "keep_node_idx" (none if negative). Nodes have to close their copies of other
+// nodes' ends, or they would never find out about a peer which is gone.
+static void closeSockets(SUMMA_GRID* grid, int keep_node_idx)
+{
+    for(unsigned int node_a = 0; node_a < MAX_NODES; node_a++)
+    {
+        if((int)node_a == keep_node_idx)
+            continue;
+
+        for(unsigned int node_b = 0; node_b < MAX_NODES; node_b++)
+        {
+            if(grid->sockets[node_a][node_b] >= 0)
+                close(grid->sockets[node_a][node_b]);
+
+            grid->sockets[node_a][node_b] = -1;
+        }
+    }
+}
+
+static pid_t forkNode()
+{
+    fflush(stdout);
+    fflush(stderr);
+
+    return fork();
+}
+
+// Returns 1 if the grid got the expected result, 0 if it did not, -1 if it could not be run.
+static int runGrid(SUMMA_GRID* grid, const int* mat_expected, unsigned long long* elapsed_ns)
+{
+    unsigned int nodes_num = grid->grid_dim * grid->grid_dim;
+    pid_t nodes[MAX_NODES];
+    unsigned int forked_num = 0;
+
+    if(openSockets(grid) < 0)
+        return -1;
+
+    memset(grid->mat_C, 0, (size_t)grid->dim * grid->dim * sizeof(int));
+    memset(grid->stats, 0, nodes_num * sizeof(SUMMA_NODE_STATS));
+
+    unsigned long long start_ns = latencyHistogramGetTimeNs();
+
+    for(; forked_num < nodes_num; forked_num++)
+    {
+        nodes[forked_num] = forkNode();
+
+        if(nodes[forked_num] < 0)
+            break;
+
+        if(nodes[forked_num] == 0)
+        {
+            closeSockets(grid, (int)forked_num);
+            _exit(runNode(grid, forked_num));
+        }
+    }
+
+    // Nodes which could not be forked leave their peers' sockets closed, so those fail instead of waiting for them.
+    closeSockets(grid, -1);
+
+    int failed = (forked_num < nodes_num);
+
+    for(unsigned int node_idx = 0; node_idx < forked_num; node_idx++)
+    {
+        int status;
+
+        if(waitpid(nodes[node_idx], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+            failed = 1;
+    }
+
+    *elapsed_ns = latencyHistogramGetTimeNs() - start_ns;
+
+    if(failed)
+        return -1;
+
+    return (memcmp(grid->mat_C, mat_expected, (size_t)grid->dim * grid->dim * sizeof(int)) == 0);
+}
+
+void exampleDistributedMatrixMultiplication()
+{
+    srand(time(NULL));
+
+    // Matrices are square. Their dimension and the largest number of nodes can be given as lesson parameters (see
+    // LessonParameters.c).
+    unsigned int dim = (unsigned int)getLessonParameter(LESSON_PARAM_MAT_DIM, DEFAULT_MAT_DIM);
+    unsigned int max_nodes = (unsigned int)getLessonParameter(LESSON_PARAM_THREADS, DEFAULT_MAX_NODES);
+
+    dim = (dim < DIM_MULTIPLE ? DIM_MULTIPLE : (dim + DIM_MULTIPLE - 1) / DIM_MULTIPLE * DIM_MULTIPLE);
+
+    size_t mat_size = (size_t)dim * dim * sizeof(int);
+    size_t shared_size = 3 * mat_size + MAX_NODES * sizeof(SUMMA_NODE_STATS);
+
+    // Matrices A, B and C, then the nodes' statistics, all of them in memory shared with the node processes.
+    unsigned char* shared = (unsigned char*)mmap(NULL, shared_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    int* mat_expected = (int*)calloc((size_t)dim * dim, sizeof(int));
+
+    if(shared == MAP_FAILED || mat_expected == NULL)
+    {
+        printf("%sCould not allocate matrices, so the procedure cannot go on.%s\r\n", PRINT_COLOR_RED, PRINT_COLOR_RESET);
+
+        if(shared != MAP_FAILED)
+            munmap(shared, shared_size);
+
+        free(mat_expected);
+        return;
+    }
+
+    SUMMA_GRID grid;
+
+    memset(&grid, 0, sizeof(grid));
+
+    grid.mat_A  = (const int*)shared                                ;
+    grid.mat_B  = (const int*)(shared + mat_size)                   ;
+    grid.mat_C  = (int*)(shared + 2 * mat_size)                     ;
+    grid.stats  = (SUMMA_NODE_STATS*)(shared + 3 * mat_size)        ;
+    grid.dim    = dim                                               ;
+
+    for(size_t element_idx = 0; element_idx < 2 * (size_t)dim * dim; element_idx++)
+        ((int*)shared)[element_idx] = rand() % (MAX_MAT_VAL - MIN_MAT_VAL + 1) + MIN_MAT_VAL;
+
+    unsigned long long serial_start_ns = latencyHistogramGetTimeNs();
+
+    multiplyAddBlock(grid.mat_A, grid.mat_B, mat_expected, dim);
+
+    unsigned long long serial_ns = latencyHistogramGetTimeNs() - serial_start_ns;
+
+    printf("%sMultiplying two %ux%u matrices with SUMMA. A serial multiplication takes %.1f ms. Speedup is relative to a single "
+            "node, waiting is the share of the nodes' time spent waiting for panels.%s\r\n",
+            PRINT_COLOR_GREEN           ,
+            dim                         ,
+            dim                         ,
+            (double)serial_ns / 1e6     ,
+            PRINT_COLOR_RESET           );
+
+    printf("Nodes\tGrid\tOverlap\t  Time (ms)\tSpeedup\tEfficiency\tWaiting\tResult\r\n");
+
+    unsigned long long single_node_ns = 0;
+    int failed = 0;
+
+    if(max_nodes < 1)
+        max_nodes = 1;
+
+    // The first run faults in the shared matrices and warms up the caches, which would make the single node baseline slower than
+    // it really is (and the efficiency of larger grids over 100%). So one single node run is done first, and not timed.
+    unsigned long long warm_up_ns = 0;
+
+    grid.grid_dim   = 1     ;
+    grid.block_dim  = dim   ;
+    grid.overlap    = 0     ;
+
+    if(runGrid(&grid, mat_expected, &warm_up_ns) < 0)
+    {
+        printf("%sCould not run a grid of 1 node(s), so the procedure cannot go on.%s\r\n", PRINT_COLOR_RED, PRINT_COLOR_RESET);
+        failed = 1;
+    }
+
+    for(unsigned int grid_dim = 1; grid_dim <= MAX_GRID_DIM && grid_dim * grid_dim <= max_nodes && !failed; grid_dim++)
+    {
+        for(int overlap = 0; overlap <= 1 && !failed; overlap++)
+        {
+            unsigned int nodes_num = grid_dim * grid_dim;
+            unsigned long long elapsed_ns = 0;
+
+            grid.grid_dim   = grid_dim          ;
+            grid.block_dim  = dim / grid_dim    ;
+            grid.overlap    = overlap           ;
+
+            int result = runGrid(&grid, mat_expected, &elapsed_ns);
+
+            if(result < 0)
+            {
+                printf("%sCould not run a grid of %u node(s), so the procedure cannot go on.%s\r\n",
+                        PRINT_COLOR_RED     ,
+                        nodes_num           ,
+                        PRINT_COLOR_RESET   );
+                failed = 1;
+                continue;
+            }
+
+            if(single_node_ns == 0)
+                single_node_ns = elapsed_ns;
+
+            unsigned long long nodes_wait_ns = 0;
+            unsigned long long nodes_busy_ns = 0;
+
+            for(unsigned int node_idx = 0; node_idx < nodes_num; node_idx++)
+            {
+                nodes_wait_ns += grid.stats[node_idx].wait_ns;
+                nodes_busy_ns += grid.stats[node_idx].wait_ns + grid.stats[node_idx].compute_ns;
+            }
+
+            double speedup = (double)single_node_ns / (double)(elapsed_ns > 0 ? elapsed_ns : 1);
+
+            printf("%s%u\t%ux%u\t%s\t%11.1f\t%7.2f\t%9.1f%%\t%6.1f%%\t%s%s\r\n",
+                    (result ? "" : PRINT_COLOR_RED)                                                     ,
+                    nodes_num                                                                           ,
+                    grid_dim                                                                            ,
+                    grid_dim                                                                            ,
+                    (overlap ? "yes" : "no")                                                            ,
+                    (double)elapsed_ns / 1e6                                                            ,
+                    speedup                                                                             ,
+                    100.0 * speedup / nodes_num                                                         ,
+                    (nodes_busy_ns > 0 ? 100.0 * (double)nodes_wait_ns / (double)nodes_busy_ns : 0.0)   ,
+                    (result ? "OK" : "Wrong result!")                                                   ,
+                    (result ? "" : PRINT_COLOR_RESET)                                                   );
+        }
+    }
+
+    free(mat_expected);
+    munmap(shared, shared_size);
+}
+
+/**************************************/
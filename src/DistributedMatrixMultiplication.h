@@ -0,0 +1,10 @@
+#ifndef DISTRIBUTED_MATRIX_MULTIPLICATION_H
+#define DISTRIBUTED_MATRIX_MULTIPLICATION_H
+
+/********* Function prototypes ********/
+
+void exampleDistributedMatrixMultiplication();
+
+/**************************************/
+
+#endif
@@ -0,0 +1,504 @@
+/*
+ThreadsWithSemaphores.c limits how many threads "handle connections" at once with a counting semaphore, connections being just a
+sleep. This is a real server doing so, on a loopback TCP port or a UNIX socket:
+
+EPOLL_SERVER* epollServerCreate(const char* address, unsigned int reactors_num, unsigned int workers_num, unsigned int admission_limit, EPOLL_SERVER_HANDLER handler, void* handler_arg)
+
+Where:
+    ·address: the path of a UNIX socket (anything containing a '/') or a TCP port, bound to the loopback interface only (see
+    LocalSockets.c). Port "0" takes any free port, as told afterwards by epollServerGetPort.
+    ·reactors_num: threads waiting for connections and requests (up to EPOLL_SERVER_MAX_REACTORS).
+    ·workers_num: workers of the thread pool requests are handled by (see ThreadPool.c).
+    ·admission_limit: most requests being handled at once, or EPOLL_SERVER_NO_ADMISSION_LIMIT.
+    ·handler, handler_arg: called by workers as handler(request, request_size, response, response_capacity, handler_arg) for every
+    request, a request being a line of text, and so is the response.
+
+A thread per connection would spend most of its time blocked on reading the next request, and thousands of connections would take
+thousands of threads. Instead, a few reactor threads wait for whichever connection has something to read, all at once, through
+epoll: every reactor has an epoll instance, watching the listening socket and every connection the reactor accepted. Connections
+are added with EPOLLONESHOT, so that once a connection has something to read, it is reported once and then disabled until it is
+enabled again (rearmed). This way, a single thread at a time owns a connection: the reactor reads the request, and hands it to a
+worker, which handles it, writes the response and rearms the connection. The listening socket is watched by every reactor with
+EPOLLEXCLUSIVE, so that a new connection wakes a single reactor up rather than all of them.
+
+Sockets are non-blocking, so that reading never blocks a reactor, which would hold every other connection of the reactor back.
+Handlers, on the other hand, may block (on a database, for instance) as long as they like, since they run on workers.
+
+Workers take requests from the pool's queues, which have no limit: past the throughput the server can keep up with, requests keep
+piling up, and so does their latency, for every client. Admission control caps the requests in flight (queued or being handled)
+with a counting semaphore, as ThreadsWithSemaphores.c does: reactors take a slot for every request (sem_trywait), and workers give
+it back once the response is sent. A reactor never waits for a slot, since it would stop reading every connection it owns, so
+requests coming with every slot taken are answered EPOLL_SERVER_BUSY_RESPONSE right away instead (load shedding). Clients get a
+quick answer they can retry later, and the ones admitted get served with a bounded latency.
+*/
+
+/********* Include statements *********/
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "ThreadCreationStatus.h"
+#include "ThreadTracer.h"
+#include "ThreadPool.h"
+#include "LocalSockets.h"
+#include "EpollServer.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define MAX_EVENTS          64      // Events taken from epoll at once.
+#define SEND_TIMEOUT_MS     1000    // How long a response waits for a client which does not read.
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+typedef struct EPOLL_SERVER_CONNECTION EPOLL_SERVER_CONNECTION;
+
+typedef struct
+{
+    EPOLL_SERVER*   server      ;
+    int             epoll_fd    ;
+    pthread_t       thread      ;
+} EPOLL_SERVER_REACTOR;
+
+// Owned by a single thread at a time: the reactor until a request is handed to a worker, and that worker until it rearms it.
+struct EPOLL_SERVER_CONNECTION
+{
+    EPOLL_SERVER*               server                                  ;
+    int                         fd                                      ;
+    int                         epoll_fd                                ;   // The one of the reactor which accepted it.
+    char                        request[EPOLL_SERVER_MAX_REQUEST]       ;   // Bytes read and not handled yet.
+    size_t                      request_size                            ;
+    size_t                      line_size                               ;   // Size of the request being handled, without its newline.
+    char                        response[EPOLL_SERVER_MAX_RESPONSE]     ;
+    EPOLL_SERVER_CONNECTION*    previous                                ;
+    EPOLL_SERVER_CONNECTION*    next                                    ;
+};
+
+struct EPOLL_SERVER
+{
+    int                         listen_fd                               ;
+    int                         stop_fd                                 ;   // An eventfd, readable once reactors have to stop.
+    int                         tcp                                     ;
+    char                        unix_path[sizeof(struct sockaddr_un)]   ;   // Removed once the server is destroyed.
+    EPOLL_SERVER_REACTOR        reactors[EPOLL_SERVER_MAX_REACTORS]     ;
+    unsigned int                reactors_num                            ;   // Reactors running.
+    THREAD_POOL*                pool                                    ;
+    EPOLL_SERVER_HANDLER        handler                                 ;
+    void*                       handler_arg                             ;
+    unsigned int                admission_limit                         ;
+    sem_t                       admission                               ;   // A slot per request which may be in flight.
+    pthread_mutex_t             connections_lock                        ;
+    EPOLL_SERVER_CONNECTION*    connections                             ;   // Every open connection, closed along with the server.
+    atomic_ullong               accepted                                ;
+    atomic_ullong               served                                  ;
+    atomic_ullong               rejected                                ;
+    atomic_uint                 in_flight                               ;
+    atomic_uint                 peak_in_flight                          ;
+};
+
+/**************************************/
+
+/********* Private variables **********/
+
+// Told apart from connections by their address only, as epoll events of the listening socket and the stop eventfd carry them.
+static char listen_marker;
+static char stop_marker;
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static int      rearmConnection(EPOLL_SERVER_CONNECTION* connection);
+static void     closeConnection(EPOLL_SERVER_CONNECTION* connection);
+static void     consumeRequest(EPOLL_SERVER_CONNECTION* connection);
+static void     dispatchRequests(EPOLL_SERVER_CONNECTION* connection);
+static void     handleRequest(void* arg);
+static void     acceptConnections(EPOLL_SERVER_REACTOR* reactor);
+static void     readRequests(EPOLL_SERVER_CONNECTION* connection);
+static void*    reactorRoutine(void* arg);
+
+/**************************************/
+
+/******** Function definitions ********/
+
+// Hands the connection back to its reactor. It must not be touched afterwards, since the reactor may be reading it already.
+static int rearmConnection(EPOLL_SERVER_CONNECTION* connection)
+{
+    struct epoll_event event = { .events = EPOLLIN | EPOLLONESHOT, .data.ptr = connection };
+
+    return epoll_ctl(connection->epoll_fd, EPOLL_CTL_MOD, connection->fd, &event);
+}
+
+// Closing the socket removes it from its reactor's epoll instance as well.
+static void closeConnection(EPOLL_SERVER_CONNECTION* connection)
+{
+    EPOLL_SERVER* server = connection->server;
+
+    TRACED_MUTEX_LOCK(&server->connections_lock);
+
+    if(connection->previous != NULL)
+        connection->previous->next = connection->next;
+    else
+        server->connections = connection->next;
+
+    if(connection->next != NULL)
+        connection->next->previous = connection->previous;
+
+    TRACED_MUTEX_UNLOCK(&server->connections_lock);
+
+    close(connection->fd);
+    free(connection);
+}
+
+// Drops the request which has just been answered, keeping whatever was read after it.
+static void consumeRequest(EPOLL_SERVER_CONNECTION* connection)
+{
+    size_t consumed = connection->line_size + 1;
+
+    memmove(connection->request, connection->request + consumed, connection->request_size - consumed);
+    connection->request_size -= consumed;
+}
+
+// Hands the first complete request read to a worker if a slot is free, or turns it away otherwise. Once no complete request is
+// left, the connection is rearmed, so that its reactor reads the next one.
+static void dispatchRequests(EPOLL_SERVER_CONNECTION* connection)
+{
+    EPOLL_SERVER* server = connection->server;
+
+    for(;;)
+    {
+        char* end = (char*)memchr(connection->request, '\n', connection->request_size);
+
+        if(end == NULL)
+        {
+            // A request too long to fit is a broken client.
+            if(connection->request_size == sizeof(connection->request) || rearmConnection(connection) < 0)
+                closeConnection(connection);
+
+            return;
+        }
+
+        connection->line_size = (size_t)(end - connection->request);
+
+        if(server->admission_limit != EPOLL_SERVER_NO_ADMISSION_LIMIT && sem_trywait(&server->admission) != 0)
+        {
+            atomic_fetch_add_explicit(&server->rejected, 1, memory_order_relaxed);
+
+            if(localSocketSendAll(connection->fd, EPOLL_SERVER_BUSY_RESPONSE "\n", sizeof(EPOLL_SERVER_BUSY_RESPONSE), SEND_TIMEOUT_MS) < 0)
+            {
+                closeConnection(connection);
+                return;
+            }
+
+            consumeRequest(connection);
+            continue;
+        }
+
+        unsigned int in_flight = atomic_fetch_add(&server->in_flight, 1) + 1;
+        unsigned int peak_in_flight = atomic_load(&server->peak_in_flight);
+
+        while(in_flight > peak_in_flight && !atomic_compare_exchange_weak(&server->peak_in_flight, &peak_in_flight, in_flight));
+
+        if(threadPoolSubmit(server->pool, handleRequest, connection, THREAD_POOL_NO_HINT) < 0)
+            handleRequest(connection);
+
+        return;
+    }
+}
+
+// Run by workers. The admission slot is given back once the response has been sent, whether it could be or not.
+static void handleRequest(void* arg)
+{
+    EPOLL_SERVER_CONNECTION* connection = (EPOLL_SERVER_CONNECTION*)arg;
+    EPOLL_SERVER* server = connection->server;
+
+    size_t response_size = server->handler(connection->request, connection->line_size, connection->response, sizeof(connection->response) - 1, server->handler_arg);
+
+    if(response_size > sizeof(connection->response) - 1)
+        response_size = sizeof(connection->response) - 1;
+
+    connection->response[response_size++] = '\n';
+
+    int send_status = localSocketSendAll(connection->fd, connection->response, response_size, SEND_TIMEOUT_MS);
+
+    atomic_fetch_add_explicit(&server->served, 1, memory_order_relaxed);
+    atomic_fetch_sub(&server->in_flight, 1);
+
+    if(server->admission_limit != EPOLL_SERVER_NO_ADMISSION_LIMIT)
+        TRACED_SEM_POST(&server->admission);
+
+    if(send_status < 0)
+    {
+        closeConnection(connection);
+        return;
+    }
+
+    consumeRequest(connection);
+    dispatchRequests(connection);
+}
+
+// Accepts every pending connection. Other reactors may have taken some of them already, in which case accept4 just fails with
+// EAGAIN.
+static void acceptConnections(EPOLL_SERVER_REACTOR* reactor)
+{
+    EPOLL_SERVER* server = reactor->server;
+
+    for(;;)
+    {
+        int fd = accept4(server->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+        if(fd < 0)
+        {
+            if(errno == EINTR)
+                continue;
+
+            return;
+        }
+
+        // Responses are small and clients wait for each of them before sending the next request, so they are sent right away
+        // rather than held back in case more data comes (Nagle's algorithm).
+        if(server->tcp)
+        {
+            int no_delay = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+        }
+
+        EPOLL_SERVER_CONNECTION* connection = (EPOLL_SERVER_CONNECTION*)calloc(1, sizeof(EPOLL_SERVER_CONNECTION));
+
+        if(connection == NULL)
+        {
+            close(fd);
+            continue;
+        }
+
+        connection->server      = server            ;
+        connection->fd          = fd                ;
+        connection->epoll_fd    = reactor->epoll_fd ;
+
+        TRACED_MUTEX_LOCK(&server->connections_lock);
+
+        connection->next = server->connections;
+
+        if(server->connections != NULL)
+            server->connections->previous = connection;
+
+        server->connections = connection;
+
+        TRACED_MUTEX_UNLOCK(&server->connections_lock);
+
+        struct epoll_event event = { .events = EPOLLIN | EPOLLONESHOT, .data.ptr = connection };
+
+        if(epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+        {
+            closeConnection(connection);
+            continue;
+        }
+
+        atomic_fetch_add_explicit(&server->accepted, 1, memory_order_relaxed);
+    }
+}
+
+// Reads whatever the connection has, then dispatches the requests it completes. A connection closed by its client (or failing)
+// is closed as well.
+static void readRequests(EPOLL_SERVER_CONNECTION* connection)
+{
+    while(connection->request_size < sizeof(connection->request))
+    {
+        ssize_t received = recv(connection->fd, connection->request + connection->request_size, sizeof(connection->request) - connection->request_size, 0);
+
+        if(received > 0)
+        {
+            connection->request_size += (size_t)received;
+            continue;
+        }
+
+        if(received < 0 && errno == EINTR)
+            continue;
+
+        if(received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+
+        closeConnection(connection);
+        return;
+    }
+
+    dispatchRequests(connection);
+}
+
+static void* reactorRoutine(void* arg)
+{
+    EPOLL_SERVER_REACTOR* reactor = (EPOLL_SERVER_REACTOR*)arg;
+    struct epoll_event events[MAX_EVENTS];
+
+    for(;;)
+    {
+        int events_num = epoll_wait(reactor->epoll_fd, events, MAX_EVENTS, -1);
+
+        if(events_num < 0)
+        {
+            if(errno == EINTR)
+                continue;
+
+            return NULL;
+        }
+
+        for(int event_idx = 0; event_idx < events_num; event_idx++)
+        {
+            void* source = events[event_idx].data.ptr;
+
+            // Connections reported along with the stop event are left as they are: the server closes every connection anyway.
+            if(source == &stop_marker)
+                return NULL;
+
+            if(source == &listen_marker)
+                acceptConnections(reactor);
+            else
+                readRequests((EPOLL_SERVER_CONNECTION*)source);
+        }
+    }
+}
+
+EPOLL_SERVER* epollServerCreate(const char* address, unsigned int reactors_num, unsigned int workers_num, unsigned int admission_limit, EPOLL_SERVER_HANDLER handler, void* handler_arg)
+{
+    if(address == NULL || handler == NULL)
+        return NULL;
+
+    EPOLL_SERVER* server = (EPOLL_SERVER*)calloc(1, sizeof(EPOLL_SERVER));
+
+    if(server == NULL)
+        return NULL;
+
+    pthread_mutex_init(&server->connections_lock, NULL);
+    sem_init(&server->admission, 0, admission_limit);
+
+    server->handler         = handler                                   ;
+    server->handler_arg     = handler_arg                               ;
+    server->admission_limit = admission_limit                           ;
+    server->tcp             = !localSocketIsUnixAddress(address)        ;
+    server->listen_fd       = localSocketListen(address, SOCK_NONBLOCK) ;
+    server->stop_fd         = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)    ;
+    server->pool            = threadPoolCreate(workers_num)             ;
+
+    if(!server->tcp && server->listen_fd >= 0)
+        strcpy(server->unix_path, address);
+
+    if(server->listen_fd < 0 || server->stop_fd < 0 || server->pool == NULL)
+    {
+        epollServerDestroy(server);
+        return NULL;
+    }
+
+    if(reactors_num < 1)
+        reactors_num = 1;
+
+    if(reactors_num > EPOLL_SERVER_MAX_REACTORS)
+        reactors_num = EPOLL_SERVER_MAX_REACTORS;
+
+    for(unsigned int reactor_idx = 0; reactor_idx < reactors_num; reactor_idx++)
+    {
+        EPOLL_SERVER_REACTOR* reactor = &server->reactors[reactor_idx];
+        struct epoll_event listen_event = { .events = EPOLLIN | EPOLLEXCLUSIVE, .data.ptr = &listen_marker };
+        struct epoll_event stop_event = { .events = EPOLLIN, .data.ptr = &stop_marker };
+
+        reactor->server     = server                        ;
+        reactor->epoll_fd   = epoll_create1(EPOLL_CLOEXEC)  ;
+
+        if( reactor->epoll_fd < 0                                                                   ||
+            epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, server->listen_fd, &listen_event) < 0       ||
+            epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, server->stop_fd, &stop_event) < 0           ||
+            checkThreadCreationStatus( TRACED_THREAD_CREATE(&reactor->thread, NULL, reactorRoutine, reactor) ))
+        {
+            if(reactor->epoll_fd >= 0)
+                close(reactor->epoll_fd);
+
+            break;
+        }
+
+        server->reactors_num++;
+    }
+
+    if(server->reactors_num == 0)
+    {
+        epollServerDestroy(server);
+        return NULL;
+    }
+
+    return server;
+}
+
+// Reactors are stopped first, so that no request comes in anymore, then workers finish the requests they were handed (rearming
+// their connections, which nobody reads anymore), and finally every connection is closed.
+void epollServerDestroy(EPOLL_SERVER* server)
+{
+    if(server == NULL)
+        return;
+
+    if(server->stop_fd >= 0)
+        eventfd_write(server->stop_fd, 1);
+
+    for(unsigned int reactor_idx = 0; reactor_idx < server->reactors_num; reactor_idx++)
+        pthread_join(server->reactors[reactor_idx].thread, NULL);
+
+    if(server->pool != NULL)
+    {
+        threadPoolWait(server->pool);
+        threadPoolDestroy(server->pool);
+    }
+
+    for(unsigned int reactor_idx = 0; reactor_idx < server->reactors_num; reactor_idx++)
+        close(server->reactors[reactor_idx].epoll_fd);
+
+    while(server->connections != NULL)
+        closeConnection(server->connections);
+
+    if(server->listen_fd >= 0)
+        close(server->listen_fd);
+
+    if(server->unix_path[0] != 0)
+        unlink(server->unix_path);
+
+    if(server->stop_fd >= 0)
+        close(server->stop_fd);
+
+    sem_destroy(&server->admission);
+    pthread_mutex_destroy(&server->connections_lock);
+    free(server);
+}
+
+// Returns the TCP port the server listens on, or -1 if it listens on a UNIX socket.
+int epollServerGetPort(const EPOLL_SERVER* server)
+{
+    struct sockaddr_in address;
+    socklen_t address_size = sizeof(address);
+
+    if(!server->tcp || getsockname(server->listen_fd, (struct sockaddr*)&address, &address_size) < 0)
+        return -1;
+
+    return ntohs(address.sin_port);
+}
+
+void epollServerGetStats(EPOLL_SERVER* server, EPOLL_SERVER_STATS* stats)
+{
+    stats->accepted         = atomic_load(&server->accepted)        ;
+    stats->served           = atomic_load(&server->served)          ;
+    stats->rejected         = atomic_load(&server->rejected)        ;
+    stats->peak_in_flight   = atomic_load(&server->peak_in_flight)  ;
+}
+
+/**************************************/
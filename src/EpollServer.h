@@ -0,0 +1,46 @@
+#ifndef EPOLL_SERVER_H
+#define EPOLL_SERVER_H
+
+/********* Include statements *********/
+
+#include <stddef.h>
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define EPOLL_SERVER_MAX_REQUEST        256     // Bytes per request, the ending newline included.
+#define EPOLL_SERVER_MAX_RESPONSE       256     // Bytes per response, the ending newline included.
+#define EPOLL_SERVER_MAX_REACTORS       8
+#define EPOLL_SERVER_NO_ADMISSION_LIMIT 0
+#define EPOLL_SERVER_BUSY_RESPONSE      "BUSY"  // Sent back for requests turned away by admission control.
+
+/**************************************/
+
+/********** Type definitions **********/
+
+// Fills "response" (without any newline, which the server adds) for a request (without its newline) and returns its size.
+typedef size_t (*EPOLL_SERVER_HANDLER)(const char* request, size_t request_size, char* response, size_t response_capacity, void* arg);
+
+typedef struct
+{
+    unsigned long long  accepted        ;   // Connections accepted.
+    unsigned long long  served          ;   // Requests handled by workers.
+    unsigned long long  rejected        ;   // Requests turned away, as the admission limit had been reached.
+    unsigned int        peak_in_flight  ;   // Most requests admitted and not yet served at once.
+} EPOLL_SERVER_STATS;
+
+typedef struct EPOLL_SERVER EPOLL_SERVER;
+
+/**************************************/
+
+/********* Function prototypes ********/
+
+EPOLL_SERVER*   epollServerCreate(const char* address, unsigned int reactors_num, unsigned int workers_num, unsigned int admission_limit, EPOLL_SERVER_HANDLER handler, void* handler_arg);
+void            epollServerDestroy(EPOLL_SERVER* server);
+int             epollServerGetPort(const EPOLL_SERVER* server);
+void            epollServerGetStats(EPOLL_SERVER* server, EPOLL_SERVER_STATS* stats);
+
+/**************************************/
+
+#endif
@@ -0,0 +1,432 @@
+/*
+The counting semaphore in ThreadsWithSemaphores.c lets a few threads at a time "handle a connection", by sleeping. This lesson
+runs a real server instead (see EpollServer.c): reactor threads wait on epoll for connections and requests, hand requests to the
+workers of a thread pool, and admit a limited number of requests at once through a counting semaphore. Requests answered while
+every slot is taken get a "BUSY" response right away.
+
+The server is loaded by a load generator built into the lesson: every client is a thread with a connection of its own, sending a
+request, waiting for its response, and sending the next one right away (a closed loop), or after a short backoff if the request
+was rejected. Handling a request takes some computation (hashing the request over and over) and then a wait for a backend, such as
+a database, which takes no CPU. Clients are run 1, 4, 16 and 64 at once, against the server listening on a loopback TCP port and
+on a UNIX socket, with and without admission control. Every run prints:
+    ·Throughput: requests served per second.
+    ·Latency: time from sending a request until its response comes, as its median and 99th percentile, for served requests.
+    ·Rejected: share of the requests turned away by admission control.
+
+With few clients, the server keeps up and the limit is never reached. Once clients outnumber what workers can serve, requests
+queue up for workers: without admission control, latency grows with every client added, while with it, requests past the limit are
+turned away at once, and the ones admitted keep being served about as fast as the workers allow.
+
+Workers are the "threads" lesson parameter, and admission slots are twice as many. Every run sends the "iterations" lesson
+parameter requests, split among its clients. Every response carries its request back, so that responses mixed up between
+connections would be told apart.
+*/
+
+/********* Include statements *********/
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "ThreadColors.h"
+#include "ThreadCreationStatus.h"
+#include "ThreadTracer.h"
+#include "EpollServer.h"
+#include "LatencyHistogram.h"
+#include "LessonParameters.h"
+#include "EpollServerBenchmark.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+// Default values, which can be overridden through lesson parameters (see LessonParameters.c).
+#define DEFAULT_REQUESTS_PER_RUN    10000
+#define DEFAULT_WORKERS             4
+
+#define REACTORS_NUM                2
+#define MAX_CLIENTS                 64
+#define ADMISSION_SLOTS_PER_WORKER  2
+#define HANDLER_ROUNDS              64      // Times every request is hashed over by the handler.
+#define BACKEND_WAIT_US             100     // How long every request waits for the (pretended) backend.
+#define REJECTED_BACKOFF_US         500     // How long clients wait before sending another request after a rejected one.
+#define UNIX_SOCKET_PATH_FORMAT     "/tmp/threads-tutorial-server-%d.sock"
+#define FNV_OFFSET_BASIS            14695981039346656037ULL
+#define FNV_PRIME                   1099511628211ULL
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+typedef struct
+{
+    struct sockaddr_storage address         ;
+    socklen_t               address_size    ;
+} LOAD_TARGET;
+
+typedef struct
+{
+    const LOAD_TARGET*  target          ;
+    atomic_int*         start           ;   // Set once every client has been created, so that they all start at once.
+    unsigned int        client_idx      ;
+    unsigned long       requests_num    ;
+    unsigned long long  served          ;
+    unsigned long long  rejected        ;
+    unsigned long long  failed          ;   // Requests lost to a broken connection, or answered with someone else's response.
+    LATENCY_HISTOGRAM*  latencies       ;
+} LOAD_CLIENT_DATA;
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static size_t   handleLoadRequest(const char* request, size_t request_size, char* response, size_t response_capacity, void* arg);
+static int      connectToServer(const LOAD_TARGET* target);
+static int      sendRequest(int fd, const char* request, size_t request_size);
+static ssize_t  receiveResponse(int fd, char* response, size_t response_capacity);
+static void*    loadClientRoutine(void* arg);
+static int      runLoad(const LOAD_TARGET* target, const char* server_name, const char* admission_name, unsigned int clients_num, unsigned long requests_num);
+static int      runServer(const char* server_name, const char* address, unsigned int workers_num, unsigned int admission_limit, unsigned long requests_num);
+
+/**************************************/
+
+/********* Private variables **********/
+
+static const unsigned int clients_levels[] = { 1, 4, 16, MAX_CLIENTS };
+
+static LATENCY_HISTOGRAM client_latencies[MAX_CLIENTS];
+static LATENCY_HISTOGRAM run_latencies;
+
+/**************************************/
+
+/******** Function definitions ********/
+
+// Computing a response takes some CPU (hashing the request, which stands for parsing it and working it out), then a wait for a
+// backend, which takes none. The response is the request itself followed by its hash.
+static size_t handleLoadRequest(const char* request, size_t request_size, char* response, size_t response_capacity, void* arg)
+{
+    (void)arg;
+
+    unsigned long long hash = FNV_OFFSET_BASIS;
+
+    for(unsigned int round = 0; round < HANDLER_ROUNDS; round++)
+    {
+        for(size_t byte_idx = 0; byte_idx < request_size; byte_idx++)
+        {
+            hash ^= (unsigned char)request[byte_idx];
+            hash *= FNV_PRIME;
+        }
+    }
+
+    struct timespec backend_wait = { .tv_sec = 0, .tv_nsec = BACKEND_WAIT_US * 1000L };
+    nanosleep(&backend_wait, NULL);
+
+    int response_size = snprintf(response, response_capacity, "%.*s=%016llx", (int)request_size, request, hash);
+
+    if(response_size < 0)
+        return 0;
+
+    return ((size_t)response_size < response_capacity ? (size_t)response_size : response_capacity - 1);
+}
+
+static int connectToServer(const LOAD_TARGET* target)
+{
+    int fd = socket(target->address.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if(fd < 0)
+        return -1;
+
+    if(connect(fd, (const struct sockaddr*)&target->address, target->address_size) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    // As the server does, requests are sent right away rather than held back in case more data comes (Nagle's algorithm).
+    if(target->address.ss_family == AF_INET)
+    {
+        int no_delay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+    }
+
+    return fd;
+}
+
+static int sendRequest(int fd, const char* request, size_t request_size)
+{
+    while(request_size > 0)
+    {
+        ssize_t sent = send(fd, request, request_size, MSG_NOSIGNAL);
+
+        if(sent < 0 && errno == EINTR)
+            continue;
+
+        if(sent <= 0)
+            return -1;
+
+        request += sent;
+        request_size -= (size_t)sent;
+    }
+
+    return 0;
+}
+
+// Reads a whole response, and returns its size without the newline. Clients wait for every response before sending the next
+// request, so nothing ever comes after the newline.
+static ssize_t receiveResponse(int fd, char* response, size_t response_capacity)
+{
+    size_t response_size = 0;
+
+    while(response_size < response_capacity)
+    {
+        ssize_t received = recv(fd, response + response_size, response_capacity - response_size, 0);
+
+        if(received < 0 && errno == EINTR)
+            continue;
+
+        if(received <= 0)
+            return -1;
+
+        char* end = (char*)memchr(response + response_size, '\n', (size_t)received);
+
+        response_size += (size_t)received;
+
+        if(end != NULL)
+            return end - response;
+    }
+
+    return -1;
+}
+
+static void* loadClientRoutine(void* arg)
+{
+    LOAD_CLIENT_DATA* data = (LOAD_CLIENT_DATA*)arg;
+    char request[EPOLL_SERVER_MAX_REQUEST];
+    char response[EPOLL_SERVER_MAX_RESPONSE];
+
+    // Connecting is not part of the run.
+    int fd = connectToServer(data->target);
+
+    while(!atomic_load(data->start))
+        sched_yield();
+
+    for(unsigned long request_idx = 0; request_idx < data->requests_num; request_idx++)
+    {
+        int request_size = snprintf(request, sizeof(request), "%u:%lu\n", data->client_idx, request_idx);
+        unsigned long long send_ns = latencyHistogramGetTimeNs();
+        ssize_t response_size;
+
+        if(fd < 0 || sendRequest(fd, request, (size_t)request_size) < 0 || (response_size = receiveResponse(fd, response, sizeof(response))) < 0)
+        {
+            data->failed += data->requests_num - request_idx;
+            break;
+        }
+
+        unsigned long long latency_ns = latencyHistogramGetTimeNs() - send_ns;
+
+        // Retrying right away would just keep the server busier, so clients back off for a while first, as real ones should.
+        if(response_size == sizeof(EPOLL_SERVER_BUSY_RESPONSE) - 1 && memcmp(response, EPOLL_SERVER_BUSY_RESPONSE, (size_t)response_size) == 0)
+        {
+            struct timespec backoff = { .tv_sec = 0, .tv_nsec = REJECTED_BACKOFF_US * 1000L };
+
+            data->rejected++;
+            nanosleep(&backoff, NULL);
+        }
+        else if(response_size > request_size && memcmp(response, request, (size_t)request_size - 1) == 0 && response[request_size - 1] == '=')
+        {
+            latencyHistogramRecord(data->latencies, latency_ns);
+            data->served++;
+        }
+        else
+            data->failed++;
+    }
+
+    if(fd >= 0)
+        close(fd);
+
+    return NULL;
+}
+
+// Returns 0 if the run was done (whether every request got its response or not), -1 otherwise.
+static int runLoad(const LOAD_TARGET* target, const char* server_name, const char* admission_name, unsigned int clients_num, unsigned long requests_num)
+{
+    pthread_t clients[MAX_CLIENTS];
+    LOAD_CLIENT_DATA clients_data[MAX_CLIENTS];
+    atomic_int start = 0;
+    unsigned int clients_created = 0;
+    unsigned long requests_per_client = requests_num / clients_num;
+    unsigned long extra_requests = requests_num % clients_num;  // Sent by the first clients, one each, so that none is dropped.
+
+    for(; clients_created < clients_num; clients_created++)
+    {
+        unsigned long client_requests = requests_per_client + (clients_created < extra_requests ? 1 : 0);
+
+        latencyHistogramReset(&client_latencies[clients_created]);
+
+        clients_data[clients_created] = (LOAD_CLIENT_DATA)
+        {
+            .target         = target                                ,
+            .start          = &start                                ,
+            .client_idx     = clients_created                       ,
+            .requests_num   = client_requests                       ,
+            .latencies      = &client_latencies[clients_created]    ,
+        };
+
+        if(checkThreadCreationStatus( TRACED_THREAD_CREATE(&clients[clients_created], NULL, loadClientRoutine, &clients_data[clients_created]) ))
+            break;
+    }
+
+    // If not every client could be created, the ones which were are let go with nothing to send.
+    int created_all = (clients_created == clients_num);
+
+    if(!created_all)
+        for(unsigned int client_idx = 0; client_idx < clients_created; client_idx++)
+            clients_data[client_idx].requests_num = 0;
+
+    unsigned long long start_ns = latencyHistogramGetTimeNs();
+
+    atomic_store(&start, 1);
+
+    unsigned long long served_num = 0;
+    unsigned long long rejected_num = 0;
+    unsigned long long failed_num = 0;
+
+    latencyHistogramReset(&run_latencies);
+
+    for(unsigned int client_idx = 0; client_idx < clients_created; client_idx++)
+    {
+        pthread_join(clients[client_idx], NULL);
+
+        served_num      += clients_data[client_idx].served      ;
+        rejected_num    += clients_data[client_idx].rejected    ;
+        failed_num      += clients_data[client_idx].failed      ;
+        latencyHistogramMerge(&run_latencies, &client_latencies[client_idx]);
+    }
+
+    unsigned long long elapsed_ns = latencyHistogramGetTimeNs() - start_ns;
+
+    if(!created_all || elapsed_ns == 0)
+        return -1;
+
+    unsigned long long sent_num = served_num + rejected_num + failed_num;
+
+    printf("%-11s\t%-9s\t%7u\t%10.0f\t%10.1f\t%10.1f\t%7.1f%%%s\r\n",
+            server_name                                                     ,
+            admission_name                                                  ,
+            clients_num                                                     ,
+            (double)served_num * 1e9 / (double)elapsed_ns                   ,
+            latencyHistogramGetPercentile(&run_latencies, 50.0) / 1000.0    ,
+            latencyHistogramGetPercentile(&run_latencies, 99.0) / 1000.0    ,
+            (sent_num > 0 ? 100.0 * (double)rejected_num / (double)sent_num : 0.0),
+            (failed_num == 0 ? "" : "\tRequests lost or answered wrong!")   );
+
+    return 0;
+}
+
+// Runs every number of clients against a server. Returns 0 if every run was done, -1 otherwise.
+static int runServer(const char* server_name, const char* address, unsigned int workers_num, unsigned int admission_limit, unsigned long requests_num)
+{
+    EPOLL_SERVER* server = epollServerCreate(address, REACTORS_NUM, workers_num, admission_limit, handleLoadRequest, NULL);
+
+    if(server == NULL)
+        return -1;
+
+    LOAD_TARGET target;
+    char admission_name[16];
+
+    memset(&target, 0, sizeof(target));
+
+    if(epollServerGetPort(server) >= 0)
+    {
+        struct sockaddr_in* inet_address = (struct sockaddr_in*)&target.address;
+
+        inet_address->sin_family        = AF_INET                                       ;
+        inet_address->sin_port          = htons((unsigned short)epollServerGetPort(server));
+        inet_address->sin_addr.s_addr   = htonl(INADDR_LOOPBACK)                        ;
+        target.address_size             = sizeof(struct sockaddr_in)                    ;
+    }
+    else
+    {
+        struct sockaddr_un* unix_address = (struct sockaddr_un*)&target.address;
+
+        unix_address->sun_family = AF_UNIX;
+        snprintf(unix_address->sun_path, sizeof(unix_address->sun_path), "%s", address);
+        target.address_size = sizeof(struct sockaddr_un);
+    }
+
+    if(admission_limit == EPOLL_SERVER_NO_ADMISSION_LIMIT)
+        snprintf(admission_name, sizeof(admission_name), "none");
+    else
+        snprintf(admission_name, sizeof(admission_name), "%u", admission_limit);
+
+    int status = 0;
+
+    for(unsigned int level_idx = 0; level_idx < sizeof(clients_levels) / sizeof(clients_levels[0]) && status == 0; level_idx++)
+        status = runLoad(&target, server_name, admission_name, clients_levels[level_idx], requests_num);
+
+    EPOLL_SERVER_STATS stats;
+    epollServerGetStats(server, &stats);
+
+    printf("%s%s server, admission limit %s: %llu connection(s) accepted, %llu request(s) served, %llu rejected, at most %u in "
+            "flight at once.%s\r\n",
+            PRINT_COLOR_CYAN    ,
+            server_name         ,
+            admission_name      ,
+            stats.accepted      ,
+            stats.served        ,
+            stats.rejected      ,
+            stats.peak_in_flight,
+            PRINT_COLOR_RESET   );
+
+    epollServerDestroy(server);
+
+    return status;
+}
+
+void exampleEpollServerBenchmark()
+{
+    // The number of workers and requests per run can be given as lesson parameters (see LessonParameters.c).
+    unsigned long requests_num = getLessonParameter(LESSON_PARAM_ITERATIONS, DEFAULT_REQUESTS_PER_RUN);
+    unsigned int workers_num = (unsigned int)getLessonParameter(LESSON_PARAM_THREADS, DEFAULT_WORKERS);
+
+    if(workers_num < 1)
+        workers_num = 1;
+
+    char unix_path[sizeof(((struct sockaddr_un*)NULL)->sun_path)];
+    snprintf(unix_path, sizeof(unix_path), UNIX_SOCKET_PATH_FORMAT, (int)getpid());
+
+    const char* server_names[] = { "TCP"    , "UNIX socket" };
+    const char* addresses[]    = { "0"      , unix_path     };     // Port 0 takes any free port.
+
+    printf("%s%lu request(s) per run, %u worker(s), %d reactor(s). Throughput in requests per second, latencies in microseconds.%s\r\n",
+            PRINT_COLOR_GREEN   ,
+            requests_num        ,
+            workers_num         ,
+            REACTORS_NUM        ,
+            PRINT_COLOR_RESET   );
+
+    printf("%-11s\t%-9s\tClients\tThroughput\t       p50\t       p99\tRejected\r\n", "Server", "Admission");
+
+    for(unsigned int server_idx = 0; server_idx < sizeof(addresses) / sizeof(addresses[0]); server_idx++)
+    {
+        if( runServer(server_names[server_idx], addresses[server_idx], workers_num, EPOLL_SERVER_NO_ADMISSION_LIMIT, requests_num) < 0 ||
+            runServer(server_names[server_idx], addresses[server_idx], workers_num, workers_num * ADMISSION_SLOTS_PER_WORKER, requests_num) < 0)
+        {
+            printf("%sCould not run the server or its clients, so the procedure cannot go on.%s\r\n", PRINT_COLOR_RED, PRINT_COLOR_RESET);
+            return;
+        }
+    }
+}
+
+/**************************************/
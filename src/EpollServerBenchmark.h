@@ -0,0 +1,10 @@
+#ifndef EPOLL_SERVER_BENCHMARK_H
+#define EPOLL_SERVER_BENCHMARK_H
+
+/********* Function prototypes ********/
+
+void exampleEpollServerBenchmark();
+
+/**************************************/
+
+#endif
@@ -0,0 +1,342 @@
+/*
+Memory shared by threads has been freed once the threads using it had been joined: after pthread_join, nobody else can be looking
+at it. Lock-free structures (such as LockFreeStack.c and LockFreeQueue.c) have no such point: a thread may unlink a node and want
+to free it while other threads, which read a pointer to the node a moment earlier, are still about to look into it. Freeing it right
+away would make them read freed memory, or worse, memory which has been allocated again for something else (the ABA problem: a
+compare-and-swap succeeds because the same address is back, even though it is not the same node anymore).
+
+Hazard pointers tell other threads which nodes must not be freed yet:
+
+void* hazardPointerProtect(int hazard_idx, void* _Atomic* source)
+void hazardPointerClear(int hazard_idx)
+void hazardPointerRetire(void* node, HAZARD_POINTER_RECLAIM reclaim)
+
+Where:
+    ·hazardPointerProtect reads a shared pointer and publishes it in one of the calling thread's hazard pointers, reading the source
+    again until it has not changed meanwhile. Once it returns, the node cannot be freed until the hazard pointer is cleared (or
+    used to protect something else).
+    ·hazardPointerRetire is called instead of freeing an unlinked node. The node is kept in a list of the calling thread, and
+    every now and then the whole list is checked against every thread's hazard pointers (a scan): nodes nobody protects are freed
+    through "reclaim", the rest are kept for the next scan.
+
+Scans go through every hazard pointer, so they are not made on every retirement: they are made once a thread has retired more
+nodes than there are hazard pointers (twice as many, plus a fixed batch), so that at least half of them can always be freed, making
+the cost of every scan amortized over the nodes it frees. Hazard pointers are gathered and sorted first, so every retired node is
+looked up in logarithmic time.
+
+Every thread gets a record (its hazard pointers and retired nodes) the first time it needs one. Once the thread ends, its record is
+left for the next thread needing one, retired nodes included, so nothing is lost or freed too early. hazardPointerReclaimAll frees
+every node left once no thread is using the structures anymore (after joining them).
+
+Structures retiring a few large blocks rather than many nodes (such as ConcurrentHashMap.c's tables) may rather keep them in a list
+of their own, so that they can free them whenever they are destroyed without touching anybody else's: hazardPointerIsProtected tells
+whether any thread protects a given block.
+*/
+
+/********* Include statements *********/
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include "OwnedCounter.h"
+#include "HazardPointers.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define SCAN_THRESHOLD_BASE     256     // Retired nodes kept on top of twice the number of hazard pointers before scanning.
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+typedef struct HAZARD_RETIRED_NODE
+{
+    void*                           node    ;
+    HAZARD_POINTER_RECLAIM          reclaim ;
+    struct HAZARD_RETIRED_NODE*     next    ;
+} HAZARD_RETIRED_NODE;
+
+typedef struct HAZARD_RECORD
+{
+    void* _Atomic           hazards[HAZARD_POINTERS_PER_THREAD] ;
+    atomic_int              in_use                              ;
+    HAZARD_RETIRED_NODE*    retired                             ;   // Just touched by the owning thread.
+    unsigned int            retired_num                         ;
+    atomic_ullong           retired_total                       ;
+    atomic_ullong           reclaimed_total                     ;
+    atomic_ullong           scans                               ;
+    struct HAZARD_RECORD*   next                                ;
+} HAZARD_RECORD;
+
+/**************************************/
+
+/********* Private variables **********/
+
+static pthread_mutex_t                  records_lock = PTHREAD_MUTEX_INITIALIZER;
+static HAZARD_RECORD* _Atomic           records_list;
+static atomic_uint                      records_num;
+static pthread_once_t                   record_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t                    record_key;
+static _Thread_local HAZARD_RECORD*     thread_record;
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static void             createRecordKey();
+static void             releaseRecord(void* record);
+static HAZARD_RECORD*   getThreadRecord();
+static int              comparePointers(const void* a, const void* b);
+static void             scanRecord(HAZARD_RECORD* record);
+
+/**************************************/
+
+/******** Function definitions ********/
+
+static void createRecordKey()
+{
+    pthread_key_create(&record_key, releaseRecord);
+}
+
+// Called as the owning thread ends. Retired nodes stay in the record, to be scanned by its next owner.
+static void releaseRecord(void* record)
+{
+    HAZARD_RECORD* released = (HAZARD_RECORD*)record;
+
+    for(int hazard_idx = 0; hazard_idx < HAZARD_POINTERS_PER_THREAD; hazard_idx++)
+        atomic_store(&released->hazards[hazard_idx], NULL);
+
+    atomic_store(&released->in_use, 0);
+}
+
+static HAZARD_RECORD* getThreadRecord()
+{
+    if(thread_record != NULL)
+        return thread_record;
+
+    pthread_once(&record_key_once, createRecordKey);
+
+    HAZARD_RECORD* record = NULL;
+
+    // Take over a record left behind by a thread which already ended, if any.
+    for(HAZARD_RECORD* candidate = atomic_load(&records_list); candidate != NULL && record == NULL; candidate = candidate->next)
+    {
+        int expected = 0;
+
+        if(atomic_compare_exchange_strong(&candidate->in_use, &expected, 1))
+            record = candidate;
+    }
+
+    if(record == NULL)
+    {
+        record = (HAZARD_RECORD*)calloc(1, sizeof(HAZARD_RECORD));
+
+        if(record == NULL)
+            return NULL;
+
+        atomic_store(&record->in_use, 1);
+
+        pthread_mutex_lock(&records_lock);
+        record->next = atomic_load(&records_list);
+        atomic_store(&records_list, record);
+        atomic_fetch_add(&records_num, 1);
+        pthread_mutex_unlock(&records_lock);
+    }
+
+    pthread_setspecific(record_key, record);
+    thread_record = record;
+
+    return record;
+}
+
+static int comparePointers(const void* a, const void* b)
+{
+    void* pointer_a = *(void* const*)a;
+    void* pointer_b = *(void* const*)b;
+
+    return (pointer_a > pointer_b) - (pointer_a < pointer_b);
+}
+
+// Frees every node retired into the record which no hazard pointer protects. Must be called by the record's owner.
+static void scanRecord(HAZARD_RECORD* record)
+{
+    // Records are only ever added at the head of the list, so the ones after "first_record" stay the same while scanning. Records
+    // added meanwhile do not matter: their owners cannot read a pointer to a node which had been unlinked before the scan started.
+    HAZARD_RECORD* first_record = atomic_load(&records_list);
+    unsigned int hazards_max = 0;
+
+    for(HAZARD_RECORD* other = first_record; other != NULL; other = other->next)
+        hazards_max += HAZARD_POINTERS_PER_THREAD;
+
+    void** hazards = (void**)malloc((hazards_max > 0 ? hazards_max : 1) * sizeof(void*));
+
+    // Nodes cannot be told apart from protected ones without a snapshot of hazard pointers, so they are kept until the next scan.
+    if(hazards == NULL)
+        return;
+
+    unsigned int hazards_num = 0;
+
+    for(HAZARD_RECORD* other = first_record; other != NULL; other = other->next)
+        for(int hazard_idx = 0; hazard_idx < HAZARD_POINTERS_PER_THREAD; hazard_idx++)
+        {
+            void* hazard = atomic_load(&other->hazards[hazard_idx]);
+
+            if(hazard != NULL)
+                hazards[hazards_num++] = hazard;
+        }
+
+    qsort(hazards, hazards_num, sizeof(void*), comparePointers);
+
+    HAZARD_RETIRED_NODE** link = &record->retired;
+    unsigned long long reclaimed_num = 0;
+
+    while(*link != NULL)
+    {
+        HAZARD_RETIRED_NODE* retired = *link;
+
+        if(hazards_num > 0 && bsearch(&retired->node, hazards, hazards_num, sizeof(void*), comparePointers) != NULL)
+        {
+            link = &retired->next;
+            continue;
+        }
+
+        *link = retired->next;
+        retired->reclaim(retired->node);
+        free(retired);
+        reclaimed_num++;
+    }
+
+    free(hazards);
+
+    record->retired_num -= (unsigned int)reclaimed_num;
+    ownedCounterAdd(&record->reclaimed_total, reclaimed_num);
+    ownedCounterAdd(&record->scans, 1);
+}
+
+// Returns the pointer read from "source", which stays protected until hazard "hazard_idx" is cleared or used again. Returns what
+// "source" holds without protecting it if the calling thread could not get a record.
+void* hazardPointerProtect(int hazard_idx, void* _Atomic* source)
+{
+    HAZARD_RECORD* record = getThreadRecord();
+    void* pointer = atomic_load(source);
+
+    if(record == NULL)
+        return pointer;
+
+    // Publishing the pointer is not enough: the node may have been retired (and scanned) between reading and publishing it. Once
+    // the source is seen to still hold it after publishing, any later scan is bound to see the hazard pointer.
+    while(1)
+    {
+        atomic_store(&record->hazards[hazard_idx], pointer);
+
+        void* reread = atomic_load(source);
+
+        if(reread == pointer)
+            return pointer;
+
+        pointer = reread;
+    }
+}
+
+void hazardPointerClear(int hazard_idx)
+{
+    HAZARD_RECORD* record = getThreadRecord();
+
+    if(record != NULL)
+        atomic_store(&record->hazards[hazard_idx], NULL);
+}
+
+// The node must have been unlinked already, so that no thread can read a pointer to it anymore.
+void hazardPointerRetire(void* node, HAZARD_POINTER_RECLAIM reclaim)
+{
+    HAZARD_RECORD* record = getThreadRecord();
+    HAZARD_RETIRED_NODE* retired = (HAZARD_RETIRED_NODE*)malloc(sizeof(HAZARD_RETIRED_NODE));
+
+    // Leaking the node is the only safe choice left.
+    if(record == NULL || retired == NULL)
+    {
+        free(retired);
+        return;
+    }
+
+    retired->node       = node              ;
+    retired->reclaim    = reclaim           ;
+    retired->next       = record->retired   ;
+
+    record->retired = retired;
+    record->retired_num++;
+    ownedCounterAdd(&record->retired_total, 1);
+
+    if(record->retired_num >= SCAN_THRESHOLD_BASE + 2 * HAZARD_POINTERS_PER_THREAD * atomic_load(&records_num))
+        scanRecord(record);
+}
+
+// Frees whatever the calling thread has retired and nobody protects, without waiting for the threshold to be reached.
+void hazardPointerScan()
+{
+    HAZARD_RECORD* record = getThreadRecord();
+
+    if(record != NULL)
+        scanRecord(record);
+}
+
+// Frees every node retired by any thread, protected or not. No thread may be using a structure whose nodes are retired here.
+void hazardPointerReclaimAll()
+{
+    pthread_mutex_lock(&records_lock);
+
+    for(HAZARD_RECORD* record = atomic_load(&records_list); record != NULL; record = record->next)
+    {
+        unsigned long long reclaimed_num = 0;
+
+        while(record->retired != NULL)
+        {
+            HAZARD_RETIRED_NODE* retired = record->retired;
+
+            record->retired = retired->next;
+            retired->reclaim(retired->node);
+            free(retired);
+            reclaimed_num++;
+        }
+
+        record->retired_num = 0;
+        atomic_fetch_add(&record->reclaimed_total, reclaimed_num);
+
+        for(int hazard_idx = 0; hazard_idx < HAZARD_POINTERS_PER_THREAD; hazard_idx++)
+            atomic_store(&record->hazards[hazard_idx], NULL);
+    }
+
+    pthread_mutex_unlock(&records_lock);
+}
+
+// Returns 1 if any thread's hazard pointer holds "node". As for scans, the node must have been unlinked already, so that no thread
+// can start protecting it once this has returned 0.
+int hazardPointerIsProtected(const void* node)
+{
+    for(HAZARD_RECORD* record = atomic_load(&records_list); record != NULL; record = record->next)
+        for(int hazard_idx = 0; hazard_idx < HAZARD_POINTERS_PER_THREAD; hazard_idx++)
+            if(atomic_load(&record->hazards[hazard_idx]) == node)
+                return 1;
+
+    return 0;
+}
+
+void hazardPointerGetStats(HAZARD_POINTER_STATS* stats)
+{
+    if(stats == NULL)
+        return;
+
+    *stats = (HAZARD_POINTER_STATS){ 0 };
+
+    for(HAZARD_RECORD* record = atomic_load(&records_list); record != NULL; record = record->next)
+    {
+        stats->retired      += atomic_load(&record->retired_total)     ;
+        stats->reclaimed    += atomic_load(&record->reclaimed_total)   ;
+        stats->scans        += atomic_load(&record->scans)             ;
+        stats->records++;
+    }
+}
+
+/**************************************/
@@ -0,0 +1,42 @@
+#ifndef HAZARD_POINTERS_H
+#define HAZARD_POINTERS_H
+
+/********* Include statements *********/
+
+#include <stdatomic.h>
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define HAZARD_POINTERS_PER_THREAD  2   // Enough for the Michael-Scott queue, which protects two nodes at once.
+
+/**************************************/
+
+/********** Type definitions **********/
+
+typedef void (*HAZARD_POINTER_RECLAIM)(void* node);
+
+typedef struct
+{
+    unsigned long long  retired     ;   // Nodes handed over to hazardPointerRetire.
+    unsigned long long  reclaimed   ;   // Retired nodes actually freed.
+    unsigned long long  scans       ;   // Times retired nodes were checked against every hazard pointer.
+    unsigned int        records     ;   // Per-thread records, whether in use or left behind by threads which ended.
+} HAZARD_POINTER_STATS;
+
+/**************************************/
+
+/********* Function prototypes ********/
+
+void*   hazardPointerProtect(int hazard_idx, void* _Atomic* source);
+void    hazardPointerClear(int hazard_idx);
+void    hazardPointerRetire(void* node, HAZARD_POINTER_RECLAIM reclaim);
+void    hazardPointerScan();
+void    hazardPointerReclaimAll();
+int     hazardPointerIsProtected(const void* node);
+void    hazardPointerGetStats(HAZARD_POINTER_STATS* stats);
+
+/**************************************/
+
+#endif
@@ -0,0 +1,517 @@
+/*
+ThreadsWithConditionVariables.c has a producer thread fill a buffer and a consumer thread empty it. This lesson does the same with
+processes: the producer is a child process created with fork, the consumer is the parent, and the buffer is a ring in shared memory
+(see SharedMemoryRing.c), where the producer waits while it is full and the consumer while it is empty, as with condition variables.
+Were the producer to crash, the consumer would go on, and could tell the producer is gone.
+
+The lesson then measures how fast messages (64 bytes each, carrying the time they were sent at) go from producer processes to a
+consumer process through:
+    ·The shared memory ring, in SPSC mode (a single producer) and in MPSC mode (one or many producers).
+    ·A pipe (pipe), which many producers can share, as writes of up to PIPE_BUF bytes are never mixed with each other.
+    ·A UNIX domain socket pair (socketpair with SOCK_SEQPACKET), which keeps messages apart as well.
+
+Pipes and sockets take two system calls per message (a write and a read), and copy it in and out of the kernel. The ring copies it
+straight into memory the consumer reads from, and just calls the kernel when one side has to sleep or wake the other up, which the
+sleep counts printed along with every run tell about. The "many producers" runs use the "threads" lesson parameter (at least 2), and
+every producer sends the "iterations" lesson parameter messages.
+
+Producers end without going through exit (with _exit), since they are copies of the whole program and must not run anything the
+parent registered to be run at exit, nor flush what the parent had buffered before forking. The parent flushes its own buffers right
+before forking for the same reason.
+*/
+
+/********* Include statements *********/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include "ThreadColors.h"
+#include "SharedMemoryRing.h"
+#include "LatencyHistogram.h"
+#include "LessonParameters.h"
+#include "InterProcessQueues.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+// Default values, which can be overridden through lesson parameters (see LessonParameters.c).
+#define BUFFER_SIZE                     3
+#define DEFAULT_MESSAGES_PER_PRODUCER   100000
+#define DEFAULT_PRODUCERS               2
+
+#define MAX_PRODUCERS                   16
+#define RING_CAPACITY                   1024    // About as many messages as a pipe holds by default (64 KiB).
+#define MESSAGE_SIZE                    64
+#define POP_TIMEOUT_MS                  100     // How often the consumer checks whether producers are still alive while waiting.
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+typedef struct
+{
+    unsigned long long  send_ns                                                     ;
+    unsigned long long  sequence                                                    ;   // Unique among every message of a run.
+    unsigned char       payload[MESSAGE_SIZE - 2 * sizeof(unsigned long long)]      ;
+} IPC_MESSAGE;
+
+typedef struct
+{
+    SHARED_MEMORY_RING*     ring        ;
+    SHARED_MEMORY_RING_MODE mode        ;
+    int                     fds[2]      ;   // Pipe or socket pair: read end, write end.
+} IPC_CHANNEL;
+
+// Every transport is used through the same functions, so that the benchmark does not care which one it is running.
+typedef struct
+{
+    const char* name                                                                ;
+    int         many_producers                                                      ;   // Whether it can be shared by many producers.
+    int         (*open)(IPC_CHANNEL* channel, unsigned int producers_num)           ;
+    int         (*send)(IPC_CHANNEL* channel, const IPC_MESSAGE* message)           ;   // Producers only.
+    void        (*finishSending)(IPC_CHANNEL* channel)                              ;   // Producers only, once done.
+    void        (*startReceiving)(IPC_CHANNEL* channel)                             ;   // Consumer only, once producers are forked.
+    int         (*receive)(IPC_CHANNEL* channel, IPC_MESSAGE* message)              ;   // 1 on success, 0 once over, -1 on timeout.
+    void        (*producerLost)(IPC_CHANNEL* channel)                               ;   // A producer ended without finishing.
+    void        (*getSleeps)(IPC_CHANNEL* channel, char* text, size_t text_size)    ;
+    void        (*close)(IPC_CHANNEL* channel)                                      ;
+} IPC_TRANSPORT;
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static int      ringOpen(IPC_CHANNEL* channel, unsigned int producers_num);
+static int      ringSend(IPC_CHANNEL* channel, const IPC_MESSAGE* message);
+static void     ringFinishSending(IPC_CHANNEL* channel);
+static void     ringStartReceiving(IPC_CHANNEL* channel);
+static int      ringReceive(IPC_CHANNEL* channel, IPC_MESSAGE* message);
+static void     ringGetSleeps(IPC_CHANNEL* channel, char* text, size_t text_size);
+static void     ringClose(IPC_CHANNEL* channel);
+static int      spscRingOpen(IPC_CHANNEL* channel, unsigned int producers_num);
+static int      mpscRingOpen(IPC_CHANNEL* channel, unsigned int producers_num);
+static int      pipeOpen(IPC_CHANNEL* channel, unsigned int producers_num);
+static int      socketOpen(IPC_CHANNEL* channel, unsigned int producers_num);
+static int      descriptorSend(IPC_CHANNEL* channel, const IPC_MESSAGE* message);
+static void     descriptorFinishSending(IPC_CHANNEL* channel);
+static void     descriptorStartReceiving(IPC_CHANNEL* channel);
+static int      descriptorReceive(IPC_CHANNEL* channel, IPC_MESSAGE* message);
+static void     descriptorProducerLost(IPC_CHANNEL* channel);
+static void     descriptorGetSleeps(IPC_CHANNEL* channel, char* text, size_t text_size);
+static void     descriptorClose(IPC_CHANNEL* channel);
+static pid_t    forkProducer();
+static int      reapProducers(pid_t* producers, unsigned int producers_num, int wait);
+static void     runProducerConsumer(unsigned int buffer_size);
+static int      runBenchmark(const IPC_TRANSPORT* transport, unsigned int producers_num, unsigned long messages_num);
+
+/**************************************/
+
+/********* Private variables **********/
+
+static const IPC_TRANSPORT transports[] =
+{
+    { "Ring (SPSC)" , 0 , spscRingOpen  , ringSend          , ringFinishSending         , ringStartReceiving        , ringReceive       , ringFinishSending         , ringGetSleeps         , ringClose         },
+    { "Ring (MPSC)" , 1 , mpscRingOpen  , ringSend          , ringFinishSending         , ringStartReceiving        , ringReceive       , ringFinishSending         , ringGetSleeps         , ringClose         },
+    { "Pipe"        , 1 , pipeOpen      , descriptorSend    , descriptorFinishSending   , descriptorStartReceiving  , descriptorReceive , descriptorProducerLost    , descriptorGetSleeps   , descriptorClose   },
+    { "UNIX socket" , 1 , socketOpen    , descriptorSend    , descriptorFinishSending   , descriptorStartReceiving  , descriptorReceive , descriptorProducerLost    , descriptorGetSleeps   , descriptorClose   },
+};
+
+static LATENCY_HISTOGRAM message_latencies;
+
+/**************************************/
+
+/******** Function definitions ********/
+
+static int ringOpen(IPC_CHANNEL* channel, unsigned int producers_num)
+{
+    channel->ring = sharedMemoryRingCreate(RING_CAPACITY, sizeof(IPC_MESSAGE), channel->mode, producers_num);
+
+    return (channel->ring != NULL ? 0 : -1);
+}
+
+static int ringSend(IPC_CHANNEL* channel, const IPC_MESSAGE* message)
+{
+    return sharedMemoryRingPush(channel->ring, message);
+}
+
+// Also called by the consumer on behalf of producers which ended without doing so.
+static void ringFinishSending(IPC_CHANNEL* channel)
+{
+    sharedMemoryRingClose(channel->ring);
+}
+
+static void ringStartReceiving(IPC_CHANNEL* channel)
+{
+    (void)channel;
+}
+
+static int ringReceive(IPC_CHANNEL* channel, IPC_MESSAGE* message)
+{
+    return sharedMemoryRingPop(channel->ring, message, POP_TIMEOUT_MS);
+}
+
+static void ringGetSleeps(IPC_CHANNEL* channel, char* text, size_t text_size)
+{
+    SHARED_MEMORY_RING_STATS stats;
+
+    sharedMemoryRingGetStats(channel->ring, &stats);
+    snprintf(text, text_size, "%llu/%llu", stats.consumer_sleeps, stats.producer_sleeps);
+}
+
+static void ringClose(IPC_CHANNEL* channel)
+{
+    sharedMemoryRingDestroy(channel->ring);
+}
+
+static int spscRingOpen(IPC_CHANNEL* channel, unsigned int producers_num)
+{
+    channel->mode = SHARED_MEMORY_RING_SPSC;
+
+    return ringOpen(channel, producers_num);
+}
+
+static int mpscRingOpen(IPC_CHANNEL* channel, unsigned int producers_num)
+{
+    channel->mode = SHARED_MEMORY_RING_MPSC;
+
+    return ringOpen(channel, producers_num);
+}
+
+static int pipeOpen(IPC_CHANNEL* channel, unsigned int producers_num)
+{
+    (void)producers_num;
+
+    return pipe(channel->fds);
+}
+
+static int socketOpen(IPC_CHANNEL* channel, unsigned int producers_num)
+{
+    (void)producers_num;
+
+    return socketpair(AF_UNIX, SOCK_SEQPACKET, 0, channel->fds);
+}
+
+// Messages are small enough to be written at once, so partial writes only come from interrupted calls.
+static int descriptorSend(IPC_CHANNEL* channel, const IPC_MESSAGE* message)
+{
+    const unsigned char* data = (const unsigned char*)message;
+    size_t sent = 0;
+
+    while(sent < sizeof(IPC_MESSAGE))
+    {
+        ssize_t written = write(channel->fds[1], data + sent, sizeof(IPC_MESSAGE) - sent);
+
+        if(written < 0 && errno == EINTR)
+            continue;
+
+        if(written <= 0)
+            return -1;
+
+        sent += (size_t)written;
+    }
+
+    return 0;
+}
+
+static void descriptorFinishSending(IPC_CHANNEL* channel)
+{
+    close(channel->fds[1]);
+}
+
+// The consumer closes its copy of the write end, so that reads hit the end of the stream once every producer has closed theirs.
+static void descriptorStartReceiving(IPC_CHANNEL* channel)
+{
+    close(channel->fds[1]);
+}
+
+static int descriptorReceive(IPC_CHANNEL* channel, IPC_MESSAGE* message)
+{
+    unsigned char* data = (unsigned char*)message;
+    size_t received = 0;
+
+    while(received < sizeof(IPC_MESSAGE))
+    {
+        ssize_t bytes_read = read(channel->fds[0], data + received, sizeof(IPC_MESSAGE) - received);
+
+        if(bytes_read < 0 && errno == EINTR)
+            continue;
+
+        if(bytes_read <= 0)
+            return 0;
+
+        received += (size_t)bytes_read;
+    }
+
+    return 1;
+}
+
+// The kernel closes whatever a process leaves open when it ends, so nothing needs to be done on its behalf.
+static void descriptorProducerLost(IPC_CHANNEL* channel)
+{
+    (void)channel;
+}
+
+// Pipes and sockets sleep within the kernel, where they cannot be counted from.
+static void descriptorGetSleeps(IPC_CHANNEL* channel, char* text, size_t text_size)
+{
+    (void)channel;
+
+    snprintf(text, text_size, "-");
+}
+
+static void descriptorClose(IPC_CHANNEL* channel)
+{
+    close(channel->fds[0]);
+}
+
+// Whatever is buffered in stdout would be written by both processes otherwise.
+static pid_t forkProducer()
+{
+    fflush(stdout);
+    fflush(stderr);
+
+    return fork();
+}
+
+// Reaps producers which have ended (or waits for every one of them, if "wait" is set). Returns the number of producers which ended
+// without succeeding, which are no longer waited for (set to -1).
+static int reapProducers(pid_t* producers, unsigned int producers_num, int wait)
+{
+    int lost_num = 0;
+
+    for(unsigned int producer_idx = 0; producer_idx < producers_num; producer_idx++)
+    {
+        int status;
+
+        if(producers[producer_idx] <= 0 || waitpid(producers[producer_idx], &status, (wait ? 0 : WNOHANG)) <= 0)
+            continue;
+
+        if(!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            lost_num++;
+
+        producers[producer_idx] = -1;
+    }
+
+    return lost_num;
+}
+
+// Same as ThreadsWithConditionVariables.c, with a process on each side.
+static void runProducerConsumer(unsigned int buffer_size)
+{
+    SHARED_MEMORY_RING* ring = sharedMemoryRingCreate(buffer_size, sizeof(int), SHARED_MEMORY_RING_SPSC, 1);
+
+    if(ring == NULL)
+    {
+        printf("%sCould not create the shared memory ring, so the procedure cannot go on.%s\r\n", PRINT_COLOR_RED, PRINT_COLOR_RESET);
+        return;
+    }
+
+    // Rings hold a power of two items. The producer produces twice as many: it fills the ring up, then waits for room while the
+    // consumer empties it.
+    unsigned int items_num = buffer_size;
+
+    while(items_num & (items_num - 1))
+        items_num++;
+
+    pid_t producer = forkProducer();
+
+    if(producer < 0)
+    {
+        printf("%sCould not create the producer process, so the procedure cannot go on.%s\r\n", PRINT_COLOR_RED, PRINT_COLOR_RESET);
+        sharedMemoryRingDestroy(ring);
+        return;
+    }
+
+    if(producer == 0)
+    {
+        for(int item = 1; item <= (int)items_num * 2; item++)
+        {
+            sharedMemoryRingPush(ring, &item);
+
+            printf("%sProducer with PID %d says: \"Added an item. Current item number: %d\"%s\r\n",
+                    PRINT_COLOR_YELLOW  ,
+                    getpid()            ,
+                    item                ,
+                    PRINT_COLOR_RESET   );
+            fflush(stdout);
+        }
+
+        sharedMemoryRingClose(ring);
+        _exit(EXIT_SUCCESS);
+    }
+
+    int item;
+    int pop_status;
+
+    // Giving the producer a head start lets it fill the ring up and wait for room, as it would if the consumer were busy.
+    usleep(100000);
+
+    while((pop_status = sharedMemoryRingPop(ring, &item, POP_TIMEOUT_MS)) != 0)
+    {
+        if(pop_status < 0)
+        {
+            if(reapProducers(&producer, 1, 0) > 0)
+                sharedMemoryRingClose(ring);
+
+            continue;
+        }
+
+        printf("%sConsumer with PID %d says: \"Consumed an item. Current item number: %d\"%s\r\n",
+                PRINT_COLOR_BLUE    ,
+                getpid()            ,
+                item                ,
+                PRINT_COLOR_RESET   );
+    }
+
+    reapProducers(&producer, 1, 1);
+
+    printf("%sConsumer with PID %d says: \"All items have been consumed!\"%s\r\n", PRINT_COLOR_PURPLE, getpid(), PRINT_COLOR_RESET);
+
+    sharedMemoryRingDestroy(ring);
+}
+
+// Returns 0 if the benchmark was run (whether its messages added up or not), -1 otherwise.
+static int runBenchmark(const IPC_TRANSPORT* transport, unsigned int producers_num, unsigned long messages_num)
+{
+    IPC_CHANNEL channel;
+    pid_t producers[MAX_PRODUCERS];
+    unsigned int forked_num = 0;
+
+    memset(&channel, 0, sizeof(channel));
+
+    if(transport->open(&channel, producers_num) < 0)
+        return -1;
+
+    unsigned long long start_ns = latencyHistogramGetTimeNs();
+
+    for(; forked_num < producers_num; forked_num++)
+    {
+        producers[forked_num] = forkProducer();
+
+        if(producers[forked_num] < 0)
+            break;
+
+        if(producers[forked_num] == 0)
+        {
+            IPC_MESSAGE message;
+            int status = EXIT_SUCCESS;
+
+            memset(&message, 0xA5, sizeof(message));
+
+            for(unsigned long message_idx = 0; message_idx < messages_num && status == EXIT_SUCCESS; message_idx++)
+            {
+                message.send_ns     = latencyHistogramGetTimeNs()                   ;
+                message.sequence    = 1 + forked_num * messages_num + message_idx   ;
+
+                if(transport->send(&channel, &message) < 0)
+                    status = EXIT_FAILURE;
+            }
+
+            transport->finishSending(&channel);
+            _exit(status);
+        }
+    }
+
+    // Producers which could not be forked will never finish sending, so they are accounted for as lost.
+    for(unsigned int lost_idx = forked_num; lost_idx < producers_num; lost_idx++)
+        transport->producerLost(&channel);
+
+    transport->startReceiving(&channel);
+    latencyHistogramReset(&message_latencies);
+
+    IPC_MESSAGE message;
+    unsigned long long received_num = 0;
+    unsigned long long sequence_sum = 0;
+    int receive_status;
+
+    while((receive_status = transport->receive(&channel, &message)) != 0)
+    {
+        // Timed out: producers which died without finishing are finished for, so that the consumer does not wait for them forever.
+        if(receive_status < 0)
+        {
+            for(int lost_num = reapProducers(producers, forked_num, 0); lost_num > 0; lost_num--)
+                transport->producerLost(&channel);
+
+            continue;
+        }
+
+        latencyHistogramRecord(&message_latencies, latencyHistogramGetTimeNs() - message.send_ns);
+        sequence_sum += message.sequence;
+        received_num++;
+    }
+
+    unsigned long long elapsed_ns = latencyHistogramGetTimeNs() - start_ns;
+    char sleeps[64];
+
+    reapProducers(producers, forked_num, 1);
+    transport->getSleeps(&channel, sleeps, sizeof(sleeps));
+    transport->close(&channel);
+
+    if(forked_num < producers_num || elapsed_ns == 0)
+        return -1;
+
+    unsigned long long sent_num = (unsigned long long)producers_num * messages_num;
+
+    printf("%-12s\t%u:1\t%10.3f\t%10.1f\t%10.1f\t%s%s\r\n",
+            transport->name                                                     ,
+            producers_num                                                       ,
+            (double)received_num * 1000.0 / (double)elapsed_ns                  ,
+            latencyHistogramGetPercentile(&message_latencies, 50.0) / 1000.0    ,
+            latencyHistogramGetPercentile(&message_latencies, 99.0) / 1000.0    ,
+            sleeps                                                              ,
+            (received_num == sent_num && sequence_sum == sent_num * (sent_num + 1) / 2 ? "" : "\tMessages lost or duplicated!"));
+
+    return 0;
+}
+
+void exampleInterProcessQueues()
+{
+    // The buffer size, number of producers and messages per producer can be given as lesson parameters (see LessonParameters.c).
+    unsigned int buffer_size = (unsigned int)getLessonParameter(LESSON_PARAM_BUFFER_SIZE, BUFFER_SIZE);
+    unsigned long messages_num = getLessonParameter(LESSON_PARAM_ITERATIONS, DEFAULT_MESSAGES_PER_PRODUCER);
+    unsigned int producers_num = (unsigned int)getLessonParameter(LESSON_PARAM_THREADS, DEFAULT_PRODUCERS);
+
+    if(buffer_size < 1)
+        buffer_size = 1;
+
+    if(producers_num < 2)
+        producers_num = 2;
+
+    if(producers_num > MAX_PRODUCERS)
+        producers_num = MAX_PRODUCERS;
+
+    runProducerConsumer(buffer_size);
+
+    printf("%s%lu message(s) of %d bytes per producer. Throughput in millions of messages per second, latencies in microseconds, "
+            "sleeps as consumer/producers.%s\r\n",
+            PRINT_COLOR_GREEN   ,
+            messages_num        ,
+            MESSAGE_SIZE        ,
+            PRINT_COLOR_RESET   );
+
+    printf("%-12s\tP:C\tThroughput\t       p50\t       p99\tSleeps\r\n", "Transport");
+
+    for(unsigned int transport_idx = 0; transport_idx < sizeof(transports) / sizeof(transports[0]); transport_idx++)
+    {
+        int failed = (runBenchmark(&transports[transport_idx], 1, messages_num) < 0);
+
+        if(!failed && transports[transport_idx].many_producers)
+            failed = (runBenchmark(&transports[transport_idx], producers_num, messages_num) < 0);
+
+        if(failed)
+        {
+            printf("%sCould not run the benchmark, so the procedure cannot go on.%s\r\n", PRINT_COLOR_RED, PRINT_COLOR_RESET);
+            return;
+        }
+    }
+}
+
+/**************************************/
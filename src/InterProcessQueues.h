@@ -0,0 +1,10 @@
+#ifndef INTER_PROCESS_QUEUES_H
+#define INTER_PROCESS_QUEUES_H
+
+/********* Function prototypes ********/
+
+void exampleInterProcessQueues();
+
+/**************************************/
+
+#endif
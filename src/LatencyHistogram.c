@@ -0,0 +1,290 @@
+/*
+Latencies (how long a thread waited for a lock, held it, or took to run its task) are rarely well described by their mean: most of
+them are short, but the few long ones are what makes a program feel slow. Thus, percentiles (p50, p99, p99.99) are reported instead,
+which requires keeping the whole distribution. Storing every value is too expensive when recording from many threads, so values are
+counted into buckets, the same way HdrHistogram does:
+    ·Values below 2^bits (see LATENCY_HISTOGRAM_SUB_BUCKET_BITS) get a bucket of their own.
+    ·Greater values are split into ranges by their most significant bit ([2^n, 2^(n + 1)), logarithmic), and each range is split
+    into 2^(bits - 1) equally wide sub-buckets (linear). Thus, every value is within a fixed relative error (below 1.6% for 7 bits)
+    of its bucket's bounds, whatever its magnitude, and a few thousand buckets cover nanoseconds to minutes.
+
+A value's bucket is found with a couple of shifts, and recording is just an atomic increment (plus compare-and-swap loops for the
+minimum and maximum, which rarely loop), so no lock is taken: many threads can record into the same histogram, or each thread into
+one of its own, which are then merged by adding their buckets up. Histograms are plain structures, so static and zero-initialized
+ones are ready to be used.
+
+Percentiles are computed by walking buckets until the requested fraction of values is reached, and are reported as the upper bound
+of that bucket (never above the actual maximum). Histograms are printed as a text summary or as CSV, a line per non-empty bucket.
+*/
+
+/********* Include statements *********/
+
+#include <time.h>
+#include "LatencyHistogram.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define NS_PER_SEC              1000000000ULL
+#define MAX_RECORDABLE_VALUE    ((1ULL << LATENCY_HISTOGRAM_MAX_VALUE_BITS) - 1)
+#define DURATION_TEXT_SIZE      32
+
+/**************************************/
+
+/********* Private variables **********/
+
+static const double reported_percentiles[] = { 50.0, 90.0, 99.0, 99.9, 99.99 };
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static unsigned int         getBucketIndex(unsigned long long value);
+static unsigned long long   getBucketLowerBound(unsigned int bucket_idx);
+static unsigned long long   getBucketUpperBound(unsigned int bucket_idx);
+static void                 updateMin(LATENCY_HISTOGRAM* histogram, unsigned long long value);
+static void                 updateMax(LATENCY_HISTOGRAM* histogram, unsigned long long value);
+static const char*          formatDuration(char* text, unsigned long long value);
+
+/**************************************/
+
+/******** Function definitions ********/
+
+static unsigned int getBucketIndex(unsigned long long value)
+{
+    if(value > MAX_RECORDABLE_VALUE)
+        value = MAX_RECORDABLE_VALUE;
+
+    if(value < (1ULL << LATENCY_HISTOGRAM_SUB_BUCKET_BITS))
+        return (unsigned int)value;
+
+    // Values in [2^n, 2^(n + 1)) are shifted so that just their "bits" most significant bits are kept.
+    unsigned int shift = (63 - __builtin_clzll(value)) - LATENCY_HISTOGRAM_SUB_BUCKET_BITS + 1;
+
+    return shift * LATENCY_HISTOGRAM_HALF_SUB_BUCKETS + (unsigned int)(value >> shift);
+}
+
+static unsigned long long getBucketLowerBound(unsigned int bucket_idx)
+{
+    if(bucket_idx < 2 * LATENCY_HISTOGRAM_HALF_SUB_BUCKETS)
+        return bucket_idx;
+
+    unsigned int shift = bucket_idx / LATENCY_HISTOGRAM_HALF_SUB_BUCKETS - 1;
+    unsigned long long sub_bucket = bucket_idx - shift * LATENCY_HISTOGRAM_HALF_SUB_BUCKETS;
+
+    return (sub_bucket << shift);
+}
+
+static unsigned long long getBucketUpperBound(unsigned int bucket_idx)
+{
+    if(bucket_idx < 2 * LATENCY_HISTOGRAM_HALF_SUB_BUCKETS)
+        return bucket_idx;
+
+    unsigned int shift = bucket_idx / LATENCY_HISTOGRAM_HALF_SUB_BUCKETS - 1;
+    unsigned long long sub_bucket = bucket_idx - shift * LATENCY_HISTOGRAM_HALF_SUB_BUCKETS;
+
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+static void updateMin(LATENCY_HISTOGRAM* histogram, unsigned long long value)
+{
+    unsigned long long current = atomic_load_explicit(&histogram->min_plus_one, memory_order_relaxed);
+
+    while((current == 0 || value + 1 < current) && !atomic_compare_exchange_weak_explicit(&histogram->min_plus_one, &current, value + 1, memory_order_relaxed, memory_order_relaxed))
+        ;
+}
+
+static void updateMax(LATENCY_HISTOGRAM* histogram, unsigned long long value)
+{
+    unsigned long long current = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+
+    while(value > current && !atomic_compare_exchange_weak_explicit(&histogram->max, &current, value, memory_order_relaxed, memory_order_relaxed))
+        ;
+}
+
+// "text" must be DURATION_TEXT_SIZE bytes long at least.
+static const char* formatDuration(char* text, unsigned long long value)
+{
+    if(value < 1000ULL)
+        snprintf(text, DURATION_TEXT_SIZE, "%llu ns", value);
+    else if(value < 1000000ULL)
+        snprintf(text, DURATION_TEXT_SIZE, "%.2f us", value / 1e3);
+    else if(value < NS_PER_SEC)
+        snprintf(text, DURATION_TEXT_SIZE, "%.2f ms", value / 1e6);
+    else
+        snprintf(text, DURATION_TEXT_SIZE, "%.2f s", value / 1e9);
+
+    return text;
+}
+
+// CLOCK_MONOTONIC timestamp in nanoseconds, meant to compute the durations to be recorded.
+unsigned long long latencyHistogramGetTimeNs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((unsigned long long)now.tv_sec * NS_PER_SEC + (unsigned long long)now.tv_nsec);
+}
+
+// Not safe while other threads are recording into the same histogram.
+void latencyHistogramReset(LATENCY_HISTOGRAM* histogram)
+{
+    if(histogram == NULL)
+        return;
+
+    for(unsigned int bucket_idx = 0; bucket_idx < LATENCY_HISTOGRAM_BUCKETS_NUM; bucket_idx++)
+        atomic_init(&histogram->counts[bucket_idx], 0);
+
+    atomic_init(&histogram->total_count , 0);
+    atomic_init(&histogram->total_sum   , 0);
+    atomic_init(&histogram->min_plus_one, 0);
+    atomic_init(&histogram->max         , 0);
+}
+
+void latencyHistogramRecord(LATENCY_HISTOGRAM* histogram, unsigned long long value)
+{
+    if(histogram == NULL)
+        return;
+
+    if(value > MAX_RECORDABLE_VALUE)
+        value = MAX_RECORDABLE_VALUE;
+
+    atomic_fetch_add_explicit(&histogram->counts[getBucketIndex(value)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->total_count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->total_sum, value, memory_order_relaxed);
+
+    updateMin(histogram, value);
+    updateMax(histogram, value);
+}
+
+// Adds every value in "source" to "destination". Both can be recorded into meanwhile.
+void latencyHistogramMerge(LATENCY_HISTOGRAM* destination, const LATENCY_HISTOGRAM* source)
+{
+    if(destination == NULL || source == NULL || latencyHistogramGetCount(source) == 0)
+        return;
+
+    for(unsigned int bucket_idx = 0; bucket_idx < LATENCY_HISTOGRAM_BUCKETS_NUM; bucket_idx++)
+    {
+        unsigned long long count = atomic_load_explicit(&source->counts[bucket_idx], memory_order_relaxed);
+
+        if(count > 0)
+            atomic_fetch_add_explicit(&destination->counts[bucket_idx], count, memory_order_relaxed);
+    }
+
+    atomic_fetch_add_explicit(&destination->total_count, atomic_load_explicit(&source->total_count, memory_order_relaxed), memory_order_relaxed);
+    atomic_fetch_add_explicit(&destination->total_sum, atomic_load_explicit(&source->total_sum, memory_order_relaxed), memory_order_relaxed);
+
+    updateMin(destination, latencyHistogramGetMin(source));
+    updateMax(destination, latencyHistogramGetMax(source));
+}
+
+unsigned long long latencyHistogramGetCount(const LATENCY_HISTOGRAM* histogram)
+{
+    return atomic_load_explicit(&histogram->total_count, memory_order_relaxed);
+}
+
+unsigned long long latencyHistogramGetMin(const LATENCY_HISTOGRAM* histogram)
+{
+    unsigned long long min_plus_one = atomic_load_explicit(&histogram->min_plus_one, memory_order_relaxed);
+
+    return (min_plus_one ? min_plus_one - 1 : 0);
+}
+
+unsigned long long latencyHistogramGetMax(const LATENCY_HISTOGRAM* histogram)
+{
+    return atomic_load_explicit(&histogram->max, memory_order_relaxed);
+}
+
+double latencyHistogramGetMean(const LATENCY_HISTOGRAM* histogram)
+{
+    unsigned long long count = latencyHistogramGetCount(histogram);
+
+    return (count ? (double)atomic_load_explicit(&histogram->total_sum, memory_order_relaxed) / count : 0.0);
+}
+
+// "percentile" goes from 0 to 100. Returns 0 if the histogram is empty.
+unsigned long long latencyHistogramGetPercentile(const LATENCY_HISTOGRAM* histogram, double percentile)
+{
+    unsigned long long count = latencyHistogramGetCount(histogram);
+
+    if(count == 0)
+        return 0;
+
+    if(percentile >= 100.0)
+        return latencyHistogramGetMax(histogram);
+
+    // Number of values at or below the requested percentile, rounded up.
+    unsigned long long target = (unsigned long long)(percentile / 100.0 * count);
+
+    if((double)target < percentile / 100.0 * count || target == 0)
+        ++target;
+
+    unsigned long long cumulative = 0;
+
+    for(unsigned int bucket_idx = 0; bucket_idx < LATENCY_HISTOGRAM_BUCKETS_NUM; bucket_idx++)
+    {
+        cumulative += atomic_load_explicit(&histogram->counts[bucket_idx], memory_order_relaxed);
+
+        if(cumulative >= target)
+        {
+            unsigned long long value = getBucketUpperBound(bucket_idx);
+            unsigned long long max = latencyHistogramGetMax(histogram);
+
+            return (value < max ? value : max);
+        }
+    }
+
+    return latencyHistogramGetMax(histogram);
+}
+
+void latencyHistogramPrint(FILE* stream, const char* name, const LATENCY_HISTOGRAM* histogram)
+{
+    if(stream == NULL || histogram == NULL)
+        return;
+
+    char text[DURATION_TEXT_SIZE];
+
+    fprintf(stream, "%s\r\n    count %-10llu min %-11s", name, latencyHistogramGetCount(histogram), formatDuration(text, latencyHistogramGetMin(histogram)));
+    fprintf(stream, "mean %-11s", formatDuration(text, (unsigned long long)latencyHistogramGetMean(histogram)));
+
+    for(unsigned int i = 0; i < sizeof(reported_percentiles) / sizeof(reported_percentiles[0]); i++)
+        fprintf(stream, "p%-6g%-11s", reported_percentiles[i], formatDuration(text, latencyHistogramGetPercentile(histogram, reported_percentiles[i])));
+
+    fprintf(stream, "max %s\r\n", formatDuration(text, latencyHistogramGetMax(histogram)));
+}
+
+void latencyHistogramPrintCSVHeader(FILE* stream)
+{
+    if(stream != NULL)
+        fprintf(stream, "name,bucket_low_ns,bucket_high_ns,count,cumulative_percentile\n");
+}
+
+// A line per non-empty bucket. Names are expected not to contain commas nor quotes.
+void latencyHistogramPrintCSV(FILE* stream, const char* name, const LATENCY_HISTOGRAM* histogram)
+{
+    if(stream == NULL || histogram == NULL)
+        return;
+
+    unsigned long long count = latencyHistogramGetCount(histogram);
+    unsigned long long cumulative = 0;
+
+    for(unsigned int bucket_idx = 0; bucket_idx < LATENCY_HISTOGRAM_BUCKETS_NUM && count > 0; bucket_idx++)
+    {
+        unsigned long long bucket_count = atomic_load_explicit(&histogram->counts[bucket_idx], memory_order_relaxed);
+
+        if(bucket_count == 0)
+            continue;
+
+        cumulative += bucket_count;
+
+        fprintf(stream, "%s,%llu,%llu,%llu,%.4f\n",
+                name                                    ,
+                getBucketLowerBound(bucket_idx)         ,
+                getBucketUpperBound(bucket_idx)         ,
+                bucket_count                            ,
+                100.0 * cumulative / count              );
+    }
+}
+
+/**************************************/
@@ -0,0 +1,51 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+/********* Include statements *********/
+
+#include <stdio.h>
+#include <stdatomic.h>
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define LATENCY_HISTOGRAM_SUB_BUCKET_BITS   7                                                   // Relative error below 1 / 2^(bits - 1).
+#define LATENCY_HISTOGRAM_MAX_VALUE_BITS    40                                                  // Values up to about 18 minutes (in ns).
+#define LATENCY_HISTOGRAM_HALF_SUB_BUCKETS  (1U << (LATENCY_HISTOGRAM_SUB_BUCKET_BITS - 1))
+#define LATENCY_HISTOGRAM_BUCKETS_NUM       ((LATENCY_HISTOGRAM_MAX_VALUE_BITS - LATENCY_HISTOGRAM_SUB_BUCKET_BITS + 2) * LATENCY_HISTOGRAM_HALF_SUB_BUCKETS)
+
+/**************************************/
+
+/********** Type definitions **********/
+
+// Zero-initialized histograms (such as static ones) are ready to be used, as well as the ones reset by latencyHistogramReset.
+typedef struct
+{
+    atomic_ullong   counts[LATENCY_HISTOGRAM_BUCKETS_NUM]   ;
+    atomic_ullong   total_count                             ;
+    atomic_ullong   total_sum                               ;
+    atomic_ullong   min_plus_one                            ;   // 0 while empty.
+    atomic_ullong   max                                     ;
+} LATENCY_HISTOGRAM;
+
+/**************************************/
+
+/********* Function prototypes ********/
+
+unsigned long long  latencyHistogramGetTimeNs();
+void                latencyHistogramReset(LATENCY_HISTOGRAM* histogram);
+void                latencyHistogramRecord(LATENCY_HISTOGRAM* histogram, unsigned long long value);
+void                latencyHistogramMerge(LATENCY_HISTOGRAM* destination, const LATENCY_HISTOGRAM* source);
+unsigned long long  latencyHistogramGetCount(const LATENCY_HISTOGRAM* histogram);
+unsigned long long  latencyHistogramGetMin(const LATENCY_HISTOGRAM* histogram);
+unsigned long long  latencyHistogramGetMax(const LATENCY_HISTOGRAM* histogram);
+double              latencyHistogramGetMean(const LATENCY_HISTOGRAM* histogram);
+unsigned long long  latencyHistogramGetPercentile(const LATENCY_HISTOGRAM* histogram, double percentile);
+void                latencyHistogramPrint(FILE* stream, const char* name, const LATENCY_HISTOGRAM* histogram);
+void                latencyHistogramPrintCSVHeader(FILE* stream);
+void                latencyHistogramPrintCSV(FILE* stream, const char* name, const LATENCY_HISTOGRAM* histogram);
+
+/**************************************/
+
+#endif
@@ -0,0 +1,163 @@
+/*
+Workload sizes and thread counts used to be compile-time constants within every lesson, so studying how a lesson scales required
+recompiling it each time. Lessons now ask for their parameters when they are entered:
+
+unsigned long getLessonParameter(LESSON_PARAM_ID param_id, unsigned long default_value)
+
+Where:
+    ·param_id: the parameter to be retrieved (threads, increments, matrix dimension, ...).
+    ·default_value: the value to use if the parameter has not been given. Lessons pass their former constant, so they behave
+    exactly as before unless told otherwise.
+
+Parameters are given either from the command line (--threads=8) or from the environment (THREADS_TUTORIAL_THREADS=8), the former
+taking precedence. Each lesson decides which parameters are meaningful for it; the rest are simply ignored.
+*/
+
+/********* Include statements *********/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "LessonParameters.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define ENVIRONMENT_PREFIX          "THREADS_TUTORIAL_"
+#define ENVIRONMENT_NAME_MAX_SIZE   64
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+typedef struct
+{
+    const char* name        ;
+    const char* description ;
+} LESSON_PARAM_INFO;
+
+/**************************************/
+
+/********* Private variables **********/
+
+static const LESSON_PARAM_INFO param_info[LESSON_PARAMS_NUM] =
+{
+    [LESSON_PARAM_THREADS]      = { "threads"       , "Number of worker threads (mutex, semaphores, attributes, matrix, matrix-tiled, pool-*, task-graph, hash-map, lock-free, queue-bench, ipc-queues, epoll-server), nodes (summa)."                                              },
+    [LESSON_PARAM_INCREMENTS]   = { "increments"    , "Increments per thread (mutex, attributes)."                                                                                                                                                                                  },
+    [LESSON_PARAM_MAT_DIM]      = { "mat-dim"       , "Dimension of square matrices (matrix, matrix-tiled, task-graph, summa)."                                                                                                                                                     },
+    [LESSON_PARAM_ITERATIONS]   = { "iterations"    , "Iterations per thread (semaphores), tasks (pool-priorities, pool-deadlines), runs (task-graph), operations per thread (hash-map, lock-free), items per producer (queue-bench, ipc-queues), requests per run (epoll-server)." },
+    [LESSON_PARAM_BUFFER_SIZE]  = { "buffer-size"   , "Items produced and consumed (condition variables, ipc-queues)."                                                                                                                                                              },
+    [LESSON_PARAM_TILE_DIM]     = { "tile-dim"      , "Dimension of square tiles (matrix-tiled)."                                                                                                                                                                                   },
+};
+
+static LESSON_PARAMETERS current_parameters;
+
+/**************************************/
+
+/******** Function definitions ********/
+
+unsigned long getLessonParameter(LESSON_PARAM_ID param_id, unsigned long default_value)
+{
+    if(param_id >= LESSON_PARAMS_NUM || !(current_parameters.set_mask & (1U << param_id)))
+        return default_value;
+
+    return current_parameters.values[param_id];
+}
+
+int setLessonParameter(LESSON_PARAM_ID param_id, unsigned long value)
+{
+    if(param_id >= LESSON_PARAMS_NUM)
+        return -1;
+
+    current_parameters.values[param_id] = value;
+    current_parameters.set_mask |= (1U << param_id);
+
+    return 0;
+}
+
+void clearLessonParameter(LESSON_PARAM_ID param_id)
+{
+    if(param_id < LESSON_PARAMS_NUM)
+        current_parameters.set_mask &= ~(1U << param_id);
+}
+
+int findLessonParameter(const char* name)
+{
+    if(name == NULL)
+        return -1;
+
+    for(int param_id = 0; param_id < LESSON_PARAMS_NUM; param_id++)
+        if(strcmp(param_info[param_id].name, name) == 0)
+            return param_id;
+
+    return -1;
+}
+
+// Parameters must be positive integers, as none of them makes sense being 0.
+int setLessonParameterFromText(const char* name, const char* value)
+{
+    int param_id = findLessonParameter(name);
+
+    if(param_id < 0 || value == NULL || !isdigit((unsigned char)value[0]))
+        return -1;
+
+    char* end;
+    unsigned long parsed = strtoul(value, &end, 10);
+
+    if(*end != 0 || parsed == 0)
+        return -1;
+
+    return setLessonParameter((LESSON_PARAM_ID)param_id, parsed);
+}
+
+const char* getLessonParameterName(LESSON_PARAM_ID param_id)
+{
+    return (param_id < LESSON_PARAMS_NUM ? param_info[param_id].name : NULL);
+}
+
+const char* getLessonParameterDescription(LESSON_PARAM_ID param_id)
+{
+    return (param_id < LESSON_PARAMS_NUM ? param_info[param_id].description : NULL);
+}
+
+// Environment variable names are built from the parameter's name: "mat-dim" is read from THREADS_TUTORIAL_MAT_DIM.
+int loadLessonParametersFromEnvironment()
+{
+    for(int param_id = 0; param_id < LESSON_PARAMS_NUM; param_id++)
+    {
+        char env_name[ENVIRONMENT_NAME_MAX_SIZE];
+        int len = snprintf(env_name, sizeof(env_name), "%s%s", ENVIRONMENT_PREFIX, param_info[param_id].name);
+
+        for(int i = strlen(ENVIRONMENT_PREFIX); i < len; i++)
+            env_name[i] = (env_name[i] == '-' ? '_' : toupper((unsigned char)env_name[i]));
+
+        const char* value = getenv(env_name);
+
+        if(value == NULL)
+            continue;
+
+        if(setLessonParameterFromText(param_info[param_id].name, value) < 0)
+        {
+            printf("Invalid value for %s: %s\r\n", env_name, value);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+void getLessonParameters(LESSON_PARAMETERS* parameters)
+{
+    if(parameters != NULL)
+        *parameters = current_parameters;
+}
+
+void setLessonParameters(const LESSON_PARAMETERS* parameters)
+{
+    if(parameters != NULL)
+        current_parameters = *parameters;
+}
+
+/**************************************/
@@ -0,0 +1,40 @@
+#ifndef LESSON_PARAMETERS_H
+#define LESSON_PARAMETERS_H
+
+/********** Type definitions **********/
+
+typedef enum
+{
+    LESSON_PARAM_THREADS        ,
+    LESSON_PARAM_INCREMENTS     ,
+    LESSON_PARAM_MAT_DIM        ,
+    LESSON_PARAM_ITERATIONS     ,
+    LESSON_PARAM_BUFFER_SIZE    ,
+    LESSON_PARAM_TILE_DIM       ,
+    LESSON_PARAMS_NUM           ,
+} LESSON_PARAM_ID;
+
+typedef struct
+{
+    unsigned long   values[LESSON_PARAMS_NUM]   ;
+    unsigned int    set_mask                    ;   // Bit i is set if parameter i has been explicitly given.
+} LESSON_PARAMETERS;
+
+/**************************************/
+
+/********* Function prototypes ********/
+
+unsigned long   getLessonParameter(LESSON_PARAM_ID param_id, unsigned long default_value);
+int             setLessonParameter(LESSON_PARAM_ID param_id, unsigned long value);
+void            clearLessonParameter(LESSON_PARAM_ID param_id);
+int             setLessonParameterFromText(const char* name, const char* value);
+int             findLessonParameter(const char* name);
+const char*     getLessonParameterName(LESSON_PARAM_ID param_id);
+const char*     getLessonParameterDescription(LESSON_PARAM_ID param_id);
+int             loadLessonParametersFromEnvironment();
+void            getLessonParameters(LESSON_PARAMETERS* parameters);
+void            setLessonParameters(const LESSON_PARAMETERS* parameters);
+
+/**************************************/
+
+#endif
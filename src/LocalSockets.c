@@ -0,0 +1,165 @@
+/*
+Both the metrics exporter (MetricsExporter.c) and the epoll server (EpollServer.c) listen on sockets which just local clients can
+reach: a UNIX domain socket, given its path, or a TCP port bound to the loopback interface, given its number:
+
+int localSocketListen(const char* address, int type_flags)
+
+Where:
+    ·address: the path of a UNIX socket (anything containing a '/', see localSocketIsUnixAddress) or a TCP port. Port 0 takes any
+    free port, which getsockname tells afterwards.
+    ·type_flags: added to SOCK_STREAM | SOCK_CLOEXEC when creating the socket, such as SOCK_NONBLOCK.
+    Returns the listening socket, or -1 on error.
+
+A stale socket file left behind by a previous run is replaced, but no other kind of file is ever removed. Callers remove the socket
+file themselves (unlink) once they are done with it.
+
+Responses are written with localSocketSendAll, which keeps on sending until everything has been sent. Sends on a non-blocking socket
+whose buffer is full are waited for (up to timeout_ms at a time), and MSG_NOSIGNAL keeps clients hanging up early from killing the
+process with SIGPIPE.
+*/
+
+/********* Include statements *********/
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "LocalSockets.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define LISTEN_BACKLOG  128
+#define MAX_PORT        65535
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static int  listenOnUnixSocket(const char* path, int type_flags);
+static int  listenOnLoopbackPort(const char* port, int type_flags);
+
+/**************************************/
+
+/******** Function definitions ********/
+
+static int listenOnUnixSocket(const char* path, int type_flags)
+{
+    struct sockaddr_un address;
+
+    if(strlen(path) >= sizeof(address.sun_path))
+        return -1;
+
+    struct stat path_stat;
+
+    if(lstat(path, &path_stat) == 0 && S_ISSOCK(path_stat.st_mode))
+        unlink(path);
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | type_flags, 0);
+
+    if(fd < 0)
+        return -1;
+
+    if(bind(fd, (struct sockaddr*)&address, sizeof(address)) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    // The socket file exists once bound, so it is removed if the socket cannot be used after all.
+    if(listen(fd, LISTEN_BACKLOG) < 0)
+    {
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+
+    return fd;
+}
+
+static int listenOnLoopbackPort(const char* port, int type_flags)
+{
+    char* end;
+    unsigned long parsed = strtoul(port, &end, 10);
+
+    if(end == port || *end != 0 || parsed > MAX_PORT)
+        return -1;
+
+    struct sockaddr_in address =
+    {
+        .sin_family = AF_INET                           ,
+        .sin_port   = htons((unsigned short)parsed)     ,
+        .sin_addr   = { .s_addr = htonl(INADDR_LOOPBACK) },
+    };
+
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC | type_flags, 0);
+
+    if(fd < 0)
+        return -1;
+
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    if(bind(fd, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(fd, LISTEN_BACKLOG) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+int localSocketListen(const char* address, int type_flags)
+{
+    if(address == NULL)
+        return -1;
+
+    return (localSocketIsUnixAddress(address) ? listenOnUnixSocket(address, type_flags) : listenOnLoopbackPort(address, type_flags));
+}
+
+int localSocketIsUnixAddress(const char* address)
+{
+    return (strchr(address, '/') != NULL);
+}
+
+// Returns -1 if the peer is gone, or did not make room for the rest of the data within timeout_ms.
+int localSocketSendAll(int fd, const char* data, size_t size, int timeout_ms)
+{
+    while(size > 0)
+    {
+        ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+
+        if(sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        {
+            struct pollfd peer_poll = { .fd = fd, .events = POLLOUT };
+
+            if(errno != EINTR && poll(&peer_poll, 1, timeout_ms) <= 0)
+                return -1;
+
+            continue;
+        }
+
+        if(sent <= 0)
+            return -1;
+
+        data += sent;
+        size -= (size_t)sent;
+    }
+
+    return 0;
+}
+
+/**************************************/
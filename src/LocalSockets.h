@@ -0,0 +1,18 @@
+#ifndef LOCAL_SOCKETS_H
+#define LOCAL_SOCKETS_H
+
+/********* Include statements *********/
+
+#include <stddef.h>
+
+/**************************************/
+
+/********* Function prototypes ********/
+
+int localSocketListen(const char* address, int type_flags);
+int localSocketIsUnixAddress(const char* address);
+int localSocketSendAll(int fd, const char* data, size_t size, int timeout_ms);
+
+/**************************************/
+
+#endif
@@ -0,0 +1,185 @@
+/*
+The Michael-Scott queue is the lock-free counterpart of a linked list with a mutex, where items are taken from the head and added at
+the tail. Both ends are atomic pointers, and the list always starts with a dummy node, so head and tail never point to nothing:
+
+int lockFreeQueueEnqueue(LOCK_FREE_QUEUE* queue, void* value)
+int lockFreeQueueDequeue(LOCK_FREE_QUEUE* queue, void** value)
+
+Where:
+    ·Enqueuing links a new node after the last one (a compare-and-swap on the last node's next pointer), then moves the tail to it
+    (another compare-and-swap).
+    ·Dequeuing takes the value of the node after the dummy one, and moves the head to it (a compare-and-swap): that node becomes the
+    new dummy, and the old dummy is retired.
+
+Enqueuing takes two steps, so other threads may find the tail lagging behind the last node. Rather than waiting for the enqueuing
+thread to move it, they move it themselves and try again: no thread ever waits for another, so the queue keeps going even if
+threads are preempted halfway through an operation.
+
+As with Treiber's stack (see LockFreeStack.c), nodes are read by threads which may not have noticed they were dequeued meanwhile, so
+they are protected with hazard pointers (see HazardPointers.c) and retired rather than freed. Dequeuing reads two nodes (the dummy
+node and the one after it), so it takes two hazard pointers.
+*/
+
+/********* Include statements *********/
+
+#include <stdlib.h>
+#include <stdatomic.h>
+#include "HazardPointers.h"
+#include "LockFreeQueue.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define QUEUE_END_HAZARD    0   // Head or tail node.
+#define QUEUE_NEXT_HAZARD   1   // Node after the head.
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+typedef struct LOCK_FREE_QUEUE_NODE
+{
+    void*                                   value   ;
+    struct LOCK_FREE_QUEUE_NODE* _Atomic    next    ;
+} LOCK_FREE_QUEUE_NODE;
+
+struct LOCK_FREE_QUEUE
+{
+    LOCK_FREE_QUEUE_NODE* _Atomic   head    ;   // Dummy node: values are taken from the node after it.
+    LOCK_FREE_QUEUE_NODE* _Atomic   tail    ;   // Last node, or one lagging behind it.
+};
+
+/**************************************/
+
+/******** Function definitions ********/
+
+// Returns NULL if the queue (or its dummy node) could not be allocated.
+LOCK_FREE_QUEUE* lockFreeQueueCreate()
+{
+    LOCK_FREE_QUEUE* queue = (LOCK_FREE_QUEUE*)malloc(sizeof(LOCK_FREE_QUEUE));
+    LOCK_FREE_QUEUE_NODE* dummy = (LOCK_FREE_QUEUE_NODE*)calloc(1, sizeof(LOCK_FREE_QUEUE_NODE));
+
+    if(queue == NULL || dummy == NULL)
+    {
+        free(queue);
+        free(dummy);
+        return NULL;
+    }
+
+    atomic_store(&queue->head, dummy);
+    atomic_store(&queue->tail, dummy);
+
+    return queue;
+}
+
+// No other thread may be using the queue anymore. Nodes already dequeued are freed by hazardPointerReclaimAll.
+void lockFreeQueueDestroy(LOCK_FREE_QUEUE* queue)
+{
+    if(queue == NULL)
+        return;
+
+    LOCK_FREE_QUEUE_NODE* node = atomic_load(&queue->head);
+
+    while(node != NULL)
+    {
+        LOCK_FREE_QUEUE_NODE* next = atomic_load(&node->next);
+
+        free(node);
+        node = next;
+    }
+
+    free(queue);
+}
+
+// Returns 0 on success, -1 if the node could not be allocated.
+int lockFreeQueueEnqueue(LOCK_FREE_QUEUE* queue, void* value)
+{
+    LOCK_FREE_QUEUE_NODE* node = (LOCK_FREE_QUEUE_NODE*)malloc(sizeof(LOCK_FREE_QUEUE_NODE));
+
+    if(queue == NULL || node == NULL)
+    {
+        free(node);
+        return -1;
+    }
+
+    node->value = value;
+    atomic_store(&node->next, NULL);
+
+    while(1)
+    {
+        LOCK_FREE_QUEUE_NODE* tail = (LOCK_FREE_QUEUE_NODE*)hazardPointerProtect(QUEUE_END_HAZARD, (void* _Atomic*)&queue->tail);
+        LOCK_FREE_QUEUE_NODE* next = atomic_load(&tail->next);
+
+        if(tail != atomic_load(&queue->tail))
+            continue;
+
+        // The tail lags behind the last node: move it forward on behalf of whoever enqueued it, then try again.
+        if(next != NULL)
+        {
+            atomic_compare_exchange_strong(&queue->tail, &tail, next);
+            continue;
+        }
+
+        LOCK_FREE_QUEUE_NODE* expected = NULL;
+
+        if(atomic_compare_exchange_strong(&tail->next, &expected, node))
+        {
+            // Whether this or some other thread moves the tail makes no difference.
+            atomic_compare_exchange_strong(&queue->tail, &tail, node);
+            hazardPointerClear(QUEUE_END_HAZARD);
+
+            return 0;
+        }
+    }
+}
+
+// Returns 1 if a value was dequeued (and stored in "value", if not NULL), 0 if the queue was empty.
+int lockFreeQueueDequeue(LOCK_FREE_QUEUE* queue, void** value)
+{
+    if(queue == NULL)
+        return 0;
+
+    while(1)
+    {
+        LOCK_FREE_QUEUE_NODE* head = (LOCK_FREE_QUEUE_NODE*)hazardPointerProtect(QUEUE_END_HAZARD, (void* _Atomic*)&queue->head);
+        LOCK_FREE_QUEUE_NODE* tail = atomic_load(&queue->tail);
+        LOCK_FREE_QUEUE_NODE* next = (LOCK_FREE_QUEUE_NODE*)hazardPointerProtect(QUEUE_NEXT_HAZARD, (void* _Atomic*)&head->next);
+
+        // Unless the head is still the same, its next node may have been dequeued (and retired) before being protected.
+        if(head != atomic_load(&queue->head))
+            continue;
+
+        if(next == NULL)
+        {
+            hazardPointerClear(QUEUE_END_HAZARD);
+            hazardPointerClear(QUEUE_NEXT_HAZARD);
+
+            return 0;
+        }
+
+        // The head must never get past the tail, or the tail would point to a retired node.
+        if(head == tail)
+        {
+            atomic_compare_exchange_strong(&queue->tail, &tail, next);
+            continue;
+        }
+
+        void* next_value = next->value;
+
+        if(atomic_compare_exchange_strong(&queue->head, &head, next))
+        {
+            hazardPointerClear(QUEUE_END_HAZARD);
+            hazardPointerClear(QUEUE_NEXT_HAZARD);
+
+            if(value != NULL)
+                *value = next_value;
+
+            hazardPointerRetire(head, free);
+
+            return 1;
+        }
+    }
+}
+
+/**************************************/
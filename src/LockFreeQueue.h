@@ -0,0 +1,19 @@
+#ifndef LOCK_FREE_QUEUE_H
+#define LOCK_FREE_QUEUE_H
+
+/********** Type definitions **********/
+
+typedef struct LOCK_FREE_QUEUE LOCK_FREE_QUEUE;
+
+/**************************************/
+
+/********* Function prototypes ********/
+
+LOCK_FREE_QUEUE*    lockFreeQueueCreate();
+void                lockFreeQueueDestroy(LOCK_FREE_QUEUE* queue);
+int                 lockFreeQueueEnqueue(LOCK_FREE_QUEUE* queue, void* value);
+int                 lockFreeQueueDequeue(LOCK_FREE_QUEUE* queue, void** value);
+
+/**************************************/
+
+#endif
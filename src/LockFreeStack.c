@@ -0,0 +1,129 @@
+/*
+A stack shared by many threads is usually a linked list guarded by a mutex. Treiber's stack needs no lock at all: its top is a single
+atomic pointer, and every push or pop is a compare-and-swap on it.
+
+int lockFreeStackPush(LOCK_FREE_STACK* stack, void* value)
+int lockFreeStackPop(LOCK_FREE_STACK* stack, void** value)
+
+Where:
+    ·Pushing links a new node to the current top, then swaps the top for the new node, as long as the top has not changed meanwhile.
+    ·Popping reads the top and its next node, then swaps the top for the next node, again as long as the top has not changed.
+    ·If some other thread got there first, the compare-and-swap fails and the operation is tried again with the new top. Some
+    thread always succeeds, so the stack as a whole always makes progress, even if threads are preempted at any point (which a lock
+    holder being preempted would not allow).
+
+The catch is popping: between reading the top and swapping it, another thread may pop the same node and free it, so reading its next
+node would read freed memory. Worse, the node's memory may be allocated again and pushed back, so the swap succeeds with a stale next
+node (the ABA problem). Hazard pointers (see HazardPointers.c) avoid both: the top is protected before being read from, and popped
+nodes are retired instead of freed, so no node is freed or reused while some thread may still be looking at it.
+*/
+
+/********* Include statements *********/
+
+#include <stdlib.h>
+#include <stdatomic.h>
+#include "HazardPointers.h"
+#include "LockFreeStack.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define STACK_TOP_HAZARD    0
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+typedef struct LOCK_FREE_STACK_NODE
+{
+    void*                           value   ;
+    struct LOCK_FREE_STACK_NODE*    next    ;   // Never changed once the node has been pushed.
+} LOCK_FREE_STACK_NODE;
+
+struct LOCK_FREE_STACK
+{
+    LOCK_FREE_STACK_NODE* _Atomic   top ;
+};
+
+/**************************************/
+
+/******** Function definitions ********/
+
+LOCK_FREE_STACK* lockFreeStackCreate()
+{
+    return (LOCK_FREE_STACK*)calloc(1, sizeof(LOCK_FREE_STACK));
+}
+
+// No other thread may be using the stack anymore. Nodes already popped are freed by hazardPointerReclaimAll.
+void lockFreeStackDestroy(LOCK_FREE_STACK* stack)
+{
+    if(stack == NULL)
+        return;
+
+    LOCK_FREE_STACK_NODE* node = atomic_load(&stack->top);
+
+    while(node != NULL)
+    {
+        LOCK_FREE_STACK_NODE* next = node->next;
+
+        free(node);
+        node = next;
+    }
+
+    free(stack);
+}
+
+// Returns 0 on success, -1 if the node could not be allocated.
+int lockFreeStackPush(LOCK_FREE_STACK* stack, void* value)
+{
+    LOCK_FREE_STACK_NODE* node = (LOCK_FREE_STACK_NODE*)malloc(sizeof(LOCK_FREE_STACK_NODE));
+
+    if(stack == NULL || node == NULL)
+    {
+        free(node);
+        return -1;
+    }
+
+    node->value = value;
+    node->next = atomic_load(&stack->top);
+
+    // On failure, the top seen is stored into node->next, so the node is ready for the next attempt. The new node is not shared yet,
+    // so it needs no protection.
+    while(!atomic_compare_exchange_weak(&stack->top, &node->next, node));
+
+    return 0;
+}
+
+// Returns 1 if a value was popped (and stored in "value", if not NULL), 0 if the stack was empty.
+int lockFreeStackPop(LOCK_FREE_STACK* stack, void** value)
+{
+    if(stack == NULL)
+        return 0;
+
+    while(1)
+    {
+        LOCK_FREE_STACK_NODE* top = (LOCK_FREE_STACK_NODE*)hazardPointerProtect(STACK_TOP_HAZARD, (void* _Atomic*)&stack->top);
+
+        if(top == NULL)
+        {
+            hazardPointerClear(STACK_TOP_HAZARD);
+            return 0;
+        }
+
+        // The protected node cannot be freed (nor pushed again), so its next node is still the right one if the top is unchanged.
+        if(atomic_compare_exchange_weak(&stack->top, &top, top->next))
+        {
+            hazardPointerClear(STACK_TOP_HAZARD);
+
+            if(value != NULL)
+                *value = top->value;
+
+            hazardPointerRetire(top, free);
+
+            return 1;
+        }
+    }
+}
+
+/**************************************/
@@ -0,0 +1,19 @@
+#ifndef LOCK_FREE_STACK_H
+#define LOCK_FREE_STACK_H
+
+/********** Type definitions **********/
+
+typedef struct LOCK_FREE_STACK LOCK_FREE_STACK;
+
+/**************************************/
+
+/********* Function prototypes ********/
+
+LOCK_FREE_STACK*    lockFreeStackCreate();
+void                lockFreeStackDestroy(LOCK_FREE_STACK* stack);
+int                 lockFreeStackPush(LOCK_FREE_STACK* stack, void* value);
+int                 lockFreeStackPop(LOCK_FREE_STACK* stack, void** value);
+
+/**************************************/
+
+#endif
@@ -0,0 +1,445 @@
+/*
+LockFreeStack.c and LockFreeQueue.c share stacks and queues between threads without any lock, freeing their nodes safely through
+hazard pointers (see HazardPointers.c). This lesson compares them with the usual way of doing the same: a linked list guarded by a
+mutex.
+
+Every thread pushes (or enqueues) a value and pops (or dequeues) one, over and over, so all of them keep hitting both ends of the
+same structure at once. Each of the four structures (stack and queue, with a mutex or lock-free) is run by a growing number of
+threads (1, 2, 4, ... up to the "threads" lesson parameter, or the available CPUs), and the number of operations per second they get
+through together is printed side by side.
+
+Values are unique, and every thread adds up what it pushes and what it pops. Once threads are joined, whatever is left is drained
+and added up as well, so both sums must match: a lost or duplicated value (such as a node popped twice after being freed and
+reused) would tell them apart. Hazard pointer statistics tell how many nodes were retired and freed, and how many scans that took.
+
+Lock-free does not mean faster: a compare-and-swap failing because another thread got there first has to be tried again, much as a
+mutex has to be waited for. What lock-free structures guarantee is that a thread being preempted (or stopped) halfway through an
+operation never keeps the others from going on, which a thread holding a mutex does. The number of push and pop pairs per thread is
+the "iterations" lesson parameter.
+
+Building with -fsanitize=address (see README.md) checks the same runs for nodes used after being freed, as long as allocation tracking
+(see AllocationTracker.c) is left out. For data races, the structures and HazardPointers.c are built with -fsanitize=thread into a
+program of their own, stress/LockFreeStress.c, which checks that values are neither lost, duplicated nor reordered as well.
+*/
+
+/********* Include statements *********/
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include "ThreadColors.h"
+#include "ThreadCreationStatus.h"
+#include "ThreadTracer.h"
+#include "HazardPointers.h"
+#include "LockFreeStack.h"
+#include "LockFreeQueue.h"
+#include "LatencyHistogram.h"
+#include "LessonParameters.h"
+#include "LockFreeStructures.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define DEFAULT_PAIRS_PER_THREAD    100000
+#define MAX_BENCHMARK_THREADS       64
+#define PREFILLED_VALUES            64      // So that pops hardly ever find the structure empty.
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+typedef struct MUTEX_LIST_NODE
+{
+    void*                   value   ;
+    struct MUTEX_LIST_NODE* next    ;
+} MUTEX_LIST_NODE;
+
+typedef struct
+{
+    pthread_mutex_t     lock    ;
+    MUTEX_LIST_NODE*    head    ;
+    MUTEX_LIST_NODE*    tail    ;
+} MUTEX_LIST;
+
+// Every structure is used through the same functions, so that the benchmark does not care which one it is running.
+typedef struct
+{
+    const char* name                                    ;
+    void*       (*create)()                             ;
+    void        (*destroy)(void* structure)             ;
+    int         (*push)(void* structure, void* value)   ;
+    int         (*pop)(void* structure, void** value)   ;
+} STRUCTURE_OPERATIONS;
+
+typedef struct
+{
+    const STRUCTURE_OPERATIONS* operations      ;
+    void*                       structure       ;
+    atomic_int*                 start           ;   // Set once every thread has been created, so that they all start at once.
+    unsigned long               pairs_num       ;
+    uintptr_t                   first_value     ;   // Values pushed go from first_value to first_value + pairs_num - 1.
+    unsigned long long          pushed_sum      ;
+    unsigned long long          popped_sum      ;
+} BENCHMARK_THREAD_DATA;
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static void*        mutexListCreate();
+static void         mutexListDestroy(void* structure);
+static int          mutexStackPush(void* structure, void* value);
+static int          mutexQueueEnqueue(void* structure, void* value);
+static int          mutexListPop(void* structure, void** value);
+static void*        lockFreeStackCreateAny();
+static void         lockFreeStackDestroyAny(void* structure);
+static int          lockFreeStackPushAny(void* structure, void* value);
+static int          lockFreeStackPopAny(void* structure, void** value);
+static void*        lockFreeQueueCreateAny();
+static void         lockFreeQueueDestroyAny(void* structure);
+static int          lockFreeQueueEnqueueAny(void* structure, void* value);
+static int          lockFreeQueueDequeueAny(void* structure, void** value);
+static void*        benchmarkRoutine(void* arg);
+static double       runBenchmark(const STRUCTURE_OPERATIONS* operations, unsigned int threads_num, unsigned long pairs_num, int* consistent);
+static unsigned int getAvailableCPUs();
+
+/**************************************/
+
+/********* Private variables **********/
+
+static const STRUCTURE_OPERATIONS structures[] =
+{
+    { "Mutex stack"     , mutexListCreate           , mutexListDestroy          , mutexStackPush            , mutexListPop              },
+    { "Treiber stack"   , lockFreeStackCreateAny    , lockFreeStackDestroyAny   , lockFreeStackPushAny      , lockFreeStackPopAny       },
+    { "Mutex queue"     , mutexListCreate           , mutexListDestroy          , mutexQueueEnqueue         , mutexListPop              },
+    { "M-S queue"       , lockFreeQueueCreateAny    , lockFreeQueueDestroyAny   , lockFreeQueueEnqueueAny   , lockFreeQueueDequeueAny   },
+};
+
+/**************************************/
+
+/******** Function definitions ********/
+
+static void* mutexListCreate()
+{
+    MUTEX_LIST* list = (MUTEX_LIST*)calloc(1, sizeof(MUTEX_LIST));
+
+    if(list != NULL)
+        pthread_mutex_init(&list->lock, NULL);
+
+    return list;
+}
+
+static void mutexListDestroy(void* structure)
+{
+    MUTEX_LIST* list = (MUTEX_LIST*)structure;
+
+    while(list->head != NULL)
+    {
+        MUTEX_LIST_NODE* next = list->head->next;
+
+        free(list->head);
+        list->head = next;
+    }
+
+    pthread_mutex_destroy(&list->lock);
+    free(list);
+}
+
+// Nodes are allocated before taking the lock, just as lock-free structures do before their compare-and-swap.
+static int mutexStackPush(void* structure, void* value)
+{
+    MUTEX_LIST* list = (MUTEX_LIST*)structure;
+    MUTEX_LIST_NODE* node = (MUTEX_LIST_NODE*)malloc(sizeof(MUTEX_LIST_NODE));
+
+    if(node == NULL)
+        return -1;
+
+    node->value = value;
+
+    pthread_mutex_lock(&list->lock);
+
+    node->next = list->head;
+    list->head = node;
+
+    if(list->tail == NULL)
+        list->tail = node;
+
+    pthread_mutex_unlock(&list->lock);
+
+    return 0;
+}
+
+static int mutexQueueEnqueue(void* structure, void* value)
+{
+    MUTEX_LIST* list = (MUTEX_LIST*)structure;
+    MUTEX_LIST_NODE* node = (MUTEX_LIST_NODE*)malloc(sizeof(MUTEX_LIST_NODE));
+
+    if(node == NULL)
+        return -1;
+
+    node->value = value;
+    node->next = NULL;
+
+    pthread_mutex_lock(&list->lock);
+
+    if(list->tail != NULL)
+        list->tail->next = node;
+    else
+        list->head = node;
+
+    list->tail = node;
+
+    pthread_mutex_unlock(&list->lock);
+
+    return 0;
+}
+
+// Both stacks and queues take values from the head.
+static int mutexListPop(void* structure, void** value)
+{
+    MUTEX_LIST* list = (MUTEX_LIST*)structure;
+
+    pthread_mutex_lock(&list->lock);
+
+    MUTEX_LIST_NODE* node = list->head;
+
+    if(node != NULL)
+    {
+        list->head = node->next;
+
+        if(list->head == NULL)
+            list->tail = NULL;
+    }
+
+    pthread_mutex_unlock(&list->lock);
+
+    if(node == NULL)
+        return 0;
+
+    *value = node->value;
+    free(node);
+
+    return 1;
+}
+
+static void* lockFreeStackCreateAny()
+{
+    return lockFreeStackCreate();
+}
+
+static void lockFreeStackDestroyAny(void* structure)
+{
+    lockFreeStackDestroy((LOCK_FREE_STACK*)structure);
+}
+
+static int lockFreeStackPushAny(void* structure, void* value)
+{
+    return lockFreeStackPush((LOCK_FREE_STACK*)structure, value);
+}
+
+static int lockFreeStackPopAny(void* structure, void** value)
+{
+    return lockFreeStackPop((LOCK_FREE_STACK*)structure, value);
+}
+
+static void* lockFreeQueueCreateAny()
+{
+    return lockFreeQueueCreate();
+}
+
+static void lockFreeQueueDestroyAny(void* structure)
+{
+    lockFreeQueueDestroy((LOCK_FREE_QUEUE*)structure);
+}
+
+static int lockFreeQueueEnqueueAny(void* structure, void* value)
+{
+    return lockFreeQueueEnqueue((LOCK_FREE_QUEUE*)structure, value);
+}
+
+static int lockFreeQueueDequeueAny(void* structure, void** value)
+{
+    return lockFreeQueueDequeue((LOCK_FREE_QUEUE*)structure, value);
+}
+
+static void* benchmarkRoutine(void* arg)
+{
+    BENCHMARK_THREAD_DATA* data = (BENCHMARK_THREAD_DATA*)arg;
+    void* value;
+
+    while(!atomic_load(data->start))
+        sched_yield();
+
+    for(unsigned long pair_idx = 0; pair_idx < data->pairs_num; pair_idx++)
+    {
+        uintptr_t pushed = data->first_value + pair_idx;
+
+        if(data->operations->push(data->structure, (void*)pushed) == 0)
+            data->pushed_sum += pushed;
+
+        if(data->operations->pop(data->structure, &value))
+            data->popped_sum += (uintptr_t)value;
+    }
+
+    return NULL;
+}
+
+// Returns millions of operations (pushes and pops) per second, or a negative value on failure. "consistent" tells whether every
+// value pushed was popped exactly once.
+static double runBenchmark(const STRUCTURE_OPERATIONS* operations, unsigned int threads_num, unsigned long pairs_num, int* consistent)
+{
+    pthread_t threads[MAX_BENCHMARK_THREADS];
+    BENCHMARK_THREAD_DATA threads_data[MAX_BENCHMARK_THREADS];
+    atomic_int start = 0;
+    void* structure = operations->create();
+    unsigned long long pushed_sum = 0;
+    unsigned long long popped_sum = 0;
+    void* value;
+
+    if(structure == NULL)
+        return -1.0;
+
+    // Prefilled values go from 1 to PREFILLED_VALUES, and every thread's values come after them.
+    for(uintptr_t prefilled = 1; prefilled <= PREFILLED_VALUES; prefilled++)
+        if(operations->push(structure, (void*)prefilled) == 0)
+            pushed_sum += prefilled;
+
+    unsigned int created_num = 0;
+
+    for(; created_num < threads_num; created_num++)
+    {
+        threads_data[created_num] = (BENCHMARK_THREAD_DATA)
+        {
+            .operations     = operations                                        ,
+            .structure      = structure                                         ,
+            .start          = &start                                            ,
+            .pairs_num      = pairs_num                                         ,
+            .first_value    = PREFILLED_VALUES + 1 + created_num * pairs_num    ,
+            .pushed_sum     = 0                                                 ,
+            .popped_sum     = 0                                                 ,
+        };
+
+        if(checkThreadCreationStatus( TRACED_THREAD_CREATE(&threads[created_num], NULL, benchmarkRoutine, &threads_data[created_num]) ))
+            break;
+    }
+
+    // If not every thread could be created, the ones which were are let go with nothing to do.
+    if(created_num < threads_num)
+        for(unsigned int thread_idx = 0; thread_idx < created_num; thread_idx++)
+            threads_data[thread_idx].pairs_num = 0;
+
+    unsigned long long start_ns = latencyHistogramGetTimeNs();
+
+    atomic_store(&start, 1);
+
+    for(unsigned int thread_idx = 0; thread_idx < created_num; thread_idx++)
+    {
+        pthread_join(threads[thread_idx], NULL);
+
+        pushed_sum += threads_data[thread_idx].pushed_sum;
+        popped_sum += threads_data[thread_idx].popped_sum;
+    }
+
+    unsigned long long elapsed_ns = latencyHistogramGetTimeNs() - start_ns;
+
+    while(operations->pop(structure, &value))
+        popped_sum += (uintptr_t)value;
+
+    *consistent = (pushed_sum == popped_sum);
+
+    operations->destroy(structure);
+
+    // Every thread has been joined, so nodes still waiting for a scan can be freed right away.
+    hazardPointerReclaimAll();
+
+    if(created_num < threads_num || elapsed_ns == 0)
+        return -1.0;
+
+    return (double)pairs_num * 2 * threads_num * 1000.0 / (double)elapsed_ns;
+}
+
+static unsigned int getAvailableCPUs()
+{
+    cpu_set_t cpu_set;
+
+    if(sched_getaffinity(0, sizeof(cpu_set), &cpu_set) < 0)
+        return 1;
+
+    int cpus_num = CPU_COUNT(&cpu_set);
+
+    return (cpus_num > 0 ? (unsigned int)cpus_num : 1);
+}
+
+void exampleLockFreeStructures()
+{
+    // The number of push and pop pairs per thread and the largest number of threads can be given as lesson parameters (see
+    // LessonParameters.c). Threads go up to one per available CPU otherwise.
+    unsigned long pairs_num = getLessonParameter(LESSON_PARAM_ITERATIONS, DEFAULT_PAIRS_PER_THREAD);
+    unsigned int max_threads = (unsigned int)getLessonParameter(LESSON_PARAM_THREADS, getAvailableCPUs());
+    int all_consistent = 1;
+
+    if(max_threads < 1)
+        max_threads = 1;
+
+    if(max_threads > MAX_BENCHMARK_THREADS)
+        max_threads = MAX_BENCHMARK_THREADS;
+
+    printf("%s%lu push and pop pair(s) per thread, in millions of operations per second.%s\r\n",
+            PRINT_COLOR_GREEN   ,
+            pairs_num           ,
+            PRINT_COLOR_RESET   );
+
+    printf("\tThreads");
+
+    for(unsigned int structure_idx = 0; structure_idx < sizeof(structures) / sizeof(structures[0]); structure_idx++)
+        printf("\t%14s", structures[structure_idx].name);
+
+    printf("\r\n");
+
+    for(unsigned int threads_num = 1; ; threads_num = (threads_num * 2 < max_threads ? threads_num * 2 : max_threads))
+    {
+        printf("\t%u", threads_num);
+
+        for(unsigned int structure_idx = 0; structure_idx < sizeof(structures) / sizeof(structures[0]); structure_idx++)
+        {
+            int consistent;
+            double mops = runBenchmark(&structures[structure_idx], threads_num, pairs_num, &consistent);
+
+            if(mops < 0)
+            {
+                printf("\r\n%sCould not run the benchmark, so the procedure cannot go on.%s\r\n", PRINT_COLOR_RED, PRINT_COLOR_RESET);
+                return;
+            }
+
+            all_consistent &= consistent;
+            printf("\t%14.2f", mops);
+        }
+
+        printf("\r\n");
+
+        if(threads_num == max_threads)
+            break;
+    }
+
+    HAZARD_POINTER_STATS stats;
+    hazardPointerGetStats(&stats);
+
+    printf("Hazard pointers: %llu node(s) retired, %llu freed, in %llu scan(s) by %u thread record(s).\r\n",
+            stats.retired   ,
+            stats.reclaimed ,
+            stats.scans     ,
+            stats.records   );
+
+    if(all_consistent)
+        printf("%sEvery value pushed was popped exactly once.%s\r\n", PRINT_COLOR_GREEN, PRINT_COLOR_RESET);
+    else
+        printf("%sValues were lost or popped more than once.%s\r\n", PRINT_COLOR_RED, PRINT_COLOR_RESET);
+}
+
+/**************************************/
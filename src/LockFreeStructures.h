@@ -0,0 +1,10 @@
+#ifndef LOCK_FREE_STRUCTURES_H
+#define LOCK_FREE_STRUCTURES_H
+
+/********* Function prototypes ********/
+
+void exampleLockFreeStructures();
+
+/**************************************/
+
+#endif
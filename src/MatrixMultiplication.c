@@ -1,7 +1,20 @@
 /*
 In this example, a couple of matrices are going to be multiplied, giving a third matrix as result. Every element in the resulting
-matrix will be calculated by a thread. Thus, if the outcoming matrix size was 3x2 (6 elements), six threads would run in
-parallel for those element values to be calculated.
+matrix is an independent task, which any thread can take. A thread per online CPU is requested by default (or as many as given by
+the "threads" lesson parameter), but never more than elements: if the outcoming matrix size was 3x2 (6 elements), no more than six
+threads would be requested to run in parallel for those element values to be calculated.
+
+Threads are requested to the thread budget governor (see ThreadBudget.c) though, so if the system is close to its limits fewer threads
+are granted. Each thread keeps taking the next pending element until none is left, so the multiplication degrades to fewer threads
+instead of failing. The same happens if the system refuses to create any of the granted threads.
+
+How well this decomposition can scale is measured by the work/span analysis (see WorkSpan.c) if enabled: matrix setup is a serial
+strand, and each element is a task of the parallel section. Elements are tiny tasks (a row by column product), so parallelism is
+huge, but so is the overhead of handing them out one at a time.
+
+Threads are created with default attributes. Asking for a real-time scheduling policy (such as SCHED_RR at maximum priority) takes
+privileges most users lack, and would not make every element any faster anyway, since all threads would get the same priority. When
+some work really is more urgent than the rest, it is better prioritized as tasks on a thread pool (see ThreadPoolPriorities.c).
 
 Note that even if not strictly necessary, a mutex lock is used so that only a single thread is able to modify the resulting
 matrix each time.
@@ -14,11 +27,16 @@ Disclaimer: this may not be the most efficient approach, yet it may be good enou
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <sched.h>
 #include <time.h>
 #include <string.h>
+#include <unistd.h>
+#include <stdatomic.h>
 #include "ThreadColors.h"
 #include "ThreadCreationStatus.h"
+#include "ThreadBudget.h"
+#include "ThreadTracer.h"
+#include "LessonParameters.h"
+#include "WorkSpan.h"
 #include "MatrixMultiplication.h"
 
 /**************************************/
@@ -32,6 +50,7 @@ Disclaimer: this may not be the most efficient approach, yet it may be good enou
 #define MAT_NAME_HEADER "Matrix "
 #define MAT_HEADER_SEP  '.'
 #define MAT_DELIM_SIZE  5
+#define MAX_PRINTED_DIM 10
 
 /**************************************/
 
@@ -44,19 +63,16 @@ typedef struct
     int** mat_C;
 
     unsigned int mat_A_cols;
+    unsigned int mat_C_cols;
 
-    pthread_mutex_t* p_mutex_C;
+    unsigned int elements_num;
+    atomic_uint next_element;
 
-} MATRIX_MULT_COMMON_DATA;
-
-typedef struct
-{
-    unsigned int target_row_A;
-    unsigned int target_col_B;
+    pthread_mutex_t* p_mutex_C;
 
-    MATRIX_MULT_COMMON_DATA* p_matrix_mult_common_data; 
+    WORK_SPAN_JOB* job;
 
-} MATRIX_MULT_DATA;
+} MATRIX_MULT_COMMON_DATA;
 
 /**************************************/
 
@@ -69,7 +85,6 @@ static int**    createRandomValuesMatrix(unsigned int rows, unsigned int cols, i
 static void     deallocateMatrix(int** mat, unsigned int rows);
 static int      multiplyRowByColumn(int** A, int** B, unsigned int A_cols, unsigned int row_A, unsigned int col_B);
 static void     printMatrix(int** mat, unsigned int rows, unsigned int cols, char* matrix_name, char* color);
-static int      setAttr(pthread_attr_t* p_attr, int scheduling_policy, struct sched_param* scheduling_priority, int schdueling_policy_inheritance);
 static void*    matrixMultThreadRoutine(void* arg);
 
 /**************************************/
@@ -202,69 +217,64 @@ static void printMatrix(int** mat, unsigned int rows, unsigned int cols, char* m
     printf("\r\n");
 }
 
-static int setAttr(pthread_attr_t* p_attr, int scheduling_policy, struct sched_param* scheduling_priority, int schdueling_policy_inheritance)
+static void* matrixMultThreadRoutine(void* arg)
 {
-    int err;
+    // Make the thread cancellable (deferred).
+    pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+    pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, NULL);
 
-    // Set scheduling policy
-    if((err = pthread_attr_setschedpolicy(p_attr, scheduling_policy)))
-    {
-        printf("Error setting scheduling policy: %s\r\n", strerror(err));
-        return err;
-    }
+    MATRIX_MULT_COMMON_DATA* p_common_data = (MATRIX_MULT_COMMON_DATA*)arg;
 
-    // Set scheduling priority
-    if((err = pthread_attr_setschedparam(p_attr, scheduling_priority)))
-    {
-        printf("Error setting scheduling parameter: %s\r\n", strerror(err));
-        return err;
-    }
+    // Keep taking pending elements until every one of them has been calculated. This way, any number of threads (even a single one)
+    // is able to complete the whole resulting matrix.
+    unsigned int element_idx;
 
-    // Set explicit scheduling to override inherited scheduling
-    if((err = pthread_attr_setinheritsched(p_attr, schdueling_policy_inheritance)))
+    while((element_idx = atomic_fetch_add(&p_common_data->next_element, 1)) < p_common_data->elements_num)
     {
-        printf("Error setting inherit scheduling at line : %s\r\n", strerror(err));
-        return err;
-    }
+        WORK_SPAN_TASK task;
+        workSpanTaskBegin(&task);
 
-    return err;
-}
+        unsigned int target_row_A = (element_idx / p_common_data->mat_C_cols);
+        unsigned int target_col_B = (element_idx % p_common_data->mat_C_cols);
 
-static void* matrixMultThreadRoutine(void* arg)
-{
-    // Make the thread cancellable (deferred).
-    pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
-    pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, NULL);
+        int calculated_value = multiplyRowByColumn( p_common_data->mat_A        ,
+                                                    p_common_data->mat_B        ,
+                                                    p_common_data->mat_A_cols   ,
+                                                    target_row_A                ,
+                                                    target_col_B                );
 
-    MATRIX_MULT_DATA* p_matrix_mult_data = (MATRIX_MULT_DATA*)arg;
+        // Write the calculated value onto the resulting matrix, making sure just a single thread modifies it at a each time.
+        // TRACED_* macros are just the plain calls unless the tracer is compiled in (see ThreadTracer.c).
+        TRACED_MUTEX_LOCK(p_common_data->p_mutex_C);
 
-    int calculated_value = multiplyRowByColumn( p_matrix_mult_data->p_matrix_mult_common_data->mat_A        ,
-                                                p_matrix_mult_data->p_matrix_mult_common_data->mat_B        ,
-                                                p_matrix_mult_data->p_matrix_mult_common_data->mat_A_cols   ,
-                                                p_matrix_mult_data->target_row_A                            ,
-                                                p_matrix_mult_data->target_col_B                            );
-    
-    // Write the calculated value onto the resulting matrix, making sure just a single thread modifies it at a each time.
-    pthread_mutex_lock(p_matrix_mult_data->p_matrix_mult_common_data->p_mutex_C);
+        p_common_data->mat_C[target_row_A][target_col_B] = calculated_value;
 
-    p_matrix_mult_data->p_matrix_mult_common_data->mat_C[p_matrix_mult_data->target_row_A][p_matrix_mult_data->target_col_B] = calculated_value;
+        TRACED_MUTEX_UNLOCK(p_common_data->p_mutex_C);
 
-    pthread_mutex_unlock(p_matrix_mult_data->p_matrix_mult_common_data->p_mutex_C);
+        workSpanTaskEnd(p_common_data->job, &task);
+    }
 
     return NULL;
 }
 
 void exampleMatrixMultiplication()
 {
+    // The whole multiplication (but printing) is a fork-join job, whose work and span are measured if enabled.
+    WORK_SPAN_JOB job;
+    workSpanJobBegin(&job, "matrix");
+
     // Initilize time seed for random values to be properly generated.
     srand(time(NULL));
 
-    // Allocate memory for matrices.
-    unsigned int mat_A_rows = getDelimitedRandomInteger(MIN_MAT_DIM, MAX_MAT_DIM);
-    unsigned int mat_A_cols = getDelimitedRandomInteger(MIN_MAT_DIM, MAX_MAT_DIM);
+    // Allocate memory for matrices. Dimensions are random unless a fixed one has been given as lesson parameter (see
+    // LessonParameters.c), in which case every matrix is square.
+    unsigned int fixed_dim = (unsigned int)getLessonParameter(LESSON_PARAM_MAT_DIM, 0);
+
+    unsigned int mat_A_rows = (fixed_dim ? fixed_dim : (unsigned int)getDelimitedRandomInteger(MIN_MAT_DIM, MAX_MAT_DIM));
+    unsigned int mat_A_cols = (fixed_dim ? fixed_dim : (unsigned int)getDelimitedRandomInteger(MIN_MAT_DIM, MAX_MAT_DIM));
     
     unsigned int mat_B_rows = mat_A_cols;
-    unsigned int mat_B_cols = getDelimitedRandomInteger(MIN_MAT_DIM, MAX_MAT_DIM);
+    unsigned int mat_B_cols = (fixed_dim ? fixed_dim : (unsigned int)getDelimitedRandomInteger(MIN_MAT_DIM, MAX_MAT_DIM));
     
     unsigned int mat_C_rows = mat_A_rows;
     unsigned int mat_C_cols = mat_B_cols;
@@ -281,101 +291,119 @@ void exampleMatrixMultiplication()
         return;
     }
 
-    // Create threads, one for each element in the resulting matrix.
-    unsigned int threads_num = mat_C_rows * mat_C_cols;
-    pthread_t* threads = (pthread_t*)malloc(threads_num * sizeof(pthread_t*));
-
     // Create a mutex, so that only a single thread writes on the resulting matrix each time.
     pthread_mutex_t mat_C_lock;
 
-    // Initialize a variable holding the common scheduling type as well as priority (Round-Robin, maximum priority).
-    int scheduling_policy = SCHED_RR;
-    struct sched_param scheduling_priority = { .sched_priority = sched_get_priority_max(scheduling_policy) };
-    
-    // Set previously specified attributes.
-    pthread_attr_t attr;
-
-    int set_attr_status = setAttr(&attr, scheduling_policy, &scheduling_priority, PTHREAD_EXPLICIT_SCHED);
+    // Request a thread per online CPU (or as many as given by the "threads" lesson parameter), but never more than elements in the
+    // resulting matrix, as extra threads would find nothing left to calculate. The governor may grant fewer of them.
+    long online_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int elements_num = mat_C_rows * mat_C_cols;
+    unsigned int threads_num = (unsigned int)getLessonParameter(LESSON_PARAM_THREADS, (online_cpus > 0 ? (unsigned long)online_cpus : 1));
 
-    if(set_attr_status < 0)
-    {
-        printf("%sCommon attributes holding variable could not be properly set, so the procedure cannot go on.\r\n%s",
-                PRINT_COLOR_RED     ,
-                PRINT_COLOR_RESET   );
-        return;
-    }
+    unsigned int requested_threads_num = (threads_num < elements_num ? threads_num : elements_num);
 
-    // For each thread, allocate its data structure.
-    MATRIX_MULT_DATA* matrix_mult_data_arr = (MATRIX_MULT_DATA*)malloc(threads_num * sizeof(MATRIX_MULT_DATA));
+    threads_num = threadBudgetAcquire(requested_threads_num, 1);
+    pthread_t* threads = (pthread_t*)malloc(threads_num * sizeof(pthread_t));
 
-    if(matrix_mult_data_arr == NULL)
+    // Without handles no thread can be created, so every element is calculated from the current thread, as when the system refuses
+    // to create any of them.
+    if(threads == NULL && threads_num > 0)
     {
-        printf("%sCould not allocate matrix data array!%s\r\n", PRINT_COLOR_RED, PRINT_COLOR_RESET);
-        return;
+        printf("%sCould not allocate thread array, so no thread is created.%s\r\n", PRINT_COLOR_RED, PRINT_COLOR_RESET);
+        threadBudgetRelease(threads_num, 0);
+        threads_num = 0;
     }
 
     // Allocate common multiplication data.
     MATRIX_MULT_COMMON_DATA matrix_mult_common_data = 
     {
-        .mat_A      = mat_A         ,
-        .mat_B      = mat_B         ,
-        .mat_C      = mat_C         ,
-        .mat_A_cols = mat_A_cols    ,
-        .p_mutex_C  = &mat_C_lock   ,
+        .mat_A          = mat_A         ,
+        .mat_B          = mat_B         ,
+        .mat_C          = mat_C         ,
+        .mat_A_cols     = mat_A_cols    ,
+        .mat_C_cols     = mat_C_cols    ,
+        .elements_num   = elements_num  ,
+        .p_mutex_C      = &mat_C_lock   ,
+        .job            = &job          ,
     };
 
+    atomic_init(&matrix_mult_common_data.next_element, 0);
+
     // Initialize C matrix mutex lock.
     pthread_mutex_init(&mat_C_lock, NULL);
 
-    // Initialize thread common attributes holding variable.
-    pthread_attr_init(&attr);
+    // Launch every granted thread. If the system refuses to create any of them, go on with the ones already running.
+    unsigned int created_threads_num = 0;
+
+    workSpanParallelBegin(&job);
 
-    // Prepare data given as each thread's input parameter and launch them.
     for(unsigned int thread_idx = 0; thread_idx < threads_num; thread_idx++)
     {
-        matrix_mult_data_arr[thread_idx].p_matrix_mult_common_data = &matrix_mult_common_data;
-        matrix_mult_data_arr[thread_idx].target_row_A = (thread_idx / mat_C_cols);
-        matrix_mult_data_arr[thread_idx].target_col_B = (thread_idx % mat_C_cols);
-
-        if(checkThreadCreationStatus( pthread_create(&threads[thread_idx], &attr, matrixMultThreadRoutine, &matrix_mult_data_arr[thread_idx]) ))
-        {
-            printf("%sCould not create thread %d (element at C[%d][%d]). Aborting matrix multiplication.%s\r\n",
-                    PRINT_COLOR_RED,
-                    thread_idx,
-                    (thread_idx / mat_C_cols),
-                    (thread_idx % mat_C_cols),
-                    PRINT_COLOR_RESET);
-            
-            for(unsigned int cancel_idx = (thread_idx - 1); cancel_idx >= 0; cancel_idx--)
-                pthread_cancel(threads[cancel_idx]);
-
-            return;
-        }
+        if(checkThreadCreationStatus( TRACED_THREAD_CREATE_WITH(threadBudgetCreateThread, &threads[thread_idx], NULL, matrixMultThreadRoutine, &matrix_mult_common_data) ))
+            break;
+
+        ++created_threads_num;
     }
 
-    // Wait for every thread to join the main one.
-    for(unsigned int thread_idx = 0; thread_idx < threads_num; thread_idx++)
+    if(created_threads_num < requested_threads_num)
+        printf("%sRunning with %u of %u requested thread(s) for %u element(s).%s\r\n",
+                PRINT_COLOR_YELLOW      ,
+                created_threads_num     ,
+                requested_threads_num   ,
+                elements_num            ,
+                PRINT_COLOR_RESET       );
+
+    // If not even a single thread could be created, calculate every element from the current thread.
+    if(created_threads_num == 0)
+        matrixMultThreadRoutine(&matrix_mult_common_data);
+
+    // Wait for every thread to join the main one, then give slots back to the governor.
+    for(unsigned int thread_idx = 0; thread_idx < created_threads_num; thread_idx++)
         pthread_join(threads[thread_idx], NULL);
+
+    workSpanParallelEnd(&job);
+    workSpanJobEnd(&job);
+
+    threadBudgetRelease(threads_num, created_threads_num);
     
-    // Print matrices.
-    printMatrix(mat_A, mat_A_rows, mat_A_cols, "A", PRINT_COLOR_CYAN     );
-    printMatrix(mat_B, mat_B_rows, mat_B_cols, "B", PRINT_COLOR_PURPLE   );
-    printMatrix(mat_C, mat_C_rows, mat_C_cols, "C (A x B = C)", PRINT_COLOR_GREEN    );
+    // Print matrices, unless they are too large to be displayed.
+    if(mat_A_rows <= MAX_PRINTED_DIM && mat_A_cols <= MAX_PRINTED_DIM && mat_B_cols <= MAX_PRINTED_DIM)
+    {
+        printMatrix(mat_A, mat_A_rows, mat_A_cols, "A", PRINT_COLOR_CYAN     );
+        printMatrix(mat_B, mat_B_rows, mat_B_cols, "B", PRINT_COLOR_PURPLE   );
+        printMatrix(mat_C, mat_C_rows, mat_C_cols, "C (A x B = C)", PRINT_COLOR_GREEN    );
+    }
+    else
+        printf("%sMultiplied a %ux%u matrix by a %ux%u one using %u thread(s).%s\r\n",
+                PRINT_COLOR_GREEN   ,
+                mat_A_rows          ,
+                mat_A_cols          ,
+                mat_B_rows          ,
+                mat_B_cols          ,
+                created_threads_num ,
+                PRINT_COLOR_RESET   );
 
-    // Free memory used to store pthread_t and MATRIX_MULT_DATA type variables.
+    threadBudgetPrintMetrics();
+
+    // Free memory used to store pthread_t type variables.
     free(threads);
-    free(matrix_mult_data_arr);
 
     // Destroy mutex lock.
     pthread_mutex_destroy(&mat_C_lock);
 
-    // Destroy thread common attributes.
-    pthread_attr_destroy(&attr);
-
     // Free memory previously allocated for each matrix.
     deallocateMatrix(mat_A, mat_A_rows);
     deallocateMatrix(mat_B, mat_B_rows);
     deallocateMatrix(mat_C, mat_C_rows);
 }
 
+// Multiply-adds done by a single run of the lesson, used to report its throughput when benchmarked. Unknown (0) unless a fixed
+// dimension has been given, as random dimensions change from run to run.
+unsigned long long getMatrixMultiplicationWorkUnits()
+{
+    unsigned long long fixed_dim = getLessonParameter(LESSON_PARAM_MAT_DIM, 0);
+
+    return fixed_dim * fixed_dim * fixed_dim;
+}
+
 /**************************************/
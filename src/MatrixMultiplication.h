@@ -4,6 +4,7 @@
 /********* Function prototypes ********/
 
 void exampleMatrixMultiplication();
+unsigned long long getMatrixMultiplicationWorkUnits();
 
 /**************************************/
 
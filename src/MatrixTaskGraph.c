@@ -0,0 +1,423 @@
+/*
+A job made of several steps, laid out as a task graph (see TaskGraph.c). Two square matrices A and B are generated, multiplied
+(C = A x B), C is transposed and reduced (all of its elements are summed), and the results are verified. Every step is split into
+bands of rows, and each band only waits for what it actually reads:
+    ·Generating a band of A or B depends on nothing.
+    ·Multiplying a band of rows of C depends on the same band of A, and on every band of B.
+    ·Transposing a band of C (into a band of columns of C^T) and reducing it to a partial sum depend on multiplying that band only.
+    ·Verifying a band of columns of C^T (spot-checked against row by column products of A and B) depends on transposing that band.
+    ·The final check depends on every partial sum and every verification. The whole sum of C is compared with the one obtained
+    straight from A and B, as the sum of C's elements is the sum over k of (column k of A's sum) times (row k of B's sum).
+
+The graph is built and compiled once, then run once per iteration ("iterations" lesson parameter), new matrices being generated
+every time. For comparison, the same tasks are then run stage by stage, waiting for every task of a stage to end before the next
+stage is submitted, as joins or barriers would do: bands which could have gone on wait for the slowest band of the previous stage.
+*/
+
+/********* Include statements *********/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include "ThreadColors.h"
+#include "ThreadPool.h"
+#include "TaskGraph.h"
+#include "LatencyHistogram.h"
+#include "LessonParameters.h"
+#include "MatrixTaskGraph.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define DEFAULT_MAT_DIM     128
+#define DEFAULT_RUNS        5
+#define BAND_ROWS           16
+#define MAX_MAT_VAL         10
+#define SPOT_CHECKS_NUM     4       // Elements checked per band.
+#define NS_PER_MSEC         1000000.0
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+typedef enum
+{
+    STAGE_GENERATE_A    ,
+    STAGE_GENERATE_B    ,
+    STAGE_MULTIPLY      ,
+    STAGE_TRANSPOSE     ,
+    STAGE_REDUCE        ,
+    STAGE_VERIFY        ,
+    STAGES_NUM          ,
+} MATRIX_STAGE;
+
+typedef struct
+{
+    int*                mat_A           ;
+    int*                mat_B           ;
+    long long*          mat_C           ;
+    long long*          mat_CT          ;
+    long long*          partial_sums    ;   // One per band.
+    unsigned int        dim             ;
+    unsigned int        bands_num       ;
+    unsigned int        run             ;   // Seeds the matrices of the current run.
+    atomic_uint         wrong_num       ;
+    int                 result_ok       ;
+} MATRIX_GRAPH_COMMON_DATA;
+
+typedef struct
+{
+    MATRIX_GRAPH_COMMON_DATA*   common  ;
+    unsigned int                band    ;
+} MATRIX_BAND_TASK_DATA;
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static void         generateBand(int* mat, unsigned int dim, unsigned int band, unsigned int seed);
+static void         generateBandA(void* arg);
+static void         generateBandB(void* arg);
+static void         multiplyBand(void* arg);
+static void         transposeBand(void* arg);
+static void         reduceBand(void* arg);
+static void         verifyBand(void* arg);
+static void         checkResult(void* arg);
+static int          buildGraph(TASK_GRAPH* graph, MATRIX_BAND_TASK_DATA* band_tasks, MATRIX_GRAPH_COMMON_DATA* common);
+static void         runStages(THREAD_POOL* pool, MATRIX_BAND_TASK_DATA* band_tasks, MATRIX_GRAPH_COMMON_DATA* common);
+static unsigned int getAvailableCPUs();
+
+/**************************************/
+
+/********* Private variables **********/
+
+static const THREAD_POOL_TASK_ROUTINE stage_routines[STAGES_NUM] =
+{
+    [STAGE_GENERATE_A]  = generateBandA     ,
+    [STAGE_GENERATE_B]  = generateBandB     ,
+    [STAGE_MULTIPLY]    = multiplyBand      ,
+    [STAGE_TRANSPOSE]   = transposeBand     ,
+    [STAGE_REDUCE]      = reduceBand        ,
+    [STAGE_VERIFY]      = verifyBand        ,
+};
+
+static const char* stage_names[STAGES_NUM] =
+{
+    [STAGE_GENERATE_A]  = "generate A"  ,
+    [STAGE_GENERATE_B]  = "generate B"  ,
+    [STAGE_MULTIPLY]    = "multiply"    ,
+    [STAGE_TRANSPOSE]   = "transpose"   ,
+    [STAGE_REDUCE]      = "reduce"      ,
+    [STAGE_VERIFY]      = "verify"      ,
+};
+
+/**************************************/
+
+/******** Function definitions ********/
+
+// Bands are generated by different threads, so each one has a random number generator of its own (rand is not thread-safe).
+static void generateBand(int* mat, unsigned int dim, unsigned int band, unsigned int seed)
+{
+    unsigned int last_row = ((band + 1) * BAND_ROWS < dim ? (band + 1) * BAND_ROWS : dim);
+
+    for(unsigned int row = band * BAND_ROWS; row < last_row; row++)
+        for(unsigned int col = 0; col < dim; col++)
+            mat[(size_t)row * dim + col] = rand_r(&seed) % (MAX_MAT_VAL + 1);
+}
+
+static void generateBandA(void* arg)
+{
+    MATRIX_BAND_TASK_DATA* task = (MATRIX_BAND_TASK_DATA*)arg;
+
+    generateBand(task->common->mat_A, task->common->dim, task->band, task->common->run * 2 * task->common->bands_num + task->band);
+}
+
+static void generateBandB(void* arg)
+{
+    MATRIX_BAND_TASK_DATA* task = (MATRIX_BAND_TASK_DATA*)arg;
+
+    generateBand(task->common->mat_B, task->common->dim, task->band, (task->common->run * 2 + 1) * task->common->bands_num + task->band);
+}
+
+// Rows are accumulated in i-k-j order, so that the innermost loop walks rows of B and C sequentially.
+static void multiplyBand(void* arg)
+{
+    MATRIX_BAND_TASK_DATA* task = (MATRIX_BAND_TASK_DATA*)arg;
+    MATRIX_GRAPH_COMMON_DATA* common = task->common;
+    unsigned int dim = common->dim;
+    unsigned int last_row = ((task->band + 1) * BAND_ROWS < dim ? (task->band + 1) * BAND_ROWS : dim);
+
+    for(unsigned int row = task->band * BAND_ROWS; row < last_row; row++)
+    {
+        long long* row_C = &common->mat_C[(size_t)row * dim];
+
+        for(unsigned int col = 0; col < dim; col++)
+            row_C[col] = 0;
+
+        for(unsigned int k = 0; k < dim; k++)
+        {
+            long long value_A = common->mat_A[(size_t)row * dim + k];
+            const int* row_B = &common->mat_B[(size_t)k * dim];
+
+            for(unsigned int col = 0; col < dim; col++)
+                row_C[col] += value_A * row_B[col];
+        }
+    }
+}
+
+static void transposeBand(void* arg)
+{
+    MATRIX_BAND_TASK_DATA* task = (MATRIX_BAND_TASK_DATA*)arg;
+    MATRIX_GRAPH_COMMON_DATA* common = task->common;
+    unsigned int dim = common->dim;
+    unsigned int last_row = ((task->band + 1) * BAND_ROWS < dim ? (task->band + 1) * BAND_ROWS : dim);
+
+    for(unsigned int row = task->band * BAND_ROWS; row < last_row; row++)
+        for(unsigned int col = 0; col < dim; col++)
+            common->mat_CT[(size_t)col * dim + row] = common->mat_C[(size_t)row * dim + col];
+}
+
+static void reduceBand(void* arg)
+{
+    MATRIX_BAND_TASK_DATA* task = (MATRIX_BAND_TASK_DATA*)arg;
+    MATRIX_GRAPH_COMMON_DATA* common = task->common;
+    unsigned int dim = common->dim;
+    unsigned int last_row = ((task->band + 1) * BAND_ROWS < dim ? (task->band + 1) * BAND_ROWS : dim);
+    long long sum = 0;
+
+    for(size_t element_idx = (size_t)task->band * BAND_ROWS * dim; element_idx < (size_t)last_row * dim; element_idx++)
+        sum += common->mat_C[element_idx];
+
+    common->partial_sums[task->band] = sum;
+}
+
+// Columns of C^T within the band are checked against row by column products of A and B.
+static void verifyBand(void* arg)
+{
+    MATRIX_BAND_TASK_DATA* task = (MATRIX_BAND_TASK_DATA*)arg;
+    MATRIX_GRAPH_COMMON_DATA* common = task->common;
+    unsigned int dim = common->dim;
+    unsigned int first_col = task->band * BAND_ROWS;
+    unsigned int band_cols = (first_col + BAND_ROWS < dim ? BAND_ROWS : dim - first_col);
+    unsigned int seed = common->run + task->band;
+
+    for(unsigned int check_idx = 0; check_idx < SPOT_CHECKS_NUM; check_idx++)
+    {
+        unsigned int row = (unsigned int)rand_r(&seed) % dim;
+        unsigned int col = first_col + (unsigned int)rand_r(&seed) % band_cols;
+        long long expected = 0;
+
+        for(unsigned int k = 0; k < dim; k++)
+            expected += (long long)common->mat_A[(size_t)col * dim + k] * common->mat_B[(size_t)k * dim + row];
+
+        if(common->mat_CT[(size_t)row * dim + col] != expected)
+            atomic_fetch_add(&common->wrong_num, 1);
+    }
+}
+
+// The sum of C's elements is the sum over k of A's column k sum times B's row k sum.
+static void checkResult(void* arg)
+{
+    MATRIX_GRAPH_COMMON_DATA* common = (MATRIX_GRAPH_COMMON_DATA*)arg;
+    unsigned int dim = common->dim;
+    long long sum = 0;
+    long long expected = 0;
+
+    for(unsigned int band = 0; band < common->bands_num; band++)
+        sum += common->partial_sums[band];
+
+    for(unsigned int k = 0; k < dim; k++)
+    {
+        long long col_sum_A = 0;
+        long long row_sum_B = 0;
+
+        for(unsigned int idx = 0; idx < dim; idx++)
+        {
+            col_sum_A += common->mat_A[(size_t)idx * dim + k];
+            row_sum_B += common->mat_B[(size_t)k * dim + idx];
+        }
+
+        expected += col_sum_A * row_sum_B;
+    }
+
+    common->result_ok = (sum == expected && atomic_load(&common->wrong_num) == 0);
+}
+
+// Returns -1 if any task or edge could not be added, or the graph could not be compiled.
+static int buildGraph(TASK_GRAPH* graph, MATRIX_BAND_TASK_DATA* band_tasks, MATRIX_GRAPH_COMMON_DATA* common)
+{
+    unsigned int bands_num = common->bands_num;
+    int task_ids[STAGES_NUM][bands_num];
+    int status = 0;
+
+    for(int stage = 0; stage < STAGES_NUM; stage++)
+        for(unsigned int band = 0; band < bands_num; band++)
+            if((task_ids[stage][band] = taskGraphAddTask(graph, stage_names[stage], stage_routines[stage], &band_tasks[band])) < 0)
+                return -1;
+
+    int check_task = taskGraphAddTask(graph, "check", checkResult, common);
+
+    if(check_task < 0)
+        return -1;
+
+    for(unsigned int band = 0; band < bands_num; band++)
+    {
+        status |= taskGraphAddEdge(graph, task_ids[STAGE_GENERATE_A][band], task_ids[STAGE_MULTIPLY][band]);
+
+        for(unsigned int band_B = 0; band_B < bands_num; band_B++)
+            status |= taskGraphAddEdge(graph, task_ids[STAGE_GENERATE_B][band_B], task_ids[STAGE_MULTIPLY][band]);
+
+        status |= taskGraphAddEdge(graph, task_ids[STAGE_MULTIPLY][band], task_ids[STAGE_TRANSPOSE][band]);
+        status |= taskGraphAddEdge(graph, task_ids[STAGE_MULTIPLY][band], task_ids[STAGE_REDUCE][band]);
+        status |= taskGraphAddEdge(graph, task_ids[STAGE_TRANSPOSE][band], task_ids[STAGE_VERIFY][band]);
+        status |= taskGraphAddEdge(graph, task_ids[STAGE_REDUCE][band], check_task);
+        status |= taskGraphAddEdge(graph, task_ids[STAGE_VERIFY][band], check_task);
+    }
+
+    if(status < 0)
+        return -1;
+
+    return taskGraphCompile(graph);
+}
+
+// Every stage is submitted as a whole, once the previous one has ended. Generating A and B go together.
+static void runStages(THREAD_POOL* pool, MATRIX_BAND_TASK_DATA* band_tasks, MATRIX_GRAPH_COMMON_DATA* common)
+{
+    for(int stage = 0; stage < STAGES_NUM; stage++)
+    {
+        for(unsigned int band = 0; band < common->bands_num; band++)
+            if(threadPoolSubmit(pool, stage_routines[stage], &band_tasks[band], THREAD_POOL_NO_HINT) < 0)
+                stage_routines[stage](&band_tasks[band]);
+
+        if(stage != STAGE_GENERATE_A)
+            threadPoolWait(pool);
+    }
+
+    checkResult(common);
+}
+
+static unsigned int getAvailableCPUs()
+{
+    cpu_set_t cpu_set;
+
+    if(sched_getaffinity(0, sizeof(cpu_set), &cpu_set) < 0)
+        return 1;
+
+    int cpus_num = CPU_COUNT(&cpu_set);
+
+    return (cpus_num > 0 ? (unsigned int)cpus_num : 1);
+}
+
+void exampleMatrixTaskGraph()
+{
+    // The matrices' dimension, the number of runs and the number of workers can be given as lesson parameters (see
+    // LessonParameters.c). Workers are one per available CPU otherwise.
+    unsigned int dim = (unsigned int)getLessonParameter(LESSON_PARAM_MAT_DIM, DEFAULT_MAT_DIM);
+    unsigned int runs_num = (unsigned int)getLessonParameter(LESSON_PARAM_ITERATIONS, DEFAULT_RUNS);
+    unsigned int workers_num = (unsigned int)getLessonParameter(LESSON_PARAM_THREADS, getAvailableCPUs());
+
+    if(dim == 0)
+        dim = 1;
+
+    unsigned int bands_num = (dim + BAND_ROWS - 1) / BAND_ROWS;
+
+    MATRIX_GRAPH_COMMON_DATA common =
+    {
+        .mat_A          = (int*)malloc((size_t)dim * dim * sizeof(int))                 ,
+        .mat_B          = (int*)malloc((size_t)dim * dim * sizeof(int))                 ,
+        .mat_C          = (long long*)malloc((size_t)dim * dim * sizeof(long long))     ,
+        .mat_CT         = (long long*)malloc((size_t)dim * dim * sizeof(long long))     ,
+        .partial_sums   = (long long*)malloc(bands_num * sizeof(long long))             ,
+        .dim            = dim                                                           ,
+        .bands_num      = bands_num                                                     ,
+    };
+
+    MATRIX_BAND_TASK_DATA* band_tasks = (MATRIX_BAND_TASK_DATA*)malloc(bands_num * sizeof(MATRIX_BAND_TASK_DATA));
+    TASK_GRAPH* graph = taskGraphCreate();
+    THREAD_POOL* pool = threadPoolCreate(workers_num);
+
+    if(common.mat_A == NULL || common.mat_B == NULL || common.mat_C == NULL || common.mat_CT == NULL || common.partial_sums == NULL ||
+        band_tasks == NULL || graph == NULL || pool == NULL)
+    {
+        printf("%sCould not allocate matrices, tasks, the graph or the thread pool, so the procedure cannot go on.%s\r\n",
+                PRINT_COLOR_RED     ,
+                PRINT_COLOR_RESET   );
+    }
+    else
+    {
+        for(unsigned int band = 0; band < bands_num; band++)
+        {
+            band_tasks[band].common = &common   ;
+            band_tasks[band].band   = band      ;
+        }
+
+        if(buildGraph(graph, band_tasks, &common) < 0)
+        {
+            if(taskGraphGetCycleTask(graph) != NULL)
+                printf("%sTask \"%s\" is part of, or depends on, a cycle.%s\r\n", PRINT_COLOR_RED, taskGraphGetCycleTask(graph), PRINT_COLOR_RESET);
+
+            printf("%sCould not build the task graph, so the procedure cannot go on.%s\r\n", PRINT_COLOR_RED, PRINT_COLOR_RESET);
+        }
+        else
+        {
+            unsigned long long graph_ns = 0;
+            unsigned long long stages_ns = 0;
+            unsigned int failed_runs = 0;
+
+            for(unsigned int run = 0; run < runs_num; run++)
+            {
+                common.run = run;
+                atomic_store(&common.wrong_num, 0);
+
+                unsigned long long start_ns = latencyHistogramGetTimeNs();
+                taskGraphRun(graph, pool);
+                graph_ns += latencyHistogramGetTimeNs() - start_ns;
+
+                failed_runs += !common.result_ok;
+                atomic_store(&common.wrong_num, 0);
+
+                start_ns = latencyHistogramGetTimeNs();
+                runStages(pool, band_tasks, &common);
+                stages_ns += latencyHistogramGetTimeNs() - start_ns;
+
+                failed_runs += !common.result_ok;
+            }
+
+            printf("%sRan a graph of %u task(s) and %u edge(s) (%u task(s) deep) %u time(s) on %u worker(s), for %ux%u matrices.%s\r\n",
+                    (failed_runs == 0 ? PRINT_COLOR_GREEN : PRINT_COLOR_RED)    ,
+                    taskGraphGetTasksNum(graph)                                 ,
+                    taskGraphGetEdgesNum(graph)                                 ,
+                    taskGraphGetDepth(graph)                                    ,
+                    runs_num                                                    ,
+                    threadPoolGetWorkersNum(pool)                               ,
+                    dim                                                         ,
+                    dim                                                         ,
+                    PRINT_COLOR_RESET                                           );
+
+            if(failed_runs > 0)
+                printf("%s%u run(s) gave wrong results!%s\r\n", PRINT_COLOR_RED, failed_runs, PRINT_COLOR_RESET);
+
+            if(runs_num > 0)
+                printf("%sAverage time per run: %.3f ms as a task graph, %.3f ms stage by stage.%s\r\n",
+                        PRINT_COLOR_YELLOW                  ,
+                        graph_ns / NS_PER_MSEC / runs_num   ,
+                        stages_ns / NS_PER_MSEC / runs_num  ,
+                        PRINT_COLOR_RESET                   );
+        }
+    }
+
+    threadPoolDestroy(pool);
+    taskGraphDestroy(graph);
+    free(band_tasks);
+    free(common.partial_sums);
+    free(common.mat_CT);
+    free(common.mat_C);
+    free(common.mat_B);
+    free(common.mat_A);
+}
+
+/**************************************/
@@ -0,0 +1,10 @@
+#ifndef MATRIX_TASK_GRAPH_H
+#define MATRIX_TASK_GRAPH_H
+
+/********* Function prototypes ********/
+
+void exampleMatrixTaskGraph();
+
+/**************************************/
+
+#endif
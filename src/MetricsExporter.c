@@ -0,0 +1,425 @@
+/*
+Reports printed once lessons are done tell what happened, but not what is happening: how many items sit in a queue right now, how
+many threads are waiting for a slot, how often locks are found taken. Long running programs expose such live counters through an
+endpoint which monitoring tools poll (scrape) every now and then. The exporter serves them in the Prometheus text format:
+
+# HELP thread_budget_slots_in_use Thread slots currently held.
+# TYPE thread_budget_slots_in_use gauge
+thread_budget_slots_in_use 4
+# HELP thread_budget_queue_wait_seconds Time spent waiting for thread slots.
+# TYPE thread_budget_queue_wait_seconds summary
+thread_budget_queue_wait_seconds{quantile="0.5"} 0.000251903
+thread_budget_queue_wait_seconds_sum 0.001316219
+thread_budget_queue_wait_seconds_count 5
+
+Where:
+    ·Counters only ever go up (such as requests served), while gauges go up and down (such as items in a buffer).
+    ·Summaries are taken from latency histograms (see LatencyHistogram.c): a few percentiles, plus the sum and count of the values.
+
+Metrics are registered by name (registering the same name again returns the same metric), and updated through metricsExporterAdd.
+Updates must not slow the threads doing the actual work down, so every thread adds into a slot of its own: since nobody else writes
+into it, no lock nor atomic read-modify-write instruction is needed, and no cache line bounces between CPUs. A metric's value is the
+sum of every slot, read by the exporter thread without stopping anyone, so a snapshot may miss the very last updates (and different
+metrics may be read a few instants apart), but never sees a torn value. A thread's slot is handed over to another thread once it
+ends: values are sums anyway, so the new owner can go on adding into it.
+
+The exporter thread listens on a UNIX domain socket (when the address is a path, such as /tmp/threads.sock) or on a loopback TCP
+port (when it is a number, such as 9100, see LocalSockets.c), so that just local tools can reach it. Whatever is connected gets a
+snapshot and is disconnected. Clients sending an HTTP GET request get an HTTP response, so both of these work:
+
+curl --unix-socket /tmp/threads.sock http://localhost/metrics
+curl http://127.0.0.1:9100/metrics
+*/
+
+/********* Include statements *********/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "LocalSockets.h"
+#include "MetricsExporter.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define POLL_PERIOD_MS          100     // How often the exporter thread checks whether it has been asked to stop.
+#define REQUEST_TIMEOUT_MS      100     // How long clients are given to send a request before being sent the snapshot anyway.
+#define REQUEST_SIZE            1024
+#define SEND_TIMEOUT_MS         1000    // How long a client which does not read the snapshot is waited for.
+#define NS_PER_SEC              1e9
+#define HTTP_GET_PREFIX         "GET "
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+typedef struct
+{
+    const char*     name    ;
+    const char*     help    ;
+    METRIC_TYPE     type    ;
+} METRIC_DESCRIPTION;
+
+typedef struct
+{
+    const char*                 name        ;
+    const char*                 help        ;
+    const LATENCY_HISTOGRAM*    histogram   ;
+} HISTOGRAM_DESCRIPTION;
+
+typedef struct METRICS_SLOT
+{
+    struct METRICS_SLOT*    next                                    ;
+    atomic_int              in_use                                  ;   // Whether a running thread owns the slot.
+    atomic_llong            values[METRICS_EXPORTER_MAX_METRICS]    ;
+} METRICS_SLOT;
+
+/**************************************/
+
+/********* Private variables **********/
+
+static pthread_mutex_t                  registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static METRIC_DESCRIPTION               metrics[METRICS_EXPORTER_MAX_METRICS];
+static atomic_int                       metrics_num;
+static HISTOGRAM_DESCRIPTION            histograms[METRICS_EXPORTER_MAX_HISTOGRAMS];
+static atomic_int                       histograms_num;
+static pthread_mutex_t                  slots_lock = PTHREAD_MUTEX_INITIALIZER;
+static METRICS_SLOT* _Atomic            slots_list;
+static pthread_once_t                   slot_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t                    slot_key;
+static _Thread_local METRICS_SLOT*      thread_slot;
+static pthread_t                        exporter_thread;
+static atomic_int                       exporter_running;
+static atomic_int                       stop_requested;
+static int                              listen_fd = -1;
+static struct sockaddr_un               unix_address;   // Just used (and unlinked when stopping) if listening on a UNIX socket.
+static int                              scrapes_metric = -1;
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static void             createSlotKey();
+static void             releaseSlot(void* slot);
+static METRICS_SLOT*    getThreadSlot();
+static void             writeHistogram(FILE* stream, const HISTOGRAM_DESCRIPTION* description);
+static void             serveClient(int client_fd);
+static void*            exporterRoutine(void* arg);
+
+/**************************************/
+
+/******** Function definitions ********/
+
+static void createSlotKey()
+{
+    pthread_key_create(&slot_key, releaseSlot);
+}
+
+// Called as the owning thread ends. Its values are kept, since they still count towards every metric's sum.
+static void releaseSlot(void* slot)
+{
+    atomic_store(&((METRICS_SLOT*)slot)->in_use, 0);
+}
+
+static METRICS_SLOT* getThreadSlot()
+{
+    if(thread_slot != NULL)
+        return thread_slot;
+
+    pthread_once(&slot_key_once, createSlotKey);
+
+    METRICS_SLOT* slot = NULL;
+
+    // Take over a slot left behind by a thread which already ended, if any.
+    for(METRICS_SLOT* candidate = atomic_load(&slots_list); candidate != NULL && slot == NULL; candidate = candidate->next)
+    {
+        int expected = 0;
+
+        if(atomic_compare_exchange_strong(&candidate->in_use, &expected, 1))
+            slot = candidate;
+    }
+
+    if(slot == NULL)
+    {
+        slot = (METRICS_SLOT*)calloc(1, sizeof(METRICS_SLOT));
+
+        if(slot == NULL)
+            return NULL;
+
+        atomic_store(&slot->in_use, 1);
+
+        pthread_mutex_lock(&slots_lock);
+        slot->next = atomic_load(&slots_list);
+        atomic_store(&slots_list, slot);
+        pthread_mutex_unlock(&slots_lock);
+    }
+
+    pthread_setspecific(slot_key, slot);
+    thread_slot = slot;
+
+    return slot;
+}
+
+// Returns the metric to be passed to metricsExporterAdd, or -1 if there is no room left. "name" and "help" must outlive the exporter.
+int metricsExporterRegister(const char* name, const char* help, METRIC_TYPE type)
+{
+    if(name == NULL)
+        return -1;
+
+    pthread_mutex_lock(&registry_lock);
+
+    int registered_num = atomic_load(&metrics_num);
+    int metric = -1;
+
+    for(int metric_idx = 0; metric_idx < registered_num && metric < 0; metric_idx++)
+        if(strcmp(metrics[metric_idx].name, name) == 0)
+            metric = metric_idx;
+
+    if(metric < 0 && registered_num < METRICS_EXPORTER_MAX_METRICS)
+    {
+        metric = registered_num;
+        metrics[metric].name = name;
+        metrics[metric].help = (help != NULL ? help : "");
+        metrics[metric].type = type;
+
+        // Published after being filled in, so that snapshots never see half of a description.
+        atomic_store(&metrics_num, registered_num + 1);
+    }
+
+    pthread_mutex_unlock(&registry_lock);
+
+    return metric;
+}
+
+// The histogram is read (not copied) on every snapshot, so it must outlive the exporter. Returns -1 if it could not be registered.
+int metricsExporterRegisterHistogram(const char* name, const char* help, const LATENCY_HISTOGRAM* histogram)
+{
+    if(name == NULL || histogram == NULL)
+        return -1;
+
+    pthread_mutex_lock(&registry_lock);
+
+    int registered_num = atomic_load(&histograms_num);
+    int ret = -1;
+
+    for(int histogram_idx = 0; histogram_idx < registered_num && ret < 0; histogram_idx++)
+        if(strcmp(histograms[histogram_idx].name, name) == 0)
+            ret = 0;
+
+    if(ret < 0 && registered_num < METRICS_EXPORTER_MAX_HISTOGRAMS)
+    {
+        histograms[registered_num].name         = name                          ;
+        histograms[registered_num].help         = (help != NULL ? help : "")    ;
+        histograms[registered_num].histogram    = histogram                     ;
+
+        atomic_store(&histograms_num, registered_num + 1);
+        ret = 0;
+    }
+
+    pthread_mutex_unlock(&registry_lock);
+
+    return ret;
+}
+
+// Just the calling thread writes into its slot, so a plain load and store are enough. Does nothing for metrics which failed to be
+// registered (-1).
+void metricsExporterAdd(int metric, long long value)
+{
+    if(metric < 0 || metric >= METRICS_EXPORTER_MAX_METRICS)
+        return;
+
+    METRICS_SLOT* slot = getThreadSlot();
+
+    if(slot == NULL)
+        return;
+
+    atomic_store_explicit(&slot->values[metric], atomic_load_explicit(&slot->values[metric], memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+long long metricsExporterGetValue(int metric)
+{
+    if(metric < 0 || metric >= METRICS_EXPORTER_MAX_METRICS)
+        return 0;
+
+    long long value = 0;
+
+    for(METRICS_SLOT* slot = atomic_load(&slots_list); slot != NULL; slot = slot->next)
+        value += atomic_load_explicit(&slot->values[metric], memory_order_relaxed);
+
+    return value;
+}
+
+// Values are turned from nanoseconds into seconds, as Prometheus expects.
+static void writeHistogram(FILE* stream, const HISTOGRAM_DESCRIPTION* description)
+{
+    static const double percentiles[] = {50.0, 90.0, 99.0, 99.9};
+
+    fprintf(stream, "# HELP %s %s\n", description->name, description->help);
+    fprintf(stream, "# TYPE %s summary\n", description->name);
+
+    for(unsigned int percentile_idx = 0; percentile_idx < sizeof(percentiles) / sizeof(percentiles[0]); percentile_idx++)
+        fprintf(stream, "%s{quantile=\"%g\"} %.9f\n",
+                description->name                                                                                   ,
+                percentiles[percentile_idx] / 100.0                                                                 ,
+                latencyHistogramGetPercentile(description->histogram, percentiles[percentile_idx]) / NS_PER_SEC     );
+
+    unsigned long long count = latencyHistogramGetCount(description->histogram);
+
+    fprintf(stream, "%s_sum %.9f\n", description->name, latencyHistogramGetMean(description->histogram) * count / NS_PER_SEC);
+    fprintf(stream, "%s_count %llu\n", description->name, count);
+}
+
+int metricsExporterWriteSnapshot(FILE* stream)
+{
+    if(stream == NULL)
+        return -1;
+
+    int registered_metrics = atomic_load(&metrics_num);
+
+    for(int metric_idx = 0; metric_idx < registered_metrics; metric_idx++)
+    {
+        const METRIC_DESCRIPTION* description = &metrics[metric_idx];
+
+        fprintf(stream, "# HELP %s %s\n", description->name, description->help);
+        fprintf(stream, "# TYPE %s %s\n", description->name, (description->type == METRIC_TYPE_COUNTER ? "counter" : "gauge"));
+        fprintf(stream, "%s %lld\n", description->name, metricsExporterGetValue(metric_idx));
+    }
+
+    int registered_histograms = atomic_load(&histograms_num);
+
+    for(int histogram_idx = 0; histogram_idx < registered_histograms; histogram_idx++)
+        writeHistogram(stream, &histograms[histogram_idx]);
+
+    return (ferror(stream) ? -1 : 0);
+}
+
+static void serveClient(int client_fd)
+{
+    char request[REQUEST_SIZE] = {0};
+    struct pollfd client_poll = { .fd = client_fd, .events = POLLIN };
+
+    if(poll(&client_poll, 1, REQUEST_TIMEOUT_MS) > 0)
+    {
+        ssize_t size = recv(client_fd, request, sizeof(request) - 1, 0);
+        request[(size > 0 ? size : 0)] = 0;
+    }
+
+    char* body = NULL;
+    size_t body_size = 0;
+    FILE* body_stream = open_memstream(&body, &body_size);
+
+    if(body_stream == NULL)
+        return;
+
+    metricsExporterWriteSnapshot(body_stream);
+    fclose(body_stream);
+
+    if(strncmp(request, HTTP_GET_PREFIX, strlen(HTTP_GET_PREFIX)) == 0)
+    {
+        char header[REQUEST_SIZE];
+        int header_size = snprintf(header, sizeof(header), "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n", body_size);
+
+        if(localSocketSendAll(client_fd, header, (size_t)header_size, SEND_TIMEOUT_MS) < 0)
+        {
+            free(body);
+            return;
+        }
+    }
+
+    localSocketSendAll(client_fd, body, body_size, SEND_TIMEOUT_MS);
+    free(body);
+
+    metricsExporterAdd(scrapes_metric, 1);
+}
+
+static void* exporterRoutine(void* arg)
+{
+    (void)arg;
+
+    while(!atomic_load(&stop_requested))
+    {
+        struct pollfd listen_poll = { .fd = listen_fd, .events = POLLIN };
+
+        if(poll(&listen_poll, 1, POLL_PERIOD_MS) <= 0)
+            continue;
+
+        int client_fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+
+        if(client_fd < 0)
+            continue;
+
+        serveClient(client_fd);
+
+        shutdown(client_fd, SHUT_WR);
+        close(client_fd);
+    }
+
+    return NULL;
+}
+
+// "address" is either the path of a UNIX socket (anything containing a '/') or a TCP port, bound to the loopback interface only.
+int metricsExporterStart(const char* address)
+{
+    if(address == NULL || atomic_load(&exporter_running))
+        return -1;
+
+    listen_fd = localSocketListen(address, 0);
+
+    if(listen_fd < 0)
+        return -1;
+
+    if(localSocketIsUnixAddress(address))
+        strcpy(unix_address.sun_path, address);
+
+    scrapes_metric = metricsExporterRegister("metrics_exporter_scrapes_total", "Snapshots served by the metrics exporter.", METRIC_TYPE_COUNTER);
+    atomic_store(&stop_requested, 0);
+
+    if(pthread_create(&exporter_thread, NULL, exporterRoutine, NULL) != 0)
+    {
+        metricsExporterStop();
+        return -1;
+    }
+
+    atomic_store(&exporter_running, 1);
+
+    return 0;
+}
+
+// Waits for the client being served (if any), then closes the socket.
+void metricsExporterStop()
+{
+    if(atomic_load(&exporter_running))
+    {
+        atomic_store(&stop_requested, 1);
+        pthread_join(exporter_thread, NULL);
+        atomic_store(&exporter_running, 0);
+    }
+
+    if(listen_fd >= 0)
+    {
+        close(listen_fd);
+        listen_fd = -1;
+    }
+
+    if(unix_address.sun_path[0] != 0)
+    {
+        unlink(unix_address.sun_path);
+        unix_address.sun_path[0] = 0;
+    }
+}
+
+int metricsExporterIsRunning()
+{
+    return atomic_load(&exporter_running);
+}
+
+/**************************************/
@@ -0,0 +1,41 @@
+#ifndef METRICS_EXPORTER_H
+#define METRICS_EXPORTER_H
+
+/********* Include statements *********/
+
+#include <stdio.h>
+#include "LatencyHistogram.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define METRICS_EXPORTER_MAX_METRICS    64
+#define METRICS_EXPORTER_MAX_HISTOGRAMS 16
+
+/**************************************/
+
+/********** Type definitions **********/
+
+typedef enum
+{
+    METRIC_TYPE_COUNTER = 0 ,   // Only ever goes up, such as the number of requests.
+    METRIC_TYPE_GAUGE       ,   // Goes up and down, such as the number of items in a queue.
+} METRIC_TYPE;
+
+/**************************************/
+
+/********* Function prototypes ********/
+
+int       metricsExporterRegister(const char* name, const char* help, METRIC_TYPE type);
+int       metricsExporterRegisterHistogram(const char* name, const char* help, const LATENCY_HISTOGRAM* histogram);
+void      metricsExporterAdd(int metric, long long value);
+long long metricsExporterGetValue(int metric);
+int       metricsExporterWriteSnapshot(FILE* stream);
+int       metricsExporterStart(const char* address);
+void      metricsExporterStop();
+int       metricsExporterIsRunning();
+
+/**************************************/
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef OWNED_COUNTER_H
+#define OWNED_COUNTER_H
+
+/********* Include statements *********/
+
+#include <stdatomic.h>
+
+/**************************************/
+
+/******** Function definitions ********/
+
+// Adds to a counter written by a single thread (its owner), so no atomic read-modify-write is needed. Counters are atomic so that
+// other threads can read them meanwhile.
+static inline void ownedCounterAdd(atomic_ullong* counter, unsigned long long value)
+{
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+/**************************************/
+
+#endif
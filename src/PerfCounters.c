@@ -0,0 +1,221 @@
+/*
+Timings tell how long a piece of code takes, but not why. Modern CPUs include a Performance Monitoring Unit (PMU) able to count
+hardware events such as cycles, retired instructions or cache misses, and the Linux kernel exposes those counters (along with
+software ones, such as context switches) through a system call that has no glibc wrapper:
+
+int perf_event_open(struct perf_event_attr *attr, pid_t pid, int cpu, int group_fd, unsigned long flags)
+
+Where:
+    ·attr: describes the event to count (type, config) and how to count it (initially disabled, inherited by new threads, ...).
+    ·pid: 0 for the calling thread.
+    ·cpu: -1 to count on any CPU.
+    ·group_fd: -1 to create a group leader, or the leader's file descriptor so that the new event is scheduled on the PMU
+    together with the rest of the group. This guarantees ratios such as instructions per cycle (IPC) are computed from counts
+    taken during the very same time span.
+    ·Returns a file descriptor, from which the count is read(), or -1 on failure.
+
+Counters are enabled and disabled through ioctl (PERF_EVENT_IOC_ENABLE, PERF_EVENT_IOC_DISABLE, PERF_EVENT_IOC_RESET). When there
+are more events than PMU registers, the kernel multiplexes them; the enabled and running times read along with each value allow
+estimating the full count.
+
+Two scopes are supported:
+    ·PERF_COUNTER_SCOPE_THREAD: counts just the calling thread.
+    ·PERF_COUNTER_SCOPE_PROCESS: the "inherit" flag makes every thread created after opening the counters get its own copy, which
+    is added to the parent's count when it ends. Thus, opening them right before launching a lesson counts the whole lesson.
+
+Many environments (virtual machines, containers, perf_event_paranoid settings) do not provide some of the counters, so each one is
+opened independently and the missing ones are just reported as unavailable.
+*/
+
+/********* Include statements *********/
+
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "PerfCounters.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define HW_CACHE_CONFIG(cache, op, result)  ((cache) | ((op) << 8) | ((result) << 16))
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+typedef struct
+{
+    const char*     name    ;
+    unsigned int    type    ;
+    unsigned long   config  ;
+} PERF_COUNTER_INFO;
+
+typedef struct
+{
+    unsigned long long  value           ;
+    unsigned long long  time_enabled    ;
+    unsigned long long  time_running    ;
+} PERF_COUNTER_READING;
+
+/**************************************/
+
+/********* Private variables **********/
+
+static const PERF_COUNTER_INFO counter_info[PERF_COUNTERS_NUM] =
+{
+    [PERF_COUNTER_CYCLES]           = { "cycles"            , PERF_TYPE_HARDWARE    , PERF_COUNT_HW_CPU_CYCLES      },
+    [PERF_COUNTER_INSTRUCTIONS]     = { "instructions"      , PERF_TYPE_HARDWARE    , PERF_COUNT_HW_INSTRUCTIONS    },
+    [PERF_COUNTER_LLC_MISSES]       = { "llc_misses"        , PERF_TYPE_HW_CACHE    , HW_CACHE_CONFIG(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)     },
+    [PERF_COUNTER_BRANCH_MISSES]    = { "branch_misses"     , PERF_TYPE_HARDWARE    , PERF_COUNT_HW_BRANCH_MISSES   },
+    [PERF_COUNTER_DTLB_MISSES]      = { "dtlb_misses"       , PERF_TYPE_HW_CACHE    , HW_CACHE_CONFIG(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)   },
+    [PERF_COUNTER_CONTEXT_SWITCHES] = { "context_switches"  , PERF_TYPE_SOFTWARE    , PERF_COUNT_SW_CONTEXT_SWITCHES},
+};
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static int openCounter(PERF_COUNTER_ID counter_id, PERF_COUNTER_SCOPE scope, int group_fd);
+
+/**************************************/
+
+/******** Function definitions ********/
+
+static int openCounter(PERF_COUNTER_ID counter_id, PERF_COUNTER_SCOPE scope, int group_fd)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+
+    attr.size           = sizeof(attr);
+    attr.type           = counter_info[counter_id].type;
+    attr.config         = counter_info[counter_id].config;
+    attr.disabled       = (group_fd < 0);   // Group members follow their leader, so only the leader starts disabled.
+    attr.inherit        = (scope == PERF_COUNTER_SCOPE_PROCESS);
+    attr.exclude_hv     = 1;
+    attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    // Count kernel-side events too if allowed. Unprivileged users may be restricted to user space by perf_event_paranoid.
+    int fd = syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+
+    if(fd < 0 && (errno == EACCES || errno == EPERM))
+    {
+        attr.exclude_kernel = 1;
+        fd = syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+    }
+
+    return fd;
+}
+
+// Returns the number of counters that could be opened (0 if none of them is available in the current environment).
+int perfCountersOpen(PERF_COUNTER_GROUP* group, PERF_COUNTER_SCOPE scope)
+{
+    if(group == NULL)
+        return -1;
+
+    group->scope = scope;
+
+    int opened_num = 0;
+    int hardware_leader_fd = -1;
+
+    for(int counter_id = 0; counter_id < PERF_COUNTERS_NUM; counter_id++)
+    {
+        // Hardware events are grouped under the first one that could be opened. Software events are not limited by PMU
+        // registers, so they stay on their own.
+        int is_hardware = (counter_info[counter_id].type != PERF_TYPE_SOFTWARE);
+        int group_fd = (is_hardware ? hardware_leader_fd : -1);
+
+        group->fds[counter_id] = openCounter((PERF_COUNTER_ID)counter_id, scope, group_fd);
+
+        // If the group could not be joined, count the event on its own rather than losing it.
+        if(group->fds[counter_id] < 0 && group_fd >= 0)
+            group->fds[counter_id] = openCounter((PERF_COUNTER_ID)counter_id, scope, -1);
+
+        if(group->fds[counter_id] < 0)
+            continue;
+
+        if(is_hardware && hardware_leader_fd < 0)
+            hardware_leader_fd = group->fds[counter_id];
+
+        ++opened_num;
+    }
+
+    return opened_num;
+}
+
+int perfCountersStart(PERF_COUNTER_GROUP* group)
+{
+    if(group == NULL)
+        return -1;
+
+    for(int counter_id = 0; counter_id < PERF_COUNTERS_NUM; counter_id++)
+    {
+        if(group->fds[counter_id] < 0)
+            continue;
+
+        ioctl(group->fds[counter_id], PERF_EVENT_IOC_RESET, 0);
+        ioctl(group->fds[counter_id], PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    return 0;
+}
+
+int perfCountersStop(PERF_COUNTER_GROUP* group, PERF_COUNTER_VALUES* values)
+{
+    if(group == NULL || values == NULL)
+        return -1;
+
+    memset(values, 0, sizeof(PERF_COUNTER_VALUES));
+
+    for(int counter_id = 0; counter_id < PERF_COUNTERS_NUM; counter_id++)
+        if(group->fds[counter_id] >= 0)
+            ioctl(group->fds[counter_id], PERF_EVENT_IOC_DISABLE, 0);
+
+    for(int counter_id = 0; counter_id < PERF_COUNTERS_NUM; counter_id++)
+    {
+        PERF_COUNTER_READING reading;
+
+        if(group->fds[counter_id] < 0 || read(group->fds[counter_id], &reading, sizeof(reading)) != sizeof(reading))
+            continue;
+
+        values->values[counter_id] = reading.value;
+        values->available_mask |= (1U << counter_id);
+
+        // If the counter has not been on the PMU the whole time, estimate the full count.
+        if(reading.time_running != 0 && reading.time_running < reading.time_enabled)
+        {
+            values->values[counter_id] = (unsigned long long)((double)reading.value * reading.time_enabled / reading.time_running);
+            values->multiplexed_mask |= (1U << counter_id);
+        }
+    }
+
+    return 0;
+}
+
+void perfCountersClose(PERF_COUNTER_GROUP* group)
+{
+    if(group == NULL)
+        return;
+
+    // Members are closed before their leader.
+    for(int counter_id = PERF_COUNTERS_NUM - 1; counter_id >= 0; counter_id--)
+    {
+        if(group->fds[counter_id] >= 0)
+            close(group->fds[counter_id]);
+
+        group->fds[counter_id] = -1;
+    }
+}
+
+const char* perfCounterGetName(PERF_COUNTER_ID counter_id)
+{
+    return (counter_id < PERF_COUNTERS_NUM ? counter_info[counter_id].name : NULL);
+}
+
+/**************************************/
@@ -0,0 +1,48 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+/********** Type definitions **********/
+
+typedef enum
+{
+    PERF_COUNTER_CYCLES             ,
+    PERF_COUNTER_INSTRUCTIONS       ,
+    PERF_COUNTER_LLC_MISSES         ,
+    PERF_COUNTER_BRANCH_MISSES      ,
+    PERF_COUNTER_DTLB_MISSES        ,
+    PERF_COUNTER_CONTEXT_SWITCHES   ,
+    PERF_COUNTERS_NUM               ,
+} PERF_COUNTER_ID;
+
+typedef enum
+{
+    PERF_COUNTER_SCOPE_THREAD   ,   // Just the calling thread.
+    PERF_COUNTER_SCOPE_PROCESS  ,   // The calling thread plus every thread it creates afterwards.
+} PERF_COUNTER_SCOPE;
+
+typedef struct
+{
+    int                 fds[PERF_COUNTERS_NUM]  ;
+    PERF_COUNTER_SCOPE  scope                   ;
+} PERF_COUNTER_GROUP;
+
+typedef struct
+{
+    unsigned long long  values[PERF_COUNTERS_NUM]   ;
+    unsigned int        available_mask              ;   // Bit i is set if counter i could be opened and read.
+    unsigned int        multiplexed_mask            ;   // Bit i is set if counter i was scaled (not always on the PMU).
+} PERF_COUNTER_VALUES;
+
+/**************************************/
+
+/********* Function prototypes ********/
+
+int         perfCountersOpen(PERF_COUNTER_GROUP* group, PERF_COUNTER_SCOPE scope);
+int         perfCountersStart(PERF_COUNTER_GROUP* group);
+int         perfCountersStop(PERF_COUNTER_GROUP* group, PERF_COUNTER_VALUES* values);
+void        perfCountersClose(PERF_COUNTER_GROUP* group);
+const char* perfCounterGetName(PERF_COUNTER_ID counter_id);
+
+/**************************************/
+
+#endif
@@ -0,0 +1,357 @@
+/*
+Lessons share a single process when run one after another, so any of them can spoil the rest of the run: detached threads that
+outlive their lesson keep on printing, and a crash or a hang takes every remaining lesson down. Running each lesson in a process of
+its own avoids all of that:
+
+pid_t fork(void)
+
+Where:
+    ·Returns the child's PID to the parent, 0 to the child and -1 on failure. The child is an exact copy of the parent, except
+    that just the thread calling fork is duplicated.
+
+The child's stdout and stderr are redirected (dup2) to the write end of a pipe, so that the parent can collect each lesson's output
+and print it in order later, even if lessons ran at the same time. The parent waits on all pipes at once with poll, and reaps
+children with waitpid, which tells whether a child exited (and its exit status) or was terminated by a signal.
+
+Independent lessons are run concurrently, as long as the CPUs they keep busy fit within the given CPU budget. Lessons that mostly
+sleep or wait have a weight of 0, so they are always started right away. A lesson that does not finish within the timeout is killed
+(SIGKILL) and reported as timed out. Some lessons fork processes of their own, which inherit the pipe, so every child is made the
+leader of a new process group (setpgid) and the whole group is killed at once. Whatever is left in the pipe of a killed lesson is not
+waited for either, in case any process escaped its group.
+*/
+
+/********* Include statements *********/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/prctl.h>
+#include "VirtualTime.h"
+#include "ProcessRunner.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define POLL_INTERVAL_MS            50
+#define READ_CHUNK_SIZE             4096
+#define INITIAL_OUTPUT_CAPACITY     4096
+#define MAX_OUTPUT_SIZE             (8 * 1024 * 1024)   // Any output beyond this is read and discarded.
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+typedef struct
+{
+    pid_t           pid             ;
+    int             pipe_fd         ;
+    int             running         ;
+    int             exited          ;
+    int             wait_status     ;
+    int             timed_out       ;
+    unsigned int    weight          ;
+    size_t          output_capacity ;
+    struct timespec start_time      ;
+} PROCESS_RUNNER_JOB_STATE;
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static unsigned long long   getElapsedNanoseconds(const struct timespec* start_time);
+static int                  appendOutput(PROCESS_RUNNER_JOB_STATE* state, PROCESS_RUNNER_RESULT* result, const char* data, size_t size);
+static int                  startJob(const PROCESS_RUNNER_JOB* job, PROCESS_RUNNER_JOB_STATE* states, unsigned int jobs_num, unsigned int job_idx);
+static void                 drainPipe(PROCESS_RUNNER_JOB_STATE* state, PROCESS_RUNNER_RESULT* result);
+static void                 finishJob(PROCESS_RUNNER_JOB_STATE* state, PROCESS_RUNNER_RESULT* result);
+
+/**************************************/
+
+/******** Function definitions ********/
+
+static unsigned long long getElapsedNanoseconds(const struct timespec* start_time)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (unsigned long long)(now.tv_sec - start_time->tv_sec) * 1000000000ULL + now.tv_nsec - start_time->tv_nsec;
+}
+
+static int appendOutput(PROCESS_RUNNER_JOB_STATE* state, PROCESS_RUNNER_RESULT* result, const char* data, size_t size)
+{
+    if(result->output_size + size > MAX_OUTPUT_SIZE)
+        size = MAX_OUTPUT_SIZE - result->output_size;
+
+    if(size == 0)
+        return 0;
+
+    // One byte is always kept for the null terminator.
+    if(result->output_size + size + 1 > state->output_capacity)
+    {
+        size_t new_capacity = (state->output_capacity == 0 ? INITIAL_OUTPUT_CAPACITY : state->output_capacity);
+
+        while(result->output_size + size + 1 > new_capacity)
+            new_capacity *= 2;
+
+        char* new_output = (char*)realloc(result->output, new_capacity);
+
+        if(new_output == NULL)
+            return -1;
+
+        result->output = new_output;
+        state->output_capacity = new_capacity;
+    }
+
+    memcpy(result->output + result->output_size, data, size);
+    result->output_size += size;
+    result->output[result->output_size] = 0;
+
+    return 0;
+}
+
+static int startJob(const PROCESS_RUNNER_JOB* job, PROCESS_RUNNER_JOB_STATE* states, unsigned int jobs_num, unsigned int job_idx)
+{
+    int pipe_fds[2];
+
+    if(pipe(pipe_fds) < 0)
+        return -1;
+
+    // Anything still buffered would be printed by the child as well.
+    fflush(NULL);
+
+    pid_t pid = fork();
+
+    if(pid < 0)
+    {
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        return -1;
+    }
+
+    if(pid == 0)
+    {
+        // Do not outlive the runner if it is killed, and take any process the lesson forks into a group of its own.
+        prctl(PR_SET_PDEATHSIG, SIGKILL);
+        setpgid(0, 0);
+
+        for(unsigned int i = 0; i < jobs_num; i++)
+            if(states[i].running && states[i].pipe_fd >= 0)
+                close(states[i].pipe_fd);
+
+        close(pipe_fds[0]);
+        dup2(pipe_fds[1], STDOUT_FILENO);
+        dup2(pipe_fds[1], STDERR_FILENO);
+        close(pipe_fds[1]);
+
+        // Lines are flushed as they are written, so that output is not lost if the lesson crashes or is killed.
+        setvbuf(stdout, NULL, _IOLBF, 0);
+
+        virtualTimeRunAsParticipant(job->function);
+
+        exit(EXIT_SUCCESS);
+    }
+
+    close(pipe_fds[1]);
+
+    // Also set from the parent, so that the group exists even if the lesson times out before the child has run at all.
+    setpgid(pid, pid);
+
+    PROCESS_RUNNER_JOB_STATE* state = &states[job_idx];
+
+    state->pid      = pid;
+    state->pipe_fd  = pipe_fds[0];
+    state->running  = 1;
+    clock_gettime(CLOCK_MONOTONIC, &state->start_time);
+
+    return 0;
+}
+
+// Reads whatever is available. The pipe is closed once every writer (the child and any thread of it) is gone.
+static void drainPipe(PROCESS_RUNNER_JOB_STATE* state, PROCESS_RUNNER_RESULT* result)
+{
+    char buffer[READ_CHUNK_SIZE];
+    ssize_t read_size = read(state->pipe_fd, buffer, sizeof(buffer));
+
+    if(read_size < 0 && errno == EINTR)
+        return;
+
+    if(read_size > 0)
+    {
+        appendOutput(state, result, buffer, (size_t)read_size);
+        return;
+    }
+
+    close(state->pipe_fd);
+    state->pipe_fd = -1;
+}
+
+static void finishJob(PROCESS_RUNNER_JOB_STATE* state, PROCESS_RUNNER_RESULT* result)
+{
+    state->running = 0;
+
+    result->wall_time_ns = getElapsedNanoseconds(&state->start_time);
+
+    if(state->timed_out)
+    {
+        result->status = PROCESS_RUNNER_STATUS_TIMED_OUT;
+        return;
+    }
+
+    if(WIFSIGNALED(state->wait_status))
+    {
+        result->status = PROCESS_RUNNER_STATUS_CRASHED;
+        result->signal_number = WTERMSIG(state->wait_status);
+        return;
+    }
+
+    result->exit_code = WEXITSTATUS(state->wait_status);
+    result->status = (result->exit_code == 0 ? PROCESS_RUNNER_STATUS_OK : PROCESS_RUNNER_STATUS_FAILED);
+}
+
+// Runs every job in a child process of its own. Results are given in the same order as jobs. A timeout of 0 means no timeout.
+// Returns the number of jobs which did not finish successfully, or -1 on error.
+int processRunnerRun(const PROCESS_RUNNER_JOB* jobs, unsigned int jobs_num, unsigned int cpu_budget, unsigned int timeout_s, PROCESS_RUNNER_RESULT* results)
+{
+    if(jobs == NULL || results == NULL || jobs_num == 0)
+        return -1;
+
+    PROCESS_RUNNER_JOB_STATE* states = (PROCESS_RUNNER_JOB_STATE*)calloc(jobs_num, sizeof(PROCESS_RUNNER_JOB_STATE));
+    struct pollfd* poll_fds = (struct pollfd*)calloc(jobs_num, sizeof(struct pollfd));
+    unsigned int* polled_jobs = (unsigned int*)calloc(jobs_num, sizeof(unsigned int));
+
+    if(states == NULL || poll_fds == NULL || polled_jobs == NULL)
+    {
+        free(states);
+        free(poll_fds);
+        free(polled_jobs);
+        return -1;
+    }
+
+    memset(results, 0, jobs_num * sizeof(PROCESS_RUNNER_RESULT));
+
+    if(cpu_budget == 0)
+        cpu_budget = 1;
+
+    unsigned int next_job = 0;
+    unsigned int running_num = 0;
+    unsigned int used_weight = 0;
+
+    while(next_job < jobs_num || running_num > 0)
+    {
+        // Jobs are started in order. A job heavier than the whole budget is just run on its own.
+        while(next_job < jobs_num)
+        {
+            unsigned int weight = (jobs[next_job].cpu_weight < cpu_budget ? jobs[next_job].cpu_weight : cpu_budget);
+
+            if(running_num > 0 && used_weight + weight > cpu_budget)
+                break;
+
+            if(startJob(&jobs[next_job], states, jobs_num, next_job) < 0)
+            {
+                results[next_job].status = PROCESS_RUNNER_STATUS_NOT_STARTED;
+                ++next_job;
+                continue;
+            }
+
+            states[next_job].weight = weight;
+            used_weight += weight;
+            ++running_num;
+            ++next_job;
+        }
+
+        nfds_t poll_fds_num = 0;
+
+        for(unsigned int job_idx = 0; job_idx < jobs_num; job_idx++)
+        {
+            if(!states[job_idx].running || states[job_idx].pipe_fd < 0)
+                continue;
+
+            poll_fds[poll_fds_num].fd = states[job_idx].pipe_fd;
+            poll_fds[poll_fds_num].events = POLLIN;
+            polled_jobs[poll_fds_num++] = job_idx;
+        }
+
+        if(poll(poll_fds, poll_fds_num, POLL_INTERVAL_MS) > 0)
+            for(nfds_t poll_idx = 0; poll_idx < poll_fds_num; poll_idx++)
+                if(poll_fds[poll_idx].revents != 0)
+                    drainPipe(&states[polled_jobs[poll_idx]], &results[polled_jobs[poll_idx]]);
+
+        for(unsigned int job_idx = 0; job_idx < jobs_num; job_idx++)
+        {
+            PROCESS_RUNNER_JOB_STATE* state = &states[job_idx];
+
+            if(!state->running)
+                continue;
+
+            if(!state->exited && waitpid(state->pid, &state->wait_status, WNOHANG) == state->pid)
+                state->exited = 1;
+
+            // The lesson may have exited while processes it forked still hold its pipe, and those are killed as well.
+            if(!state->timed_out && (!state->exited || state->pipe_fd >= 0) && timeout_s > 0 && getElapsedNanoseconds(&state->start_time) >= timeout_s * 1000000000ULL)
+            {
+                kill(-state->pid, SIGKILL);
+                state->timed_out = 1;
+            }
+
+            // A killed lesson prints nothing else, so its pipe is not waited for (processes outside its group may still hold it).
+            if(state->exited && state->timed_out && state->pipe_fd >= 0)
+            {
+                close(state->pipe_fd);
+                state->pipe_fd = -1;
+            }
+
+            // Output is complete once the pipe has been closed, so wait for both before reporting the job.
+            if(state->exited && state->pipe_fd < 0)
+            {
+                finishJob(state, &results[job_idx]);
+                used_weight -= state->weight;
+                --running_num;
+            }
+        }
+    }
+
+    unsigned int failed_num = 0;
+
+    for(unsigned int job_idx = 0; job_idx < jobs_num; job_idx++)
+        if(results[job_idx].status != PROCESS_RUNNER_STATUS_OK)
+            ++failed_num;
+
+    free(states);
+    free(poll_fds);
+    free(polled_jobs);
+
+    return (int)failed_num;
+}
+
+void processRunnerFreeResults(PROCESS_RUNNER_RESULT* results, unsigned int results_num)
+{
+    if(results == NULL)
+        return;
+
+    for(unsigned int result_idx = 0; result_idx < results_num; result_idx++)
+    {
+        free(results[result_idx].output);
+        results[result_idx].output = NULL;
+        results[result_idx].output_size = 0;
+    }
+}
+
+const char* processRunnerGetStatusName(PROCESS_RUNNER_STATUS status)
+{
+    switch(status)
+    {
+        case PROCESS_RUNNER_STATUS_OK:          return "ok";
+        case PROCESS_RUNNER_STATUS_FAILED:      return "failed";
+        case PROCESS_RUNNER_STATUS_CRASHED:     return "crashed";
+        case PROCESS_RUNNER_STATUS_TIMED_OUT:   return "timed out";
+        default:                                return "not started";
+    }
+}
+
+/**************************************/
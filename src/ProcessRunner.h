@@ -0,0 +1,48 @@
+#ifndef PROCESS_RUNNER_H
+#define PROCESS_RUNNER_H
+
+/********* Include statements *********/
+
+#include <stddef.h>
+
+/**************************************/
+
+/********** Type definitions **********/
+
+typedef struct
+{
+    const char*     name            ;
+    void            (*function)(void);
+    unsigned int    cpu_weight      ;   // Number of CPUs the job keeps busy (0 for jobs which mostly sleep or wait).
+} PROCESS_RUNNER_JOB;
+
+typedef enum
+{
+    PROCESS_RUNNER_STATUS_NOT_STARTED   ,
+    PROCESS_RUNNER_STATUS_OK            ,
+    PROCESS_RUNNER_STATUS_FAILED        ,   // Exited with a non-zero status.
+    PROCESS_RUNNER_STATUS_CRASHED       ,   // Terminated by a signal.
+    PROCESS_RUNNER_STATUS_TIMED_OUT     ,
+} PROCESS_RUNNER_STATUS;
+
+typedef struct
+{
+    PROCESS_RUNNER_STATUS   status          ;
+    int                     exit_code       ;
+    int                     signal_number   ;
+    unsigned long long      wall_time_ns    ;
+    char*                   output          ;   // Everything written to stdout and stderr, null-terminated.
+    size_t                  output_size     ;
+} PROCESS_RUNNER_RESULT;
+
+/**************************************/
+
+/********* Function prototypes ********/
+
+int         processRunnerRun(const PROCESS_RUNNER_JOB* jobs, unsigned int jobs_num, unsigned int cpu_budget, unsigned int timeout_s, PROCESS_RUNNER_RESULT* results);
+void        processRunnerFreeResults(PROCESS_RUNNER_RESULT* results, unsigned int results_num);
+const char* processRunnerGetStatusName(PROCESS_RUNNER_STATUS status);
+
+/**************************************/
+
+#endif
@@ -0,0 +1,578 @@
+/*
+Producers and consumers have been connected in many ways so far: a buffer guarded by a mutex and a condition variable (see
+ThreadsWithConditionVariables.c), semaphores (ThreadsWithSemaphores.c), or a lock-free queue (LockFreeQueue.c). Which one suits a
+program best depends on how many threads are on each side, how large items are and whether they come one by one or in batches, so
+rather than guessing, this lesson runs every queue through the same set of scenarios and measures them:
+    ·Condition variable ring: a bounded circular buffer guarded by a mutex, where producers wait while it is full and consumers wait
+    while it is empty, each on a condition variable of its own. Batches are copied in under a single lock.
+    ·Michael-Scott queue: the lock-free queue in LockFreeQueue.c, unbounded, with every item allocated by its producer and freed by
+    its consumer. It has no way to wait, so consumers yield the CPU while it is empty, and batches are just items queued one by one.
+
+Every queue is run with one producer and one consumer (1:1), one producer and many consumers (1:N), many producers and one consumer
+(N:1) and many of both (N:M), where N is the "threads" lesson parameter (at least 2), for small and large items (16 and 512 bytes)
+and for single items and batches of 16. For every run, the lesson prints:
+    ·Throughput: items from producers to consumers per second.
+    ·Latency: time from an item being handed to the queue until a consumer takes it, as its median and 99th percentile. Every item
+    carries the time it was queued at.
+    ·CPU use: CPU time spent by the whole process over wall time (getrusage, as in Benchmark.c). 100% is one CPU kept busy: waiting
+    on a condition variable takes none, while yielding in a loop keeps taking it.
+
+Being unbounded, the Michael-Scott queue never makes producers wait, so they may run far ahead of consumers: items pile up, and
+their latency grows with the backlog. The ring pushes back on producers once it is full instead, which keeps latencies bounded.
+
+Every item is numbered, and consumers add numbers up, so that items lost or delivered twice are told apart. The number of items per
+producer is the "iterations" lesson parameter.
+*/
+
+/********* Include statements *********/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "ThreadColors.h"
+#include "ThreadCreationStatus.h"
+#include "ThreadTracer.h"
+#include "HazardPointers.h"
+#include "LockFreeQueue.h"
+#include "LatencyHistogram.h"
+#include "LessonParameters.h"
+#include "QueueBenchmark.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define DEFAULT_ITEMS_PER_PRODUCER  50000
+#define DEFAULT_SIDE_THREADS        2       // Producers or consumers on the "many" side of a scenario.
+#define MAX_SIDE_THREADS            16
+#define RING_CAPACITY               1024    // Items held by the condition variable ring.
+#define MAX_ITEM_SIZE               512
+#define MAX_BATCH_SIZE              16
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+// Every item starts with this header. Items larger than it are padded with payload bytes, copied along with the header.
+typedef struct
+{
+    unsigned long long  enqueue_ns  ;
+    unsigned long long  sequence    ;   // Unique among every item of a run, starting from 1.
+} QUEUE_ITEM_HEADER;
+
+typedef struct
+{
+    pthread_mutex_t lock        ;
+    pthread_cond_t  not_full    ;
+    pthread_cond_t  not_empty   ;
+    unsigned char*  slots       ;
+    size_t          item_size   ;
+    unsigned int    head        ;
+    unsigned int    count       ;
+    int             closed      ;
+} CONDVAR_RING;
+
+typedef struct
+{
+    LOCK_FREE_QUEUE*    queue       ;
+    size_t              item_size   ;
+    atomic_int          closed      ;
+} LOCK_FREE_CHANNEL;
+
+// Every queue is used through the same functions, so that scenarios do not care which one they are running.
+typedef struct
+{
+    const char* name                                                            ;
+    void*       (*create)(size_t item_size)                                     ;
+    void        (*destroy)(void* queue)                                         ;
+    int         (*push)(void* queue, const unsigned char* items, int items_num) ;   // Blocks until every item has been queued.
+    int         (*pop)(void* queue, unsigned char* items, int max_items)        ;   // Blocks until some item comes, 0 once closed and empty.
+    void        (*close)(void* queue)                                           ;
+} QUEUE_OPERATIONS;
+
+typedef struct
+{
+    unsigned int    producers_num   ;
+    unsigned int    consumers_num   ;
+} QUEUE_SCENARIO;
+
+typedef struct
+{
+    const QUEUE_OPERATIONS* operations      ;
+    void*                   queue           ;
+    atomic_int*             start           ;   // Set once every thread has been created, so that they all start at once.
+    size_t                  item_size       ;
+    int                     batch_size      ;
+    unsigned long           items_num       ;   // Items to be produced (consumers take as many as they get).
+    unsigned long long      first_sequence  ;
+    unsigned long long      sequence_sum    ;
+    unsigned long long      items_done      ;
+    LATENCY_HISTOGRAM*      latencies       ;
+} QUEUE_THREAD_DATA;
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static void*                condvarRingCreate(size_t item_size);
+static void                 condvarRingDestroy(void* queue);
+static int                  condvarRingPush(void* queue, const unsigned char* items, int items_num);
+static int                  condvarRingPop(void* queue, unsigned char* items, int max_items);
+static void                 condvarRingClose(void* queue);
+static void*                lockFreeChannelCreate(size_t item_size);
+static void                 lockFreeChannelDestroy(void* queue);
+static int                  lockFreeChannelPush(void* queue, const unsigned char* items, int items_num);
+static int                  lockFreeChannelPop(void* queue, unsigned char* items, int max_items);
+static void                 lockFreeChannelClose(void* queue);
+static void*                producerRoutine(void* arg);
+static void*                consumerRoutine(void* arg);
+static unsigned long long   getProcessCpuNs();
+static int                  runScenario(const QUEUE_OPERATIONS* operations, const QUEUE_SCENARIO* scenario, size_t item_size, int batch_size, unsigned long items_num);
+
+/**************************************/
+
+/********* Private variables **********/
+
+static const QUEUE_OPERATIONS queues[] =
+{
+    { "Condvar ring"    , condvarRingCreate     , condvarRingDestroy    , condvarRingPush       , condvarRingPop        , condvarRingClose      },
+    { "M-S queue"       , lockFreeChannelCreate , lockFreeChannelDestroy, lockFreeChannelPush   , lockFreeChannelPop    , lockFreeChannelClose  },
+};
+
+static const size_t item_sizes[]    = { sizeof(QUEUE_ITEM_HEADER), MAX_ITEM_SIZE };
+static const int    batch_sizes[]   = { 1, MAX_BATCH_SIZE };
+
+static LATENCY_HISTOGRAM    consumer_latencies[MAX_SIDE_THREADS];
+static LATENCY_HISTOGRAM    scenario_latencies;
+
+/**************************************/
+
+/******** Function definitions ********/
+
+static void* condvarRingCreate(size_t item_size)
+{
+    CONDVAR_RING* ring = (CONDVAR_RING*)calloc(1, sizeof(CONDVAR_RING));
+
+    if(ring == NULL)
+        return NULL;
+
+    ring->slots = (unsigned char*)malloc(RING_CAPACITY * item_size);
+
+    if(ring->slots == NULL)
+    {
+        free(ring);
+        return NULL;
+    }
+
+    ring->item_size = item_size;
+    pthread_mutex_init(&ring->lock, NULL);
+    pthread_cond_init(&ring->not_full, NULL);
+    pthread_cond_init(&ring->not_empty, NULL);
+
+    return ring;
+}
+
+static void condvarRingDestroy(void* queue)
+{
+    CONDVAR_RING* ring = (CONDVAR_RING*)queue;
+
+    pthread_cond_destroy(&ring->not_empty);
+    pthread_cond_destroy(&ring->not_full);
+    pthread_mutex_destroy(&ring->lock);
+    free(ring->slots);
+    free(ring);
+}
+
+static int condvarRingPush(void* queue, const unsigned char* items, int items_num)
+{
+    CONDVAR_RING* ring = (CONDVAR_RING*)queue;
+    int pushed_num = 0;
+
+    pthread_mutex_lock(&ring->lock);
+
+    while(pushed_num < items_num)
+    {
+        while(ring->count == RING_CAPACITY)
+            pthread_cond_wait(&ring->not_full, &ring->lock);
+
+        int copied_num = 0;
+
+        for(; pushed_num < items_num && ring->count < RING_CAPACITY; pushed_num++, copied_num++)
+        {
+            unsigned int tail = (ring->head + ring->count) % RING_CAPACITY;
+
+            memcpy(ring->slots + tail * ring->item_size, items + pushed_num * ring->item_size, ring->item_size);
+            ring->count++;
+        }
+
+        // A batch may be enough for several consumers.
+        if(copied_num > 1)
+            pthread_cond_broadcast(&ring->not_empty);
+        else
+            pthread_cond_signal(&ring->not_empty);
+    }
+
+    pthread_mutex_unlock(&ring->lock);
+
+    return pushed_num;
+}
+
+static int condvarRingPop(void* queue, unsigned char* items, int max_items)
+{
+    CONDVAR_RING* ring = (CONDVAR_RING*)queue;
+    int popped_num = 0;
+
+    pthread_mutex_lock(&ring->lock);
+
+    while(ring->count == 0 && !ring->closed)
+        pthread_cond_wait(&ring->not_empty, &ring->lock);
+
+    for(; popped_num < max_items && ring->count > 0; popped_num++)
+    {
+        memcpy(items + popped_num * ring->item_size, ring->slots + ring->head * ring->item_size, ring->item_size);
+        ring->head = (ring->head + 1) % RING_CAPACITY;
+        ring->count--;
+    }
+
+    if(popped_num > 1)
+        pthread_cond_broadcast(&ring->not_full);
+    else if(popped_num == 1)
+        pthread_cond_signal(&ring->not_full);
+
+    pthread_mutex_unlock(&ring->lock);
+
+    return popped_num;
+}
+
+// Wakes every consumer up, so that the ones finding the ring empty end.
+static void condvarRingClose(void* queue)
+{
+    CONDVAR_RING* ring = (CONDVAR_RING*)queue;
+
+    pthread_mutex_lock(&ring->lock);
+    ring->closed = 1;
+    pthread_cond_broadcast(&ring->not_empty);
+    pthread_mutex_unlock(&ring->lock);
+}
+
+static void* lockFreeChannelCreate(size_t item_size)
+{
+    LOCK_FREE_CHANNEL* channel = (LOCK_FREE_CHANNEL*)calloc(1, sizeof(LOCK_FREE_CHANNEL));
+
+    if(channel == NULL)
+        return NULL;
+
+    channel->queue = lockFreeQueueCreate();
+
+    if(channel->queue == NULL)
+    {
+        free(channel);
+        return NULL;
+    }
+
+    channel->item_size = item_size;
+
+    return channel;
+}
+
+// Every thread has been joined by now, so nodes still waiting for a scan can be freed right away.
+static void lockFreeChannelDestroy(void* queue)
+{
+    LOCK_FREE_CHANNEL* channel = (LOCK_FREE_CHANNEL*)queue;
+    void* item;
+
+    while(lockFreeQueueDequeue(channel->queue, &item))
+        free(item);
+
+    lockFreeQueueDestroy(channel->queue);
+    hazardPointerReclaimAll();
+    free(channel);
+}
+
+// Items are copied into memory of their own, which the consumer frees, since the queue just carries pointers.
+static int lockFreeChannelPush(void* queue, const unsigned char* items, int items_num)
+{
+    LOCK_FREE_CHANNEL* channel = (LOCK_FREE_CHANNEL*)queue;
+    int pushed_num = 0;
+
+    for(; pushed_num < items_num; pushed_num++)
+    {
+        void* item = malloc(channel->item_size);
+
+        if(item == NULL)
+            break;
+
+        memcpy(item, items + pushed_num * channel->item_size, channel->item_size);
+
+        if(lockFreeQueueEnqueue(channel->queue, item) < 0)
+        {
+            free(item);
+            break;
+        }
+    }
+
+    return pushed_num;
+}
+
+static int lockFreeChannelPop(void* queue, unsigned char* items, int max_items)
+{
+    LOCK_FREE_CHANNEL* channel = (LOCK_FREE_CHANNEL*)queue;
+    int popped_num = 0;
+    void* item;
+
+    while(1)
+    {
+        // Read before dequeuing: once closed, every item has been queued already, so finding none then means there are no more.
+        int closed = atomic_load(&channel->closed);
+
+        while(popped_num < max_items && lockFreeQueueDequeue(channel->queue, &item))
+        {
+            memcpy(items + popped_num * channel->item_size, item, channel->item_size);
+            free(item);
+            popped_num++;
+        }
+
+        if(popped_num > 0 || closed)
+            return popped_num;
+
+        sched_yield();
+    }
+}
+
+static void lockFreeChannelClose(void* queue)
+{
+    atomic_store(&((LOCK_FREE_CHANNEL*)queue)->closed, 1);
+}
+
+static void* producerRoutine(void* arg)
+{
+    QUEUE_THREAD_DATA* data = (QUEUE_THREAD_DATA*)arg;
+    unsigned char items[MAX_BATCH_SIZE * MAX_ITEM_SIZE];
+
+    memset(items, 0xA5, sizeof(items));
+
+    while(!atomic_load(data->start))
+        sched_yield();
+
+    for(unsigned long item_idx = 0; item_idx < data->items_num; )
+    {
+        int batch_num = (data->items_num - item_idx < (unsigned long)data->batch_size ? (int)(data->items_num - item_idx) : data->batch_size);
+        unsigned long long enqueue_ns = latencyHistogramGetTimeNs();
+
+        for(int batch_idx = 0; batch_idx < batch_num; batch_idx++)
+        {
+            QUEUE_ITEM_HEADER* header = (QUEUE_ITEM_HEADER*)(items + batch_idx * data->item_size);
+
+            header->enqueue_ns  = enqueue_ns                                    ;
+            header->sequence    = data->first_sequence + item_idx + batch_idx   ;
+        }
+
+        int pushed_num = data->operations->push(data->queue, items, batch_num);
+
+        for(int batch_idx = 0; batch_idx < pushed_num; batch_idx++)
+            data->sequence_sum += data->first_sequence + item_idx + batch_idx;
+
+        data->items_done += pushed_num;
+
+        // Items which could not be queued (out of memory) are given up on, so that the run still ends.
+        item_idx += batch_num;
+    }
+
+    return NULL;
+}
+
+static void* consumerRoutine(void* arg)
+{
+    QUEUE_THREAD_DATA* data = (QUEUE_THREAD_DATA*)arg;
+    unsigned char items[MAX_BATCH_SIZE * MAX_ITEM_SIZE];
+    int popped_num;
+
+    while(!atomic_load(data->start))
+        sched_yield();
+
+    while((popped_num = data->operations->pop(data->queue, items, data->batch_size)) > 0)
+    {
+        unsigned long long dequeue_ns = latencyHistogramGetTimeNs();
+
+        for(int batch_idx = 0; batch_idx < popped_num; batch_idx++)
+        {
+            QUEUE_ITEM_HEADER header;
+
+            memcpy(&header, items + batch_idx * data->item_size, sizeof(header));
+            latencyHistogramRecord(data->latencies, dequeue_ns - header.enqueue_ns);
+            data->sequence_sum += header.sequence;
+        }
+
+        data->items_done += popped_num;
+    }
+
+    return NULL;
+}
+
+static unsigned long long getProcessCpuNs()
+{
+    struct rusage usage;
+
+    if(getrusage(RUSAGE_SELF, &usage) < 0)
+        return 0;
+
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000ULL + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000ULL;
+}
+
+// Returns 0 if the scenario was run (whether its items added up or not), -1 otherwise.
+static int runScenario(const QUEUE_OPERATIONS* operations, const QUEUE_SCENARIO* scenario, size_t item_size, int batch_size, unsigned long items_num)
+{
+    pthread_t producers[MAX_SIDE_THREADS];
+    pthread_t consumers[MAX_SIDE_THREADS];
+    QUEUE_THREAD_DATA producers_data[MAX_SIDE_THREADS];
+    QUEUE_THREAD_DATA consumers_data[MAX_SIDE_THREADS];
+    atomic_int start = 0;
+    unsigned int producers_created = 0;
+    unsigned int consumers_created = 0;
+    void* queue = operations->create(item_size);
+
+    if(queue == NULL)
+        return -1;
+
+    for(; consumers_created < scenario->consumers_num; consumers_created++)
+    {
+        latencyHistogramReset(&consumer_latencies[consumers_created]);
+
+        consumers_data[consumers_created] = (QUEUE_THREAD_DATA)
+        {
+            .operations = operations                                ,
+            .queue      = queue                                     ,
+            .start      = &start                                    ,
+            .item_size  = item_size                                 ,
+            .batch_size = batch_size                                ,
+            .latencies  = &consumer_latencies[consumers_created]    ,
+        };
+
+        if(checkThreadCreationStatus( TRACED_THREAD_CREATE(&consumers[consumers_created], NULL, consumerRoutine, &consumers_data[consumers_created]) ))
+            break;
+    }
+
+    for(; consumers_created == scenario->consumers_num && producers_created < scenario->producers_num; producers_created++)
+    {
+        producers_data[producers_created] = (QUEUE_THREAD_DATA)
+        {
+            .operations     = operations                        ,
+            .queue          = queue                             ,
+            .start          = &start                            ,
+            .item_size      = item_size                         ,
+            .batch_size     = batch_size                        ,
+            .items_num      = items_num                         ,
+            .first_sequence = 1 + producers_created * items_num ,
+        };
+
+        if(checkThreadCreationStatus( TRACED_THREAD_CREATE(&producers[producers_created], NULL, producerRoutine, &producers_data[producers_created]) ))
+            break;
+    }
+
+    // If not every thread could be created, the producers which were are let go with nothing to produce.
+    int created_all = (consumers_created == scenario->consumers_num && producers_created == scenario->producers_num);
+
+    if(!created_all)
+        for(unsigned int producer_idx = 0; producer_idx < producers_created; producer_idx++)
+            producers_data[producer_idx].items_num = 0;
+
+    unsigned long long cpu_start_ns = getProcessCpuNs();
+    unsigned long long start_ns = latencyHistogramGetTimeNs();
+
+    atomic_store(&start, 1);
+
+    unsigned long long produced_num = 0;
+    unsigned long long produced_sum = 0;
+    unsigned long long consumed_num = 0;
+    unsigned long long consumed_sum = 0;
+
+    for(unsigned int producer_idx = 0; producer_idx < producers_created; producer_idx++)
+    {
+        pthread_join(producers[producer_idx], NULL);
+
+        produced_num += producers_data[producer_idx].items_done;
+        produced_sum += producers_data[producer_idx].sequence_sum;
+    }
+
+    // Consumers end once every item has been taken.
+    operations->close(queue);
+
+    latencyHistogramReset(&scenario_latencies);
+
+    for(unsigned int consumer_idx = 0; consumer_idx < consumers_created; consumer_idx++)
+    {
+        pthread_join(consumers[consumer_idx], NULL);
+
+        consumed_num += consumers_data[consumer_idx].items_done;
+        consumed_sum += consumers_data[consumer_idx].sequence_sum;
+        latencyHistogramMerge(&scenario_latencies, &consumer_latencies[consumer_idx]);
+    }
+
+    unsigned long long elapsed_ns = latencyHistogramGetTimeNs() - start_ns;
+    unsigned long long cpu_ns = getProcessCpuNs() - cpu_start_ns;
+
+    operations->destroy(queue);
+
+    if(!created_all || elapsed_ns == 0)
+        return -1;
+
+    printf("%-14s\t%u:%u\t%4zu B\t%5d\t%10.3f\t%10.1f\t%10.1f\t%6.0f%%%s\r\n",
+            operations->name                                                    ,
+            scenario->producers_num                                             ,
+            scenario->consumers_num                                             ,
+            item_size                                                           ,
+            batch_size                                                          ,
+            (double)consumed_num * 1000.0 / (double)elapsed_ns                  ,
+            latencyHistogramGetPercentile(&scenario_latencies, 50.0) / 1000.0   ,
+            latencyHistogramGetPercentile(&scenario_latencies, 99.0) / 1000.0   ,
+            (double)cpu_ns * 100.0 / (double)elapsed_ns                         ,
+            (consumed_num == produced_num && consumed_sum == produced_sum ? "" : "\tItems lost or duplicated!"));
+
+    return 0;
+}
+
+void exampleQueueBenchmark()
+{
+    // The number of items per producer and the number of threads on the "many" side of scenarios can be given as lesson parameters
+    // (see LessonParameters.c).
+    unsigned long items_num = getLessonParameter(LESSON_PARAM_ITERATIONS, DEFAULT_ITEMS_PER_PRODUCER);
+    unsigned int side_threads = (unsigned int)getLessonParameter(LESSON_PARAM_THREADS, DEFAULT_SIDE_THREADS);
+
+    if(side_threads < 2)
+        side_threads = 2;
+
+    if(side_threads > MAX_SIDE_THREADS)
+        side_threads = MAX_SIDE_THREADS;
+
+    const QUEUE_SCENARIO scenarios[] =
+    {
+        { 1             , 1             },
+        { 1             , side_threads  },
+        { side_threads  , 1             },
+        { side_threads  , side_threads  },
+    };
+
+    printf("%s%lu item(s) per producer. Throughput in millions of items per second, latencies in microseconds.%s\r\n",
+            PRINT_COLOR_GREEN   ,
+            items_num           ,
+            PRINT_COLOR_RESET   );
+
+    printf("%-14s\tP:C\tItem\tBatch\tThroughput\t       p50\t       p99\t   CPU\r\n", "Queue");
+
+    for(unsigned int scenario_idx = 0; scenario_idx < sizeof(scenarios) / sizeof(scenarios[0]); scenario_idx++)
+        for(unsigned int size_idx = 0; size_idx < sizeof(item_sizes) / sizeof(item_sizes[0]); size_idx++)
+            for(unsigned int batch_idx = 0; batch_idx < sizeof(batch_sizes) / sizeof(batch_sizes[0]); batch_idx++)
+                for(unsigned int queue_idx = 0; queue_idx < sizeof(queues) / sizeof(queues[0]); queue_idx++)
+                    if(runScenario(&queues[queue_idx], &scenarios[scenario_idx], item_sizes[size_idx], batch_sizes[batch_idx], items_num) < 0)
+                    {
+                        printf("%sCould not run the benchmark, so the procedure cannot go on.%s\r\n", PRINT_COLOR_RED, PRINT_COLOR_RESET);
+                        return;
+                    }
+}
+
+/**************************************/
@@ -0,0 +1,10 @@
+#ifndef QUEUE_BENCHMARK_H
+#define QUEUE_BENCHMARK_H
+
+/********* Function prototypes ********/
+
+void exampleQueueBenchmark();
+
+/**************************************/
+
+#endif
@@ -0,0 +1,604 @@
+/*
+Timings tell how long a lesson took, and the tracer (see ThreadTracer.c) tells which thread was waiting for what, but neither tells
+where CPU time went within the code. A sampling profiler does: every so often, the running thread is interrupted and its call stack
+is recorded. Functions which take most of the CPU time show up in most samples.
+
+Each thread is sampled by a timer of its own, measuring that thread's CPU time:
+
+timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &timer);
+
+Where the event asks for SIGPROF to be sent to that very thread (SIGEV_THREAD_ID, a Linux extension) rather than to the process.
+As the clock only runs while the thread is on a CPU, sleeping or blocked threads are never sampled, and busy ones are sampled at the
+same rate (SAMPLING_PROFILER_DEFAULT_FREQUENCY samples per CPU second by default) however many other threads are running.
+
+Timers have to be created by the sampled thread, as CLOCK_THREAD_CPUTIME_ID is the calling thread's clock. So, while the profiler is
+running, pthread_create is interposed: this file defines a function of that name, which starts every new thread through a trampoline
+arming its timer (and deleting it on return, pthread_exit or cancellation), and then calls the actual pthread_create found by
+dlsym(RTLD_NEXT, ...). Thus, every thread in every lesson is profiled, however it is created. Lessons need no changes at all.
+
+Within the signal handler, just async-signal-safe work can be done: no locks, no malloc. The stack is captured by backtrace (whose
+first call, which loads the unwinder, is made when the profiler starts), and copied into a sample from a pool preallocated when the
+profiler starts. The pool is handed out in chunks: a thread takes a chunk with an atomic increment and then fills it alone, so no
+lock is taken. Samples beyond the pool's capacity are counted as dropped.
+
+Once lessons are done, samples are written as folded stacks, a line per distinct stack, from the outermost frame to the innermost
+one, followed by the number of samples:
+
+mutex;[libc.so.6];[libc.so.6];trampolineRoutine;incrementFunction 66
+
+The root frame is the lesson the thread was created for, and the unnamed frames below it are the C library starting the thread.
+Such lines are the input of flame graph tools such as flamegraph.pl (https://github.com/brendangregg/FlameGraph) or
+https://www.speedscope.app. Addresses are turned into names through the executable's own symbol table (read from /proc/self/exe,
+so that static functions are named as well) and through dladdr for shared libraries. On glibc older than 2.34, add -ldl (and -lrt)
+to the gcc command given in main.c.
+*/
+
+/********* Include statements *********/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <dlfcn.h>
+#include <link.h>
+#include <execinfo.h>
+#include <sys/syscall.h>
+#include "SamplingProfiler.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define MAX_STACK_DEPTH         48
+#define SKIPPED_FRAMES          2                   // The signal handler and the kernel's signal return trampoline.
+#define SAMPLES_PER_CHUNK       64
+#define CHUNKS_NUM              512                 // About 13 MB, 32768 samples (33 CPU seconds at the default frequency).
+#define NS_PER_SEC              1000000000L
+#define EXECUTABLE_PATH         "/proc/self/exe"
+#define UNKNOWN_FRAME_NAME      "[unknown]"
+#define FRAME_NAME_SIZE         256
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+typedef struct
+{
+    const char*     label                   ;
+    atomic_uint     depth                   ;   // Published once frames are written. 0 while the sample is unused.
+    void*           frames[MAX_STACK_DEPTH] ;   // Innermost first.
+} PROFILER_SAMPLE;
+
+typedef struct
+{
+    unsigned long long  start   ;
+    unsigned long long  size    ;
+    char*               name    ;
+} PROFILER_SYMBOL;
+
+typedef struct
+{
+    void*       (*start_routine)(void*) ;
+    void*       arg                     ;
+    const char* label                   ;
+} PROFILER_TRAMPOLINE_DATA;
+
+typedef int (*PTHREAD_CREATE_FUNCTION)(pthread_t*, const pthread_attr_t*, void* (*)(void*), void*);
+
+/**************************************/
+
+/********* Private variables **********/
+
+static atomic_int                               profiling_enabled;
+static long                                     sampling_period_ns;
+static PROFILER_SAMPLE*                         samples;
+static atomic_uint                              next_chunk;
+static atomic_ulong                             recorded_samples;
+static atomic_ulong                             dropped_samples;
+static const char* _Atomic                      current_label;
+static PTHREAD_CREATE_FUNCTION _Atomic          real_pthread_create;
+static PROFILER_SYMBOL*                         symbols;
+static unsigned int                             symbols_num;
+static _Thread_local PROFILER_SAMPLE*           thread_chunk;
+static _Thread_local unsigned int               thread_chunk_used;
+static _Thread_local const char*                thread_label;
+static _Thread_local timer_t                    thread_timer;
+static _Thread_local int                        thread_timer_armed;
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static void                     sampleHandler(int signal_number, siginfo_t* info, void* context);
+static void                     armThreadTimer();
+static void                     disarmThreadTimer(void* arg);
+static void*                    trampolineRoutine(void* arg);
+static PTHREAD_CREATE_FUNCTION  getRealPthreadCreate();
+static int                      getExecutableBias(struct dl_phdr_info* info, size_t size, void* data);
+static int                      compareSymbols(const void* a, const void* b);
+static int                      compareLines(const void* a, const void* b);
+static void                     loadExecutableSymbols();
+static void                     freeExecutableSymbols();
+static const char*              getFrameName(void* address, char* name);
+static char*                    getFoldedStack(const PROFILER_SAMPLE* sample);
+
+/**************************************/
+
+/******** Function definitions ********/
+
+// Runs on the sampled thread itself, whenever its CPU timer expires.
+static void sampleHandler(int signal_number, siginfo_t* info, void* context)
+{
+    (void)signal_number;
+    (void)info;
+    (void)context;
+
+    if(!atomic_load_explicit(&profiling_enabled, memory_order_relaxed))
+        return;
+
+    int saved_errno = errno;
+
+    if(thread_chunk == NULL || thread_chunk_used >= SAMPLES_PER_CHUNK)
+    {
+        unsigned int chunk_idx = atomic_fetch_add_explicit(&next_chunk, 1, memory_order_relaxed);
+
+        if(chunk_idx >= CHUNKS_NUM)
+        {
+            atomic_fetch_add_explicit(&dropped_samples, 1, memory_order_relaxed);
+            errno = saved_errno;
+            return;
+        }
+
+        thread_chunk = &samples[chunk_idx * SAMPLES_PER_CHUNK];
+        thread_chunk_used = 0;
+    }
+
+    PROFILER_SAMPLE* sample = &thread_chunk[thread_chunk_used++];
+    void* frames[MAX_STACK_DEPTH + SKIPPED_FRAMES];
+    int depth = backtrace(frames, MAX_STACK_DEPTH + SKIPPED_FRAMES) - SKIPPED_FRAMES;
+
+    if(depth <= 0)
+    {
+        errno = saved_errno;
+        return;
+    }
+
+    memcpy(sample->frames, frames + SKIPPED_FRAMES, depth * sizeof(void*));
+    sample->label = (thread_label != NULL ? thread_label : atomic_load_explicit(&current_label, memory_order_relaxed));
+
+    atomic_store_explicit(&sample->depth, (unsigned int)depth, memory_order_release);
+    atomic_fetch_add_explicit(&recorded_samples, 1, memory_order_relaxed);
+
+    errno = saved_errno;
+}
+
+// Threads which cannot get a timer are just not sampled.
+static void armThreadTimer()
+{
+    if(!atomic_load(&profiling_enabled) || thread_timer_armed)
+        return;
+
+    struct sigevent event;
+    memset(&event, 0, sizeof(event));
+
+    event.sigev_notify              = SIGEV_THREAD_ID           ;
+    event.sigev_signo               = SIGPROF                   ;
+    event._sigev_un._tid             = (pid_t)syscall(SYS_gettid);   // sigev_notify_thread_id, which not every C library names.
+
+    if(timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &thread_timer) < 0)
+        return;
+
+    struct itimerspec period =
+    {
+        .it_interval    = { .tv_sec = sampling_period_ns / NS_PER_SEC, .tv_nsec = sampling_period_ns % NS_PER_SEC },
+        .it_value       = { .tv_sec = sampling_period_ns / NS_PER_SEC, .tv_nsec = sampling_period_ns % NS_PER_SEC },
+    };
+
+    if(timer_settime(thread_timer, 0, &period, NULL) < 0)
+    {
+        timer_delete(thread_timer);
+        return;
+    }
+
+    thread_timer_armed = 1;
+}
+
+static void disarmThreadTimer(void* arg)
+{
+    (void)arg;
+
+    if(!thread_timer_armed)
+        return;
+
+    timer_delete(thread_timer);
+    thread_timer_armed = 0;
+}
+
+static void* trampolineRoutine(void* arg)
+{
+    PROFILER_TRAMPOLINE_DATA data = *((PROFILER_TRAMPOLINE_DATA*)arg);
+    void* ret;
+
+    free(arg);
+
+    thread_label = data.label;
+    armThreadTimer();
+
+    pthread_cleanup_push(disarmThreadTimer, NULL);
+    ret = data.start_routine(data.arg);
+    pthread_cleanup_pop(1);
+
+    return ret;
+}
+
+static PTHREAD_CREATE_FUNCTION getRealPthreadCreate()
+{
+    PTHREAD_CREATE_FUNCTION function = atomic_load(&real_pthread_create);
+
+    if(function == NULL)
+    {
+        function = (PTHREAD_CREATE_FUNCTION)dlsym(RTLD_NEXT, "pthread_create");
+        atomic_store(&real_pthread_create, function);
+    }
+
+    return function;
+}
+
+// Interposes the C library's pthread_create, see the explanation above. Threads are created as usual while not profiling.
+int pthread_create(pthread_t* thread, const pthread_attr_t* attr, void* (*start_routine)(void*), void* arg)
+{
+    PTHREAD_CREATE_FUNCTION create = getRealPthreadCreate();
+
+    if(create == NULL)
+        return EAGAIN;
+
+    if(!atomic_load(&profiling_enabled))
+        return create(thread, attr, start_routine, arg);
+
+    PROFILER_TRAMPOLINE_DATA* data = (PROFILER_TRAMPOLINE_DATA*)malloc(sizeof(PROFILER_TRAMPOLINE_DATA));
+
+    if(data == NULL)
+        return create(thread, attr, start_routine, arg);
+
+    data->start_routine = start_routine                     ;
+    data->arg           = arg                               ;
+    data->label         = (thread_label != NULL ? thread_label : atomic_load(&current_label));
+
+    int ret = create(thread, attr, trampolineRoutine, data);
+
+    if(ret != 0)
+        free(data);
+
+    return ret;
+}
+
+// Samples are taken every 1 / frequency seconds of each thread's CPU time, from the calling thread and every thread created
+// afterwards. Returns -1 if the profiler could not be started.
+int samplingProfilerStart(unsigned int frequency)
+{
+    if(frequency == 0 || atomic_load(&profiling_enabled))
+        return -1;
+
+    // The pool is never freed nor reallocated, as threads keep pointers to their chunks.
+    if(samples == NULL)
+    {
+        samples = (PROFILER_SAMPLE*)calloc(CHUNKS_NUM * SAMPLES_PER_CHUNK, sizeof(PROFILER_SAMPLE));
+
+        if(samples == NULL)
+            return -1;
+    }
+
+    // The first call to backtrace loads the unwinder, which allocates memory, so it must not happen within the signal handler.
+    void* frames[1];
+    backtrace(frames, 1);
+
+    if(getRealPthreadCreate() == NULL)
+        return -1;
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+
+    action.sa_sigaction = sampleHandler;
+    action.sa_flags     = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    if(sigaction(SIGPROF, &action, NULL) < 0)
+        return -1;
+
+    sampling_period_ns = NS_PER_SEC / frequency;
+
+    if(sampling_period_ns == 0)
+        sampling_period_ns = 1;
+
+    atomic_store(&profiling_enabled, 1);
+    armThreadTimer();
+
+    return 0;
+}
+
+// Threads still running keep their timers until they end, but their samples are ignored from now on.
+void samplingProfilerStop()
+{
+    atomic_store(&profiling_enabled, 0);
+    disarmThreadTimer(NULL);
+}
+
+// Samples taken from now on (and threads created from now on) are put under "label", which is meant to be the running lesson.
+void samplingProfilerSetLabel(const char* label)
+{
+    atomic_store(&current_label, label);
+}
+
+unsigned long samplingProfilerGetSamples()
+{
+    return atomic_load(&recorded_samples);
+}
+
+unsigned long samplingProfilerGetDroppedSamples()
+{
+    return atomic_load(&dropped_samples);
+}
+
+// The first object reported is the executable itself.
+static int getExecutableBias(struct dl_phdr_info* info, size_t size, void* data)
+{
+    (void)size;
+
+    *((unsigned long long*)data) = (unsigned long long)info->dlpi_addr;
+
+    return 1;
+}
+
+static int compareSymbols(const void* a, const void* b)
+{
+    const PROFILER_SYMBOL* symbol_a = (const PROFILER_SYMBOL*)a;
+    const PROFILER_SYMBOL* symbol_b = (const PROFILER_SYMBOL*)b;
+
+    return (symbol_a->start > symbol_b->start) - (symbol_a->start < symbol_b->start);
+}
+
+static int compareLines(const void* a, const void* b)
+{
+    return strcmp(*((char* const*)a), *((char* const*)b));
+}
+
+// Function symbols are read from the executable's symbol table, which dladdr does not look into. If it cannot be read (such as for
+// stripped executables), just exported functions get named.
+static void loadExecutableSymbols()
+{
+    FILE* file = fopen(EXECUTABLE_PATH, "rb");
+
+    if(file == NULL)
+        return;
+
+    char* image = NULL;
+    long image_size = -1;
+
+    if(fseek(file, 0, SEEK_END) == 0 && (image_size = ftell(file)) > 0 && fseek(file, 0, SEEK_SET) == 0)
+        image = (char*)malloc(image_size);
+
+    if(image == NULL || fread(image, 1, image_size, file) != (size_t)image_size)
+    {
+        free(image);
+        fclose(file);
+        return;
+    }
+
+    fclose(file);
+
+    const ElfW(Ehdr)* header = (const ElfW(Ehdr)*)image;
+
+    if((size_t)image_size < sizeof(ElfW(Ehdr)) || memcmp(header->e_ident, ELFMAG, SELFMAG) != 0 ||
+        header->e_shoff + (unsigned long long)header->e_shnum * sizeof(ElfW(Shdr)) > (unsigned long long)image_size)
+    {
+        free(image);
+        return;
+    }
+
+    unsigned long long bias = 0;
+    dl_iterate_phdr(getExecutableBias, &bias);
+
+    const ElfW(Shdr)* sections = (const ElfW(Shdr)*)(image + header->e_shoff);
+
+    for(unsigned int section_idx = 0; section_idx < header->e_shnum && symbols == NULL; section_idx++)
+    {
+        const ElfW(Shdr)* symbol_table = &sections[section_idx];
+
+        if(symbol_table->sh_type != SHT_SYMTAB || symbol_table->sh_link >= header->e_shnum)
+            continue;
+
+        const ElfW(Shdr)* string_table = &sections[symbol_table->sh_link];
+
+        if(symbol_table->sh_offset + symbol_table->sh_size > (unsigned long long)image_size ||
+            string_table->sh_offset + string_table->sh_size > (unsigned long long)image_size)
+            break;
+
+        const ElfW(Sym)* entries = (const ElfW(Sym)*)(image + symbol_table->sh_offset);
+        unsigned int entries_num = symbol_table->sh_size / sizeof(ElfW(Sym));
+
+        symbols = (PROFILER_SYMBOL*)calloc(entries_num, sizeof(PROFILER_SYMBOL));
+
+        if(symbols == NULL)
+            break;
+
+        for(unsigned int entry_idx = 0; entry_idx < entries_num; entry_idx++)
+        {
+            const ElfW(Sym)* entry = &entries[entry_idx];
+
+            // ELF64_ST_TYPE is the same as ELF32_ST_TYPE.
+            // Sizeless symbols (such as _init and _fini) are left out, as they would match any address beyond the executable.
+            if(ELF64_ST_TYPE(entry->st_info) != STT_FUNC || entry->st_value == 0 || entry->st_size == 0 || entry->st_name >= string_table->sh_size)
+                continue;
+
+            char* name = strdup(image + string_table->sh_offset + entry->st_name);
+
+            if(name == NULL)
+                continue;
+
+            symbols[symbols_num].start  = bias + entry->st_value;
+            symbols[symbols_num].size   = entry->st_size;
+            symbols[symbols_num].name   = name;
+            ++symbols_num;
+        }
+
+        qsort(symbols, symbols_num, sizeof(PROFILER_SYMBOL), compareSymbols);
+    }
+
+    free(image);
+}
+
+static void freeExecutableSymbols()
+{
+    for(unsigned int symbol_idx = 0; symbol_idx < symbols_num; symbol_idx++)
+        free(symbols[symbol_idx].name);
+
+    free(symbols);
+    symbols = NULL;
+    symbols_num = 0;
+}
+
+// "name" must be FRAME_NAME_SIZE bytes long at least. Frames in shared libraries with no exported symbol are named after the library.
+static const char* getFrameName(void* address, char* name)
+{
+    unsigned long long value = (unsigned long long)address;
+    unsigned int low = 0, high = symbols_num;
+
+    // Last symbol starting at or before the address.
+    while(low < high)
+    {
+        unsigned int middle = (low + high) / 2;
+
+        if(symbols[middle].start <= value)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    if(low > 0 && value < symbols[low - 1].start + symbols[low - 1].size)
+        return symbols[low - 1].name;
+
+    Dl_info info;
+
+    if(dladdr(address, &info) == 0)
+        return UNKNOWN_FRAME_NAME;
+
+    if(info.dli_sname != NULL)
+        return info.dli_sname;
+
+    if(info.dli_fname == NULL || *info.dli_fname == 0)
+        return UNKNOWN_FRAME_NAME;
+
+    const char* library = strrchr(info.dli_fname, '/');
+    snprintf(name, FRAME_NAME_SIZE, "[%s]", (library != NULL ? library + 1 : info.dli_fname));
+
+    return name;
+}
+
+// Outermost frame first. Every frame but the innermost one holds a return address, which may already belong to the next function
+// if the call was the last instruction of the caller, so the address before it is looked up instead.
+static char* getFoldedStack(const PROFILER_SAMPLE* sample)
+{
+    char* line = NULL;
+    size_t line_size = 0;
+    FILE* stream = open_memstream(&line, &line_size);
+
+    if(stream == NULL)
+        return NULL;
+
+    unsigned int depth = atomic_load_explicit(&sample->depth, memory_order_acquire);
+    char name[FRAME_NAME_SIZE];
+
+    if(sample->label != NULL)
+        fprintf(stream, "%s;", sample->label);
+
+    for(int frame_idx = (int)depth - 1; frame_idx >= 0; frame_idx--)
+    {
+        void* address = (frame_idx > 0 ? (char*)sample->frames[frame_idx] - 1 : sample->frames[frame_idx]);
+
+        fprintf(stream, "%s%s", getFrameName(address, name), (frame_idx > 0 ? ";" : ""));
+    }
+
+    if(fclose(stream) != 0)
+    {
+        free(line);
+        return NULL;
+    }
+
+    return line;
+}
+
+// Identical stacks are counted once sorted. Folded stacks are newline-terminated, as flame graph tools expect. Returns -1 if the
+// file could not be written.
+int samplingProfilerWriteFolded(const char* path)
+{
+    if(samples == NULL)
+        return -1;
+
+    unsigned int chunks_num = atomic_load(&next_chunk);
+
+    if(chunks_num > CHUNKS_NUM)
+        chunks_num = CHUNKS_NUM;
+
+    char** lines = (char**)calloc(chunks_num * SAMPLES_PER_CHUNK + 1, sizeof(char*));
+
+    if(lines == NULL)
+        return -1;
+
+    loadExecutableSymbols();
+
+    unsigned int lines_num = 0;
+    int ret = 0;
+
+    for(unsigned int sample_idx = 0; sample_idx < chunks_num * SAMPLES_PER_CHUNK && ret == 0; sample_idx++)
+    {
+        if(atomic_load_explicit(&samples[sample_idx].depth, memory_order_acquire) == 0)
+            continue;
+
+        if((lines[lines_num] = getFoldedStack(&samples[sample_idx])) == NULL)
+            ret = -1;
+        else
+            ++lines_num;
+    }
+
+    freeExecutableSymbols();
+
+    FILE* file = (ret == 0 ? fopen(path, "w") : NULL);
+
+    if(file == NULL)
+        ret = -1;
+
+    if(ret == 0)
+    {
+        qsort(lines, lines_num, sizeof(char*), compareLines);
+
+        for(unsigned int line_idx = 0; line_idx < lines_num; )
+        {
+            unsigned int count = 1;
+
+            while(line_idx + count < lines_num && strcmp(lines[line_idx], lines[line_idx + count]) == 0)
+                ++count;
+
+            fprintf(file, "%s %u\n", lines[line_idx], count);
+            line_idx += count;
+        }
+
+        if(fclose(file) != 0)
+            ret = -1;
+    }
+
+    for(unsigned int line_idx = 0; line_idx < lines_num; line_idx++)
+        free(lines[line_idx]);
+
+    free(lines);
+
+    return ret;
+}
+
+/**************************************/
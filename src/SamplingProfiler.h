@@ -0,0 +1,21 @@
+#ifndef SAMPLING_PROFILER_H
+#define SAMPLING_PROFILER_H
+
+/********** Define statements *********/
+
+#define SAMPLING_PROFILER_DEFAULT_FREQUENCY 997     // Samples per CPU second. Not a round number, so as not to run in lockstep with periodic work.
+
+/**************************************/
+
+/********* Function prototypes ********/
+
+int             samplingProfilerStart(unsigned int frequency);
+void            samplingProfilerStop();
+void            samplingProfilerSetLabel(const char* label);
+int             samplingProfilerWriteFolded(const char* path);
+unsigned long   samplingProfilerGetSamples();
+unsigned long   samplingProfilerGetDroppedSamples();
+
+/**************************************/
+
+#endif
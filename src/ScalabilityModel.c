@@ -0,0 +1,224 @@
+/*
+Adding threads to a lesson rarely multiplies its throughput by the same factor. Two models describe how throughput X(N) grows with
+the number of threads N, given the throughput X(1) of a single thread:
+
+Amdahl's law:               X(N) = X(1) * N / (1 + sigma * (N - 1))
+Universal Scalability Law:  X(N) = X(1) * N / (1 + sigma * (N - 1) + kappa * N * (N - 1))
+
+Where:
+    ·sigma (contention): fraction of the work which is serialized, such as the section protected by a mutex in ThreadsWithMutex.c.
+    Throughput can never go beyond X(1) / sigma, however many threads are added.
+    ·kappa (coherency): cost of keeping data consistent among threads, paid by every pair of them, such as cache lines bouncing
+    among CPUs (false sharing). If kappa is greater than 0, throughput peaks at N* = sqrt((1 - sigma) / kappa) threads and gets
+    worse beyond that point.
+
+Both models are fitted by least squares on their linearized form. Being C(N) = X(N) / X(1) the relative capacity:
+
+N / C(N) - 1 = sigma * (N - 1) + kappa * N * (N - 1)
+
+Which is linear in sigma and kappa, with no intercept. Coefficients are kept within their meaningful range (0 <= sigma <= 1,
+kappa >= 0). How well each model describes the measurements is given by R^2, computed on the throughputs it predicts.
+
+Finally, whichever term is greater at the greatest N measured tells what limits scalability the most, unless the efficiency there
+(C(N) / N) is still close to 1.
+
+No math library is required: square roots are computed by Newton's method.
+*/
+
+/********* Include statements *********/
+
+#include <string.h>
+#include "ScalabilityModel.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define MIN_LIMITED_EFFICIENCY  0.9     // Below this efficiency at the greatest N measured, scalability is regarded as limited.
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static double   squareRoot(double value);
+static double   clampCoefficient(double value, double max);
+static double   getRSquared(const SCALABILITY_POINT* points, unsigned int points_num, const SCALABILITY_FIT* fit, const SCALABILITY_MODEL* model);
+
+/**************************************/
+
+/******** Function definitions ********/
+
+static double squareRoot(double value)
+{
+    if(value <= 0.0)
+        return 0.0;
+
+    double root = (value > 1.0 ? value / 2.0 : 1.0);
+
+    for(int i = 0; i < 64; i++)
+    {
+        double next = 0.5 * (root + value / root);
+
+        if(next == root)
+            break;
+
+        root = next;
+    }
+
+    return root;
+}
+
+// A max of 0 means no upper bound.
+static double clampCoefficient(double value, double max)
+{
+    if(value < 0.0)
+        return 0.0;
+
+    if(max > 0.0 && value > max)
+        return max;
+
+    return value;
+}
+
+static double getRSquared(const SCALABILITY_POINT* points, unsigned int points_num, const SCALABILITY_FIT* fit, const SCALABILITY_MODEL* model)
+{
+    double mean = 0.0;
+
+    for(unsigned int i = 0; i < points_num; i++)
+        mean += points[i].throughput;
+
+    mean /= points_num;
+
+    double residual_sum = 0.0;
+    double total_sum = 0.0;
+
+    for(unsigned int i = 0; i < points_num; i++)
+    {
+        double residual = points[i].throughput - scalabilityModelPredict(fit, model, points[i].concurrency);
+        double deviation = points[i].throughput - mean;
+
+        residual_sum += residual * residual;
+        total_sum += deviation * deviation;
+    }
+
+    if(total_sum <= 0.0)
+        return (residual_sum <= 0.0 ? 1.0 : 0.0);
+
+    return 1.0 - residual_sum / total_sum;
+}
+
+// Points must include a single thread one (N = 1) and at least another one. Amdahl's law needs just that, while the USL needs at
+// least two points with N > 1 to tell both coefficients apart. Returns -1 if no model could be fitted.
+int scalabilityModelFit(const SCALABILITY_POINT* points, unsigned int points_num, SCALABILITY_FIT* fit)
+{
+    if(points == NULL || fit == NULL)
+        return -1;
+
+    memset(fit, 0, sizeof(SCALABILITY_FIT));
+
+    for(unsigned int i = 0; i < points_num; i++)
+    {
+        if(points[i].concurrency == 1.0)
+            fit->base_throughput = points[i].throughput;
+
+        if(points[i].concurrency > fit->max_concurrency)
+            fit->max_concurrency = points[i].concurrency;
+    }
+
+    if(fit->base_throughput <= 0.0)
+        return -1;
+
+    // Sums for the normal equations, being x1 = N - 1, x2 = N * (N - 1) and y = N / C(N) - 1.
+    double x1_x1 = 0.0, x1_x2 = 0.0, x2_x2 = 0.0, x1_y = 0.0, x2_y = 0.0;
+    unsigned int scaled_points_num = 0;
+
+    for(unsigned int i = 0; i < points_num; i++)
+    {
+        double n = points[i].concurrency;
+
+        if(n <= 1.0 || points[i].throughput <= 0.0)
+            continue;
+
+        double x1 = n - 1.0;
+        double x2 = n * (n - 1.0);
+        double y = n * fit->base_throughput / points[i].throughput - 1.0;
+
+        x1_x1 += x1 * x1;
+        x1_x2 += x1 * x2;
+        x2_x2 += x2 * x2;
+        x1_y  += x1 * y;
+        x2_y  += x2 * y;
+
+        ++scaled_points_num;
+    }
+
+    if(scaled_points_num == 0)
+        return -1;
+
+    fit->amdahl.available   = 1;
+    fit->amdahl.sigma       = clampCoefficient(x1_y / x1_x1, 1.0);
+    fit->amdahl.r_squared   = getRSquared(points, points_num, fit, &fit->amdahl);
+
+    double determinant = x1_x1 * x2_x2 - x1_x2 * x1_x2;
+
+    if(scaled_points_num >= 2 && determinant > 0.0)
+    {
+        double sigma = (x1_y * x2_x2 - x2_y * x1_x2) / determinant;
+        double kappa = (x2_y * x1_x1 - x1_y * x1_x2) / determinant;
+
+        // If either coefficient falls out of range, fit the other one alone.
+        if(kappa < 0.0)
+        {
+            kappa = 0.0;
+            sigma = x1_y / x1_x1;
+        }
+        else if(sigma < 0.0)
+        {
+            sigma = 0.0;
+            kappa = x2_y / x2_x2;
+        }
+
+        fit->usl.available  = 1;
+        fit->usl.sigma      = clampCoefficient(sigma, 1.0);
+        fit->usl.kappa      = clampCoefficient(kappa, 0.0);
+        fit->usl.r_squared  = getRSquared(points, points_num, fit, &fit->usl);
+
+        if(fit->usl.kappa > 0.0)
+        {
+            fit->peak_concurrency = squareRoot((1.0 - fit->usl.sigma) / fit->usl.kappa);
+            fit->peak_throughput = scalabilityModelPredict(fit, &fit->usl, fit->peak_concurrency);
+        }
+    }
+
+    const SCALABILITY_MODEL* model = (fit->usl.available ? &fit->usl : &fit->amdahl);
+    double n = fit->max_concurrency;
+    double contention = model->sigma * (n - 1.0);
+    double coherency = model->kappa * n * (n - 1.0);
+
+    if(1.0 / (1.0 + contention + coherency) >= MIN_LIMITED_EFFICIENCY)
+        fit->limit = SCALABILITY_LIMIT_NONE;
+    else
+        fit->limit = (coherency > contention ? SCALABILITY_LIMIT_COHERENCY : SCALABILITY_LIMIT_CONTENTION);
+
+    return 0;
+}
+
+double scalabilityModelPredict(const SCALABILITY_FIT* fit, const SCALABILITY_MODEL* model, double concurrency)
+{
+    if(fit == NULL || model == NULL || concurrency <= 0.0)
+        return 0.0;
+
+    return fit->base_throughput * concurrency / (1.0 + model->sigma * (concurrency - 1.0) + model->kappa * concurrency * (concurrency - 1.0));
+}
+
+const char* scalabilityModelGetLimitName(SCALABILITY_LIMIT limit)
+{
+    switch(limit)
+    {
+        case SCALABILITY_LIMIT_CONTENTION:  return "contention";
+        case SCALABILITY_LIMIT_COHERENCY:   return "coherency";
+        default:                            return "none";
+    }
+}
+
+/**************************************/
@@ -0,0 +1,48 @@
+#ifndef SCALABILITY_MODEL_H
+#define SCALABILITY_MODEL_H
+
+/********** Type definitions **********/
+
+typedef enum
+{
+    SCALABILITY_LIMIT_NONE          ,   // Close to linear scaling within the measured range.
+    SCALABILITY_LIMIT_CONTENTION    ,   // Mostly serialization, such as threads queueing for a lock.
+    SCALABILITY_LIMIT_COHERENCY     ,   // Mostly crosstalk between threads, such as cache lines bouncing among CPUs.
+} SCALABILITY_LIMIT;
+
+typedef struct
+{
+    double  concurrency ;   // N: number of threads.
+    double  throughput  ;   // X(N): work units per second.
+} SCALABILITY_POINT;
+
+typedef struct
+{
+    int     available   ;
+    double  sigma       ;   // Contention coefficient (serial fraction).
+    double  kappa       ;   // Coherency coefficient. Always 0 for Amdahl's law.
+    double  r_squared   ;   // Coefficient of determination of the predicted throughputs.
+} SCALABILITY_MODEL;
+
+typedef struct
+{
+    double              base_throughput     ;   // X(1).
+    double              max_concurrency     ;   // Greatest N measured.
+    SCALABILITY_MODEL   amdahl              ;
+    SCALABILITY_MODEL   usl                 ;
+    double              peak_concurrency    ;   // N at which the USL predicts throughput to peak, 0 if it never does.
+    double              peak_throughput     ;
+    SCALABILITY_LIMIT   limit               ;
+} SCALABILITY_FIT;
+
+/**************************************/
+
+/********* Function prototypes ********/
+
+int         scalabilityModelFit(const SCALABILITY_POINT* points, unsigned int points_num, SCALABILITY_FIT* fit);
+double      scalabilityModelPredict(const SCALABILITY_FIT* fit, const SCALABILITY_MODEL* model, double concurrency);
+const char* scalabilityModelGetLimitName(SCALABILITY_LIMIT limit);
+
+/**************************************/
+
+#endif
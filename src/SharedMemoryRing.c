@@ -0,0 +1,421 @@
+/*
+Threads share memory by default, so connecting producers and consumers is just a matter of guarding a buffer (see
+ThreadsWithConditionVariables.c). Processes do not: a crash in one of them cannot corrupt the others, which is why producers and
+consumers are sometimes split into processes of their own (fault isolation). Pipes and sockets connect processes too, but every item
+then goes through the kernel twice (copied in by a write, copied out by a read). A ring buffer in memory mapped by every process
+needs no system call at all while there is something to do:
+
+int memfd_create(const char* name, unsigned int flags)
+void* mmap(void* addr, size_t length, int prot, int flags, int fd, off_t offset)
+
+Where:
+    ·memfd_create creates an anonymous file living in memory, returning a file descriptor for it (shm_open does the same with a
+    name other processes can open). It is sized with ftruncate.
+    ·mmap with MAP_SHARED maps it into the process, so that writes are seen by every process mapping the same file. Children
+    created with fork inherit both the file descriptor and the mapping, while unrelated processes may be handed the descriptor
+    through a UNIX socket.
+
+Mutexes and condition variables could be used within the mapping (with the PTHREAD_PROCESS_SHARED attribute), but a process dying
+while holding the mutex would leave every other one stuck. The ring takes no lock instead:
+    ·SPSC mode (a single producer, a single consumer): the producer alone moves the tail and the consumer alone moves the head, so
+    each just publishes its position with a release store once the slot has been written or read.
+    ·MPSC mode (many producers, a single consumer): producers claim slots by a compare-and-swap on the tail, and every slot has a
+    sequence number telling whether it has been written yet, since producers may finish writing slots in a different order than
+    they claimed them (Dmitry Vyukov's bounded queue).
+
+Nothing has to wait while there are items and free slots. Otherwise, processes sleep on a futex (fast userspace mutex), a 32-bit word
+in shared memory the kernel can put processes to sleep on until it changes:
+
+syscall(SYS_futex, uint32_t* word, FUTEX_WAIT, uint32_t expected, const struct timespec* timeout, NULL, 0)
+syscall(SYS_futex, uint32_t* word, FUTEX_WAKE, int waiters_num, NULL, NULL, 0)
+
+FUTEX_WAIT sleeps only if the word still holds the expected value, so a wake up happening between checking the ring and going to
+sleep is never missed. The _PRIVATE variants, which glibc uses for mutexes by default, would only work within a single process.
+Waiters announce themselves before sleeping, so that wakers make the system call only when somebody is actually waiting.
+
+Consumers have to tell when producers are done: each producer calls sharedMemoryRingClose once it is, and the consumer is told the
+ring is over once every producer has, and every item has been taken. A producer which crashed never does, which is why the consumer
+can wait with a timeout and check whether producers are still alive meanwhile (see InterProcessQueues.c).
+*/
+
+/********* Include statements *********/
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "SharedMemoryRing.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define CACHE_LINE_SIZE     64      // Positions moved by different processes are kept apart, so that they do not share a cache line.
+#define MIN_CAPACITY        2
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+// Lives at the start of the shared mapping, followed by the slots.
+typedef struct
+{
+    unsigned int                            capacity            ;   // Always a power of two.
+    size_t                                  item_size           ;
+    size_t                                  slot_size           ;
+    SHARED_MEMORY_RING_MODE                 mode                ;
+    atomic_uint                             open_producers      ;
+    atomic_int                              closed              ;
+
+    _Alignas(CACHE_LINE_SIZE) atomic_ulong  head                ;   // Next slot to be read, just moved by the consumer.
+    atomic_uint                             consumer_waiting    ;
+    atomic_uint                             items_futex         ;   // Changed whenever the consumer must be woken up.
+
+    _Alignas(CACHE_LINE_SIZE) atomic_ulong  tail                ;   // Next slot to be written (or claimed, in MPSC mode).
+    atomic_uint                             producers_waiting   ;
+    atomic_uint                             slots_futex         ;   // Changed whenever producers must be woken up.
+
+    _Alignas(CACHE_LINE_SIZE) atomic_ullong consumer_sleeps     ;
+    atomic_ullong                           producer_sleeps     ;
+    atomic_ullong                           wakeups             ;
+} SHARED_MEMORY_RING_HEADER;
+
+typedef struct
+{
+    atomic_ulong    sequence    ;   // MPSC mode: position the slot can be written at, or that position plus one once written.
+    unsigned char   item[]      ;
+} SHARED_MEMORY_RING_SLOT;
+
+// Private to every process (copied along by fork), pointing to the shared mapping.
+struct SHARED_MEMORY_RING
+{
+    SHARED_MEMORY_RING_HEADER*  header      ;
+    unsigned char*              slots       ;
+    size_t                      mapping_size;
+    int                         fd          ;
+};
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static SHARED_MEMORY_RING_SLOT* getSlot(SHARED_MEMORY_RING* ring, unsigned long position);
+static int                      futexWait(atomic_uint* word, unsigned int expected, int timeout_ms);
+static void                     futexWake(SHARED_MEMORY_RING_HEADER* header, atomic_uint* word, int waiters_num);
+static int                      tryPush(SHARED_MEMORY_RING* ring, const void* item);
+static int                      tryPop(SHARED_MEMORY_RING* ring, void* item);
+static int                      isFull(SHARED_MEMORY_RING* ring);
+static int                      isEmpty(SHARED_MEMORY_RING* ring);
+
+/**************************************/
+
+/******** Function definitions ********/
+
+static SHARED_MEMORY_RING_SLOT* getSlot(SHARED_MEMORY_RING* ring, unsigned long position)
+{
+    return (SHARED_MEMORY_RING_SLOT*)(ring->slots + (position & (ring->header->capacity - 1)) * ring->header->slot_size);
+}
+
+// Returns -1 if the timeout expired, 0 otherwise (woken up, or the word did not hold "expected" anymore). No FUTEX_PRIVATE_FLAG,
+// since waiters and wakers live in different processes.
+static int futexWait(atomic_uint* word, unsigned int expected, int timeout_ms)
+{
+    struct timespec timeout = { .tv_sec = timeout_ms / 1000, .tv_nsec = (timeout_ms % 1000) * 1000000L };
+
+    if(syscall(SYS_futex, (unsigned int*)word, FUTEX_WAIT, expected, (timeout_ms < 0 ? NULL : &timeout), NULL, 0) < 0 && errno == ETIMEDOUT)
+        return -1;
+
+    return 0;
+}
+
+// Changing the word makes waiters which have not gone to sleep yet find it different, so they do not go to sleep at all.
+static void futexWake(SHARED_MEMORY_RING_HEADER* header, atomic_uint* word, int waiters_num)
+{
+    atomic_fetch_add(word, 1);
+    syscall(SYS_futex, (unsigned int*)word, FUTEX_WAKE, waiters_num, NULL, NULL, 0);
+    atomic_fetch_add_explicit(&header->wakeups, 1, memory_order_relaxed);
+}
+
+// Returns 1 if the item was written, 0 if the ring was full.
+static int tryPush(SHARED_MEMORY_RING* ring, const void* item)
+{
+    SHARED_MEMORY_RING_HEADER* header = ring->header;
+
+    if(header->mode == SHARED_MEMORY_RING_SPSC)
+    {
+        unsigned long tail = atomic_load_explicit(&header->tail, memory_order_relaxed);
+
+        if(tail - atomic_load_explicit(&header->head, memory_order_acquire) >= header->capacity)
+            return 0;
+
+        memcpy(getSlot(ring, tail)->item, item, header->item_size);
+
+        // The item is written before the consumer can see the new tail.
+        atomic_store_explicit(&header->tail, tail + 1, memory_order_release);
+
+        return 1;
+    }
+
+    unsigned long position = atomic_load_explicit(&header->tail, memory_order_relaxed);
+    SHARED_MEMORY_RING_SLOT* slot;
+
+    while(1)
+    {
+        slot = getSlot(ring, position);
+
+        long difference = (long)(atomic_load_explicit(&slot->sequence, memory_order_acquire) - position);
+
+        // The slot is free for this position: claim it, unless some other producer got there first (which updates "position").
+        if(difference == 0)
+        {
+            if(atomic_compare_exchange_weak_explicit(&header->tail, &position, position + 1, memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        // The slot still holds the item from a lap before, which the consumer has not read yet.
+        else if(difference < 0)
+            return 0;
+        else
+            position = atomic_load_explicit(&header->tail, memory_order_relaxed);
+    }
+
+    memcpy(slot->item, item, header->item_size);
+    atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+
+    return 1;
+}
+
+// Returns 1 if an item was read, 0 if the ring was empty (or the next item was still being written).
+static int tryPop(SHARED_MEMORY_RING* ring, void* item)
+{
+    SHARED_MEMORY_RING_HEADER* header = ring->header;
+    unsigned long head = atomic_load_explicit(&header->head, memory_order_relaxed);
+    SHARED_MEMORY_RING_SLOT* slot = getSlot(ring, head);
+
+    if(header->mode == SHARED_MEMORY_RING_SPSC)
+    {
+        if(atomic_load_explicit(&header->tail, memory_order_acquire) == head)
+            return 0;
+
+        memcpy(item, slot->item, header->item_size);
+    }
+    else
+    {
+        if(atomic_load_explicit(&slot->sequence, memory_order_acquire) != head + 1)
+            return 0;
+
+        memcpy(item, slot->item, header->item_size);
+
+        // Free for the producer claiming this slot on the next lap.
+        atomic_store_explicit(&slot->sequence, head + header->capacity, memory_order_release);
+    }
+
+    atomic_store_explicit(&header->head, head + 1, memory_order_release);
+
+    return 1;
+}
+
+// Slots claimed but not written yet count as taken.
+static int isFull(SHARED_MEMORY_RING* ring)
+{
+    return (atomic_load(&ring->header->tail) - atomic_load(&ring->header->head) >= ring->header->capacity);
+}
+
+// Items claimed but not written yet count as missing, since they cannot be read yet. Their producer wakes the consumer up anyway.
+static int isEmpty(SHARED_MEMORY_RING* ring)
+{
+    unsigned long head = atomic_load(&ring->header->head);
+
+    if(ring->header->mode == SHARED_MEMORY_RING_SPSC)
+        return (atomic_load(&ring->header->tail) == head);
+
+    return (atomic_load(&getSlot(ring, head)->sequence) != head + 1);
+}
+
+// The capacity is rounded up to a power of two. SPSC rings take a single producer. Returns NULL on failure.
+SHARED_MEMORY_RING* sharedMemoryRingCreate(unsigned int capacity, size_t item_size, SHARED_MEMORY_RING_MODE mode, unsigned int producers_num)
+{
+    if(item_size == 0 || producers_num == 0 || (mode == SHARED_MEMORY_RING_SPSC && producers_num > 1))
+        return NULL;
+
+    unsigned int rounded_capacity = MIN_CAPACITY;
+
+    while(rounded_capacity < capacity && rounded_capacity < (1U << 30))
+        rounded_capacity *= 2;
+
+    size_t slot_size = (sizeof(SHARED_MEMORY_RING_SLOT) + item_size + sizeof(atomic_ulong) - 1) / sizeof(atomic_ulong) * sizeof(atomic_ulong);
+    size_t header_size = (sizeof(SHARED_MEMORY_RING_HEADER) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+    size_t mapping_size = header_size + rounded_capacity * slot_size;
+
+    SHARED_MEMORY_RING* ring = (SHARED_MEMORY_RING*)calloc(1, sizeof(SHARED_MEMORY_RING));
+
+    if(ring == NULL)
+        return NULL;
+
+    ring->fd = memfd_create("shared-memory-ring", MFD_CLOEXEC);
+
+    if(ring->fd < 0 || ftruncate(ring->fd, (off_t)mapping_size) < 0)
+    {
+        if(ring->fd >= 0)
+            close(ring->fd);
+
+        free(ring);
+        return NULL;
+    }
+
+    void* mapping = mmap(NULL, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, 0);
+
+    if(mapping == MAP_FAILED)
+    {
+        close(ring->fd);
+        free(ring);
+        return NULL;
+    }
+
+    // The file starts zero-filled, so just what is not zero has to be set.
+    ring->header        = (SHARED_MEMORY_RING_HEADER*)mapping   ;
+    ring->slots         = (unsigned char*)mapping + header_size ;
+    ring->mapping_size  = mapping_size                          ;
+
+    ring->header->capacity  = rounded_capacity  ;
+    ring->header->item_size = item_size         ;
+    ring->header->slot_size = slot_size         ;
+    ring->header->mode      = mode              ;
+    atomic_store(&ring->header->open_producers, producers_num);
+
+    for(unsigned int slot_idx = 0; slot_idx < rounded_capacity; slot_idx++)
+        atomic_store(&getSlot(ring, slot_idx)->sequence, slot_idx);
+
+    return ring;
+}
+
+// Unmaps the ring from the calling process. Shared memory is freed once every process sharing it has done so (or ended).
+void sharedMemoryRingDestroy(SHARED_MEMORY_RING* ring)
+{
+    if(ring == NULL)
+        return;
+
+    munmap(ring->header, ring->mapping_size);
+    close(ring->fd);
+    free(ring);
+}
+
+// Waits while the ring is full. Returns 0 once the item has been written, -1 on invalid input.
+int sharedMemoryRingPush(SHARED_MEMORY_RING* ring, const void* item)
+{
+    if(ring == NULL || item == NULL)
+        return -1;
+
+    SHARED_MEMORY_RING_HEADER* header = ring->header;
+
+    while(!tryPush(ring, item))
+    {
+        unsigned int expected = atomic_load(&header->slots_futex);
+
+        // Announced before checking again, so that the consumer either sees it, or frees a slot this check sees.
+        atomic_fetch_add(&header->producers_waiting, 1);
+
+        if(isFull(ring))
+        {
+            atomic_fetch_add_explicit(&header->producer_sleeps, 1, memory_order_relaxed);
+            futexWait(&header->slots_futex, expected, SHARED_MEMORY_RING_WAIT_FOREVER);
+        }
+
+        atomic_fetch_sub(&header->producers_waiting, 1);
+    }
+
+    // The item was published before checking whether the consumer is waiting (both sequentially consistent), so either the
+    // consumer sees the item before going to sleep, or this sees the consumer waiting.
+    atomic_thread_fence(memory_order_seq_cst);
+
+    if(atomic_load(&header->consumer_waiting))
+        futexWake(header, &header->items_futex, 1);
+
+    return 0;
+}
+
+// Waits for an item for up to "timeout_ms" milliseconds (SHARED_MEMORY_RING_WAIT_FOREVER to wait for as long as it takes). Just the
+// consumer may call it. Returns 1 if an item was read, 0 if every producer has closed the ring and no item is left, and -1 if the
+// timeout expired or on invalid input.
+int sharedMemoryRingPop(SHARED_MEMORY_RING* ring, void* item, int timeout_ms)
+{
+    if(ring == NULL || item == NULL)
+        return -1;
+
+    SHARED_MEMORY_RING_HEADER* header = ring->header;
+
+    while(1)
+    {
+        // Read before popping: once closed, every item has been written already, so finding none then means there are no more.
+        int closed = atomic_load(&header->closed);
+
+        if(tryPop(ring, item))
+        {
+            atomic_thread_fence(memory_order_seq_cst);
+
+            if(atomic_load(&header->producers_waiting) > 0)
+                futexWake(header, &header->slots_futex, 1);
+
+            return 1;
+        }
+
+        if(closed)
+            return 0;
+
+        atomic_store(&header->consumer_waiting, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+
+        unsigned int expected = atomic_load(&header->items_futex);
+        int timed_out = 0;
+
+        if(isEmpty(ring) && !atomic_load(&header->closed))
+        {
+            atomic_fetch_add_explicit(&header->consumer_sleeps, 1, memory_order_relaxed);
+            timed_out = (futexWait(&header->items_futex, expected, timeout_ms) < 0);
+        }
+
+        atomic_store(&header->consumer_waiting, 0);
+
+        if(timed_out)
+            return -1;
+    }
+}
+
+// Called by every producer once it is done (or on its behalf, if it ended without doing so). The consumer is woken up once the last
+// producer has closed the ring.
+void sharedMemoryRingClose(SHARED_MEMORY_RING* ring)
+{
+    if(ring == NULL)
+        return;
+
+    SHARED_MEMORY_RING_HEADER* header = ring->header;
+    unsigned int open_producers = atomic_load(&header->open_producers);
+
+    // Closing more times than there are producers changes nothing.
+    while(open_producers > 0 && !atomic_compare_exchange_weak(&header->open_producers, &open_producers, open_producers - 1));
+
+    if(open_producers == 1)
+    {
+        atomic_store(&header->closed, 1);
+        futexWake(header, &header->items_futex, INT_MAX);
+    }
+}
+
+void sharedMemoryRingGetStats(SHARED_MEMORY_RING* ring, SHARED_MEMORY_RING_STATS* stats)
+{
+    if(ring == NULL || stats == NULL)
+        return;
+
+    stats->consumer_sleeps  = atomic_load(&ring->header->consumer_sleeps)  ;
+    stats->producer_sleeps  = atomic_load(&ring->header->producer_sleeps)  ;
+    stats->wakeups          = atomic_load(&ring->header->wakeups)          ;
+}
+
+/**************************************/
@@ -0,0 +1,46 @@
+#ifndef SHARED_MEMORY_RING_H
+#define SHARED_MEMORY_RING_H
+
+/********* Include statements *********/
+
+#include <stddef.h>
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define SHARED_MEMORY_RING_WAIT_FOREVER -1
+
+/**************************************/
+
+/********** Type definitions **********/
+
+typedef enum
+{
+    SHARED_MEMORY_RING_SPSC = 0 ,   // A single producer and a single consumer.
+    SHARED_MEMORY_RING_MPSC     ,   // Many producers and a single consumer.
+} SHARED_MEMORY_RING_MODE;
+
+typedef struct
+{
+    unsigned long long  consumer_sleeps ;   // Times the consumer waited on a futex for items.
+    unsigned long long  producer_sleeps ;   // Times producers waited on a futex for free slots.
+    unsigned long long  wakeups         ;   // futex wake calls, made only when someone is waiting.
+} SHARED_MEMORY_RING_STATS;
+
+typedef struct SHARED_MEMORY_RING SHARED_MEMORY_RING;
+
+/**************************************/
+
+/********* Function prototypes ********/
+
+SHARED_MEMORY_RING* sharedMemoryRingCreate(unsigned int capacity, size_t item_size, SHARED_MEMORY_RING_MODE mode, unsigned int producers_num);
+void                sharedMemoryRingDestroy(SHARED_MEMORY_RING* ring);
+int                 sharedMemoryRingPush(SHARED_MEMORY_RING* ring, const void* item);
+int                 sharedMemoryRingPop(SHARED_MEMORY_RING* ring, void* item, int timeout_ms);
+void                sharedMemoryRingClose(SHARED_MEMORY_RING* ring);
+void                sharedMemoryRingGetStats(SHARED_MEMORY_RING* ring, SHARED_MEMORY_RING_STATS* stats);
+
+/**************************************/
+
+#endif
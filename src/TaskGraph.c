@@ -0,0 +1,386 @@
+/*
+Jobs made of several steps, some of which need the results of others, have been put together by hand so far: joining threads
+before the next step (MatrixMultiplication.c), waiting on barriers (ThreadsWithBarrier.c) or posting semaphores
+(ThreadsWithSemaphores.c). Every step then waits for the whole previous one, even if it only needs a part of it. A task graph
+(a directed acyclic graph, or DAG) states what each task needs instead, and runs every task as soon as its inputs are done:
+
+TASK_GRAPH* taskGraphCreate()
+int taskGraphAddTask(TASK_GRAPH* graph, const char* name, THREAD_POOL_TASK_ROUTINE routine, void* arg)
+int taskGraphAddEdge(TASK_GRAPH* graph, int from_task, int to_task)
+int taskGraphCompile(TASK_GRAPH* graph)
+int taskGraphRun(TASK_GRAPH* graph, THREAD_POOL* pool)
+
+Where:
+    ·taskGraphAddTask returns the new task's index, which edges refer to.
+    ·taskGraphAddEdge makes to_task depend on from_task, so that it is not started before from_task has ended.
+    ·taskGraphCompile lays every task's successors out in a single array and checks that the graph has no cycles (which would leave
+    tasks waiting for each other forever). No tasks nor edges can be added afterwards. If a cycle is found, the name of one of the
+    tasks it leaves waiting can be retrieved with taskGraphGetCycleTask, so that callers can report it.
+    ·taskGraphRun runs the whole graph on a thread pool (see ThreadPool.c) and returns once every task has ended.
+
+Each task has an atomic counter of the dependencies it is still waiting for, set to its number of predecessors when a run starts.
+Tasks without any are submitted right away. Whenever a task ends, it decrements its successors' counters, and submits the ones
+reaching zero: the last predecessor to end is the one which finds the counter going from 1 to 0, so every task is submitted exactly
+once, without any lock. Successors are submitted from the worker which ran their predecessor, so they go to its own queue and
+likely find their inputs still in its caches.
+
+Compiled graphs can be run as many times as wanted: runs just reset counters, so nothing is allocated once the graph is compiled.
+A graph must not be run again before its previous run has ended.
+*/
+
+/********* Include statements *********/
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include "ThreadPool.h"
+#include "TaskGraph.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define INITIAL_GRAPH_CAPACITY  16
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+typedef struct
+{
+    TASK_GRAPH*                 graph               ;
+    const char*                 name                ;
+    THREAD_POOL_TASK_ROUTINE    routine             ;
+    void*                       arg                 ;
+    unsigned int                predecessors_num    ;
+    unsigned int                first_successor     ;   // Index within the graph's successors, once compiled.
+    unsigned int                successors_num      ;
+    atomic_uint                 waiting_for         ;   // Predecessors not done yet within the current run.
+} TASK_GRAPH_NODE;
+
+typedef struct
+{
+    unsigned int    from_task   ;
+    unsigned int    to_task     ;
+} TASK_GRAPH_EDGE;
+
+struct TASK_GRAPH
+{
+    TASK_GRAPH_NODE*    nodes           ;
+    unsigned int        nodes_num       ;
+    unsigned int        nodes_capacity  ;
+    TASK_GRAPH_EDGE*    edges           ;
+    unsigned int        edges_num       ;
+    unsigned int        edges_capacity  ;
+    unsigned int*       successors      ;   // Successors of every task, one task after another.
+    unsigned int        depth           ;   // Tasks along the longest path.
+    const char*         cycle_task      ;   // Name of a task left waiting by a cycle, if compiling found one.
+    int                 compiled        ;
+    THREAD_POOL*        pool            ;   // Pool of the current run.
+    atomic_uint         remaining       ;   // Tasks not done yet within the current run.
+    int                 done            ;   // Set by the last task of the current run, under done_lock.
+    pthread_mutex_t     done_lock       ;
+    pthread_cond_t      done_cond       ;
+};
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static int  growArray(void** array, unsigned int* capacity, size_t element_size);
+static int  sortTopologically(TASK_GRAPH* graph);
+static void submitNode(TASK_GRAPH_NODE* node);
+static void runNode(void* arg);
+
+/**************************************/
+
+/******** Function definitions ********/
+
+static int growArray(void** array, unsigned int* capacity, size_t element_size)
+{
+    unsigned int new_capacity = (*capacity > 0 ? *capacity * 2 : INITIAL_GRAPH_CAPACITY);
+    void* new_array = realloc(*array, new_capacity * element_size);
+
+    if(new_array == NULL)
+        return -1;
+
+    *array = new_array;
+    *capacity = new_capacity;
+
+    return 0;
+}
+
+// Kahn's algorithm, which also finds the graph's depth. Returns -1 if some tasks are never reached, since they are part of a cycle.
+static int sortTopologically(TASK_GRAPH* graph)
+{
+    unsigned int* ready = (unsigned int*)malloc((graph->nodes_num > 0 ? graph->nodes_num : 1) * sizeof(unsigned int));
+    unsigned int* waiting_for = (unsigned int*)malloc((graph->nodes_num > 0 ? graph->nodes_num : 1) * sizeof(unsigned int));
+    unsigned int* level = (unsigned int*)calloc((graph->nodes_num > 0 ? graph->nodes_num : 1), sizeof(unsigned int));
+
+    if(ready == NULL || waiting_for == NULL || level == NULL)
+    {
+        free(level);
+        free(waiting_for);
+        free(ready);
+        return -1;
+    }
+
+    unsigned int ready_num = 0;
+
+    for(unsigned int node_idx = 0; node_idx < graph->nodes_num; node_idx++)
+    {
+        waiting_for[node_idx] = graph->nodes[node_idx].predecessors_num;
+
+        if(waiting_for[node_idx] == 0)
+        {
+            ready[ready_num++] = node_idx;
+            level[node_idx] = 1;
+        }
+    }
+
+    graph->depth = 0;
+
+    for(unsigned int ready_idx = 0; ready_idx < ready_num; ready_idx++)
+    {
+        const TASK_GRAPH_NODE* node = &graph->nodes[ready[ready_idx]];
+
+        if(level[ready[ready_idx]] > graph->depth)
+            graph->depth = level[ready[ready_idx]];
+
+        for(unsigned int successor_idx = 0; successor_idx < node->successors_num; successor_idx++)
+        {
+            unsigned int successor = graph->successors[node->first_successor + successor_idx];
+
+            if(level[successor] < level[ready[ready_idx]] + 1)
+                level[successor] = level[ready[ready_idx]] + 1;
+
+            if(--waiting_for[successor] == 0)
+                ready[ready_num++] = successor;
+        }
+    }
+
+    // Tasks still waiting for predecessors are either part of a cycle or depend on one.
+    graph->cycle_task = NULL;
+
+    for(unsigned int node_idx = 0; ready_num < graph->nodes_num && graph->cycle_task == NULL && node_idx < graph->nodes_num; node_idx++)
+        if(waiting_for[node_idx] > 0)
+            graph->cycle_task = (graph->nodes[node_idx].name != NULL ? graph->nodes[node_idx].name : "?");
+
+    free(level);
+    free(waiting_for);
+    free(ready);
+
+    return (ready_num == graph->nodes_num ? 0 : -1);
+}
+
+static void submitNode(TASK_GRAPH_NODE* node)
+{
+    if(threadPoolSubmit(node->graph->pool, runNode, node, THREAD_POOL_NO_HINT) < 0)
+        runNode(node);
+}
+
+static void runNode(void* arg)
+{
+    TASK_GRAPH_NODE* node = (TASK_GRAPH_NODE*)arg;
+    TASK_GRAPH* graph = node->graph;
+
+    node->routine(node->arg);
+
+    // Release semantics make this task's results visible to whichever task finds its counter reaching zero (acquire).
+    for(unsigned int successor_idx = 0; successor_idx < node->successors_num; successor_idx++)
+    {
+        TASK_GRAPH_NODE* successor = &graph->nodes[graph->successors[node->first_successor + successor_idx]];
+
+        if(atomic_fetch_sub_explicit(&successor->waiting_for, 1, memory_order_acq_rel) == 1)
+            submitNode(successor);
+    }
+
+    // The graph may be destroyed as soon as its run is seen to be done, so that is told under the lock, as the very last access.
+    if(atomic_fetch_sub_explicit(&graph->remaining, 1, memory_order_acq_rel) == 1)
+    {
+        pthread_mutex_lock(&graph->done_lock);
+        graph->done = 1;
+        pthread_cond_broadcast(&graph->done_cond);
+        pthread_mutex_unlock(&graph->done_lock);
+    }
+}
+
+// Returns NULL if the graph could not be allocated.
+TASK_GRAPH* taskGraphCreate()
+{
+    TASK_GRAPH* graph = (TASK_GRAPH*)calloc(1, sizeof(TASK_GRAPH));
+
+    if(graph == NULL)
+        return NULL;
+
+    pthread_mutex_init(&graph->done_lock, NULL);
+    pthread_cond_init(&graph->done_cond, NULL);
+
+    return graph;
+}
+
+void taskGraphDestroy(TASK_GRAPH* graph)
+{
+    if(graph == NULL)
+        return;
+
+    pthread_mutex_destroy(&graph->done_lock);
+    pthread_cond_destroy(&graph->done_cond);
+
+    free(graph->successors);
+    free(graph->edges);
+    free(graph->nodes);
+    free(graph);
+}
+
+// Returns the task's index, or -1 if it could not be added (such as once the graph has been compiled).
+int taskGraphAddTask(TASK_GRAPH* graph, const char* name, THREAD_POOL_TASK_ROUTINE routine, void* arg)
+{
+    if(graph == NULL || routine == NULL || graph->compiled)
+        return -1;
+
+    if(graph->nodes_num == graph->nodes_capacity && growArray((void**)&graph->nodes, &graph->nodes_capacity, sizeof(TASK_GRAPH_NODE)) < 0)
+        return -1;
+
+    TASK_GRAPH_NODE* node = &graph->nodes[graph->nodes_num];
+
+    node->graph             = graph     ;
+    node->name              = name      ;
+    node->routine           = routine   ;
+    node->arg               = arg       ;
+    node->predecessors_num  = 0         ;
+    node->first_successor   = 0         ;
+    node->successors_num    = 0         ;
+    atomic_init(&node->waiting_for, 0);
+
+    return (int)graph->nodes_num++;
+}
+
+int taskGraphAddEdge(TASK_GRAPH* graph, int from_task, int to_task)
+{
+    if(graph == NULL || graph->compiled)
+        return -1;
+
+    if(from_task < 0 || to_task < 0 || (unsigned int)from_task >= graph->nodes_num || (unsigned int)to_task >= graph->nodes_num || from_task == to_task)
+        return -1;
+
+    if(graph->edges_num == graph->edges_capacity && growArray((void**)&graph->edges, &graph->edges_capacity, sizeof(TASK_GRAPH_EDGE)) < 0)
+        return -1;
+
+    graph->edges[graph->edges_num].from_task    = (unsigned int)from_task   ;
+    graph->edges[graph->edges_num].to_task      = (unsigned int)to_task     ;
+    ++graph->edges_num;
+
+    return 0;
+}
+
+// Returns -1 if the graph has a cycle, or could not be laid out.
+int taskGraphCompile(TASK_GRAPH* graph)
+{
+    if(graph == NULL || graph->compiled)
+        return -1;
+
+    graph->successors = (unsigned int*)malloc((graph->edges_num > 0 ? graph->edges_num : 1) * sizeof(unsigned int));
+
+    if(graph->successors == NULL)
+        return -1;
+
+    for(unsigned int edge_idx = 0; edge_idx < graph->edges_num; edge_idx++)
+    {
+        ++graph->nodes[graph->edges[edge_idx].from_task].successors_num;
+        ++graph->nodes[graph->edges[edge_idx].to_task].predecessors_num;
+    }
+
+    // Every task's successors go right after the previous task's ones.
+    unsigned int first_successor = 0;
+
+    for(unsigned int node_idx = 0; node_idx < graph->nodes_num; node_idx++)
+    {
+        graph->nodes[node_idx].first_successor = first_successor;
+        first_successor += graph->nodes[node_idx].successors_num;
+        graph->nodes[node_idx].successors_num = 0;
+    }
+
+    for(unsigned int edge_idx = 0; edge_idx < graph->edges_num; edge_idx++)
+    {
+        TASK_GRAPH_NODE* from = &graph->nodes[graph->edges[edge_idx].from_task];
+        graph->successors[from->first_successor + from->successors_num++] = graph->edges[edge_idx].to_task;
+    }
+
+    if(sortTopologically(graph) < 0)
+    {
+        for(unsigned int node_idx = 0; node_idx < graph->nodes_num; node_idx++)
+        {
+            graph->nodes[node_idx].predecessors_num = 0;
+            graph->nodes[node_idx].successors_num = 0;
+        }
+
+        free(graph->successors);
+        graph->successors = NULL;
+        return -1;
+    }
+
+    // Edges are not needed anymore.
+    free(graph->edges);
+    graph->edges = NULL;
+    graph->edges_capacity = 0;
+    graph->compiled = 1;
+
+    return 0;
+}
+
+// Returns -1 if the graph has not been compiled. Must not be called from within a task of the same pool, which might then wait for
+// tasks queued behind itself.
+int taskGraphRun(TASK_GRAPH* graph, THREAD_POOL* pool)
+{
+    if(graph == NULL || pool == NULL || !graph->compiled)
+        return -1;
+
+    if(graph->nodes_num == 0)
+        return 0;
+
+    graph->pool = pool;
+    graph->done = 0;
+    atomic_store(&graph->remaining, graph->nodes_num);
+
+    for(unsigned int node_idx = 0; node_idx < graph->nodes_num; node_idx++)
+        atomic_store(&graph->nodes[node_idx].waiting_for, graph->nodes[node_idx].predecessors_num);
+
+    // Counters are all set before any task is submitted, since the first ones may end (and decrement others) right away.
+    for(unsigned int node_idx = 0; node_idx < graph->nodes_num; node_idx++)
+        if(graph->nodes[node_idx].predecessors_num == 0)
+            submitNode(&graph->nodes[node_idx]);
+
+    pthread_mutex_lock(&graph->done_lock);
+
+    while(!graph->done)
+        pthread_cond_wait(&graph->done_cond, &graph->done_lock);
+
+    pthread_mutex_unlock(&graph->done_lock);
+
+    return 0;
+}
+
+unsigned int taskGraphGetTasksNum(const TASK_GRAPH* graph)
+{
+    return (graph != NULL ? graph->nodes_num : 0);
+}
+
+unsigned int taskGraphGetEdgesNum(const TASK_GRAPH* graph)
+{
+    return (graph != NULL ? graph->edges_num : 0);
+}
+
+// Tasks along the longest path (the graph's span, if every task took as long), or 0 if the graph has not been compiled yet.
+unsigned int taskGraphGetDepth(const TASK_GRAPH* graph)
+{
+    return (graph != NULL && graph->compiled ? graph->depth : 0);
+}
+
+// Returns NULL unless the last taskGraphCompile call failed because of a cycle.
+const char* taskGraphGetCycleTask(const TASK_GRAPH* graph)
+{
+    return (graph != NULL ? graph->cycle_task : NULL);
+}
+
+/**************************************/
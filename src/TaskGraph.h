@@ -0,0 +1,31 @@
+#ifndef TASK_GRAPH_H
+#define TASK_GRAPH_H
+
+/********* Include statements *********/
+
+#include "ThreadPool.h"
+
+/**************************************/
+
+/********** Type definitions **********/
+
+typedef struct TASK_GRAPH TASK_GRAPH;
+
+/**************************************/
+
+/********* Function prototypes ********/
+
+TASK_GRAPH*     taskGraphCreate();
+void            taskGraphDestroy(TASK_GRAPH* graph);
+int             taskGraphAddTask(TASK_GRAPH* graph, const char* name, THREAD_POOL_TASK_ROUTINE routine, void* arg);
+int             taskGraphAddEdge(TASK_GRAPH* graph, int from_task, int to_task);
+int             taskGraphCompile(TASK_GRAPH* graph);
+int             taskGraphRun(TASK_GRAPH* graph, THREAD_POOL* pool);
+unsigned int    taskGraphGetTasksNum(const TASK_GRAPH* graph);
+unsigned int    taskGraphGetEdgesNum(const TASK_GRAPH* graph);
+unsigned int    taskGraphGetDepth(const TASK_GRAPH* graph);
+const char*     taskGraphGetCycleTask(const TASK_GRAPH* graph);
+
+/**************************************/
+
+#endif
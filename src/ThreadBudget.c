@@ -0,0 +1,473 @@
+/*
+As seen in BasicThreads.c, pthread_create may fail with EAGAIN when the system lacks the resources needed for a new thread. On Linux,
+there are several independent limits that can trigger such an error:
+    ·RLIMIT_NPROC: maximum number of processes (threads included) a user may own. Retrieved by using getrlimit. It does not apply
+    to the superuser.
+    ·/proc/sys/kernel/threads-max: system-wide maximum number of threads.
+    ·pids.max: maximum number of tasks allowed within the cgroup the process belongs to (typical in containers). Found in
+    /sys/fs/cgroup/<group>/pids.max (cgroup v2) or /sys/fs/cgroup/pids/<group>/pids.max (cgroup v1).
+
+Instead of asking for as many threads as the problem could use and failing once any of the limits above is reached, callers can ask
+this "thread budget governor" for slots first:
+
+unsigned int threadBudgetAcquire(unsigned int requested, unsigned int minimum)
+
+Where:
+    ·requested: number of threads the caller would like to create.
+    ·minimum: number of threads below which the caller prefers to wait.
+    Returns the number of slots granted, which is never greater than requested. When the limits are close, fewer slots than
+    requested are granted (capped). When not even "minimum" slots are available, the caller is queued until other callers
+    release theirs. If no slot is held by anyone else (so waiting would be pointless), 0 is returned and the caller is expected
+    to do the job from its own thread.
+
+Slots have to be given back by using threadBudgetRelease once the threads have been joined. Even with slots granted, another process
+may consume the remaining resources in the meantime, so threads should be created through threadBudgetCreateThread, which accounts
+for the spawns denied by the system. Callers are then expected to go on with fewer threads rather than giving up. Slots granted whose
+threads have not been created yet are not seen by the probes, so they are taken off the limits until threadBudgetCreateThread creates
+them or they are released. That is why callers tell threadBudgetRelease how many of their slots got a thread: the rest of them were
+never created, and are no longer set aside.
+
+How long queued callers waited for their slots is recorded into a latency histogram (see LatencyHistogram.c), whose percentiles are
+printed along with the rest of the metrics. Slots in use, waiting callers, requests and denied spawns are also kept up to date in the
+metrics exporter (see MetricsExporter.c), along with the histogram, so that they can be watched while lessons run.
+*/
+
+/********* Include statements *********/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "ThreadColors.h"
+#include "LatencyHistogram.h"
+#include "MetricsExporter.h"
+#include "ThreadBudget.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define THREADS_MAX_PATH            "/proc/sys/kernel/threads-max"
+#define LOADAVG_PATH                "/proc/loadavg"
+#define SELF_CGROUP_PATH            "/proc/self/cgroup"
+#define CGROUP_V1_PIDS_ROOT         "/sys/fs/cgroup/pids"
+#define CGROUP_V2_ROOT              "/sys/fs/cgroup"
+#define CGROUP_LINE_MAX_SIZE        512
+#define CGROUP_PATH_MAX_SIZE        1024
+#define UNLIMITED_HEADROOM          ((unsigned long)-1)
+#define HEADROOM_RESERVE_MIN        16      // Tasks always left for the rest of the system.
+#define HEADROOM_RESERVE_DIVISOR    20      // Or 5% of the tightest limit, if greater.
+#define QUEUE_RETRY_PERIOD_MS       50      // Limits may be freed by other processes, so waiting callers probe again periodically.
+
+/**************************************/
+
+/********* Private variables **********/
+
+static pthread_mutex_t          budget_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t           budget_cond = PTHREAD_COND_INITIALIZER;
+static THREAD_BUDGET_METRICS    budget_metrics;
+static unsigned long            unspawned_slots;    // Granted slots whose threads have not been created yet.
+static LATENCY_HISTOGRAM        queue_wait_histogram;
+static pthread_once_t           metrics_once = PTHREAD_ONCE_INIT;
+static int                      in_use_metric = -1;
+static int                      waiting_metric = -1;
+static int                      requests_metric = -1;
+static int                      denied_spawns_metric = -1;
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static int              readUnsignedLongFromFile(const char* path, unsigned long* value);
+static unsigned long    getSystemTaskCount();
+static unsigned long    getRemaining(unsigned long limit, unsigned long used);
+static unsigned long    getNprocHeadroom(unsigned long task_count);
+static unsigned long    getThreadsMaxHeadroom(unsigned long task_count);
+static int              getCgroupPidsDirectory(char* directory, size_t directory_size);
+static unsigned long    getCgroupPidsHeadroom();
+static unsigned long    probeHeadroom();
+static unsigned long    getAvailableSlots();
+static void             registerMetrics();
+
+/**************************************/
+
+/******** Function definitions ********/
+
+static int readUnsignedLongFromFile(const char* path, unsigned long* value)
+{
+    FILE* file = fopen(path, "r");
+
+    if(file == NULL)
+        return -1;
+
+    // Files such as pids.max may contain "max" instead of a number, meaning there is no limit at all.
+    char text[32] = {0};
+    int ret = (fscanf(file, "%31s", text) == 1 ? 0 : -1);
+
+    fclose(file);
+
+    if(ret < 0)
+        return -1;
+
+    if(strcmp(text, "max") == 0)
+    {
+        *value = UNLIMITED_HEADROOM;
+        return 0;
+    }
+
+    return (sscanf(text, "%lu", value) == 1 ? 0 : -1);
+}
+
+// The fourth field in /proc/loadavg ("running/total") holds the number of scheduling entities (threads) currently existing in the system.
+static unsigned long getSystemTaskCount()
+{
+    FILE* file = fopen(LOADAVG_PATH, "r");
+
+    if(file == NULL)
+        return 0;
+
+    unsigned long running = 0;
+    unsigned long total = 0;
+
+    if(fscanf(file, "%*s %*s %*s %lu/%lu", &running, &total) != 2)
+        total = 0;
+
+    fclose(file);
+
+    return total;
+}
+
+static unsigned long getRemaining(unsigned long limit, unsigned long used)
+{
+    if(limit == UNLIMITED_HEADROOM)
+        return UNLIMITED_HEADROOM;
+
+    return (limit > used ? limit - used : 0);
+}
+
+// The amount of threads owned by the current user is not cheaply available, so every task in the system is taken into account instead.
+// This overestimates the usage, which is the safe side to err on.
+static unsigned long getNprocHeadroom(unsigned long task_count)
+{
+    struct rlimit nproc_limit;
+
+    if(geteuid() == 0 || getrlimit(RLIMIT_NPROC, &nproc_limit) != 0 || nproc_limit.rlim_cur == RLIM_INFINITY)
+        return UNLIMITED_HEADROOM;
+
+    return getRemaining((unsigned long)nproc_limit.rlim_cur, task_count);
+}
+
+static unsigned long getThreadsMaxHeadroom(unsigned long task_count)
+{
+    unsigned long threads_max;
+
+    if(readUnsignedLongFromFile(THREADS_MAX_PATH, &threads_max) < 0)
+        return UNLIMITED_HEADROOM;
+
+    return getRemaining(threads_max, task_count);
+}
+
+// Find the directory holding pids.max for the cgroup the process belongs to. Both cgroup v1 ("N:pids:/path") and
+// cgroup v2 ("0::/path") entries are understood.
+static int getCgroupPidsDirectory(char* directory, size_t directory_size)
+{
+    FILE* file = fopen(SELF_CGROUP_PATH, "r");
+
+    if(file == NULL)
+        return -1;
+
+    char line[CGROUP_LINE_MAX_SIZE];
+    int ret = -1;
+
+    while(fgets(line, sizeof(line), file) != NULL)
+    {
+        line[strcspn(line, "\r\n")] = 0;
+
+        char* controllers = strchr(line, ':');
+        char* group_path = (controllers ? strchr(controllers + 1, ':') : NULL);
+
+        if(group_path == NULL)
+            continue;
+
+        *(group_path++) = 0;
+        ++controllers;
+
+        if(strcmp(controllers, "pids") == 0)
+        {
+            snprintf(directory, directory_size, "%s%s", CGROUP_V1_PIDS_ROOT, group_path);
+            ret = 0;
+            break;
+        }
+
+        if(controllers[0] == 0)
+        {
+            snprintf(directory, directory_size, "%s%s", CGROUP_V2_ROOT, group_path);
+            ret = 0;
+        }
+    }
+
+    fclose(file);
+
+    return ret;
+}
+
+static unsigned long getCgroupPidsHeadroom()
+{
+    char directory[CGROUP_PATH_MAX_SIZE];
+    char path[CGROUP_PATH_MAX_SIZE + 16];
+    unsigned long pids_max, pids_current;
+
+    if(getCgroupPidsDirectory(directory, sizeof(directory)) < 0)
+        return UNLIMITED_HEADROOM;
+
+    snprintf(path, sizeof(path), "%s/pids.max", directory);
+
+    // The root cgroup has no pids.max file, meaning there is no limit.
+    if(readUnsignedLongFromFile(path, &pids_max) < 0 || pids_max == UNLIMITED_HEADROOM)
+        return UNLIMITED_HEADROOM;
+
+    snprintf(path, sizeof(path), "%s/pids.current", directory);
+
+    if(readUnsignedLongFromFile(path, &pids_current) < 0)
+        return UNLIMITED_HEADROOM;
+
+    return getRemaining(pids_max, pids_current);
+}
+
+// Retrieve the tightest of the known limits, leaving a reserve so that the rest of the system is not starved.
+static unsigned long probeHeadroom()
+{
+    unsigned long task_count = getSystemTaskCount();
+    unsigned long headroom = UNLIMITED_HEADROOM;
+    unsigned long candidates[] =
+    {
+        getNprocHeadroom(task_count)        ,
+        getThreadsMaxHeadroom(task_count)   ,
+        getCgroupPidsHeadroom()             ,
+    };
+
+    for(unsigned int i = 0; i < sizeof(candidates) / sizeof(candidates[0]); i++)
+        if(candidates[i] < headroom)
+            headroom = candidates[i];
+
+    if(headroom == UNLIMITED_HEADROOM)
+        return headroom;
+
+    unsigned long reserve = headroom / HEADROOM_RESERVE_DIVISOR;
+
+    if(reserve < HEADROOM_RESERVE_MIN)
+        reserve = HEADROOM_RESERVE_MIN;
+
+    return (headroom > reserve ? headroom - reserve : 0);
+}
+
+// Must be called with budget_lock held.
+static unsigned long getAvailableSlots()
+{
+    unsigned long available = probeHeadroom();
+
+    // Threads already created are counted by the probe, but those granted and not created yet are not, so they would be handed
+    // out twice otherwise.
+    available = getRemaining(available, unspawned_slots);
+
+    budget_metrics.limit = available;
+
+    if(budget_metrics.cap != 0)
+    {
+        unsigned long cap_available = getRemaining(budget_metrics.cap, budget_metrics.in_use);
+
+        if(cap_available < available)
+            available = cap_available;
+    }
+
+    return available;
+}
+
+static void registerMetrics()
+{
+    in_use_metric           = metricsExporterRegister("thread_budget_slots_in_use"          , "Thread slots currently held."                    , METRIC_TYPE_GAUGE     );
+    waiting_metric          = metricsExporterRegister("thread_budget_waiting_callers"       , "Callers currently queued for thread slots."      , METRIC_TYPE_GAUGE     );
+    requests_metric         = metricsExporterRegister("thread_budget_requests_total"        , "Requests for thread slots."                      , METRIC_TYPE_COUNTER   );
+    denied_spawns_metric    = metricsExporterRegister("thread_budget_denied_spawns_total"   , "Thread creations refused by the system."         , METRIC_TYPE_COUNTER   );
+
+    metricsExporterRegisterHistogram("thread_budget_queue_wait_seconds", "Time spent waiting for thread slots.", &queue_wait_histogram);
+}
+
+unsigned int threadBudgetAcquire(unsigned int requested, unsigned int minimum)
+{
+    if(requested == 0)
+        return 0;
+
+    pthread_once(&metrics_once, registerMetrics);
+
+    pthread_mutex_lock(&budget_lock);
+
+    // Never wait for more slots than the cap could ever provide, otherwise the caller would be queued forever.
+    if(minimum == 0)
+        minimum = 1;
+
+    if(minimum > requested)
+        minimum = requested;
+
+    if(budget_metrics.cap != 0 && minimum > budget_metrics.cap)
+        minimum = budget_metrics.cap;
+
+    ++budget_metrics.requests;
+    budget_metrics.requested_slots += requested;
+    metricsExporterAdd(requests_metric, 1);
+
+    unsigned long available = getAvailableSlots();
+    int queued = 0;
+    unsigned long long queued_time_ns = 0;
+
+    // Waiting only makes sense if other callers hold slots that will be released sooner or later.
+    while(available < minimum && budget_metrics.in_use > 0)
+    {
+        if(!queued)
+        {
+            ++budget_metrics.queued_requests;
+            metricsExporterAdd(waiting_metric, 1);
+            queued = 1;
+            queued_time_ns = latencyHistogramGetTimeNs();
+        }
+
+        struct timespec retry_time;
+        clock_gettime(CLOCK_REALTIME, &retry_time);
+        retry_time.tv_nsec += QUEUE_RETRY_PERIOD_MS * 1000000L;
+
+        if(retry_time.tv_nsec >= 1000000000L)
+        {
+            retry_time.tv_sec += 1;
+            retry_time.tv_nsec -= 1000000000L;
+        }
+
+        pthread_cond_timedwait(&budget_cond, &budget_lock, &retry_time);
+
+        available = getAvailableSlots();
+    }
+
+    if(queued)
+    {
+        latencyHistogramRecord(&queue_wait_histogram, latencyHistogramGetTimeNs() - queued_time_ns);
+        metricsExporterAdd(waiting_metric, -1);
+    }
+
+    unsigned int granted = (available < requested ? (unsigned int)available : requested);
+
+    if(granted < minimum)
+        granted = 0;
+
+    if(granted < requested)
+        ++budget_metrics.capped_requests;
+
+    budget_metrics.granted_slots += granted;
+    budget_metrics.in_use += granted;
+    unspawned_slots += granted;
+    metricsExporterAdd(in_use_metric, granted);
+
+    pthread_mutex_unlock(&budget_lock);
+
+    return granted;
+}
+
+// Gives back a grant of "slots", "created_threads" of which had their threads created through threadBudgetCreateThread.
+void threadBudgetRelease(unsigned int slots, unsigned int created_threads)
+{
+    pthread_mutex_lock(&budget_lock);
+
+    unsigned long released = (slots < budget_metrics.in_use ? slots : budget_metrics.in_use);
+    budget_metrics.in_use -= released;
+    metricsExporterAdd(in_use_metric, -(long long)released);
+
+    // Slots of this grant whose threads were never created are no longer waiting for a spawn.
+    unsigned long never_created = (created_threads < slots ? slots - created_threads : 0);
+    unspawned_slots -= (never_created < unspawned_slots ? never_created : unspawned_slots);
+
+    pthread_cond_broadcast(&budget_cond);
+    pthread_mutex_unlock(&budget_lock);
+}
+
+// Set cap to 0 so that only system limits are taken into account.
+void threadBudgetSetCap(unsigned long cap)
+{
+    pthread_mutex_lock(&budget_lock);
+
+    budget_metrics.cap = cap;
+
+    pthread_cond_broadcast(&budget_cond);
+    pthread_mutex_unlock(&budget_lock);
+}
+
+int threadBudgetCreateThread(pthread_t* thread, const pthread_attr_t* attr, void* (*start_routine)(void*), void* arg)
+{
+    int ret = pthread_create(thread, attr, start_routine, arg);
+
+    if(ret == 0)
+    {
+        // The new thread is now counted by the probe, so its slot no longer has to be set aside.
+        pthread_mutex_lock(&budget_lock);
+
+        if(unspawned_slots > 0)
+            --unspawned_slots;
+
+        pthread_mutex_unlock(&budget_lock);
+    }
+    else if(ret == EAGAIN)
+    {
+        pthread_once(&metrics_once, registerMetrics);
+
+        pthread_mutex_lock(&budget_lock);
+        ++budget_metrics.denied_spawns;
+        metricsExporterAdd(denied_spawns_metric, 1);
+        pthread_mutex_unlock(&budget_lock);
+    }
+
+    return ret;
+}
+
+void threadBudgetGetMetrics(THREAD_BUDGET_METRICS* metrics)
+{
+    if(metrics == NULL)
+        return;
+
+    pthread_mutex_lock(&budget_lock);
+    *metrics = budget_metrics;
+    pthread_mutex_unlock(&budget_lock);
+}
+
+void threadBudgetPrintMetrics()
+{
+    THREAD_BUDGET_METRICS metrics;
+    threadBudgetGetMetrics(&metrics);
+
+    char limit_text[32];
+
+    if(metrics.limit == UNLIMITED_HEADROOM)
+        snprintf(limit_text, sizeof(limit_text), "unlimited");
+    else
+        snprintf(limit_text, sizeof(limit_text), "%lu", metrics.limit);
+
+    printf("%sThread budget: limit %s, in use %lu, requests %lu (%lu/%lu slots granted), capped %lu, queued %lu, denied spawns %lu.%s\r\n",
+            PRINT_COLOR_YELLOW          ,
+            limit_text                  ,
+            metrics.in_use              ,
+            metrics.requests            ,
+            metrics.granted_slots       ,
+            metrics.requested_slots     ,
+            metrics.capped_requests     ,
+            metrics.queued_requests     ,
+            metrics.denied_spawns       ,
+            PRINT_COLOR_RESET           );
+
+    if(latencyHistogramGetCount(&queue_wait_histogram) > 0)
+    {
+        printf("%s", PRINT_COLOR_YELLOW);
+        latencyHistogramPrint(stdout, "Thread budget queue wait", &queue_wait_histogram);
+        printf("%s", PRINT_COLOR_RESET);
+    }
+}
+
+/**************************************/
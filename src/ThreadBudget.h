@@ -0,0 +1,38 @@
+#ifndef THREAD_BUDGET_H
+#define THREAD_BUDGET_H
+
+/********* Include statements *********/
+
+#include <pthread.h>
+
+/**************************************/
+
+/********** Type definitions **********/
+
+typedef struct
+{
+    unsigned long   limit           ;   // Number of threads that could still be created when the last probe was made.
+    unsigned long   cap             ;   // Maximum number of slots that may be held at the same time (0 means no cap).
+    unsigned long   in_use          ;   // Slots currently held by the callers of threadBudgetAcquire.
+    unsigned long   requests        ;   // Number of threadBudgetAcquire calls.
+    unsigned long   requested_slots ;   // Total slots asked for.
+    unsigned long   granted_slots   ;   // Total slots handed out.
+    unsigned long   capped_requests ;   // Requests granted with fewer slots than asked for.
+    unsigned long   queued_requests ;   // Requests that had to wait for slots to be released.
+    unsigned long   denied_spawns   ;   // Thread creations refused by the system (EAGAIN).
+} THREAD_BUDGET_METRICS;
+
+/**************************************/
+
+/********* Function prototypes ********/
+
+unsigned int    threadBudgetAcquire(unsigned int requested, unsigned int minimum);
+void            threadBudgetRelease(unsigned int slots, unsigned int created_threads);
+void            threadBudgetSetCap(unsigned long cap);
+int             threadBudgetCreateThread(pthread_t* thread, const pthread_attr_t* attr, void* (*start_routine)(void*), void* arg);
+void            threadBudgetGetMetrics(THREAD_BUDGET_METRICS* metrics);
+void            threadBudgetPrintMetrics();
+
+/**************************************/
+
+#endif
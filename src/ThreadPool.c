@@ -0,0 +1,1119 @@
+/*
+Creating a thread for every task, as MatrixMultiplication.c does, pays for a thread creation (and a join) per task, and lets the
+scheduler put threads wherever it likes. A thread pool creates its workers once and hands tasks out to them instead:
+
+THREAD_POOL* threadPoolCreate(unsigned int workers_num)
+int threadPoolSubmit(THREAD_POOL* pool, THREAD_POOL_TASK_ROUTINE routine, void* arg, int cpu_hint)
+void threadPoolWait(THREAD_POOL* pool)
+
+Where:
+    ·workers_num: number of workers wanted. They are asked for to the thread budget governor (see ThreadBudget.c), so fewer of them
+    may be created. If none could be, tasks are run right away by the thread submitting them.
+    ·routine, arg: the task, which is run as routine(arg) by any of the workers.
+    ·cpu_hint: CPU the task would rather run on (such as the one owning the data it works on), or THREAD_POOL_NO_HINT.
+    threadPoolWait returns once every submitted task (including the ones submitted by tasks) is done.
+
+As told in ThreadsWithAttributes.c, threads can be bound to CPUs (processor affinity). Each worker is pinned to one of the CPUs the
+process is allowed to run on, so whatever a task leaves in that CPU's caches is still there for the next task run by the worker.
+Placement is then up to submission:
+    ·Every worker has a queue of its own. Tasks submitted by a worker (such as a task splitting its job into smaller ones) go to its
+    own queue, and are taken newest first, since those are the ones most likely to find their data in the caches. Tasks coming from
+    elsewhere are taken in submission order.
+    ·Tasks submitted with a hint go to the queue of the worker pinned to that CPU or, failing that, to the nearest one.
+    ·Any other task is handed out to each worker in turn.
+
+A worker whose queue is empty steals the oldest task from another worker's queue, trying the nearest ones first: hardware threads of
+the same core share its caches, and CPUs in the same NUMA node (read from /sys/devices/system/cpu) share its memory, while stealing
+from anywhere else means fetching the task's data from afar. Workers with nothing to steal either sleep until a task is submitted.
+
+How well placement worked is reported as the locality hit rate: the share of the tasks which had a preferred worker (hinted, or
+submitted by a worker) and were run by that very worker, along with the tasks stolen at each distance.
+
+Some tasks are more urgent than others. Real-time scheduling policies (SCHED_RR, SCHED_FIFO, see ThreadsWithAttributes.c) need
+privileges most processes lack, and apply to whole threads anyway, so priorities are handled by the pool itself instead:
+
+int threadPoolSubmitWithPriority(THREAD_POOL* pool, THREAD_POOL_TASK_ROUTINE routine, void* arg, int cpu_hint, int priority)
+
+Every worker's queue holds a ring of tasks per priority (THREAD_POOL_PRIORITY_HIGH, NORMAL and LOW), and workers take the most
+urgent task available, whether from their own queue or by stealing: a high priority task just waits for the tasks already running
+to end, however many tasks of lower priority are queued. Tasks are not preempted, so lower priority tasks should be short.
+
+Should high priority tasks keep coming, lower priority ones would starve forever, so tasks age: a task waiting for longer than its
+priority level times the aging period (THREAD_POOL_DEFAULT_AGING_MS, or as set through threadPoolSetAging) is taken by its worker
+ahead of anything more urgent. The shorter the period, the sooner lower priorities get their turn, and the more they delay urgent
+tasks. How long high priority tasks wait behind a flood of lower priority ones is measured by ThreadPoolPriorities.c.
+
+Other tasks have to be done by a given time, rather than just sooner than others:
+
+int threadPoolSubmitWithDeadline(THREAD_POOL* pool, THREAD_POOL_TASK_ROUTINE routine, void* arg, unsigned long long deadline_ns, unsigned long long cost_ns)
+
+Where:
+    ·deadline_ns: absolute deadline, on the CLOCK_MONOTONIC clock (as returned by latencyHistogramGetTimeNs).
+    ·cost_ns: how long the task is expected to take, or 0 if unknown.
+
+Deadline tasks do not go to any worker's queue, but to a single min-heap shared by every worker (guarded by a mutex, as popping
+the task due soonest takes a look at all of them anyway), and they are run ahead of any task without a deadline. The heap is ordered
+by deadline (earliest deadline first, THREAD_POOL_DEADLINE_EDF) or by submission time (THREAD_POOL_DEADLINE_FIFO), as set through
+threadPoolSetDeadlineScheduling before submitting them. Each task is accounted as met or missed once it ends.
+
+EDF meets every deadline whenever that is possible at all, but it is at its worst under overload: once tasks cannot all make it,
+it keeps running the ones whose deadlines are closest, which are the ones most likely to be missed anyway, so lateness spreads
+over every task (the domino effect). Shedding hopeless tasks avoids that: a task which cannot end before its deadline (according
+to its cost) by the time a worker would start it is dropped rather than run, and accounted as shed. Its routine is never called,
+so whoever submitted it must not expect it to. How miss rates compare is measured by ThreadPoolDeadlines.c.
+*/
+
+/********* Include statements *********/
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <stdatomic.h>
+#include <sys/sysinfo.h>
+#include "ThreadColors.h"
+#include "ThreadCreationStatus.h"
+#include "ThreadBudget.h"
+#include "ThreadTracer.h"
+#include "MetricsExporter.h"
+#include "LatencyHistogram.h"
+#include "OwnedCounter.h"
+#include "ThreadPool.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define CPU_SYSFS_PATH          "/sys/devices/system/cpu"
+#define SYSFS_PATH_SIZE         128
+#define SYSFS_VALUE_SIZE        32
+#define NODE_ENTRY_PREFIX       "node"
+#define INITIAL_QUEUE_CAPACITY  64
+#define NS_PER_MSEC             1000000ULL
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+typedef struct
+{
+    int cpu         ;
+    int core_id     ;   // Unique within the package only.
+    int package_id  ;
+    int node        ;   // -1 if unknown.
+} CPU_TOPOLOGY;
+
+typedef struct
+{
+    THREAD_POOL_TASK_ROUTINE    routine             ;
+    void*                       arg                 ;
+    int                         preferred_worker    ;   // -1 if the task may run anywhere.
+    int                         spawned             ;   // Submitted by the worker whose queue holds it.
+    int                         priority            ;
+    unsigned long long          submit_time_ns      ;
+    unsigned long long          deadline_ns         ;   // 0 if the task has no deadline.
+    unsigned long long          cost_ns             ;
+    unsigned long long          key_ns              ;   // Deadline or submission time, which the heap is ordered by.
+} THREAD_POOL_TASK;
+
+// A ring buffer, growing as needed. The owning worker takes tasks from its tail, while thieves (and aged tasks) are taken from its
+// head.
+typedef struct
+{
+    THREAD_POOL_TASK*   tasks       ;
+    unsigned int        capacity    ;
+    unsigned int        head        ;
+    unsigned int        count       ;
+} THREAD_POOL_RING;
+
+typedef struct
+{
+    pthread_mutex_t     lock                                ;
+    THREAD_POOL_RING    rings[THREAD_POOL_PRIORITIES_NUM]   ;
+} THREAD_POOL_QUEUE;
+
+// A binary min-heap on key_ns, growing as needed.
+typedef struct
+{
+    pthread_mutex_t     lock        ;
+    THREAD_POOL_TASK*   tasks       ;
+    unsigned int        capacity    ;
+    unsigned int        count       ;
+} THREAD_POOL_HEAP;
+
+typedef struct
+{
+    THREAD_POOL*        pool                                ;
+    unsigned int        idx                                 ;
+    CPU_TOPOLOGY        topology                            ;
+    atomic_int          pinned                              ;
+    pthread_t           thread                              ;
+    THREAD_POOL_QUEUE   queue                               ;
+    unsigned int*       steal_order                         ;   // Every other worker, nearest first.
+    atomic_ullong       executed                            ;   // Written by the worker only.
+    atomic_ullong       local                               ;
+    atomic_ullong       stolen[THREAD_POOL_DISTANCES_NUM]   ;
+    atomic_ullong       prioritized[THREAD_POOL_PRIORITIES_NUM];
+    atomic_ullong       aged                                ;
+    atomic_ullong       deadlines_met                       ;
+    atomic_ullong       deadlines_missed                    ;
+    atomic_ullong       deadlines_shed                      ;
+    atomic_ullong       lateness_ns                         ;
+} THREAD_POOL_WORKER;
+
+struct THREAD_POOL
+{
+    THREAD_POOL_WORKER* workers             ;
+    unsigned int        workers_num         ;   // Workers actually created.
+    unsigned int        granted_slots       ;
+    int*                cpu_workers         ;   // Worker to hand tasks hinted with each CPU to.
+    unsigned int        cpus_num            ;
+    atomic_uint         next_worker         ;
+    atomic_int          queued              ;   // Tasks sitting in queues.
+    atomic_int          queued_priorities[THREAD_POOL_PRIORITIES_NUM];
+    atomic_ullong       aging_ns            ;
+    THREAD_POOL_HEAP    deadlines           ;
+    atomic_int          queued_deadlines    ;
+    atomic_int          deadline_policy     ;
+    atomic_int          shed_hopeless       ;
+    atomic_uint         pending             ;   // Tasks submitted and not done yet.
+    atomic_uint         sleepers            ;
+    atomic_int          stop                ;
+    atomic_ullong       submitted           ;
+    atomic_ullong       preferred           ;
+    atomic_ullong       inline_executed     ;   // Run by the submitting thread, as no worker could be created.
+    pthread_mutex_t     idle_lock           ;
+    pthread_cond_t      idle_cond           ;
+    pthread_mutex_t     done_lock           ;
+    pthread_cond_t      done_cond           ;
+};
+
+/**************************************/
+
+/********* Private variables **********/
+
+static _Thread_local THREAD_POOL_WORKER*    current_worker;
+static pthread_once_t                       metrics_once = PTHREAD_ONCE_INIT;
+static int                                  queued_metric = -1;
+static int                                  executed_metric = -1;
+static int                                  steals_metric = -1;
+static int                                  missed_metric = -1;
+static int                                  shed_metric = -1;
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static void                 registerMetrics();
+static int                  readTopologyValue(int cpu, const char* name);
+static int                  readNode(int cpu);
+static void                 readTopology(int cpu, CPU_TOPOLOGY* topology);
+static int                  getDistance(const CPU_TOPOLOGY* a, const CPU_TOPOLOGY* b);
+static void                 setStealOrder(THREAD_POOL* pool, THREAD_POOL_WORKER* worker, unsigned int workers_num);
+static int                  mapCPUsToWorkers(THREAD_POOL* pool);
+static int                  pushTask(THREAD_POOL_QUEUE* queue, const THREAD_POOL_TASK* task);
+static int                  popTask(THREAD_POOL_QUEUE* queue, int priority, int owner, THREAD_POOL_TASK* task);
+static int                  popAgedTask(THREAD_POOL_QUEUE* queue, int most_urgent, unsigned long long aging_ns, THREAD_POOL_TASK* task);
+static int                  stealTask(THREAD_POOL_WORKER* worker, int priority, THREAD_POOL_TASK* task, int* distance);
+static int                  pushHeapTask(THREAD_POOL_HEAP* heap, const THREAD_POOL_TASK* task);
+static int                  popHeapTask(THREAD_POOL_HEAP* heap, THREAD_POOL_TASK* task);
+static int                  takeDeadlineTask(THREAD_POOL_WORKER* worker, THREAD_POOL_TASK* task);
+static int                  takeTask(THREAD_POOL_WORKER* worker, THREAD_POOL_TASK* task, int* distance);
+static void                 unqueueTask(THREAD_POOL* pool, const THREAD_POOL_TASK* task);
+static void                 runTask(THREAD_POOL_WORKER* worker, const THREAD_POOL_TASK* task, int distance);
+static void                 finishTask(THREAD_POOL* pool);
+static void                 wakeWorker(THREAD_POOL* pool);
+static void*                threadPoolWorkerRoutine(void* arg);
+
+/**************************************/
+
+/******** Function definitions ********/
+
+static void registerMetrics()
+{
+    queued_metric   = metricsExporterRegister("thread_pool_queued_tasks"          , "Tasks waiting in thread pool queues."     , METRIC_TYPE_GAUGE     );
+    executed_metric = metricsExporterRegister("thread_pool_tasks_total"           , "Tasks run by thread pool workers."        , METRIC_TYPE_COUNTER   );
+    steals_metric   = metricsExporterRegister("thread_pool_steals_total"          , "Tasks stolen from other workers' queues." , METRIC_TYPE_COUNTER   );
+    missed_metric   = metricsExporterRegister("thread_pool_deadline_misses_total" , "Deadline tasks which ended late."         , METRIC_TYPE_COUNTER   );
+    shed_metric     = metricsExporterRegister("thread_pool_shed_tasks_total"      , "Deadline tasks dropped as hopeless."      , METRIC_TYPE_COUNTER   );
+}
+
+// Reads /sys/devices/system/cpu/cpu<cpu>/topology/<name>. Returns -1 if it is not available.
+static int readTopologyValue(int cpu, const char* name)
+{
+    char path[SYSFS_PATH_SIZE];
+    snprintf(path, sizeof(path), "%s/cpu%d/topology/%s", CPU_SYSFS_PATH, cpu, name);
+
+    FILE* file = fopen(path, "r");
+
+    if(file == NULL)
+        return -1;
+
+    char value[SYSFS_VALUE_SIZE];
+    int ret = (fgets(value, sizeof(value), file) != NULL ? atoi(value) : -1);
+
+    fclose(file);
+
+    return ret;
+}
+
+// The NUMA node a CPU belongs to shows up as a node<N> entry within its directory.
+static int readNode(int cpu)
+{
+    char path[SYSFS_PATH_SIZE];
+    snprintf(path, sizeof(path), "%s/cpu%d", CPU_SYSFS_PATH, cpu);
+
+    DIR* directory = opendir(path);
+
+    if(directory == NULL)
+        return -1;
+
+    int node = -1;
+    struct dirent* entry;
+
+    while(node < 0 && (entry = readdir(directory)) != NULL)
+        if(strncmp(entry->d_name, NODE_ENTRY_PREFIX, strlen(NODE_ENTRY_PREFIX)) == 0)
+            sscanf(entry->d_name + strlen(NODE_ENTRY_PREFIX), "%d", &node);
+
+    closedir(directory);
+
+    return node;
+}
+
+static void readTopology(int cpu, CPU_TOPOLOGY* topology)
+{
+    topology->cpu           = cpu                                           ;
+    topology->core_id       = readTopologyValue(cpu, "core_id")             ;
+    topology->package_id    = readTopologyValue(cpu, "physical_package_id") ;
+    topology->node          = readNode(cpu)                                 ;
+}
+
+// Unknown topology (such as within some containers) makes every pair of different CPUs equally near.
+static int getDistance(const CPU_TOPOLOGY* a, const CPU_TOPOLOGY* b)
+{
+    if(a->cpu == b->cpu)
+        return THREAD_POOL_DISTANCE_CPU;
+
+    if(a->core_id >= 0 && a->core_id == b->core_id && a->package_id == b->package_id)
+        return THREAD_POOL_DISTANCE_CORE;
+
+    if(a->node >= 0 && b->node >= 0)
+        return (a->node == b->node ? THREAD_POOL_DISTANCE_NODE : THREAD_POOL_DISTANCE_REMOTE);
+
+    return (a->package_id == b->package_id ? THREAD_POOL_DISTANCE_NODE : THREAD_POOL_DISTANCE_REMOTE);
+}
+
+// Workers at the same distance are tried starting from the next one, so that thieves do not all go for the same victim.
+static void setStealOrder(THREAD_POOL* pool, THREAD_POOL_WORKER* worker, unsigned int workers_num)
+{
+    unsigned int victims_num = 0;
+
+    for(unsigned int offset = 1; offset < workers_num; offset++)
+    {
+        unsigned int victim = (worker->idx + offset) % workers_num;
+        int distance = getDistance(&worker->topology, &pool->workers[victim].topology);
+
+        // Insertion sort, which keeps the order above among workers at the same distance.
+        unsigned int insert_idx = victims_num;
+
+        while(insert_idx > 0 && getDistance(&worker->topology, &pool->workers[worker->steal_order[insert_idx - 1]].topology) > distance)
+        {
+            worker->steal_order[insert_idx] = worker->steal_order[insert_idx - 1];
+            --insert_idx;
+        }
+
+        worker->steal_order[insert_idx] = victim;
+        ++victims_num;
+    }
+}
+
+// Every CPU is given the worker pinned to it or, failing that, one of the nearest workers (picked in turn, so that hints to CPUs
+// without a worker of their own are spread among them).
+static int mapCPUsToWorkers(THREAD_POOL* pool)
+{
+    pool->cpus_num = (unsigned int)get_nprocs_conf();
+    pool->cpu_workers = (int*)malloc(pool->cpus_num * sizeof(int));
+
+    if(pool->cpu_workers == NULL)
+        return -1;
+
+    for(unsigned int cpu = 0; cpu < pool->cpus_num; cpu++)
+    {
+        CPU_TOPOLOGY topology;
+        readTopology((int)cpu, &topology);
+
+        int nearest_distance = THREAD_POOL_DISTANCES_NUM;
+        unsigned int nearest_num = 0;
+
+        for(unsigned int worker_idx = 0; worker_idx < pool->workers_num; worker_idx++)
+        {
+            int distance = getDistance(&topology, &pool->workers[worker_idx].topology);
+
+            if(distance < nearest_distance)
+            {
+                nearest_distance = distance;
+                nearest_num = 0;
+            }
+
+            if(distance == nearest_distance)
+                ++nearest_num;
+        }
+
+        unsigned int pick = cpu % nearest_num;
+        pool->cpu_workers[cpu] = 0;
+
+        for(unsigned int worker_idx = 0; worker_idx < pool->workers_num; worker_idx++)
+        {
+            if(getDistance(&topology, &pool->workers[worker_idx].topology) != nearest_distance)
+                continue;
+
+            if(pick-- == 0)
+            {
+                pool->cpu_workers[cpu] = (int)worker_idx;
+                break;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int pushTask(THREAD_POOL_QUEUE* queue, const THREAD_POOL_TASK* task)
+{
+    pthread_mutex_lock(&queue->lock);
+
+    THREAD_POOL_RING* ring = &queue->rings[task->priority];
+
+    if(ring->count == ring->capacity)
+    {
+        unsigned int new_capacity = (ring->capacity > 0 ? ring->capacity * 2 : INITIAL_QUEUE_CAPACITY);
+        THREAD_POOL_TASK* new_tasks = (THREAD_POOL_TASK*)malloc(new_capacity * sizeof(THREAD_POOL_TASK));
+
+        if(new_tasks == NULL)
+        {
+            pthread_mutex_unlock(&queue->lock);
+            return -1;
+        }
+
+        for(unsigned int task_idx = 0; task_idx < ring->count; task_idx++)
+            new_tasks[task_idx] = ring->tasks[(ring->head + task_idx) % ring->capacity];
+
+        free(ring->tasks);
+        ring->tasks     = new_tasks     ;
+        ring->capacity  = new_capacity  ;
+        ring->head      = 0             ;
+    }
+
+    ring->tasks[(ring->head + ring->count) % ring->capacity] = *task;
+    ++ring->count;
+
+    pthread_mutex_unlock(&queue->lock);
+
+    return 0;
+}
+
+// Thieves take the oldest task of the given priority. The owning worker takes the newest one if it spawned it, and the oldest one
+// otherwise.
+static int popTask(THREAD_POOL_QUEUE* queue, int priority, int owner, THREAD_POOL_TASK* task)
+{
+    pthread_mutex_lock(&queue->lock);
+
+    THREAD_POOL_RING* ring = &queue->rings[priority];
+    int popped = (ring->count > 0);
+
+    if(popped && owner && ring->tasks[(ring->head + ring->count - 1) % ring->capacity].spawned)
+    {
+        --ring->count;
+        *task = ring->tasks[(ring->head + ring->count) % ring->capacity];
+    }
+    else if(popped)
+    {
+        *task = ring->tasks[ring->head];
+        ring->head = (ring->head + 1) % ring->capacity;
+        --ring->count;
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+
+    return popped;
+}
+
+// Takes the oldest task of a priority lower than the most urgent one queued which has waited for longer than its priority level
+// times the aging period, the one exceeding it the most if there are several. The clock is only read if there are such tasks at all.
+static int popAgedTask(THREAD_POOL_QUEUE* queue, int most_urgent, unsigned long long aging_ns, THREAD_POOL_TASK* task)
+{
+    pthread_mutex_lock(&queue->lock);
+
+    unsigned long long now_ns = 0;
+    unsigned long long max_excess_ns = 0;
+    THREAD_POOL_RING* aged_ring = NULL;
+
+    for(int priority = most_urgent + 1; priority < THREAD_POOL_PRIORITIES_NUM; priority++)
+    {
+        THREAD_POOL_RING* ring = &queue->rings[priority];
+
+        if(ring->count == 0)
+            continue;
+
+        if(now_ns == 0)
+            now_ns = latencyHistogramGetTimeNs();
+
+        unsigned long long waited_ns = now_ns - ring->tasks[ring->head].submit_time_ns;
+        unsigned long long limit_ns = aging_ns * (unsigned long long)priority;
+
+        if(waited_ns > limit_ns && waited_ns - limit_ns > max_excess_ns)
+        {
+            max_excess_ns = waited_ns - limit_ns;
+            aged_ring = ring;
+        }
+    }
+
+    if(aged_ring != NULL)
+    {
+        *task = aged_ring->tasks[aged_ring->head];
+        aged_ring->head = (aged_ring->head + 1) % aged_ring->capacity;
+        --aged_ring->count;
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+
+    return (aged_ring != NULL);
+}
+
+static int stealTask(THREAD_POOL_WORKER* worker, int priority, THREAD_POOL_TASK* task, int* distance)
+{
+    THREAD_POOL* pool = worker->pool;
+
+    for(unsigned int victim_idx = 0; victim_idx + 1 < pool->granted_slots; victim_idx++)
+    {
+        // Workers which could not be created are never given any task, so their queues are just found empty.
+        THREAD_POOL_WORKER* victim = &pool->workers[worker->steal_order[victim_idx]];
+
+        if(popTask(&victim->queue, priority, 0, task))
+        {
+            *distance = getDistance(&worker->topology, &victim->topology);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int pushHeapTask(THREAD_POOL_HEAP* heap, const THREAD_POOL_TASK* task)
+{
+    pthread_mutex_lock(&heap->lock);
+
+    if(heap->count == heap->capacity)
+    {
+        unsigned int new_capacity = (heap->capacity > 0 ? heap->capacity * 2 : INITIAL_QUEUE_CAPACITY);
+        THREAD_POOL_TASK* new_tasks = (THREAD_POOL_TASK*)realloc(heap->tasks, new_capacity * sizeof(THREAD_POOL_TASK));
+
+        if(new_tasks == NULL)
+        {
+            pthread_mutex_unlock(&heap->lock);
+            return -1;
+        }
+
+        heap->tasks     = new_tasks     ;
+        heap->capacity  = new_capacity  ;
+    }
+
+    // Sift up: parents with a later key are moved down until the new task's place is found.
+    unsigned int task_idx = heap->count++;
+
+    while(task_idx > 0 && heap->tasks[(task_idx - 1) / 2].key_ns > task->key_ns)
+    {
+        heap->tasks[task_idx] = heap->tasks[(task_idx - 1) / 2];
+        task_idx = (task_idx - 1) / 2;
+    }
+
+    heap->tasks[task_idx] = *task;
+
+    pthread_mutex_unlock(&heap->lock);
+
+    return 0;
+}
+
+static int popHeapTask(THREAD_POOL_HEAP* heap, THREAD_POOL_TASK* task)
+{
+    pthread_mutex_lock(&heap->lock);
+
+    if(heap->count == 0)
+    {
+        pthread_mutex_unlock(&heap->lock);
+        return 0;
+    }
+
+    *task = heap->tasks[0];
+
+    // Sift down the last task from the root: children with an earlier key are moved up until its place is found.
+    THREAD_POOL_TASK last = heap->tasks[--heap->count];
+    unsigned int task_idx = 0;
+
+    while(2 * task_idx + 1 < heap->count)
+    {
+        unsigned int child_idx = 2 * task_idx + 1;
+
+        if(child_idx + 1 < heap->count && heap->tasks[child_idx + 1].key_ns < heap->tasks[child_idx].key_ns)
+            ++child_idx;
+
+        if(heap->tasks[child_idx].key_ns >= last.key_ns)
+            break;
+
+        heap->tasks[task_idx] = heap->tasks[child_idx];
+        task_idx = child_idx;
+    }
+
+    heap->tasks[task_idx] = last;
+
+    pthread_mutex_unlock(&heap->lock);
+
+    return 1;
+}
+
+// Hopeless tasks are shed on the way, if asked to.
+static int takeDeadlineTask(THREAD_POOL_WORKER* worker, THREAD_POOL_TASK* task)
+{
+    THREAD_POOL* pool = worker->pool;
+
+    while(popHeapTask(&pool->deadlines, task))
+    {
+        if(!atomic_load_explicit(&pool->shed_hopeless, memory_order_relaxed) || latencyHistogramGetTimeNs() + task->cost_ns <= task->deadline_ns)
+            return 1;
+
+        unqueueTask(pool, task);
+        ownedCounterAdd(&worker->deadlines_shed, 1);
+        metricsExporterAdd(shed_metric, 1);
+        finishTask(pool);
+    }
+
+    return 0;
+}
+
+// Deadline tasks go first, then aged tasks in the worker's own queue. Otherwise, the most urgent priority with queued tasks anywhere
+// is looked for in the worker's own queue first, then in other workers' ones. "distance" is set to -1 if the task was not stolen.
+static int takeTask(THREAD_POOL_WORKER* worker, THREAD_POOL_TASK* task, int* distance)
+{
+    THREAD_POOL* pool = worker->pool;
+    unsigned long long aging_ns = atomic_load_explicit(&pool->aging_ns, memory_order_relaxed);
+    int aging_checked = 0;
+
+    *distance = -1;
+
+    if(atomic_load(&pool->queued_deadlines) > 0 && takeDeadlineTask(worker, task))
+        return 1;
+
+    for(int priority = 0; priority < THREAD_POOL_PRIORITIES_NUM; priority++)
+    {
+        if(atomic_load(&pool->queued_priorities[priority]) <= 0)
+            continue;
+
+        // Tasks are only aged past the most urgent ones actually waiting.
+        if(!aging_checked && aging_ns > 0 && popAgedTask(&worker->queue, priority, aging_ns, task))
+        {
+            ownedCounterAdd(&worker->aged, 1);
+            return 1;
+        }
+
+        aging_checked = 1;
+
+        if(popTask(&worker->queue, priority, 1, task) || stealTask(worker, priority, task, distance))
+            return 1;
+    }
+
+    return 0;
+}
+
+static void unqueueTask(THREAD_POOL* pool, const THREAD_POOL_TASK* task)
+{
+    if(task->deadline_ns > 0)
+        atomic_fetch_sub(&pool->queued_deadlines, 1);
+    else
+        atomic_fetch_sub(&pool->queued_priorities[task->priority], 1);
+
+    atomic_fetch_sub(&pool->queued, 1);
+    metricsExporterAdd(queued_metric, -1);
+}
+
+// "distance" is -1 if the task was taken from the worker's own queue.
+static void runTask(THREAD_POOL_WORKER* worker, const THREAD_POOL_TASK* task, int distance)
+{
+    task->routine(task->arg);
+
+    ownedCounterAdd(&worker->executed, 1);
+    metricsExporterAdd(executed_metric, 1);
+
+    unsigned long long end_time_ns = (task->deadline_ns > 0 ? latencyHistogramGetTimeNs() : 0);
+
+    if(task->deadline_ns == 0)
+        ownedCounterAdd(&worker->prioritized[task->priority], 1);
+    else if(end_time_ns <= task->deadline_ns)
+        ownedCounterAdd(&worker->deadlines_met, 1);
+    else
+    {
+        ownedCounterAdd(&worker->lateness_ns, end_time_ns - task->deadline_ns);
+        ownedCounterAdd(&worker->deadlines_missed, 1);
+        metricsExporterAdd(missed_metric, 1);
+    }
+
+    if(task->preferred_worker == (int)worker->idx)
+        ownedCounterAdd(&worker->local, 1);
+
+    if(distance >= 0)
+    {
+        ownedCounterAdd(&worker->stolen[distance], 1);
+        metricsExporterAdd(steals_metric, 1);
+    }
+
+    finishTask(worker->pool);
+}
+
+static void finishTask(THREAD_POOL* pool)
+{
+    if(atomic_fetch_sub(&pool->pending, 1) == 1)
+    {
+        pthread_mutex_lock(&pool->done_lock);
+        pthread_cond_broadcast(&pool->done_cond);
+        pthread_mutex_unlock(&pool->done_lock);
+    }
+}
+
+static void wakeWorker(THREAD_POOL* pool)
+{
+    if(atomic_load(&pool->sleepers) > 0)
+    {
+        pthread_mutex_lock(&pool->idle_lock);
+        pthread_cond_signal(&pool->idle_cond);
+        pthread_mutex_unlock(&pool->idle_lock);
+    }
+}
+
+static void* threadPoolWorkerRoutine(void* arg)
+{
+    THREAD_POOL_WORKER* worker = (THREAD_POOL_WORKER*)arg;
+    THREAD_POOL* pool = worker->pool;
+
+    current_worker = worker;
+
+    // Pinning may not be allowed (such as within some containers), in which case the worker just runs wherever it is put.
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(worker->topology.cpu, &cpu_set);
+
+    atomic_store(&worker->pinned, pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) == 0);
+
+    while(1)
+    {
+        THREAD_POOL_TASK task;
+        int distance;
+
+        if(takeTask(worker, &task, &distance))
+        {
+            unqueueTask(pool, &task);
+            runTask(worker, &task, distance);
+            continue;
+        }
+
+        // Sleepers are counted before checking for tasks, and submitters count tasks before checking for sleepers, so either the
+        // worker sees the task or the submitter sees the worker and wakes it up.
+        pthread_mutex_lock(&pool->idle_lock);
+
+        if(atomic_load(&pool->stop) && atomic_load(&pool->queued) <= 0)
+        {
+            pthread_mutex_unlock(&pool->idle_lock);
+            break;
+        }
+
+        atomic_fetch_add(&pool->sleepers, 1);
+
+        if(atomic_load(&pool->queued) <= 0 && !atomic_load(&pool->stop))
+            pthread_cond_wait(&pool->idle_cond, &pool->idle_lock);
+
+        atomic_fetch_sub(&pool->sleepers, 1);
+
+        pthread_mutex_unlock(&pool->idle_lock);
+    }
+
+    return NULL;
+}
+
+// Returns NULL if the pool could not be allocated. The pool may still have fewer workers than asked for (even none).
+THREAD_POOL* threadPoolCreate(unsigned int workers_num)
+{
+    pthread_once(&metrics_once, registerMetrics);
+
+    THREAD_POOL* pool = (THREAD_POOL*)calloc(1, sizeof(THREAD_POOL));
+
+    if(pool == NULL)
+        return NULL;
+
+    pthread_mutex_init(&pool->idle_lock, NULL);
+    pthread_cond_init(&pool->idle_cond, NULL);
+    pthread_mutex_init(&pool->done_lock, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+    pthread_mutex_init(&pool->deadlines.lock, NULL);
+
+    atomic_store(&pool->aging_ns, THREAD_POOL_DEFAULT_AGING_MS * NS_PER_MSEC);
+    atomic_store(&pool->deadline_policy, THREAD_POOL_DEADLINE_EDF);
+
+    pool->granted_slots = threadBudgetAcquire(workers_num, 1);
+    pool->workers = (THREAD_POOL_WORKER*)calloc((pool->granted_slots > 0 ? pool->granted_slots : 1), sizeof(THREAD_POOL_WORKER));
+
+    if(pool->workers == NULL)
+    {
+        threadBudgetRelease(pool->granted_slots, 0);
+        free(pool);
+        return NULL;
+    }
+
+    // Workers are spread over the CPUs the process is allowed to run on, in order.
+    cpu_set_t allowed_cpus;
+    int allowed[CPU_SETSIZE];
+    unsigned int allowed_num = 0;
+
+    if(sched_getaffinity(0, sizeof(allowed_cpus), &allowed_cpus) == 0)
+        for(int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            if(CPU_ISSET(cpu, &allowed_cpus))
+                allowed[allowed_num++] = cpu;
+
+    if(allowed_num == 0)
+        allowed[allowed_num++] = 0;
+
+    for(unsigned int worker_idx = 0; worker_idx < pool->granted_slots; worker_idx++)
+    {
+        THREAD_POOL_WORKER* worker = &pool->workers[worker_idx];
+
+        worker->pool = pool;
+        worker->idx = worker_idx;
+        readTopology(allowed[worker_idx % allowed_num], &worker->topology);
+        pthread_mutex_init(&worker->queue.lock, NULL);
+    }
+
+    for(unsigned int worker_idx = 0; worker_idx < pool->granted_slots; worker_idx++)
+    {
+        THREAD_POOL_WORKER* worker = &pool->workers[worker_idx];
+        worker->steal_order = (unsigned int*)malloc((pool->granted_slots > 1 ? pool->granted_slots - 1 : 1) * sizeof(unsigned int));
+
+        if(worker->steal_order == NULL)
+        {
+            pool->workers_num = 0;
+            threadPoolDestroy(pool);
+            return NULL;
+        }
+
+        setStealOrder(pool, worker, pool->granted_slots);
+    }
+
+    for(unsigned int worker_idx = 0; worker_idx < pool->granted_slots; worker_idx++)
+    {
+        if(checkThreadCreationStatus( TRACED_THREAD_CREATE_WITH(threadBudgetCreateThread, &pool->workers[worker_idx].thread, NULL, threadPoolWorkerRoutine, &pool->workers[worker_idx]) ))
+            break;
+
+        ++pool->workers_num;
+    }
+
+    if(pool->workers_num > 0 && mapCPUsToWorkers(pool) < 0)
+    {
+        threadPoolDestroy(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+// Waits for every pending task, then for workers to end.
+void threadPoolDestroy(THREAD_POOL* pool)
+{
+    if(pool == NULL)
+        return;
+
+    threadPoolWait(pool);
+
+    pthread_mutex_lock(&pool->idle_lock);
+    atomic_store(&pool->stop, 1);
+    pthread_cond_broadcast(&pool->idle_cond);
+    pthread_mutex_unlock(&pool->idle_lock);
+
+    for(unsigned int worker_idx = 0; worker_idx < pool->workers_num; worker_idx++)
+        pthread_join(pool->workers[worker_idx].thread, NULL);
+
+    for(unsigned int worker_idx = 0; worker_idx < pool->granted_slots; worker_idx++)
+    {
+        for(int priority = 0; priority < THREAD_POOL_PRIORITIES_NUM; priority++)
+            free(pool->workers[worker_idx].queue.rings[priority].tasks);
+
+        free(pool->workers[worker_idx].steal_order);
+        pthread_mutex_destroy(&pool->workers[worker_idx].queue.lock);
+    }
+
+    threadBudgetRelease(pool->granted_slots, pool->workers_num);
+
+    pthread_mutex_destroy(&pool->idle_lock);
+    pthread_cond_destroy(&pool->idle_cond);
+    pthread_mutex_destroy(&pool->done_lock);
+    pthread_cond_destroy(&pool->done_cond);
+    pthread_mutex_destroy(&pool->deadlines.lock);
+
+    free(pool->deadlines.tasks);
+    free(pool->cpu_workers);
+    free(pool->workers);
+    free(pool);
+}
+
+// Returns -1 if the task could not be queued. Tasks may submit further tasks to the same pool.
+int threadPoolSubmit(THREAD_POOL* pool, THREAD_POOL_TASK_ROUTINE routine, void* arg, int cpu_hint)
+{
+    return threadPoolSubmitWithPriority(pool, routine, arg, cpu_hint, THREAD_POOL_PRIORITY_NORMAL);
+}
+
+int threadPoolSubmitWithPriority(THREAD_POOL* pool, THREAD_POOL_TASK_ROUTINE routine, void* arg, int cpu_hint, int priority)
+{
+    if(pool == NULL || routine == NULL || priority < THREAD_POOL_PRIORITY_HIGH || priority >= THREAD_POOL_PRIORITIES_NUM)
+        return -1;
+
+    atomic_fetch_add(&pool->submitted, 1);
+
+    // Without workers, the submitting thread does the job itself.
+    if(pool->workers_num == 0)
+    {
+        routine(arg);
+        atomic_fetch_add(&pool->inline_executed, 1);
+        return 0;
+    }
+
+    THREAD_POOL_TASK task =
+    {
+        .routine            = routine                       ,
+        .arg                = arg                           ,
+        .preferred_worker   = -1                            ,
+        .priority           = priority                      ,
+        .submit_time_ns     = latencyHistogramGetTimeNs()   ,
+    };
+
+    unsigned int target;
+
+    if(cpu_hint >= 0)
+    {
+        target = ((unsigned int)cpu_hint < pool->cpus_num ? (unsigned int)pool->cpu_workers[cpu_hint] : (unsigned int)cpu_hint % pool->workers_num);
+        task.preferred_worker = (int)target;
+    }
+    else if(current_worker != NULL && current_worker->pool == pool)
+    {
+        target = current_worker->idx;
+        task.preferred_worker = (int)target;
+        task.spawned = 1;
+    }
+    else
+        target = atomic_fetch_add(&pool->next_worker, 1) % pool->workers_num;
+
+    atomic_fetch_add(&pool->pending, 1);
+
+    if(pushTask(&pool->workers[target].queue, &task) < 0)
+    {
+        finishTask(pool);
+        return -1;
+    }
+
+    if(task.preferred_worker >= 0)
+        atomic_fetch_add(&pool->preferred, 1);
+
+    atomic_fetch_add(&pool->queued_priorities[priority], 1);
+    atomic_fetch_add(&pool->queued, 1);
+    metricsExporterAdd(queued_metric, 1);
+
+    wakeWorker(pool);
+
+    return 0;
+}
+
+// Tasks run by the submitting thread itself (if no worker could be created) are not accounted as met nor missed.
+int threadPoolSubmitWithDeadline(THREAD_POOL* pool, THREAD_POOL_TASK_ROUTINE routine, void* arg, unsigned long long deadline_ns, unsigned long long cost_ns)
+{
+    if(pool == NULL || routine == NULL || deadline_ns == 0)
+        return -1;
+
+    atomic_fetch_add(&pool->submitted, 1);
+
+    if(pool->workers_num == 0)
+    {
+        routine(arg);
+        atomic_fetch_add(&pool->inline_executed, 1);
+        return 0;
+    }
+
+    THREAD_POOL_TASK task =
+    {
+        .routine            = routine                       ,
+        .arg                = arg                           ,
+        .preferred_worker   = -1                            ,
+        .priority           = THREAD_POOL_PRIORITY_HIGH     ,
+        .submit_time_ns     = latencyHistogramGetTimeNs()   ,
+        .deadline_ns        = deadline_ns                   ,
+        .cost_ns            = cost_ns                       ,
+    };
+
+    task.key_ns = (atomic_load(&pool->deadline_policy) == THREAD_POOL_DEADLINE_EDF ? task.deadline_ns : task.submit_time_ns);
+
+    atomic_fetch_add(&pool->pending, 1);
+
+    if(pushHeapTask(&pool->deadlines, &task) < 0)
+    {
+        finishTask(pool);
+        return -1;
+    }
+
+    atomic_fetch_add(&pool->queued_deadlines, 1);
+    atomic_fetch_add(&pool->queued, 1);
+    metricsExporterAdd(queued_metric, 1);
+
+    wakeWorker(pool);
+
+    return 0;
+}
+
+// Changing the policy while deadline tasks are queued leaves them ordered as they were submitted.
+void threadPoolSetDeadlineScheduling(THREAD_POOL* pool, int policy, int shed_hopeless)
+{
+    if(pool == NULL)
+        return;
+
+    atomic_store(&pool->deadline_policy, (policy == THREAD_POOL_DEADLINE_FIFO ? THREAD_POOL_DEADLINE_FIFO : THREAD_POOL_DEADLINE_EDF));
+    atomic_store(&pool->shed_hopeless, (shed_hopeless != 0));
+}
+
+// A period of 0 disables aging, so that lower priority tasks are only run once no higher priority ones are left.
+void threadPoolSetAging(THREAD_POOL* pool, unsigned int aging_ms)
+{
+    if(pool != NULL)
+        atomic_store(&pool->aging_ns, aging_ms * NS_PER_MSEC);
+}
+
+// Must not be called from within a task, which would wait for itself.
+void threadPoolWait(THREAD_POOL* pool)
+{
+    if(pool == NULL)
+        return;
+
+    pthread_mutex_lock(&pool->done_lock);
+
+    while(atomic_load(&pool->pending) > 0)
+        pthread_cond_wait(&pool->done_cond, &pool->done_lock);
+
+    pthread_mutex_unlock(&pool->done_lock);
+}
+
+unsigned int threadPoolGetWorkersNum(const THREAD_POOL* pool)
+{
+    return (pool != NULL ? pool->workers_num : 0);
+}
+
+// Returns -1 if there is no such worker.
+int threadPoolGetWorkerCPU(const THREAD_POOL* pool, unsigned int worker_idx)
+{
+    if(pool == NULL || worker_idx >= pool->workers_num)
+        return -1;
+
+    return pool->workers[worker_idx].topology.cpu;
+}
+
+// Returns -1 if not called from one of the pool's workers.
+int threadPoolGetCurrentWorker(const THREAD_POOL* pool)
+{
+    if(current_worker == NULL || current_worker->pool != pool)
+        return -1;
+
+    return (int)current_worker->idx;
+}
+
+void threadPoolGetStats(const THREAD_POOL* pool, THREAD_POOL_STATS* stats)
+{
+    if(stats == NULL)
+        return;
+
+    memset(stats, 0, sizeof(THREAD_POOL_STATS));
+
+    if(pool == NULL)
+        return;
+
+    stats->submitted    = atomic_load(&pool->submitted)         ;
+    stats->executed     = atomic_load(&pool->inline_executed)   ;
+    stats->preferred    = atomic_load(&pool->preferred)         ;
+    stats->workers_num  = pool->workers_num                     ;
+
+    // Tasks run by the submitting thread itself are not told apart by priority.
+
+    for(unsigned int worker_idx = 0; worker_idx < pool->workers_num; worker_idx++)
+    {
+        THREAD_POOL_WORKER* worker = &pool->workers[worker_idx];
+
+        stats->executed += atomic_load_explicit(&worker->executed, memory_order_relaxed);
+        stats->local    += atomic_load_explicit(&worker->local, memory_order_relaxed);
+
+        for(int distance = 0; distance < THREAD_POOL_DISTANCES_NUM; distance++)
+            stats->stolen[distance] += atomic_load_explicit(&worker->stolen[distance], memory_order_relaxed);
+
+        for(int priority = 0; priority < THREAD_POOL_PRIORITIES_NUM; priority++)
+            stats->executed_by_priority[priority] += atomic_load_explicit(&worker->prioritized[priority], memory_order_relaxed);
+
+        stats->aged += atomic_load_explicit(&worker->aged, memory_order_relaxed);
+
+        stats->deadlines_met    += atomic_load_explicit(&worker->deadlines_met, memory_order_relaxed)       ;
+        stats->deadlines_missed += atomic_load_explicit(&worker->deadlines_missed, memory_order_relaxed)    ;
+        stats->deadlines_shed   += atomic_load_explicit(&worker->deadlines_shed, memory_order_relaxed)      ;
+        stats->lateness_ns      += atomic_load_explicit(&worker->lateness_ns, memory_order_relaxed)         ;
+
+        if(atomic_load(&worker->pinned))
+            ++stats->pinned_workers_num;
+    }
+}
+
+void threadPoolPrintStats(const THREAD_POOL* pool)
+{
+    THREAD_POOL_STATS stats;
+    threadPoolGetStats(pool, &stats);
+
+    printf("%sThread pool: %u worker(s) (%u pinned), %llu task(s) run, locality hit rate %.1f%% (%llu/%llu preferred), stolen from same CPU or core %llu, same node %llu, remote %llu.%s\r\n",
+            PRINT_COLOR_YELLOW                                                                  ,
+            stats.workers_num                                                                   ,
+            stats.pinned_workers_num                                                            ,
+            stats.executed                                                                      ,
+            (stats.preferred > 0 ? 100.0 * stats.local / stats.preferred : 0.0)                 ,
+            stats.local                                                                         ,
+            stats.preferred                                                                     ,
+            stats.stolen[THREAD_POOL_DISTANCE_CPU] + stats.stolen[THREAD_POOL_DISTANCE_CORE]    ,
+            stats.stolen[THREAD_POOL_DISTANCE_NODE]                                             ,
+            stats.stolen[THREAD_POOL_DISTANCE_REMOTE]                                           ,
+            PRINT_COLOR_RESET                                                                   );
+
+    unsigned long long deadline_tasks = stats.deadlines_met + stats.deadlines_missed + stats.deadlines_shed;
+
+    if(deadline_tasks > 0)
+        printf("%sDeadline tasks (%s%s): %llu met, %llu missed (%.1f%%, %.2f ms late on average), %llu shed (%.1f%%).%s\r\n",
+                PRINT_COLOR_YELLOW                                                                                  ,
+                (atomic_load(&pool->deadline_policy) == THREAD_POOL_DEADLINE_EDF ? "EDF" : "FIFO")                  ,
+                (atomic_load(&pool->shed_hopeless) ? ", shedding hopeless tasks" : "")                              ,
+                stats.deadlines_met                                                                                 ,
+                stats.deadlines_missed                                                                              ,
+                100.0 * stats.deadlines_missed / deadline_tasks                                                     ,
+                (stats.deadlines_missed > 0 ? (double)stats.lateness_ns / stats.deadlines_missed / NS_PER_MSEC : 0.0),
+                stats.deadlines_shed                                                                                ,
+                100.0 * stats.deadlines_shed / deadline_tasks                                                       ,
+                PRINT_COLOR_RESET                                                                                   );
+
+    if(stats.executed_by_priority[THREAD_POOL_PRIORITY_HIGH] + stats.executed_by_priority[THREAD_POOL_PRIORITY_LOW] == 0)
+        return;
+
+    printf("%sTasks run by priority: high %llu, normal %llu, low %llu (%llu of them run ahead of higher priorities after aging).%s\r\n",
+            PRINT_COLOR_YELLOW                                          ,
+            stats.executed_by_priority[THREAD_POOL_PRIORITY_HIGH]       ,
+            stats.executed_by_priority[THREAD_POOL_PRIORITY_NORMAL]     ,
+            stats.executed_by_priority[THREAD_POOL_PRIORITY_LOW]        ,
+            stats.aged                                                  ,
+            PRINT_COLOR_RESET                                           );
+}
+
+/**************************************/
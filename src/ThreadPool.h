@@ -0,0 +1,75 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+/********* Include statements *********/
+
+#include <stdio.h>
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define THREAD_POOL_NO_HINT         (-1)    // Tasks submitted without a CPU they would rather run on.
+
+#define THREAD_POOL_DISTANCE_CPU    0       // Same CPU.
+#define THREAD_POOL_DISTANCE_CORE   1       // Hardware threads of the same core, sharing its L1 and L2 caches.
+#define THREAD_POOL_DISTANCE_NODE   2       // Same NUMA node (or package, if nodes are unknown), sharing memory and usually L3.
+#define THREAD_POOL_DISTANCE_REMOTE 3       // Anywhere else.
+#define THREAD_POOL_DISTANCES_NUM   4
+
+#define THREAD_POOL_PRIORITY_HIGH   0
+#define THREAD_POOL_PRIORITY_NORMAL 1       // Used by threadPoolSubmit.
+#define THREAD_POOL_PRIORITY_LOW    2
+#define THREAD_POOL_PRIORITIES_NUM  3
+
+#define THREAD_POOL_DEFAULT_AGING_MS 100    // Tasks waiting for longer than this times their priority go first.
+
+#define THREAD_POOL_DEADLINE_FIFO   0       // Deadline tasks run in submission order.
+#define THREAD_POOL_DEADLINE_EDF    1       // Earliest deadline first (default).
+
+/**************************************/
+
+/********** Type definitions **********/
+
+typedef struct THREAD_POOL THREAD_POOL;
+
+typedef void (*THREAD_POOL_TASK_ROUTINE)(void* arg);
+
+typedef struct
+{
+    unsigned long long  submitted                               ;
+    unsigned long long  executed                                ;
+    unsigned long long  preferred                               ;   // Tasks which had a worker they would rather run on.
+    unsigned long long  local                                   ;   // Preferred tasks run by that very worker.
+    unsigned long long  stolen[THREAD_POOL_DISTANCES_NUM]       ;   // Tasks taken from other workers' queues, by distance.
+    unsigned long long  executed_by_priority[THREAD_POOL_PRIORITIES_NUM];   // Tasks run by workers, by priority.
+    unsigned long long  aged                                    ;   // Lower priority tasks run first since they waited too long.
+    unsigned long long  deadlines_met                           ;
+    unsigned long long  deadlines_missed                        ;
+    unsigned long long  deadlines_shed                          ;   // Dropped, as they could not have met their deadlines.
+    unsigned long long  lateness_ns                             ;   // Summed over missed deadlines.
+    unsigned int        workers_num                             ;
+    unsigned int        pinned_workers_num                      ;
+} THREAD_POOL_STATS;
+
+/**************************************/
+
+/********* Function prototypes ********/
+
+THREAD_POOL*    threadPoolCreate(unsigned int workers_num);
+void            threadPoolDestroy(THREAD_POOL* pool);
+int             threadPoolSubmit(THREAD_POOL* pool, THREAD_POOL_TASK_ROUTINE routine, void* arg, int cpu_hint);
+int             threadPoolSubmitWithPriority(THREAD_POOL* pool, THREAD_POOL_TASK_ROUTINE routine, void* arg, int cpu_hint, int priority);
+void            threadPoolSetAging(THREAD_POOL* pool, unsigned int aging_ms);
+int             threadPoolSubmitWithDeadline(THREAD_POOL* pool, THREAD_POOL_TASK_ROUTINE routine, void* arg, unsigned long long deadline_ns, unsigned long long cost_ns);
+void            threadPoolSetDeadlineScheduling(THREAD_POOL* pool, int policy, int shed_hopeless);
+void            threadPoolWait(THREAD_POOL* pool);
+unsigned int    threadPoolGetWorkersNum(const THREAD_POOL* pool);
+int             threadPoolGetWorkerCPU(const THREAD_POOL* pool, unsigned int worker_idx);
+int             threadPoolGetCurrentWorker(const THREAD_POOL* pool);
+void            threadPoolGetStats(const THREAD_POOL* pool, THREAD_POOL_STATS* stats);
+void            threadPoolPrintStats(const THREAD_POOL* pool);
+
+/**************************************/
+
+#endif
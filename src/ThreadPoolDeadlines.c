@@ -0,0 +1,189 @@
+/*
+ThreadsWithTimedWait.c and ThreadsWithTimedMutex.c deal with deadlines as timeouts: a thread gives up waiting once its deadline
+has passed. Deadlines can rather drive scheduling, so that work due sooner is done first. The thread pool (see ThreadPool.c) takes
+tasks with an absolute deadline and an expected cost:
+
+int threadPoolSubmitWithDeadline(THREAD_POOL* pool, THREAD_POOL_TASK_ROUTINE routine, void* arg, unsigned long long deadline_ns, unsigned long long cost_ns)
+
+This lesson overloads a pool on purpose: tasks (taking 100 to 500 us each) arrive at a pace which asks the workers for 25% more
+time than they have, and each of them is due 2 to 20 ms after arriving. The very same tasks, arriving at the very same times, are
+then scheduled in three ways:
+    ·FIFO: tasks run in arrival order. The backlog grows steadily, so tasks wait longer and longer, whatever their deadlines.
+    ·EDF (earliest deadline first): tasks due sooner run first. Tasks with tight deadlines are favoured, but those which can no
+    longer make it are run anyway, and make others late in turn.
+    ·EDF shedding hopeless tasks: tasks which cannot end in time by the time a worker would start them are dropped instead.
+
+Miss and shed rates are printed for each of them. With no overload at all (such as with fewer tasks than workers can handle),
+EDF would meet every deadline, which is what makes it optimal for single CPUs. The number of tasks is the "iterations" lesson
+parameter, and the number of workers the "threads" one.
+*/
+
+/********* Include statements *********/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <time.h>
+#include "ThreadColors.h"
+#include "ThreadPool.h"
+#include "LatencyHistogram.h"
+#include "LessonParameters.h"
+#include "ThreadPoolDeadlines.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define DEFAULT_DEADLINE_TASKS  600
+#define MIN_TASK_COST_NS        100000ULL   // 100 us.
+#define MAX_TASK_COST_NS        500000ULL   // 500 us.
+#define MIN_RELATIVE_DEADLINE   2000000ULL  // 2 ms.
+#define MAX_RELATIVE_DEADLINE   20000000ULL // 20 ms.
+#define LOAD_PERCENT            125         // Work asked for, relative to the time workers have.
+#define WORKLOAD_SEED           12345       // Same workload for every scenario.
+#define NS_PER_SEC              1000000000ULL
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+typedef struct
+{
+    unsigned long long  arrival_ns          ;   // Since the scenario started.
+    unsigned long long  cost_ns             ;
+    unsigned long long  relative_deadline_ns;
+} DEADLINE_TASK_DATA;
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static void                 deadlineTask(void* arg);
+static void                 createWorkload(DEADLINE_TASK_DATA* tasks, unsigned int tasks_num, unsigned int workers_num);
+static unsigned long long   getRandomValue(unsigned int* seed, unsigned long long min_val, unsigned long long max_val);
+static void                 sleepUntil(unsigned long long time_ns);
+static void                 runScenario(const DEADLINE_TASK_DATA* tasks, unsigned int tasks_num, unsigned int workers_num, int policy, int shed_hopeless);
+static unsigned int         getAvailableCPUs();
+
+/**************************************/
+
+/******** Function definitions ********/
+
+// Busy work for as long as the task's cost.
+static void deadlineTask(void* arg)
+{
+    const DEADLINE_TASK_DATA* task = (const DEADLINE_TASK_DATA*)arg;
+    unsigned long long start_ns = latencyHistogramGetTimeNs();
+
+    while(latencyHistogramGetTimeNs() - start_ns < task->cost_ns);
+}
+
+static unsigned long long getRandomValue(unsigned int* seed, unsigned long long min_val, unsigned long long max_val)
+{
+    return min_val + (unsigned long long)rand_r(seed) % (max_val - min_val + 1);
+}
+
+// Tasks arrive as soon as the work asked for by the previous ones (spread over every worker, and scaled by the load) has been
+// given time to be done.
+static void createWorkload(DEADLINE_TASK_DATA* tasks, unsigned int tasks_num, unsigned int workers_num)
+{
+    unsigned int seed = WORKLOAD_SEED;
+    unsigned long long arrival_ns = 0;
+
+    for(unsigned int task_idx = 0; task_idx < tasks_num; task_idx++)
+    {
+        tasks[task_idx].arrival_ns              = arrival_ns                                                            ;
+        tasks[task_idx].cost_ns                 = getRandomValue(&seed, MIN_TASK_COST_NS, MAX_TASK_COST_NS)             ;
+        tasks[task_idx].relative_deadline_ns    = getRandomValue(&seed, MIN_RELATIVE_DEADLINE, MAX_RELATIVE_DEADLINE)   ;
+
+        arrival_ns += tasks[task_idx].cost_ns * 100 / (LOAD_PERCENT * workers_num);
+    }
+}
+
+static void sleepUntil(unsigned long long time_ns)
+{
+    struct timespec wake_up = { .tv_sec = (time_t)(time_ns / NS_PER_SEC), .tv_nsec = (long)(time_ns % NS_PER_SEC) };
+
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake_up, NULL) != 0);
+}
+
+static void runScenario(const DEADLINE_TASK_DATA* tasks, unsigned int tasks_num, unsigned int workers_num, int policy, int shed_hopeless)
+{
+    THREAD_POOL* pool = threadPoolCreate(workers_num);
+
+    if(pool == NULL)
+    {
+        printf("%sCould not create the thread pool, so the procedure cannot go on.%s\r\n", PRINT_COLOR_RED, PRINT_COLOR_RESET);
+        return;
+    }
+
+    threadPoolSetDeadlineScheduling(pool, policy, shed_hopeless);
+
+    unsigned long long start_ns = latencyHistogramGetTimeNs();
+
+    // Every task which has arrived by now is submitted, then the main thread sleeps until the next one arrives.
+    for(unsigned int task_idx = 0; task_idx < tasks_num; task_idx++)
+    {
+        if(latencyHistogramGetTimeNs() < start_ns + tasks[task_idx].arrival_ns)
+            sleepUntil(start_ns + tasks[task_idx].arrival_ns);
+
+        unsigned long long deadline_ns = start_ns + tasks[task_idx].arrival_ns + tasks[task_idx].relative_deadline_ns;
+
+        if(threadPoolSubmitWithDeadline(pool, deadlineTask, (void*)&tasks[task_idx], deadline_ns, tasks[task_idx].cost_ns) < 0)
+            deadlineTask((void*)&tasks[task_idx]);
+    }
+
+    threadPoolWait(pool);
+    threadPoolPrintStats(pool);
+    threadPoolDestroy(pool);
+}
+
+static unsigned int getAvailableCPUs()
+{
+    cpu_set_t cpu_set;
+
+    if(sched_getaffinity(0, sizeof(cpu_set), &cpu_set) < 0)
+        return 1;
+
+    int cpus_num = CPU_COUNT(&cpu_set);
+
+    return (cpus_num > 0 ? (unsigned int)cpus_num : 1);
+}
+
+void exampleThreadPoolDeadlines()
+{
+    // The number of tasks and workers can be given as lesson parameters (see LessonParameters.c). Workers are one per available
+    // CPU otherwise, so that the load is the one intended.
+    unsigned int tasks_num = (unsigned int)getLessonParameter(LESSON_PARAM_ITERATIONS, DEFAULT_DEADLINE_TASKS);
+    unsigned int workers_num = (unsigned int)getLessonParameter(LESSON_PARAM_THREADS, getAvailableCPUs());
+
+    if(workers_num == 0)
+        workers_num = 1;
+
+    DEADLINE_TASK_DATA* tasks = (DEADLINE_TASK_DATA*)malloc(tasks_num * sizeof(DEADLINE_TASK_DATA));
+
+    if(tasks == NULL)
+    {
+        printf("%sCould not allocate tasks, so the procedure cannot go on.%s\r\n", PRINT_COLOR_RED, PRINT_COLOR_RESET);
+        return;
+    }
+
+    createWorkload(tasks, tasks_num, workers_num);
+
+    printf("%s%u task(s) on %u worker(s), asking for %d%% of the workers' time.%s\r\n",
+            PRINT_COLOR_GREEN   ,
+            tasks_num           ,
+            workers_num         ,
+            LOAD_PERCENT        ,
+            PRINT_COLOR_RESET   );
+
+    runScenario(tasks, tasks_num, workers_num, THREAD_POOL_DEADLINE_FIFO, 0);
+    runScenario(tasks, tasks_num, workers_num, THREAD_POOL_DEADLINE_EDF, 0);
+    runScenario(tasks, tasks_num, workers_num, THREAD_POOL_DEADLINE_EDF, 1);
+
+    free(tasks);
+}
+
+/**************************************/
@@ -0,0 +1,10 @@
+#ifndef THREAD_POOL_DEADLINES_H
+#define THREAD_POOL_DEADLINES_H
+
+/********* Function prototypes ********/
+
+void exampleThreadPoolDeadlines();
+
+/**************************************/
+
+#endif
@@ -0,0 +1,175 @@
+/*
+ThreadsWithAttributes.c asks the kernel to run some threads ahead of others through a real-time scheduling policy (SCHED_RR), which
+takes privileges (CAP_SYS_NICE, or being root) most processes do not have. Besides, what usually needs to go first is a piece of
+work rather than a whole thread. The thread pool (see ThreadPool.c) lets tasks be submitted with a priority instead:
+
+int threadPoolSubmitWithPriority(THREAD_POOL* pool, THREAD_POOL_TASK_ROUTINE routine, void* arg, int cpu_hint, int priority)
+
+This lesson floods a pool with short low priority tasks (a backlog of a few hundred per worker), then submits a steady trickle of
+high priority ones while the backlog is being worked through, and records how long each high priority task waited from its
+submission until a worker started it. The same is done twice:
+    ·With priorities: high priority tasks go ahead of every queued low priority one, so they only wait for the tasks being run
+    right then to end.
+    ·Without them (every task submitted as low priority, which is what a plain FIFO queue does): high priority tasks wait behind
+    the whole backlog submitted before them.
+
+Tail latencies (99th percentile and maximum) are what tell both apart. Priorities are not preemptive, so no high priority task waits
+for less than a low priority task takes, and low priority tasks which waited for too long still get their turn (see aging in
+ThreadPool.c). The number of high priority tasks is the "iterations" lesson parameter, and the number of workers the "threads" one.
+*/
+
+/********* Include statements *********/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <sched.h>
+#include <time.h>
+#include "ThreadColors.h"
+#include "ThreadPool.h"
+#include "LatencyHistogram.h"
+#include "LessonParameters.h"
+#include "ThreadPoolPriorities.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define DEFAULT_HIGH_PRIORITY_TASKS     200
+#define LOW_PRIORITY_TASKS_PER_WORKER   500
+#define LOW_PRIORITY_TASK_NS            200000ULL   // 200 us of busy work.
+#define HIGH_PRIORITY_TASK_NS           20000ULL    // 20 us of busy work.
+#define HIGH_PRIORITY_INTERVAL_NS       500000L     // Time between high priority submissions.
+#define MAX_HIGH_PRIORITY_TASKS         10000
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+typedef struct
+{
+    unsigned long long  submit_time_ns  ;
+    LATENCY_HISTOGRAM*  waits           ;
+} HIGH_PRIORITY_TASK_DATA;
+
+/**************************************/
+
+/********* Private variables **********/
+
+static LATENCY_HISTOGRAM            high_priority_waits;
+static HIGH_PRIORITY_TASK_DATA      high_priority_tasks[MAX_HIGH_PRIORITY_TASKS];
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static void         spin(unsigned long long duration_ns);
+static void         lowPriorityTask(void* arg);
+static void         highPriorityTask(void* arg);
+static void         runScenario(const char* name, unsigned int workers_num, unsigned int high_tasks_num, int high_priority);
+static unsigned int getAvailableCPUs();
+
+/**************************************/
+
+/******** Function definitions ********/
+
+// Busy work, so that tasks hold their worker for a known time.
+static void spin(unsigned long long duration_ns)
+{
+    unsigned long long start_ns = latencyHistogramGetTimeNs();
+
+    while(latencyHistogramGetTimeNs() - start_ns < duration_ns);
+}
+
+static void lowPriorityTask(void* arg)
+{
+    (void)arg;
+
+    spin(LOW_PRIORITY_TASK_NS);
+}
+
+static void highPriorityTask(void* arg)
+{
+    HIGH_PRIORITY_TASK_DATA* task = (HIGH_PRIORITY_TASK_DATA*)arg;
+
+    latencyHistogramRecord(task->waits, latencyHistogramGetTimeNs() - task->submit_time_ns);
+
+    spin(HIGH_PRIORITY_TASK_NS);
+}
+
+// "high_priority" tells whether urgent tasks are actually submitted as such, or just as any other task.
+static void runScenario(const char* name, unsigned int workers_num, unsigned int high_tasks_num, int high_priority)
+{
+    THREAD_POOL* pool = threadPoolCreate(workers_num);
+
+    if(pool == NULL)
+    {
+        printf("%sCould not create the thread pool, so the procedure cannot go on.%s\r\n", PRINT_COLOR_RED, PRINT_COLOR_RESET);
+        return;
+    }
+
+    latencyHistogramReset(&high_priority_waits);
+
+    unsigned int low_tasks_num = LOW_PRIORITY_TASKS_PER_WORKER * (threadPoolGetWorkersNum(pool) > 0 ? threadPoolGetWorkersNum(pool) : 1);
+
+    for(unsigned int task_idx = 0; task_idx < low_tasks_num; task_idx++)
+        if(threadPoolSubmitWithPriority(pool, lowPriorityTask, NULL, THREAD_POOL_NO_HINT, THREAD_POOL_PRIORITY_LOW) < 0)
+            lowPriorityTask(NULL);
+
+    struct timespec interval = { .tv_sec = 0, .tv_nsec = HIGH_PRIORITY_INTERVAL_NS };
+
+    for(unsigned int task_idx = 0; task_idx < high_tasks_num; task_idx++)
+    {
+        nanosleep(&interval, NULL);
+
+        HIGH_PRIORITY_TASK_DATA* task = &high_priority_tasks[task_idx];
+
+        task->waits             = &high_priority_waits          ;
+        task->submit_time_ns    = latencyHistogramGetTimeNs()   ;
+
+        if(threadPoolSubmitWithPriority(pool, highPriorityTask, task, THREAD_POOL_NO_HINT, (high_priority ? THREAD_POOL_PRIORITY_HIGH : THREAD_POOL_PRIORITY_LOW)) < 0)
+            highPriorityTask(task);
+    }
+
+    threadPoolWait(pool);
+
+    printf("%s%s: %u low priority task(s), %u high priority task(s) on %u worker(s).%s\r\n",
+            PRINT_COLOR_GREEN               ,
+            name                            ,
+            low_tasks_num                   ,
+            high_tasks_num                  ,
+            threadPoolGetWorkersNum(pool)   ,
+            PRINT_COLOR_RESET               );
+
+    latencyHistogramPrint(stdout, "High priority task waits", &high_priority_waits);
+    threadPoolPrintStats(pool);
+    threadPoolDestroy(pool);
+}
+
+static unsigned int getAvailableCPUs()
+{
+    cpu_set_t cpu_set;
+
+    if(sched_getaffinity(0, sizeof(cpu_set), &cpu_set) < 0)
+        return 1;
+
+    int cpus_num = CPU_COUNT(&cpu_set);
+
+    return (cpus_num > 0 ? (unsigned int)cpus_num : 1);
+}
+
+void exampleThreadPoolPriorities()
+{
+    // The number of high priority tasks and workers can be given as lesson parameters (see LessonParameters.c). Workers are one
+    // per available CPU otherwise, so that they compete with each other rather than with the kernel's scheduler.
+    unsigned int high_tasks_num = (unsigned int)getLessonParameter(LESSON_PARAM_ITERATIONS, DEFAULT_HIGH_PRIORITY_TASKS);
+    unsigned int workers_num = (unsigned int)getLessonParameter(LESSON_PARAM_THREADS, getAvailableCPUs());
+
+    if(high_tasks_num > MAX_HIGH_PRIORITY_TASKS)
+        high_tasks_num = MAX_HIGH_PRIORITY_TASKS;
+
+    runScenario("With priorities", workers_num, high_tasks_num, 1);
+    runScenario("Without priorities (FIFO)", workers_num, high_tasks_num, 0);
+}
+
+/**************************************/
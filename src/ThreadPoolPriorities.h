@@ -0,0 +1,10 @@
+#ifndef THREAD_POOL_PRIORITIES_H
+#define THREAD_POOL_PRIORITIES_H
+
+/********* Function prototypes ********/
+
+void exampleThreadPoolPriorities();
+
+/**************************************/
+
+#endif
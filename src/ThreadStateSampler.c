@@ -0,0 +1,434 @@
+/*
+A thread which is not running is either waiting for a CPU (it is runnable, but every CPU is busy) or blocked (sleeping, or waiting
+on a lock, a barrier, a condition variable, I/O...). Telling these apart shows whether a lesson is limited by the CPUs it has or by
+its threads waiting for each other, such as the countUntilLimit threads in ThreadsWithBarrier.c which finish counting at different
+times and then sit blocked on the barrier.
+
+Linux tells how every thread of a process is doing through /proc/self/task/<TID>/:
+    ·stat: among many other fields, the thread's name (as set by pthread_setname_np, 15 characters at most) and its current state
+    (R: running or runnable, S: sleeping, D: uninterruptible wait, usually I/O, and so on).
+    ·schedstat: three numbers, the time the thread spent on a CPU and the time it spent runnable but waiting for one (both in
+    nanoseconds, since the thread started), and the number of times it got a CPU.
+
+A monitor thread reads those files every period (THREAD_STATE_SAMPLER_DEFAULT_PERIOD_MS by default). For each thread and period,
+the differences between consecutive readings tell which fraction of the period the thread spent on a CPU and in the run queue; the
+rest of it, the thread was blocked. No lesson code runs while sampling, and a couple of small files are read per thread and period,
+so the overhead is low and the lessons need not be changed at all. Periods are summed up per thread into a summary, and can be
+written as a timeline (CSV) as well:
+
+time_ms,lesson,tid,name,state,on_cpu,run_queue,blocked
+120.532,barrier,4242,countUntilLimit,S,0.000,0.000,1.000
+
+Threads which start and end within a period are never seen, and threads seen for the first time are assumed to have started right
+after the previous reading. Threads are named after their routines if created through TRACED_THREAD_CREATE (see ThreadTracer.h)
+while sampling, and otherwise keep the name they inherited (the program's name).
+*/
+
+/********* Include statements *********/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/syscall.h>
+#include "ThreadStateSampler.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define TASKS_DIRECTORY_PATH    "/proc/self/task"
+#define PROC_FILE_PATH_SIZE     64
+#define PROC_FILE_SIZE          1024
+#define THREAD_NAME_SIZE        16      // Including the terminating null character, as limited by the kernel.
+#define NS_PER_SEC              1000000000ULL
+#define NS_PER_MSEC             1000000ULL
+#define STATES_NUM              3
+#define STATE_INDEX_RUNNING     0
+#define STATE_INDEX_SLEEPING    1
+#define STATE_INDEX_OTHER       2
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+typedef struct
+{
+    pid_t               tid                     ;
+    char                name[THREAD_NAME_SIZE]  ;
+    const char*         label                   ;   // Lesson running when the thread was first seen.
+    unsigned int        generation              ;   // Last reading the thread was seen in.
+    unsigned long long  run_ns                  ;   // Last values read from schedstat.
+    unsigned long long  wait_ns                 ;
+    unsigned long long  sampled_ns              ;   // Totals over every period the thread was seen in.
+    unsigned long long  on_cpu_ns               ;
+    unsigned long long  run_queue_ns            ;
+    unsigned long long  blocked_ns              ;
+    unsigned long       states[STATES_NUM]      ;
+} THREAD_STATE_RECORD;
+
+/**************************************/
+
+/********* Private variables **********/
+
+static pthread_t                monitor_thread;
+static atomic_int               monitor_running;
+static atomic_int               stop_requested;
+static pid_t                    monitor_tid;
+static unsigned long long       sampling_period_ns;
+static unsigned long long       start_time_ns;
+static unsigned long long       last_reading_time_ns;
+static unsigned int             generation;
+static FILE*                    timeline_file;
+static const char* _Atomic      current_label;
+static THREAD_STATE_RECORD*     records;
+static unsigned int             records_num;
+static unsigned int             records_capacity;
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static unsigned long long   getMonotonicTimeNs();
+static int                  readProcFile(pid_t tid, const char* file_name, char* buffer);
+static THREAD_STATE_RECORD* findRecord(pid_t tid);
+static THREAD_STATE_RECORD* addRecord(pid_t tid);
+static int                  getStateIndex(char state);
+static void                 sampleThread(pid_t tid, unsigned long long now_ns, unsigned long long period_ns);
+static void                 sampleThreads();
+static void*                monitorRoutine(void* arg);
+static void                 printPercentage(FILE* stream, unsigned long long part, unsigned long long total);
+
+/**************************************/
+
+/******** Function definitions ********/
+
+static unsigned long long getMonotonicTimeNs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((unsigned long long)now.tv_sec * NS_PER_SEC + (unsigned long long)now.tv_nsec);
+}
+
+// Reads /proc/self/task/<tid>/<file_name> into "buffer" (PROC_FILE_SIZE bytes long), null-terminated. Returns -1 if the thread
+// is already gone.
+static int readProcFile(pid_t tid, const char* file_name, char* buffer)
+{
+    char path[PROC_FILE_PATH_SIZE];
+    snprintf(path, sizeof(path), "%s/%d/%s", TASKS_DIRECTORY_PATH, (int)tid, file_name);
+
+    int fd = open(path, O_RDONLY);
+
+    if(fd < 0)
+        return -1;
+
+    ssize_t size = read(fd, buffer, PROC_FILE_SIZE - 1);
+    close(fd);
+
+    if(size <= 0)
+        return -1;
+
+    buffer[size] = 0;
+
+    return 0;
+}
+
+static THREAD_STATE_RECORD* findRecord(pid_t tid)
+{
+    for(unsigned int record_idx = 0; record_idx < records_num; record_idx++)
+        if(records[record_idx].tid == tid)
+            return &records[record_idx];
+
+    return NULL;
+}
+
+static THREAD_STATE_RECORD* addRecord(pid_t tid)
+{
+    if(records_num == records_capacity)
+    {
+        unsigned int capacity = (records_capacity ? 2 * records_capacity : 32);
+        THREAD_STATE_RECORD* new_records = (THREAD_STATE_RECORD*)realloc(records, capacity * sizeof(THREAD_STATE_RECORD));
+
+        if(new_records == NULL)
+            return NULL;
+
+        records = new_records;
+        records_capacity = capacity;
+    }
+
+    THREAD_STATE_RECORD* record = &records[records_num++];
+    memset(record, 0, sizeof(THREAD_STATE_RECORD));
+
+    record->tid     = tid                           ;
+    record->label   = atomic_load(&current_label)   ;
+
+    return record;
+}
+
+static int getStateIndex(char state)
+{
+    switch(state)
+    {
+        case 'R':   return STATE_INDEX_RUNNING;
+        case 'S':   return STATE_INDEX_SLEEPING;
+        default:    return STATE_INDEX_OTHER;
+    }
+}
+
+// "period_ns" is the time since the previous reading, or 0 for the first one, which just sets the starting point.
+static void sampleThread(pid_t tid, unsigned long long now_ns, unsigned long long period_ns)
+{
+    char stat[PROC_FILE_SIZE], schedstat[PROC_FILE_SIZE];
+    unsigned long long run_ns, wait_ns;
+
+    if(readProcFile(tid, "stat", stat) < 0 || readProcFile(tid, "schedstat", schedstat) < 0)
+        return;
+
+    if(sscanf(schedstat, "%llu %llu", &run_ns, &wait_ns) != 2)
+        return;
+
+    // The name is enclosed in parentheses, and may contain parentheses and spaces itself. The state comes right after it.
+    char* name_start = strchr(stat, '(');
+    char* name_end = strrchr(stat, ')');
+
+    if(name_start == NULL || name_end == NULL || name_end < name_start || name_end[1] == 0 || name_end[2] == 0)
+        return;
+
+    char state = name_end[2];
+    int is_new = 0;
+    THREAD_STATE_RECORD* record = findRecord(tid);
+
+    if(record == NULL)
+    {
+        if((record = addRecord(tid)) == NULL)
+            return;
+
+        is_new = 1;
+    }
+
+    // Names can be changed at any time, so the latest one is kept.
+    size_t name_size = name_end - name_start - 1;
+
+    if(name_size >= THREAD_NAME_SIZE)
+        name_size = THREAD_NAME_SIZE - 1;
+
+    memcpy(record->name, name_start + 1, name_size);
+    record->name[name_size] = 0;
+
+    // Threads seen for the first time after the first reading started within the last period, so their whole times count.
+    unsigned long long run_delta = run_ns - (is_new ? 0 : record->run_ns);
+    unsigned long long wait_delta = wait_ns - (is_new ? 0 : record->wait_ns);
+
+    record->run_ns      = run_ns        ;
+    record->wait_ns     = wait_ns       ;
+    record->generation  = generation    ;
+
+    if(period_ns == 0)
+        return;
+
+    if(run_delta > period_ns)
+        run_delta = period_ns;
+
+    if(wait_delta > period_ns - run_delta)
+        wait_delta = period_ns - run_delta;
+
+    unsigned long long blocked_delta = period_ns - run_delta - wait_delta;
+
+    record->sampled_ns      += period_ns        ;
+    record->on_cpu_ns       += run_delta        ;
+    record->run_queue_ns    += wait_delta       ;
+    record->blocked_ns      += blocked_delta    ;
+    ++record->states[getStateIndex(state)];
+
+    if(timeline_file != NULL)
+    {
+        const char* label = atomic_load(&current_label);
+
+        fprintf(timeline_file, "%.3f,%s,%d,%s,%c,%.3f,%.3f,%.3f\n",
+                (double)(now_ns - start_time_ns) / NS_PER_MSEC  ,
+                (label != NULL ? label : "")                    ,
+                (int)tid                                        ,
+                record->name                                    ,
+                state                                           ,
+                (double)run_delta / period_ns                   ,
+                (double)wait_delta / period_ns                  ,
+                (double)blocked_delta / period_ns               );
+    }
+}
+
+static void sampleThreads()
+{
+    DIR* tasks = opendir(TASKS_DIRECTORY_PATH);
+
+    if(tasks == NULL)
+        return;
+
+    unsigned long long now_ns = getMonotonicTimeNs();
+    unsigned long long period_ns = (generation > 0 ? now_ns - last_reading_time_ns : 0);
+
+    ++generation;
+
+    for(struct dirent* entry = readdir(tasks); entry != NULL; entry = readdir(tasks))
+    {
+        pid_t tid = (pid_t)atoi(entry->d_name);
+
+        // The monitor thread itself is left out.
+        if(tid > 0 && tid != monitor_tid)
+            sampleThread(tid, now_ns, period_ns);
+    }
+
+    closedir(tasks);
+
+    last_reading_time_ns = now_ns;
+}
+
+static void* monitorRoutine(void* arg)
+{
+    (void)arg;
+
+    monitor_tid = (pid_t)syscall(SYS_gettid);
+    pthread_setname_np(pthread_self(), "stateSampler");
+
+    struct timespec period =
+    {
+        .tv_sec     = sampling_period_ns / NS_PER_SEC,
+        .tv_nsec    = sampling_period_ns % NS_PER_SEC,
+    };
+
+    while(!atomic_load(&stop_requested))
+    {
+        sampleThreads();
+        nanosleep(&period, NULL);
+    }
+
+    // A last reading, so that the last period is accounted for as well.
+    sampleThreads();
+
+    return NULL;
+}
+
+// Starts the monitor thread, which reads every thread's state each "period_ms". The timeline is written to "timeline_path" unless
+// it is NULL. Returns -1 if the sampler could not be started.
+int threadStateSamplerStart(unsigned int period_ms, const char* timeline_path)
+{
+    if(period_ms == 0 || atomic_load(&monitor_running))
+        return -1;
+
+    if(timeline_path != NULL)
+    {
+        timeline_file = fopen(timeline_path, "w");
+
+        if(timeline_file == NULL)
+            return -1;
+
+        fprintf(timeline_file, "time_ms,lesson,tid,name,state,on_cpu,run_queue,blocked\n");
+    }
+
+    sampling_period_ns = (unsigned long long)period_ms * NS_PER_MSEC;
+    start_time_ns = getMonotonicTimeNs();
+    generation = 0;
+    atomic_store(&stop_requested, 0);
+
+    if(pthread_create(&monitor_thread, NULL, monitorRoutine, NULL) != 0)
+    {
+        if(timeline_file != NULL)
+        {
+            fclose(timeline_file);
+            timeline_file = NULL;
+        }
+
+        return -1;
+    }
+
+    atomic_store(&monitor_running, 1);
+
+    return 0;
+}
+
+// Waits for the monitor thread to take its last reading. Returns -1 if the timeline could not be written.
+int threadStateSamplerStop()
+{
+    if(!atomic_load(&monitor_running))
+        return 0;
+
+    atomic_store(&stop_requested, 1);
+    pthread_join(monitor_thread, NULL);
+    atomic_store(&monitor_running, 0);
+
+    if(timeline_file == NULL)
+        return 0;
+
+    int ret = (fclose(timeline_file) == 0 ? 0 : -1);
+    timeline_file = NULL;
+
+    return ret;
+}
+
+int threadStateSamplerIsRunning()
+{
+    return atomic_load(&monitor_running);
+}
+
+// Threads seen for the first time from now on (and timeline lines) are put under "label", which is meant to be the running lesson.
+void threadStateSamplerSetLabel(const char* label)
+{
+    atomic_store(&current_label, label);
+}
+
+// Names the thread just created (if "create_status" tells it was) while sampling, so that it can be told apart from the rest. The
+// name is truncated to what the kernel can keep. Returns "create_status", so that it can wrap thread creation calls.
+int threadStateSamplerNameThread(int create_status, const pthread_t* thread, const char* name)
+{
+    if(create_status != 0 || thread == NULL || name == NULL || !atomic_load(&monitor_running))
+        return create_status;
+
+    char short_name[THREAD_NAME_SIZE];
+    snprintf(short_name, sizeof(short_name), "%s", name);
+
+    pthread_setname_np(*thread, short_name);
+
+    return create_status;
+}
+
+static void printPercentage(FILE* stream, unsigned long long part, unsigned long long total)
+{
+    fprintf(stream, " %9.1f%%", (total ? 100.0 * part / total : 0.0));
+}
+
+// A line per thread ever seen, in the order they were first seen. Must be called once the sampler has been stopped.
+void threadStateSamplerPrintSummary(FILE* stream)
+{
+    if(stream == NULL || atomic_load(&monitor_running))
+        return;
+
+    fprintf(stream, "    %-20s %-16s %8s %10s %10s %10s %11s %8s %8s %8s\r\n", "lesson", "name", "tid", "on CPU", "run queue", "blocked", "sampled", "R", "S", "other");
+
+    for(unsigned int record_idx = 0; record_idx < records_num; record_idx++)
+    {
+        const THREAD_STATE_RECORD* record = &records[record_idx];
+
+        if(record->sampled_ns == 0)
+            continue;
+
+        fprintf(stream, "    %-20s %-16s %8d", (record->label != NULL ? record->label : "-"), record->name, (int)record->tid);
+
+        printPercentage(stream, record->on_cpu_ns   , record->sampled_ns);
+        printPercentage(stream, record->run_queue_ns, record->sampled_ns);
+        printPercentage(stream, record->blocked_ns  , record->sampled_ns);
+
+        fprintf(stream, " %9.3f s %8lu %8lu %8lu\r\n",
+                (double)record->sampled_ns / NS_PER_SEC     ,
+                record->states[STATE_INDEX_RUNNING]         ,
+                record->states[STATE_INDEX_SLEEPING]        ,
+                record->states[STATE_INDEX_OTHER]           );
+    }
+}
+
+/**************************************/
@@ -0,0 +1,28 @@
+#ifndef THREAD_STATE_SAMPLER_H
+#define THREAD_STATE_SAMPLER_H
+
+/********* Include statements *********/
+
+#include <stdio.h>
+#include <pthread.h>
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define THREAD_STATE_SAMPLER_DEFAULT_PERIOD_MS  10
+
+/**************************************/
+
+/********* Function prototypes ********/
+
+int     threadStateSamplerStart(unsigned int period_ms, const char* timeline_path);
+int     threadStateSamplerStop();
+int     threadStateSamplerIsRunning();
+void    threadStateSamplerSetLabel(const char* label);
+int     threadStateSamplerNameThread(int create_status, const pthread_t* thread, const char* name);
+void    threadStateSamplerPrintSummary(FILE* stream);
+
+/**************************************/
+
+#endif
@@ -0,0 +1,609 @@
+/*
+Printed messages tell the order in which things happened within a lesson, but not for how long each thread was running, waiting
+for a lock or holding it. The tracer records timestamped events instead, and writes them in the Chrome trace event format, which is
+displayed as a timeline (a row per thread) by chrome://tracing or https://ui.perfetto.dev:
+
+{ "name": "mutex held", "cat": "mutex", "ph": "B", "ts": 12.345, "pid": 1234, "tid": 1240, "args": { "object": "0x7ffd..." } }
+
+Where:
+    ·ph: event phase. "B" and "E" begin and end a span (such as waiting for a lock), "i" is an instant (such as a semaphore post),
+    and "M" carries metadata (the name of each thread, taken from its routine).
+    ·ts: timestamp in microseconds since tracing started, taken from CLOCK_MONOTONIC. It is read through the vDSO, so no system
+    call is made, and unlike the CPU's time stamp counter it needs no calibration and is comparable across CPUs.
+    ·object: address of the mutex, barrier, condition variable or semaphore, so that waits on the same object can be matched.
+
+What is traced is selected at build time through THREAD_TRACE_LEVEL (see ThreadTracer.h). Lessons use the TRACED_* and
+THREAD_TRACE_* macros, which turn into the plain pthread calls (or into nothing) if their level is not selected, so the tracer costs
+nothing at all when compiled out. To build it in, add -DTHREAD_TRACE_LEVEL=2 (or 1) to the gcc command given in main.c.
+
+Every thread records into a buffer of its own, so no lock is taken while tracing: a thread's buffer is registered (under a mutex)
+just when it records its first event, and buffers are kept until the process ends, so threads outliving the trace (such as detached
+ones) never write into freed memory. The number of events is capped, and events beyond it are counted as dropped.
+
+Thread lifetimes are recorded by starting threads through a trampoline, which begins a span named after the thread's routine and
+ends it on return, pthread_exit or cancellation (by means of a cleanup handler).
+
+Besides (or instead of) events, the duration of every span can be recorded into latency histograms (see LatencyHistogram.c): how
+long threads waited for locks, barriers, condition variables and semaphores, how long locks were held and how long threads and
+lessons ran. Each thread keeps a stack of its open spans and a histogram per kind of span of its own, so recording takes no lock
+either. Histograms of the same kind of span are merged across threads when printed.
+
+Traced mutexes also keep count of how many times they were locked and how many of those they were found already locked (contended),
+whether the tracer was started or not. Both counts are live metrics (see MetricsExporter.c).
+*/
+
+/********* Include statements *********/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include "LatencyHistogram.h"
+#include "MetricsExporter.h"
+#include "ThreadTracer.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define EVENTS_PER_CHUNK    4096
+#define MAX_TRACE_EVENTS    (1024 * 1024)   // About 40 MB. Events beyond this are dropped.
+#define NS_PER_SEC          1000000000ULL
+#define NS_PER_USEC         1000.0
+#define MAIN_THREAD_NAME    "main"
+#define MAX_OPEN_SPANS      16              // Per thread. Deeper spans are not measured.
+#define LATENCY_NAME_SIZE   128
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+typedef struct
+{
+    unsigned long long  timestamp_ns    ;
+    const char*         category        ;
+    const char*         name            ;
+    const void*         object          ;
+    char                phase           ;
+} THREAD_TRACER_EVENT;
+
+typedef struct THREAD_TRACER_CHUNK
+{
+    struct THREAD_TRACER_CHUNK* _Atomic next                ;
+    atomic_uint                 events_num                  ;   // Published after each event is written.
+    THREAD_TRACER_EVENT         events[EVENTS_PER_CHUNK]    ;
+} THREAD_TRACER_CHUNK;
+
+typedef struct
+{
+    const char*         category        ;
+    const char*         name            ;
+    unsigned long long  start_time_ns   ;
+} THREAD_TRACER_OPEN_SPAN;
+
+typedef struct THREAD_TRACER_LATENCY
+{
+    struct THREAD_TRACER_LATENCY*   next        ;
+    const char*                     category    ;
+    const char*                     name        ;
+    LATENCY_HISTOGRAM               histogram   ;
+} THREAD_TRACER_LATENCY;
+
+typedef struct THREAD_TRACER_BUFFER
+{
+    struct THREAD_TRACER_BUFFER*            next                        ;
+    pid_t                                   tid                         ;
+    const char*                             name                        ;   // NULL if the thread was not started through the tracer.
+    THREAD_TRACER_CHUNK* _Atomic            first                       ;
+    THREAD_TRACER_CHUNK*                    last                        ;
+    THREAD_TRACER_LATENCY* _Atomic          latencies                   ;
+    unsigned int                            open_spans_num              ;
+    THREAD_TRACER_OPEN_SPAN                 open_spans[MAX_OPEN_SPANS]  ;
+} THREAD_TRACER_BUFFER;
+
+typedef struct
+{
+    void*       (*start_routine)(void*) ;
+    void*       arg                     ;
+    const char* name                    ;
+} THREAD_TRACER_TRAMPOLINE_DATA;
+
+/**************************************/
+
+/********* Private variables **********/
+
+static pthread_mutex_t                      buffers_lock = PTHREAD_MUTEX_INITIALIZER;
+static THREAD_TRACER_BUFFER* _Atomic        buffers;
+static atomic_int                           events_enabled;
+static atomic_int                           latencies_enabled;
+static atomic_ulong                         recorded_events;
+static atomic_ulong                         dropped_events;
+static unsigned long long                   start_time_ns;
+static _Thread_local THREAD_TRACER_BUFFER*  thread_buffer;
+static _Thread_local const char*            pending_thread_name;
+static pthread_once_t                       mutex_metrics_once = PTHREAD_ONCE_INIT;
+static int                                  mutex_acquisitions_metric = -1;
+static int                                  mutex_contended_metric = -1;
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static unsigned long long       getMonotonicTimeNs();
+static THREAD_TRACER_BUFFER*    getThreadBuffer();
+static void                     recordEvent(THREAD_TRACER_BUFFER* buffer, unsigned long long timestamp_ns, char phase, const char* category, const char* name, const void* object);
+static void                     recordLatency(THREAD_TRACER_BUFFER* buffer, unsigned long long timestamp_ns, char phase, const char* category, const char* name);
+static THREAD_TRACER_LATENCY*   findLatency(THREAD_TRACER_LATENCY* latencies, const char* category, const char* name);
+static int                      mergeLatencies(THREAD_TRACER_LATENCY** merged);
+static void                     freeLatencies(THREAD_TRACER_LATENCY* latencies);
+static void                     recordThreadEnd(void* arg);
+static void*                    trampolineRoutine(void* arg);
+static void                     printJSONString(FILE* stream, const char* text);
+static void                     registerMutexMetrics();
+
+/**************************************/
+
+/******** Function definitions ********/
+
+static unsigned long long getMonotonicTimeNs()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((unsigned long long)now.tv_sec * NS_PER_SEC + (unsigned long long)now.tv_nsec);
+}
+
+static THREAD_TRACER_BUFFER* getThreadBuffer()
+{
+    if(thread_buffer != NULL)
+        return thread_buffer;
+
+    THREAD_TRACER_BUFFER* buffer = (THREAD_TRACER_BUFFER*)calloc(1, sizeof(THREAD_TRACER_BUFFER));
+
+    if(buffer == NULL)
+        return NULL;
+
+    buffer->tid = (pid_t)syscall(SYS_gettid);
+    buffer->name = (buffer->tid == getpid() ? MAIN_THREAD_NAME : pending_thread_name);
+
+    pthread_mutex_lock(&buffers_lock);
+    buffer->next = atomic_load(&buffers);
+    atomic_store(&buffers, buffer);
+    pthread_mutex_unlock(&buffers_lock);
+
+    thread_buffer = buffer;
+
+    return buffer;
+}
+
+static void recordEvent(THREAD_TRACER_BUFFER* buffer, unsigned long long timestamp_ns, char phase, const char* category, const char* name, const void* object)
+{
+    if(atomic_fetch_add_explicit(&recorded_events, 1, memory_order_relaxed) >= MAX_TRACE_EVENTS)
+    {
+        atomic_fetch_add_explicit(&dropped_events, 1, memory_order_relaxed);
+        return;
+    }
+
+    THREAD_TRACER_CHUNK* chunk = buffer->last;
+
+    if(chunk == NULL || atomic_load_explicit(&chunk->events_num, memory_order_relaxed) >= EVENTS_PER_CHUNK)
+    {
+        THREAD_TRACER_CHUNK* new_chunk = (THREAD_TRACER_CHUNK*)calloc(1, sizeof(THREAD_TRACER_CHUNK));
+
+        if(new_chunk == NULL)
+        {
+            atomic_fetch_add_explicit(&dropped_events, 1, memory_order_relaxed);
+            return;
+        }
+
+        if(chunk == NULL)
+            atomic_store(&buffer->first, new_chunk);
+        else
+            chunk->next = new_chunk;
+
+        buffer->last = chunk = new_chunk;
+    }
+
+    unsigned int event_idx = atomic_load_explicit(&chunk->events_num, memory_order_relaxed);
+
+    chunk->events[event_idx] = (THREAD_TRACER_EVENT)
+    {
+        .timestamp_ns   = timestamp_ns  ,
+        .category       = category      ,
+        .name           = name          ,
+        .object         = object        ,
+        .phase          = phase         ,
+    };
+
+    // The writer of the trace just reads events already published.
+    atomic_store_explicit(&chunk->events_num, event_idx + 1, memory_order_release);
+}
+
+// Names are compared as strings, since the same literal may have a different address in each translation unit.
+static THREAD_TRACER_LATENCY* findLatency(THREAD_TRACER_LATENCY* latencies, const char* category, const char* name)
+{
+    for(THREAD_TRACER_LATENCY* latency = latencies; latency != NULL; latency = latency->next)
+        if(strcmp(latency->category, category) == 0 && strcmp(latency->name, name) == 0)
+            return latency;
+
+    return NULL;
+}
+
+// Spans begun before latencies were enabled (or too deeply nested) are just not measured.
+static void recordLatency(THREAD_TRACER_BUFFER* buffer, unsigned long long timestamp_ns, char phase, const char* category, const char* name)
+{
+    if(phase == 'B')
+    {
+        if(buffer->open_spans_num < MAX_OPEN_SPANS)
+            buffer->open_spans[buffer->open_spans_num] = (THREAD_TRACER_OPEN_SPAN){ .category = category, .name = name, .start_time_ns = timestamp_ns };
+
+        ++buffer->open_spans_num;
+        return;
+    }
+
+    if(phase != 'E' || buffer->open_spans_num == 0)
+        return;
+
+    --buffer->open_spans_num;
+
+    if(buffer->open_spans_num >= MAX_OPEN_SPANS)
+        return;
+
+    const THREAD_TRACER_OPEN_SPAN* span = &buffer->open_spans[buffer->open_spans_num];
+
+    if(strcmp(span->category, category) != 0 || strcmp(span->name, name) != 0)
+        return;
+
+    THREAD_TRACER_LATENCY* latency = findLatency(atomic_load(&buffer->latencies), category, name);
+
+    if(latency == NULL)
+    {
+        latency = (THREAD_TRACER_LATENCY*)calloc(1, sizeof(THREAD_TRACER_LATENCY));
+
+        if(latency == NULL)
+            return;
+
+        latency->category = category;
+        latency->name = name;
+        latency->next = atomic_load(&buffer->latencies);
+        atomic_store(&buffer->latencies, latency);
+    }
+
+    latencyHistogramRecord(&latency->histogram, timestamp_ns - span->start_time_ns);
+}
+
+void threadTracerRecord(char phase, const char* category, const char* name, const void* object)
+{
+    int record_events = atomic_load_explicit(&events_enabled, memory_order_relaxed);
+    int record_latencies = atomic_load_explicit(&latencies_enabled, memory_order_relaxed);
+
+    if(!record_events && !record_latencies)
+        return;
+
+    THREAD_TRACER_BUFFER* buffer = getThreadBuffer();
+
+    if(buffer == NULL)
+    {
+        atomic_fetch_add_explicit(&dropped_events, 1, memory_order_relaxed);
+        return;
+    }
+
+    unsigned long long timestamp_ns = getMonotonicTimeNs();
+
+    if(record_events)
+        recordEvent(buffer, timestamp_ns, phase, category, name, object);
+
+    if(record_latencies)
+        recordLatency(buffer, timestamp_ns, phase, category, name);
+}
+
+// Events are meant to be written as a trace, and latencies to be printed as histograms. Returns -1 if the tracer has been compiled out.
+int threadTracerStart(int record_events, int record_latencies)
+{
+    if(THREAD_TRACE_LEVEL == THREAD_TRACE_LEVEL_OFF)
+        return -1;
+
+    start_time_ns = getMonotonicTimeNs();
+    atomic_store(&events_enabled, record_events);
+    atomic_store(&latencies_enabled, record_latencies);
+
+    return 0;
+}
+
+void threadTracerStop()
+{
+    atomic_store(&events_enabled, 0);
+    atomic_store(&latencies_enabled, 0);
+}
+
+unsigned long threadTracerGetDroppedEvents()
+{
+    return atomic_load(&dropped_events);
+}
+
+static void recordThreadEnd(void* arg)
+{
+    threadTracerRecord('E', THREAD_TRACE_CATEGORY_THREAD, (const char*)arg, NULL);
+}
+
+static void* trampolineRoutine(void* arg)
+{
+    THREAD_TRACER_TRAMPOLINE_DATA data = *((THREAD_TRACER_TRAMPOLINE_DATA*)arg);
+    void* ret;
+
+    free(arg);
+
+    // Picked up if this thread's buffer is created now.
+    pending_thread_name = data.name;
+
+    threadTracerRecord('B', THREAD_TRACE_CATEGORY_THREAD, data.name, NULL);
+
+    pthread_cleanup_push(recordThreadEnd, (void*)data.name);
+    ret = data.start_routine(data.arg);
+    pthread_cleanup_pop(1);
+
+    return ret;
+}
+
+// Same as "create" (pthread_create or any wrapper with the same signature), but the new thread's lifetime is traced.
+int threadTracerCreateThread(int (*create)(pthread_t*, const pthread_attr_t*, void* (*)(void*), void*), pthread_t* thread, const pthread_attr_t* attr, void* (*start_routine)(void*), void* arg, const char* name)
+{
+    THREAD_TRACER_TRAMPOLINE_DATA* data = (THREAD_TRACER_TRAMPOLINE_DATA*)malloc(sizeof(THREAD_TRACER_TRAMPOLINE_DATA));
+
+    if(data == NULL)
+        return create(thread, attr, start_routine, arg);
+
+    data->start_routine = start_routine ;
+    data->arg           = arg           ;
+    data->name          = name          ;
+
+    int ret = create(thread, attr, trampolineRoutine, data);
+
+    if(ret != 0)
+        free(data);
+
+    return ret;
+}
+
+// Both the wait for the mutex and the time it is held are traced. The latter ends in threadTracerMutexUnlock.
+static void registerMutexMetrics()
+{
+    mutex_acquisitions_metric   = metricsExporterRegister("mutex_acquisitions_total", "Traced mutex locks."                         , METRIC_TYPE_COUNTER);
+    mutex_contended_metric      = metricsExporterRegister("mutex_contended_total"   , "Traced mutex locks found already locked."    , METRIC_TYPE_COUNTER);
+}
+
+// Telling whether the mutex was already locked takes a trylock before the actual lock.
+int threadTracerMutexLock(pthread_mutex_t* mutex)
+{
+    pthread_once(&mutex_metrics_once, registerMutexMetrics);
+
+    threadTracerRecord('B', THREAD_TRACE_CATEGORY_MUTEX, "mutex wait", mutex);
+    int ret = pthread_mutex_trylock(mutex);
+
+    if(ret == EBUSY)
+    {
+        metricsExporterAdd(mutex_contended_metric, 1);
+        ret = pthread_mutex_lock(mutex);
+    }
+
+    metricsExporterAdd(mutex_acquisitions_metric, 1);
+    threadTracerRecord('E', THREAD_TRACE_CATEGORY_MUTEX, "mutex wait", mutex);
+
+    if(ret == 0)
+        threadTracerRecord('B', THREAD_TRACE_CATEGORY_MUTEX, "mutex held", mutex);
+
+    return ret;
+}
+
+int threadTracerMutexUnlock(pthread_mutex_t* mutex)
+{
+    threadTracerRecord('E', THREAD_TRACE_CATEGORY_MUTEX, "mutex held", mutex);
+
+    return pthread_mutex_unlock(mutex);
+}
+
+// Spans from the thread's arrival at the barrier until its departure.
+int threadTracerBarrierWait(pthread_barrier_t* barrier)
+{
+    threadTracerRecord('B', THREAD_TRACE_CATEGORY_BARRIER, "barrier wait", barrier);
+    int ret = pthread_barrier_wait(barrier);
+    threadTracerRecord('E', THREAD_TRACE_CATEGORY_BARRIER, "barrier wait", barrier);
+
+    return ret;
+}
+
+int threadTracerSemWait(sem_t* semaphore)
+{
+    threadTracerRecord('B', THREAD_TRACE_CATEGORY_SEMAPHORE, "semaphore wait", semaphore);
+    int ret = sem_wait(semaphore);
+    threadTracerRecord('E', THREAD_TRACE_CATEGORY_SEMAPHORE, "semaphore wait", semaphore);
+
+    return ret;
+}
+
+int threadTracerSemPost(sem_t* semaphore)
+{
+    threadTracerRecord('i', THREAD_TRACE_CATEGORY_SEMAPHORE, "semaphore post", semaphore);
+
+    return sem_post(semaphore);
+}
+
+static void printJSONString(FILE* stream, const char* text)
+{
+    fputc('"', stream);
+
+    for(const unsigned char* c = (const unsigned char*)text; *c; c++)
+    {
+        if(*c == '"' || *c == '\\')
+            fprintf(stream, "\\%c", *c);
+        else if(*c < 0x20)
+            fprintf(stream, "\\u%04x", *c);
+        else
+            fputc(*c, stream);
+    }
+
+    fputc('"', stream);
+}
+
+// Events recorded so far are written, even if tracing has not been stopped. Returns -1 on error.
+int threadTracerWriteJSON(const char* path)
+{
+    if(path == NULL)
+        return -1;
+
+    FILE* file = fopen(path, "w");
+
+    if(file == NULL)
+        return -1;
+
+    pid_t pid = getpid();
+    int first = 1;
+
+    fprintf(file, "{\n  \"displayTimeUnit\": \"ns\",\n  \"traceEvents\": [\n");
+
+    for(THREAD_TRACER_BUFFER* buffer = atomic_load(&buffers); buffer != NULL; buffer = buffer->next)
+    {
+        if(buffer->name != NULL)
+        {
+            fprintf(file, "%s    { \"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %d, \"args\": { \"name\": ", (first ? "" : ",\n"), pid, buffer->tid);
+            printJSONString(file, buffer->name);
+            fprintf(file, " } }");
+            first = 0;
+        }
+
+        for(THREAD_TRACER_CHUNK* chunk = atomic_load(&buffer->first); chunk != NULL; chunk = chunk->next)
+        {
+            unsigned int events_num = atomic_load_explicit(&chunk->events_num, memory_order_acquire);
+
+            for(unsigned int event_idx = 0; event_idx < events_num; event_idx++)
+            {
+                const THREAD_TRACER_EVENT* event = &chunk->events[event_idx];
+                double timestamp_us = (event->timestamp_ns >= start_time_ns ? (event->timestamp_ns - start_time_ns) / NS_PER_USEC : 0.0);
+
+                fprintf(file, "%s    { \"name\": ", (first ? "" : ",\n"));
+                printJSONString(file, event->name);
+                fprintf(file, ", \"cat\": \"%s\", \"ph\": \"%c\", \"ts\": %.3f, \"pid\": %d, \"tid\": %d", event->category, event->phase, timestamp_us, pid, buffer->tid);
+
+                // Instants are drawn just on their own thread's row.
+                if(event->phase == 'i')
+                    fprintf(file, ", \"s\": \"t\"");
+
+                if(event->object != NULL)
+                    fprintf(file, ", \"args\": { \"object\": \"%p\" }", event->object);
+
+                fprintf(file, " }");
+                first = 0;
+            }
+        }
+    }
+
+    fprintf(file, "\n  ]\n}\n");
+
+    return (fclose(file) == 0 ? 0 : -1);
+}
+
+// Histograms of the same kind of span are added up across threads. Returns the number of kinds of span, or -1 on error.
+static int mergeLatencies(THREAD_TRACER_LATENCY** merged)
+{
+    int merged_num = 0;
+
+    *merged = NULL;
+
+    for(THREAD_TRACER_BUFFER* buffer = atomic_load(&buffers); buffer != NULL; buffer = buffer->next)
+    {
+        for(THREAD_TRACER_LATENCY* latency = atomic_load(&buffer->latencies); latency != NULL; latency = latency->next)
+        {
+            THREAD_TRACER_LATENCY* total = findLatency(*merged, latency->category, latency->name);
+
+            if(total == NULL)
+            {
+                total = (THREAD_TRACER_LATENCY*)calloc(1, sizeof(THREAD_TRACER_LATENCY));
+
+                if(total == NULL)
+                {
+                    freeLatencies(*merged);
+                    *merged = NULL;
+                    return -1;
+                }
+
+                total->category = latency->category;
+                total->name = latency->name;
+                total->next = *merged;
+                *merged = total;
+                ++merged_num;
+            }
+
+            latencyHistogramMerge(&total->histogram, &latency->histogram);
+        }
+    }
+
+    return merged_num;
+}
+
+static void freeLatencies(THREAD_TRACER_LATENCY* latencies)
+{
+    while(latencies != NULL)
+    {
+        THREAD_TRACER_LATENCY* next = latencies->next;
+        free(latencies);
+        latencies = next;
+    }
+}
+
+// A line per kind of span, such as "mutex: mutex wait" or "thread: incrementFunction". Returns -1 on error.
+int threadTracerPrintLatencies(FILE* stream)
+{
+    THREAD_TRACER_LATENCY* merged;
+
+    if(stream == NULL || mergeLatencies(&merged) < 0)
+        return -1;
+
+    for(THREAD_TRACER_LATENCY* latency = merged; latency != NULL; latency = latency->next)
+    {
+        char name[LATENCY_NAME_SIZE];
+        snprintf(name, sizeof(name), "%s: %s", latency->category, latency->name);
+        latencyHistogramPrint(stream, name, &latency->histogram);
+    }
+
+    freeLatencies(merged);
+
+    return 0;
+}
+
+// Every non-empty bucket of every kind of span, named as "category/name". Returns -1 on error.
+int threadTracerWriteLatenciesCSV(const char* path)
+{
+    THREAD_TRACER_LATENCY* merged;
+
+    if(path == NULL || mergeLatencies(&merged) < 0)
+        return -1;
+
+    FILE* file = fopen(path, "w");
+
+    if(file == NULL)
+    {
+        freeLatencies(merged);
+        return -1;
+    }
+
+    latencyHistogramPrintCSVHeader(file);
+
+    for(THREAD_TRACER_LATENCY* latency = merged; latency != NULL; latency = latency->next)
+    {
+        char name[LATENCY_NAME_SIZE];
+        snprintf(name, sizeof(name), "%s/%s", latency->category, latency->name);
+        latencyHistogramPrintCSV(file, name, &latency->histogram);
+    }
+
+    freeLatencies(merged);
+
+    return (fclose(file) == 0 ? 0 : -1);
+}
+
+/**************************************/
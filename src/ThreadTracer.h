@@ -0,0 +1,84 @@
+#ifndef THREAD_TRACER_H
+#define THREAD_TRACER_H
+
+/********* Include statements *********/
+
+#include <stdio.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include "ThreadStateSampler.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define THREAD_TRACE_LEVEL_OFF      0
+#define THREAD_TRACE_LEVEL_THREADS  1   // Lessons and thread lifetimes.
+#define THREAD_TRACE_LEVEL_SYNC     2   // Mutexes, barriers, condition variables and semaphores as well.
+
+// Selected at build time (-DTHREAD_TRACE_LEVEL=2). Anything above the selected level is compiled out.
+#ifndef THREAD_TRACE_LEVEL
+#define THREAD_TRACE_LEVEL          THREAD_TRACE_LEVEL_OFF
+#endif
+
+#define THREAD_TRACE_CATEGORY_LESSON    "lesson"
+#define THREAD_TRACE_CATEGORY_THREAD    "thread"
+#define THREAD_TRACE_CATEGORY_MUTEX     "mutex"
+#define THREAD_TRACE_CATEGORY_BARRIER   "barrier"
+#define THREAD_TRACE_CATEGORY_CONDVAR   "condvar"
+#define THREAD_TRACE_CATEGORY_SEMAPHORE "semaphore"
+
+// Threads created through TRACED_THREAD_CREATE are named after their routine while their states are being sampled, whatever the level.
+#if THREAD_TRACE_LEVEL >= THREAD_TRACE_LEVEL_THREADS
+#define THREAD_TRACE_SPAN_BEGIN(category, name)                         threadTracerRecord('B', category, name, NULL)
+#define THREAD_TRACE_SPAN_END(category, name)                           threadTracerRecord('E', category, name, NULL)
+#define TRACED_THREAD_CREATE(thread, attr, routine, arg)                threadStateSamplerNameThread(threadTracerCreateThread(pthread_create, thread, attr, routine, arg, #routine), thread, #routine)
+#define TRACED_THREAD_CREATE_WITH(create, thread, attr, routine, arg)   threadStateSamplerNameThread(threadTracerCreateThread(create, thread, attr, routine, arg, #routine), thread, #routine)
+#else
+#define THREAD_TRACE_SPAN_BEGIN(category, name)                         ((void)0)
+#define THREAD_TRACE_SPAN_END(category, name)                           ((void)0)
+#define TRACED_THREAD_CREATE(thread, attr, routine, arg)                threadStateSamplerNameThread(pthread_create(thread, attr, routine, arg), thread, #routine)
+#define TRACED_THREAD_CREATE_WITH(create, thread, attr, routine, arg)   threadStateSamplerNameThread(create(thread, attr, routine, arg), thread, #routine)
+#endif
+
+#if THREAD_TRACE_LEVEL >= THREAD_TRACE_LEVEL_SYNC
+#define THREAD_TRACE_SYNC_BEGIN(category, name, object)                 threadTracerRecord('B', category, name, object)
+#define THREAD_TRACE_SYNC_END(category, name, object)                   threadTracerRecord('E', category, name, object)
+#define THREAD_TRACE_SYNC_INSTANT(category, name, object)               threadTracerRecord('i', category, name, object)
+#define TRACED_MUTEX_LOCK(mutex)                                        threadTracerMutexLock(mutex)
+#define TRACED_MUTEX_UNLOCK(mutex)                                      threadTracerMutexUnlock(mutex)
+#define TRACED_BARRIER_WAIT(barrier)                                    threadTracerBarrierWait(barrier)
+#define TRACED_SEM_WAIT(semaphore)                                      threadTracerSemWait(semaphore)
+#define TRACED_SEM_POST(semaphore)                                      threadTracerSemPost(semaphore)
+#else
+#define THREAD_TRACE_SYNC_BEGIN(category, name, object)                 ((void)0)
+#define THREAD_TRACE_SYNC_END(category, name, object)                   ((void)0)
+#define THREAD_TRACE_SYNC_INSTANT(category, name, object)               ((void)0)
+#define TRACED_MUTEX_LOCK(mutex)                                        pthread_mutex_lock(mutex)
+#define TRACED_MUTEX_UNLOCK(mutex)                                      pthread_mutex_unlock(mutex)
+#define TRACED_BARRIER_WAIT(barrier)                                    pthread_barrier_wait(barrier)
+#define TRACED_SEM_WAIT(semaphore)                                      sem_wait(semaphore)
+#define TRACED_SEM_POST(semaphore)                                      sem_post(semaphore)
+#endif
+
+/**************************************/
+
+/********* Function prototypes ********/
+
+int             threadTracerStart(int record_events, int record_latencies);
+void            threadTracerStop();
+int             threadTracerWriteJSON(const char* path);
+int             threadTracerPrintLatencies(FILE* stream);
+int             threadTracerWriteLatenciesCSV(const char* path);
+unsigned long   threadTracerGetDroppedEvents();
+void            threadTracerRecord(char phase, const char* category, const char* name, const void* object);
+int             threadTracerCreateThread(int (*create)(pthread_t*, const pthread_attr_t*, void* (*)(void*), void*), pthread_t* thread, const pthread_attr_t* attr, void* (*start_routine)(void*), void* arg, const char* name);
+int             threadTracerMutexLock(pthread_mutex_t* mutex);
+int             threadTracerMutexUnlock(pthread_mutex_t* mutex);
+int             threadTracerBarrierWait(pthread_barrier_t* barrier);
+int             threadTracerSemWait(sem_t* semaphore);
+int             threadTracerSemPost(sem_t* semaphore);
+
+/**************************************/
+
+#endif
@@ -38,6 +38,7 @@ invalid parameters or ESRCH for non-existent threads, among others.
 #include <unistd.h>
 #include "ThreadColors.h"
 #include "ThreadCreationStatus.h"
+#include "VirtualTime.h"
 #include "ThreadsCancellation.h"
 
 /**************************************/
@@ -77,7 +78,7 @@ static void* cancelledThreadRoutine(void* arg)
             "DEFERRED"                                                                      ,
             PRINT_COLOR_RESET                                                               );
     
-    sleep(1);
+    virtualTimeSleep(1);
     
     printf("%sThis point was reached due to cancellation not being enabled for thread ID: %lu%s\r\n",
             PRINT_COLOR_YELLOW  ,
@@ -104,17 +105,17 @@ static void createCancellableThreads(int cancellable)
 {
     pthread_t t_0, t_1;
 
-    if(checkThreadCreationStatus( pthread_create(&t_0, NULL, cancelledThreadRoutine, &cancellable) ))
+    if(checkThreadCreationStatus( virtualTimeThreadCreate(&t_0, NULL, cancelledThreadRoutine, &cancellable) ))
         return;
     
-    if(checkThreadCreationStatus( pthread_create(&t_1, NULL, cancellingThreadRoutine, &t_0) ))
+    if(checkThreadCreationStatus( virtualTimeThreadCreate(&t_1, NULL, cancellingThreadRoutine, &t_0) ))
     {
-        pthread_join(t_0, NULL);
+        virtualTimeThreadJoin(t_0, NULL);
         return;
     }
 
-    pthread_join(t_0, NULL);
-    pthread_join(t_1, NULL);
+    virtualTimeThreadJoin(t_0, NULL);
+    virtualTimeThreadJoin(t_1, NULL);
 }
 
 void threadsCancellation()
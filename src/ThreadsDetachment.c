@@ -32,6 +32,7 @@ main function. pthread_exit() terminates the calling thread but allows other thr
 #include <unistd.h>
 #include "ThreadColors.h"
 #include "ThreadCreationStatus.h"
+#include "VirtualTime.h"
 #include "ThreadsDetachment.h"
 
 /**************************************/
@@ -55,7 +56,7 @@ static int createAndDetach()
 {
     pthread_t t_0;
     
-    if( checkThreadCreationStatus( pthread_create(&t_0, NULL, detachedThreadRoutine, NULL) ) )
+    if( checkThreadCreationStatus( virtualTimeThreadCreate(&t_0, NULL, detachedThreadRoutine, NULL) ) )
         return -1;
 
     pthread_detach(t_0);
@@ -66,7 +67,7 @@ static void* detachedThreadRoutine(void* arg)
 {
     // Wait for 5 seconds before doing anything so that it can be noted how thread does not continue if pthread_exit is not being called
     // in the main thread.
-    sleep(TIME_BEFORE_DETACHMENT);
+    virtualTimeSleep(TIME_BEFORE_DETACHMENT);
 
     printf("%sThis is a detached thread! TID: %lu%s\r\n", PRINT_COLOR_CYAN, pthread_self(), PRINT_COLOR_RESET);
     return NULL;
@@ -23,7 +23,10 @@ Thread attributes can determine many of the thread's behavioural aspects, such a
         ·SCHED_RR: Round-robin policy.
         ·SCHED_FIFO: higher priority yasks complete before lower priority tasks.
         The scheduling priotity adjusts within the policy. Use sched_param.sched_priority to set it (included in <sched.h>).
-        Please, note also that scheduling priorities other than default may require root privileges.
+        Please, note also that scheduling priorities other than default may require root privileges (CAP_SYS_NICE, actually).
+        Without them, creating a thread with an explicit real-time policy fails with EPERM. This lesson then falls back to
+        inheriting the creating thread's scheduling, so threads still run, just without priorities. Priorities which do not need any
+        privileges can be given to tasks rather than threads, as ThreadPoolPriorities.c shows.
     
     ·Inherit scheduling: tells whether are threads meant to inherit scheduling policies from parent threads. Use
         pthread_attr_setinheritsched to set this attribute.
@@ -33,7 +36,8 @@ Thread attributes can determine many of the thread's behavioural aspects, such a
         ·CPU_ZERO: a maro used to clean or initialize a cpu_set_t variable to an empty set.
         ·sched_setaffinity: function used to set thread's CPU affinity.
         Same as cancellability, this is not specified by using pthread_attr_t type variables, but pthread_t type variables instead.
-        This topic will not be covered in this tutorial since it may not be suppported by some glibc versions.
+        It is not covered by this lesson since it may not be suppported by some glibc versions, but ThreadPool.c pins its workers
+        (through pthread_setaffinity_np) and places tasks near their data.
     
     ·Cancellability: while it's not set by using pthread_attr_t type variables, it tells whether threads can be terminated
         by others. This topic has been thoroughly explained in ThreadsCancellation.c file. 
@@ -43,12 +47,15 @@ Thread attributes can determine many of the thread's behavioural aspects, such a
 
 #include <pthread.h>
 #include <sched.h>
+#include <errno.h>
 #include <time.h>
 #include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "ThreadColors.h"
 #include "ThreadCreationStatus.h"
+#include "LessonParameters.h"
 #include "ThreadsWithAttributes.h"
 
 /**************************************/
@@ -98,6 +105,7 @@ typedef struct
 static int     setExampleThreadAttributes(pthread_attr_t* attr, int* scheduling_policy, priority_param* sched_priority_param);
 static void    showExampleThreadAttributes(pthread_attr_t* attr, THREAD_CANCELABILITY* cancellability);
 static void*   threadWithAttributesRoutine(void* arg);
+static void    runThreadsWithAttributes(unsigned long threads_num, pthread_t* threads, pthread_attr_t* thread_attrs, priority_param* sched_priority_param, THREAD_INPUT_DATA* thread_inputs);
 
 /**************************************/
 
@@ -240,9 +248,9 @@ static void* threadWithAttributesRoutine(void* arg)
             clock()                                                         ,
             PRINT_COLOR_RESET                                               );
 
-    unsigned int dummmy_counter = 0;
+    unsigned long dummmy_counter = 0;
 
-    for(unsigned int i = 0; i  < MAX_COUNT_VALUE; i++)
+    for(unsigned long i = 0; i  < thread_input_data->input_common->max_count_value; i++)
         ++dummmy_counter;
     
     printf("%sThread with index %d (Thread ID: %lu) ended its routine. Elapsed time: %ld%s\r\n",
@@ -255,34 +263,32 @@ static void* threadWithAttributesRoutine(void* arg)
     return NULL;
 }
 
-void threadsWithAttributes()
+static void runThreadsWithAttributes(unsigned long threads_num, pthread_t* threads, pthread_attr_t* thread_attrs, priority_param* sched_priority_param, THREAD_INPUT_DATA* thread_inputs)
 {
-    // Initialize arrays for threads, attributes, scheduling priority parameters and thread input arguments.
-    pthread_t threads[NUMBER_OF_THREADS];
-    pthread_attr_t thread_attrs[NUMBER_OF_THREADS];
-    priority_param sched_priority_param[NUMBER_OF_THREADS];
-    THREAD_INPUT_DATA thread_inputs[NUMBER_OF_THREADS];
-
     // Initialize a variable holding the common scheduling type.
     int scheduling_policy = SCHED_RR;
 
     // Initialize and set common cancellabillty details as well as common maximum counter value.
     THREAD_INPUT_COMMON_DATA thread_common_arg =
     {
-        .max_count_value                        = MAX_COUNT_VALUE           ,
+        .max_count_value                        = getLessonParameter(LESSON_PARAM_INCREMENTS, MAX_COUNT_VALUE),
         .cancelability.cancellation_type        = PTHREAD_CANCEL_ENABLE     ,
         .cancelability.cancelability_enabled    = PTHREAD_CANCEL_DEFERRED   ,
     };
 
     // Initialize thread attributes variable.
-    for(int attr_idx = 0; attr_idx < (sizeof(thread_attrs) / sizeof(thread_attrs[0])); attr_idx++)
+    for(int attr_idx = 0; attr_idx < (int)threads_num; attr_idx++)
     {
         if(threadAttributesCreationStatus(pthread_attr_init(&thread_attrs[attr_idx])))
             return;
     
-        // Set priority in ascending order, so that lowest index thread has lowest priority.
+        // Set priority in ascending order, so that lowest index thread has lowest priority. Priorities beyond the policy's maximum
+        // (as it may happen if many threads are requested) are clamped.
         sched_priority_param[attr_idx].sched_priority = (attr_idx + 1);
 
+        if(sched_priority_param[attr_idx].sched_priority > sched_get_priority_max(scheduling_policy))
+            sched_priority_param[attr_idx].sched_priority = sched_get_priority_max(scheduling_policy);
+
         // Assign features to the variable holding thread attributes. A custom function is being used this time.
         if(setExampleThreadAttributes(&thread_attrs[attr_idx], &scheduling_policy, &sched_priority_param[attr_idx]))
             return;
@@ -294,28 +300,72 @@ void threadsWithAttributes()
     }
 
     // Once attributes have been already set, launch all threads.
-    for(int thread_idx = 0; thread_idx < (sizeof(threads) / sizeof(threads[0])); thread_idx++)
+    int inherit_sched_fallback = 0;
+
+    for(int thread_idx = 0; thread_idx < (int)threads_num; thread_idx++)
     {
         thread_inputs[thread_idx].input_common = &thread_common_arg;
         thread_inputs[thread_idx].thread_idx = thread_idx;
 
-        if( checkThreadCreationStatus( pthread_create(&threads[thread_idx], &thread_attrs[thread_idx], threadWithAttributesRoutine, &thread_inputs[thread_idx]) ) )
+        int creation_status = pthread_create(&threads[thread_idx], &thread_attrs[thread_idx], threadWithAttributesRoutine, &thread_inputs[thread_idx]);
+
+        // Without privileges, real-time policies are not allowed. Threads are then created with the inherited scheduling instead.
+        if(creation_status == EPERM)
+        {
+            if(!inherit_sched_fallback)
+                printf("%sNot allowed to use real-time scheduling (it requires CAP_SYS_NICE), so threads inherit the current policy. See the pool-priorities lesson for priorities without privileges.%s\r\n",
+                        PRINT_COLOR_YELLOW  ,
+                        PRINT_COLOR_RESET   );
+
+            inherit_sched_fallback = 1;
+            pthread_attr_setinheritsched(&thread_attrs[thread_idx], PTHREAD_INHERIT_SCHED);
+            creation_status = pthread_create(&threads[thread_idx], &thread_attrs[thread_idx], threadWithAttributesRoutine, &thread_inputs[thread_idx]);
+        }
+
+        if( checkThreadCreationStatus( creation_status ) )
         {
             for(int cancel_idx = (thread_idx - 1); cancel_idx >= 0; cancel_idx--)
                 pthread_cancel(threads[cancel_idx]);
-            
+
+            // Cancelled threads are joined anyway, as their input data is freed once this function returns.
+            for(int join_idx = 0; join_idx < thread_idx; join_idx++)
+                pthread_join(threads[join_idx], NULL);
+
             return;
         }
     }
 
     // Once finished, destroy threads as well as their attribute-holding variable.
-    for(int attr_idx = 0; attr_idx < (sizeof(thread_attrs) / sizeof(thread_attrs[0])); attr_idx++)
+    for(int attr_idx = 0; attr_idx < (int)threads_num; attr_idx++)
         pthread_attr_destroy(&thread_attrs[attr_idx]);
     
-    for(int thread_idx = 0; thread_idx < (sizeof(threads) / sizeof(threads[0])); thread_idx++)
+    for(int thread_idx = 0; thread_idx < (int)threads_num; thread_idx++)
         pthread_join(threads[thread_idx], NULL);
 }
 
+void threadsWithAttributes()
+{
+    // Initialize arrays for threads, attributes, scheduling priority parameters and thread input arguments.
+    // Both the number of threads and their count limit can be overridden through lesson parameters (see LessonParameters.c). As the
+    // number of threads is not bounded, arrays are allocated on the heap rather than on the stack.
+    unsigned long threads_num = getLessonParameter(LESSON_PARAM_THREADS, NUMBER_OF_THREADS);
+
+    pthread_t* threads = (pthread_t*)calloc(threads_num, sizeof(pthread_t));
+    pthread_attr_t* thread_attrs = (pthread_attr_t*)calloc(threads_num, sizeof(pthread_attr_t));
+    priority_param* sched_priority_param = (priority_param*)calloc(threads_num, sizeof(priority_param));
+    THREAD_INPUT_DATA* thread_inputs = (THREAD_INPUT_DATA*)calloc(threads_num, sizeof(THREAD_INPUT_DATA));
+
+    if(threads != NULL && thread_attrs != NULL && sched_priority_param != NULL && thread_inputs != NULL)
+        runThreadsWithAttributes(threads_num, threads, thread_attrs, sched_priority_param, thread_inputs);
+    else
+        printf("%sCould not allocate data for %lu threads.%s\r\n", PRINT_COLOR_RED, threads_num, PRINT_COLOR_RESET);
+
+    free(thread_inputs);
+    free(sched_priority_param);
+    free(thread_attrs);
+    free(threads);
+}
+
 /*
 It can be boldly stated that the performance of the function written above strongly depends on the maximum number count as well
 as the capacities and number of processor in the machine running it. The higher the maximum number count, the clearer the differences
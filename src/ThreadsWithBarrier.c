@@ -30,6 +30,7 @@ Where:
 #include <time.h>
 #include "ThreadColors.h"
 #include "ThreadCreationStatus.h"
+#include "ThreadTracer.h"
 #include "ThreadsWithBarrier.h"
 
 /**************************************/
@@ -80,8 +81,9 @@ static void* countUntilLimit(void* arg)
             clock(),
             PRINT_COLOR_RESET);
 
-    // once the count limit has been reached, wait for other threads to reach the bar as well.
-    pthread_barrier_wait(cab->bar);
+    // once the count limit has been reached, wait for other threads to reach the bar as well. TRACED_BARRIER_WAIT is just
+    // pthread_barrier_wait unless the tracer is compiled in (see ThreadTracer.c).
+    TRACED_BARRIER_WAIT(cab->bar);
 
     printf("%sBarrier reached, thread ID: %lu goes on at %ld\r\n%s", cab->clr, pthread_self(), clock(), PRINT_COLOR_RESET);
 
@@ -117,7 +119,7 @@ void threadsWithBarrier()
         cab[i].bar = &barrier   ;
         cab[i].clr = colors[i]  ;
 
-        if(checkThreadCreationStatus( pthread_create(&threads[i], NULL, countUntilLimit, &cab[i]) ))
+        if(checkThreadCreationStatus( TRACED_THREAD_CREATE(&threads[i], NULL, countUntilLimit, &cab[i]) ))
             return;
     }
 
@@ -33,6 +33,9 @@ Once it's over, destroy the preiously allocated resources using pthread_cond_des
 A beginner-friendly example:
 The following example describes a typical consumer-producer architecture, in which a producer generates items until the buffer is full,
 and a consumer waits if the buffer is empty. A shared counter will be used, describing the number of elements in the buffer.
+
+The number of items in the buffer is also kept as a live metric (a gauge, see MetricsExporter.c), so it can be watched going up and
+down while the lesson runs.
 */
 
 /********* Include statements *********/
@@ -42,12 +45,17 @@ and a consumer waits if the buffer is empty. A shared counter will be used, desc
 #include <unistd.h>
 #include "ThreadColors.h"
 #include "ThreadCreationStatus.h"
+#include "ThreadTracer.h"
+#include "LessonParameters.h"
+#include "VirtualTime.h"
+#include "MetricsExporter.h"
 #include "ThreadsWithConditionVariables.h"
 
 /**************************************/
 
 /********** Define statements *********/
 
+// Default value, which can be overridden through lesson parameters (see LessonParameters.c).
 #define BUFFER_SIZE 3
 
 /**************************************/
@@ -58,6 +66,8 @@ typedef struct
 {
     pthread_mutex_t*    cond_p_mutex_lock   ;
     pthread_cond_t*     cond_p_full_cond    ;
+    int                 buffer_size         ;
+    int                 buffer_items_metric ;
 
 } COND_THREAD_DATA;
 
@@ -84,7 +94,8 @@ static void* consumerRoutine(void* arg)
 
     COND_THREAD_DATA* p_cond_thread_data = (COND_THREAD_DATA*)arg;
 
-    pthread_mutex_lock(p_cond_thread_data->cond_p_mutex_lock);
+    // TRACED_* macros are just the plain calls unless the tracer is compiled in (see ThreadTracer.c).
+    TRACED_MUTEX_LOCK(p_cond_thread_data->cond_p_mutex_lock);
 
     printf("%sConsumer with TID: %ld says: \"Waiting for items to be replenished ...\"%s\r\n",
             PRINT_COLOR_RED                         ,
@@ -93,10 +104,12 @@ static void* consumerRoutine(void* arg)
 
     // Wait until the full buffer condition is signaled by the producer. This action frees the mutex lock implicitly,
     // and forces the thread to wait there.
-    pthread_cond_wait(p_cond_thread_data->cond_p_full_cond, p_cond_thread_data->cond_p_mutex_lock);
+    THREAD_TRACE_SYNC_BEGIN(THREAD_TRACE_CATEGORY_CONDVAR, "condvar wait", p_cond_thread_data->cond_p_full_cond);
+    virtualTimeCondWait(p_cond_thread_data->cond_p_full_cond, p_cond_thread_data->cond_p_mutex_lock);
+    THREAD_TRACE_SYNC_END(THREAD_TRACE_CATEGORY_CONDVAR, "condvar wait", p_cond_thread_data->cond_p_full_cond);
 
     // Once the condition above has been signaled, consume all items in the buffer.
-    for(int i = BUFFER_SIZE; i >= 1; i--)
+    for(int i = p_cond_thread_data->buffer_size; i >= 1; i--)
     {
         printf("%sConsumer with TID: %ld says: \"Consumed an item. Current item number: %d\"%s\r\n",
             PRINT_COLOR_BLUE                        ,
@@ -104,8 +117,10 @@ static void* consumerRoutine(void* arg)
             i                                       ,
             PRINT_COLOR_RESET                       );
 
+        metricsExporterAdd(p_cond_thread_data->buffer_items_metric, -1);
+
         // Simulate time taken to consume a single item.
-        sleep(1);
+        virtualTimeSleep(1);
     }
     
     printf( "%sConsumer with TID: %ld says: \"All elements in buffer have been consumed!\"%s\r\n",
@@ -113,7 +128,7 @@ static void* consumerRoutine(void* arg)
             pthread_self()      ,
             PRINT_COLOR_RESET   );
 
-    pthread_mutex_unlock(p_cond_thread_data->cond_p_mutex_lock);
+    TRACED_MUTEX_UNLOCK(p_cond_thread_data->cond_p_mutex_lock);
 
     return NULL;
 }
@@ -127,10 +142,10 @@ static void* producerRoutine(void* arg)
     COND_THREAD_DATA* p_cond_thread_data = (COND_THREAD_DATA*)arg;
 
     // Lock the mutex first.
-    pthread_mutex_lock(p_cond_thread_data->cond_p_mutex_lock);
+    TRACED_MUTEX_LOCK(p_cond_thread_data->cond_p_mutex_lock);
 
     // Then, produce until the buffer is full.
-    for(int i = 1; i <= BUFFER_SIZE; i++)
+    for(int i = 1; i <= p_cond_thread_data->buffer_size; i++)
     {
         printf( "%sProducer with TID %ld says: \"Added an item. Current item number: %d\"%s\r\n",
             PRINT_COLOR_YELLOW                      ,
@@ -138,8 +153,10 @@ static void* producerRoutine(void* arg)
             i                                       ,
             PRINT_COLOR_RESET                       );
 
+        metricsExporterAdd(p_cond_thread_data->buffer_items_metric, 1);
+
         // Simulate some time taken to produce a single unit.
-        sleep(1);
+        virtualTimeSleep(1);
     }
 
     // Once it's done, signal consumer letting it know that the buffer has been already replenished.
@@ -148,10 +165,11 @@ static void* producerRoutine(void* arg)
             pthread_self()      ,
             PRINT_COLOR_RESET   );
     
-    pthread_cond_signal(p_cond_thread_data->cond_p_full_cond);
+    THREAD_TRACE_SYNC_INSTANT(THREAD_TRACE_CATEGORY_CONDVAR, "condvar signal", p_cond_thread_data->cond_p_full_cond);
+    virtualTimeCondSignal(p_cond_thread_data->cond_p_full_cond);
 
     // pthread_cond_signal does not free the mutex lock by itself, since meeting more than just a single condition may be required.
-    pthread_mutex_unlock(p_cond_thread_data->cond_p_mutex_lock);
+    TRACED_MUTEX_UNLOCK(p_cond_thread_data->cond_p_mutex_lock);
     
     return NULL;
 }
@@ -170,18 +188,20 @@ void threadsWithConditionVariables()
 
     COND_THREAD_DATA cond_thread_data =
     {
-        .cond_p_mutex_lock  = &mutex_lock   ,
-        .cond_p_full_cond   = &full_cond    ,
+        .cond_p_mutex_lock  = &mutex_lock                                               ,
+        .cond_p_full_cond   = &full_cond                                                ,
+        .buffer_size        = (int)getLessonParameter(LESSON_PARAM_BUFFER_SIZE, BUFFER_SIZE),
+        .buffer_items_metric= metricsExporterRegister("condvar_buffer_items", "Items in the condition variables lesson's buffer.", METRIC_TYPE_GAUGE),
     };
 
     // Start consumer and producer threads.
-    if( checkThreadCreationStatus( pthread_create(&consumer_thread, NULL, consumerRoutine, &cond_thread_data) ) )
+    if( checkThreadCreationStatus( TRACED_THREAD_CREATE_WITH(virtualTimeThreadCreate, &consumer_thread, NULL, consumerRoutine, &cond_thread_data) ) )
         return;
     
     // Wait for the consumer to start its own routine so that it's ensured that there's at least a thread waiting for the signal.
-    sleep(1);
+    virtualTimeSleep(1);
 
-    if( checkThreadCreationStatus( pthread_create(&producer_thread, NULL, producerRoutine, &cond_thread_data) ) )
+    if( checkThreadCreationStatus( TRACED_THREAD_CREATE_WITH(virtualTimeThreadCreate, &producer_thread, NULL, producerRoutine, &cond_thread_data) ) )
     {
         // Since both threads are cancellable, they should be terminated if any error occurs first.
         pthread_cancel(consumer_thread);
@@ -189,8 +209,8 @@ void threadsWithConditionVariables()
     }
 
     // Wait for both threads to finish.
-    pthread_join(consumer_thread, NULL);
-    pthread_join(producer_thread, NULL);
+    virtualTimeThreadJoin(consumer_thread, NULL);
+    virtualTimeThreadJoin(producer_thread, NULL);
 
     // Destroy both conditions as well as the mutex variable.
     pthread_mutex_destroy(  &mutex_lock );
@@ -39,6 +39,7 @@ educational purposes.
 #include <unistd.h>
 #include "ThreadColors.h"
 #include "ThreadCreationStatus.h"
+#include "VirtualTime.h"
 #include "ThreadsWithLocalStorage.h"
 
 /**************************************/
@@ -121,7 +122,7 @@ static void* fibonacciNumbersRoutine(void* arg)
 
     // the function call below ensures that the current routine is delayed. This way, the other thread will
     // deallocate its key-associated memory, showing different heap memory addresses when freed.
-    sleep(1);
+    virtualTimeSleep(1);
 
     return NULL;
 }
@@ -177,18 +178,18 @@ void threadsWithLocalStorage()
 
     // Run each thread. There's no need to provide any data but the quantity of numbers to calculate for each thread and
     // the common TLS key.
-    if(checkThreadCreationStatus(pthread_create(&t_fibonacci, NULL, fibonacciNumbersRoutine, &numbers_arg)))
+    if(checkThreadCreationStatus(virtualTimeThreadCreate(&t_fibonacci, NULL, fibonacciNumbersRoutine, &numbers_arg)))
         return;
     
-    if(checkThreadCreationStatus(pthread_create(&t_prime, NULL, primeNumbersRoutine, &numbers_arg)))
+    if(checkThreadCreationStatus(virtualTimeThreadCreate(&t_prime, NULL, primeNumbersRoutine, &numbers_arg)))
     {
-        pthread_join(t_fibonacci, NULL);
+        virtualTimeThreadJoin(t_fibonacci, NULL);
         return;
     }
 
     // Wait for eevery thread to join main thread back.
-    pthread_join(t_fibonacci, NULL);
-    pthread_join(t_prime, NULL);
+    virtualTimeThreadJoin(t_fibonacci, NULL);
+    virtualTimeThreadJoin(t_prime, NULL);
 
     // After both threads have ended their respective routines, TLS key can be erased.
     pthread_key_delete(numbers_arg.tls_key);
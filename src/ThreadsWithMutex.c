@@ -31,14 +31,18 @@ counter both with and without any mutex lock usage.
 
 #include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include "ThreadColors.h"
 #include "ThreadCreationStatus.h"
+#include "ThreadTracer.h"
+#include "LessonParameters.h"
 #include "ThreadsWithMutex.h"
 
 /**************************************/
 
 /********** Define statements *********/
 
+// Default values, which can be overridden through lesson parameters (see LessonParameters.c).
 #define NUMBER_OF_THREADS       7
 #define NUMBER_OF_INCREMENTS    1000000
 
@@ -49,6 +53,7 @@ counter both with and without any mutex lock usage.
 static unsigned long counter;
 static pthread_mutex_t lock;
 static int use_mutex;
+static unsigned long increments_num;
 
 /**************************************/
 
@@ -64,20 +69,23 @@ static int createThreadsAndRun();
 static void* incrementFunction(void* arg)
 {
     // First, lock the critical section (if allowed) so that no other thread but the current one can manipulate
-    // the variable taken as input parameter.
+    // the variable taken as input parameter. TRACED_MUTEX_LOCK is just pthread_mutex_lock unless the tracer is compiled in
+    // (see ThreadTracer.c), in which case the time spent waiting for and holding the lock is recorded as well.
     if(use_mutex)
-        pthread_mutex_lock(&lock);
+        TRACED_MUTEX_LOCK(&lock);
 
-    unsigned long* p_cnt = (unsigned long*)arg;
+    // Accessed as volatile so that the compiler cannot fold the loop into a single addition when optimizing: every increment
+    // really loads and stores the counter, which is what the race below (and the work units reported when benchmarked) rely on.
+    volatile unsigned long* p_cnt = (volatile unsigned long*)arg;
 
-    for(int i = 0; i < NUMBER_OF_INCREMENTS; i++)
+    for(unsigned long i = 0; i < increments_num; i++)
     {
         ++(*(p_cnt));
     }
 
     // Unlock the mutex for other threads to be able to use the counter variable.
     if(use_mutex)
-        pthread_mutex_unlock(&lock);
+        TRACED_MUTEX_UNLOCK(&lock);
 
     return NULL;
 }
@@ -85,26 +93,41 @@ static void* incrementFunction(void* arg)
 static int createThreadsAndRun()
 {
     counter = 0;
-    pthread_t threads[NUMBER_OF_THREADS];
+
+    // The number of threads is a lesson parameter, so thread handles are allocated on the heap rather than on the stack.
+    unsigned long threads_num = getLessonParameter(LESSON_PARAM_THREADS, NUMBER_OF_THREADS);
+    pthread_t* threads = (pthread_t*)calloc(threads_num, sizeof(pthread_t));
+
+    if(threads == NULL)
+    {
+        printf("%sCould not allocate %lu thread handles.%s\r\n", PRINT_COLOR_RED, threads_num, PRINT_COLOR_RESET);
+        return -1;
+    }
 
     if(use_mutex)
         pthread_mutex_init(&lock, NULL);
 
     // Declare a function to the target routine to be executed.
 
-    for(int i = 0; i < sizeof(threads) / sizeof(threads[0]); i++)
-    {
-        if(checkThreadCreationStatus( pthread_create(&threads[i], NULL, incrementFunction, &counter) ))
-        {
-            if(use_mutex)
-                pthread_mutex_destroy(&lock);
-            
-            return -1;
-        }
-    }
+    unsigned long created_num = 0;
 
-    for(int i = 0; i < sizeof(threads) / sizeof(threads[0]); i++)
+    for(; created_num < threads_num; created_num++)
+        if(checkThreadCreationStatus( TRACED_THREAD_CREATE(&threads[created_num], NULL, incrementFunction, &counter) ))
+            break;
+
+    // Threads created before a failure are waited for anyway, as they use the mutex.
+    for(unsigned long i = 0; i < created_num; i++)
         pthread_join(threads[i], NULL);
+
+    free(threads);
+
+    if(created_num < threads_num)
+    {
+        if(use_mutex)
+            pthread_mutex_destroy(&lock);
+
+        return -1;
+    }
     
     printf("%sFinal counter value (%sUSING MUTEX):\t%lu%s\r\n"   ,
             (use_mutex ? PRINT_COLOR_GREEN : PRINT_COLOR_RED)   ,
@@ -119,6 +142,8 @@ static int createThreadsAndRun()
 
 void functionUsingThreadWithoutMutex()
 {
+    increments_num = getLessonParameter(LESSON_PARAM_INCREMENTS, NUMBER_OF_INCREMENTS);
+
     printf("%sNot using Mutex:%s\r\n", PRINT_COLOR_YELLOW, PRINT_COLOR_RESET);
     use_mutex = 0;
     createThreadsAndRun();
@@ -128,6 +153,12 @@ void functionUsingThreadWithoutMutex()
     createThreadsAndRun();
 }
 
+// Increments done by a single run of the lesson (both with and without mutex), used to report its throughput when benchmarked.
+unsigned long long getMutexWorkUnits()
+{
+    return 2ULL * getLessonParameter(LESSON_PARAM_THREADS, NUMBER_OF_THREADS) * getLessonParameter(LESSON_PARAM_INCREMENTS, NUMBER_OF_INCREMENTS);
+}
+
 /*
 As seen on the resulting counters, final values are way different depending on the mutex usage. Here is what happens when a integer-like variable
 is incremented in C (var++):
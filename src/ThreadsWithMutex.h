@@ -5,6 +5,7 @@
 
 void functionUsingThreadWithoutMutex();
 void functionUsingThreadWithMutex();
+unsigned long long getMutexWorkUnits();
 
 /**************************************/
 
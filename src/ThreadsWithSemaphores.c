@@ -43,17 +43,24 @@ Two examples will be shown in this case, one for each semaphore type.
 
 #include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <semaphore.h>
 #include "ThreadColors.h"
 #include "ThreadCreationStatus.h"
+#include "ThreadTracer.h"
+#include "LessonParameters.h"
+#include "VirtualTime.h"
 #include "ThreadsWithSemaphores.h"
 
 /**************************************/
 
 /********** Define statements *********/
 
+// Default values for the binary semaphore test, which can be overridden through lesson parameters (see LessonParameters.c).
 #define MAX_ITERATIONS_NUMBER   100000
+#define BINARY_SEM_THREADS      2
+
 #define MAX_COUNTING_SEM_SLOTS  3
 #define MAX_NUM_OF_THREADS      5 
 
@@ -63,8 +70,9 @@ Two examples will be shown in this case, one for each semaphore type.
 
 typedef struct
 {
-    unsigned long*  p_counter   ;
-    sem_t*          p_semaphore ;
+    unsigned long*  p_counter       ;
+    sem_t*          p_semaphore     ;
+    unsigned long   iterations_num  ;
 } BINARY_SEMAPHORE_DATA;
 
 typedef struct
@@ -95,16 +103,17 @@ static void* binarySemaphoreRoutine(void* arg)
     pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, NULL);
 
     // Count until the maximum number of iterations is reached.
-    for(int i = 0; i < MAX_ITERATIONS_NUMBER; i++)
+    for(unsigned long i = 0; i < bsd->iterations_num; i++)
     {
-        // Wait for the semaphore. Equivalent to locking a mutex.
-        sem_wait(bsd->p_semaphore);
+        // Wait for the semaphore. Equivalent to locking a mutex. TRACED_* macros are just the plain calls unless the tracer is
+        // compiled in (see ThreadTracer.c).
+        TRACED_SEM_WAIT(bsd->p_semaphore);
 
         // Increment the counter.
         ++( *(bsd->p_counter) );
 
         // once, the critical code section is over, post (unlock) the semaphore.
-        sem_post(bsd->p_semaphore);
+        TRACED_SEM_POST(bsd->p_semaphore);
     }
 
     return NULL;
@@ -112,9 +121,15 @@ static void* binarySemaphoreRoutine(void* arg)
 
 static void testBinarySemaphores()
 {
-    // Create thread variables.
-    pthread_t t_0;
-    pthread_t t_1;
+    // Create thread variables. Their number is a lesson parameter, so they are allocated on the heap rather than on the stack.
+    unsigned long threads_num = getLessonParameter(LESSON_PARAM_THREADS, BINARY_SEM_THREADS);
+    pthread_t* threads = (pthread_t*)calloc(threads_num, sizeof(pthread_t));
+
+    if(threads == NULL)
+    {
+        printf("%sCould not allocate %lu thread handles.%s\r\n", PRINT_COLOR_RED, threads_num, PRINT_COLOR_RESET);
+        return;
+    }
 
     // Create binary semaphore variable.
     sem_t bin_sem;
@@ -128,27 +143,39 @@ static void testBinarySemaphores()
 
     BINARY_SEMAPHORE_DATA bin_sem_data = 
     {
-        .p_counter      = &counter      ,
-        .p_semaphore    = &bin_sem      ,
+        .p_counter      = &counter                                                              ,
+        .p_semaphore    = &bin_sem                                                              ,
+        .iterations_num = getLessonParameter(LESSON_PARAM_ITERATIONS, MAX_ITERATIONS_NUMBER)    ,
     };
 
     // Once it's done, create threads by passing them the task to accomplish as well as the binary semaphore's address.
-    if(checkThreadCreationStatus( pthread_create(&t_0, NULL, binarySemaphoreRoutine, &bin_sem_data) ))
-        return;
-    
-    if(checkThreadCreationStatus( pthread_create(&t_1, NULL, binarySemaphoreRoutine, &bin_sem_data) ))
+    for(unsigned long i = 0; i < threads_num; i++)
     {
-        pthread_cancel(t_0);
-        return;
+        if(checkThreadCreationStatus( TRACED_THREAD_CREATE(&threads[i], NULL, binarySemaphoreRoutine, &bin_sem_data) ))
+        {
+            // Cancelled threads are joined as well, as they use the semaphore and the counter, which live on this stack.
+            for(unsigned long j = 0; j < i; j++)
+                pthread_cancel(threads[j]);
+
+            for(unsigned long j = 0; j < i; j++)
+                pthread_join(threads[j], NULL);
+
+            sem_destroy(&bin_sem);
+            free(threads);
+
+            return;
+        }
     }
 
-    pthread_join(t_0, NULL);
-    pthread_join(t_1, NULL);
+    for(unsigned long i = 0; i < threads_num; i++)
+        pthread_join(threads[i], NULL);
 
     sem_destroy(&bin_sem);
+    free(threads);
 
-    printf( "%sCounter value after having ended both threads controlled by a binary semaphore: %lu%s\r\n",
+    printf( "%sCounter value after having ended %lu threads controlled by a binary semaphore: %lu%s\r\n",
             PRINT_COLOR_CYAN            ,
+            threads_num                 ,
             *(bin_sem_data.p_counter)   ,
             PRINT_COLOR_RESET           );
 }
@@ -162,10 +189,12 @@ static void* countingSemaphoreRoutine(void* arg)
     pthread_setcanceltype(PTHREAD_CANCEL_DEFERRED, NULL);
 
     // Wait for the counting semaphore to allow the current thread to proceed.
-    sem_wait(csd->p_semaphore);
+    THREAD_TRACE_SYNC_BEGIN(THREAD_TRACE_CATEGORY_SEMAPHORE, "semaphore wait", csd->p_semaphore);
+    virtualTimeSemWait(csd->p_semaphore);
+    THREAD_TRACE_SYNC_END(THREAD_TRACE_CATEGORY_SEMAPHORE, "semaphore wait", csd->p_semaphore);
 
-    // Simulate a connection request to server socket.
-    sleep(1);
+    // Simulate a connection request to server socket. A real server limiting requests this way is in EpollServer.c.
+    virtualTimeSleep(1);
 
     // Print the number of threads currently working in the critical section.
     int semaphore_free_slots;
@@ -178,7 +207,7 @@ static void* countingSemaphoreRoutine(void* arg)
             PRINT_COLOR_RESET                                                   );
 
     // Once it's done, signal the semaphore.
-    sem_post(csd->p_semaphore);
+    TRACED_SEM_POST(csd->p_semaphore);
 
     return NULL;
 }
@@ -211,7 +240,7 @@ static void testCountingSemaphores()
         counting_semaphore_data[i].color        = thread_color[i]   ;
         counting_semaphore_data[i].p_semaphore  = &counting_sem     ;
 
-        if( checkThreadCreationStatus( pthread_create( &threads[i], NULL, countingSemaphoreRoutine, &counting_semaphore_data[i] ) ) )
+        if( checkThreadCreationStatus( TRACED_THREAD_CREATE_WITH( virtualTimeThreadCreate, &threads[i], NULL, countingSemaphoreRoutine, &counting_semaphore_data[i] ) ) )
         {
             for(int j = (i - 1); j >= 0; j--)
                 pthread_cancel(threads[j]);
@@ -221,7 +250,7 @@ static void testCountingSemaphores()
     }
     
     for(int i = 0; i < sizeof(threads) / sizeof(threads[0]); i++)
-        pthread_join(threads[i], NULL);
+        virtualTimeThreadJoin(threads[i], NULL);
 
     sem_destroy(&counting_sem);
 }
@@ -232,4 +261,11 @@ void threadsWithSemaphores()
     testCountingSemaphores();
 }
 
+// Increments done by the binary semaphore test, used to report the lesson's throughput when benchmarked. Note that the counting
+// semaphore test just sleeps, so throughput is only meaningful if sleeps take no real time (see VirtualTime.c).
+unsigned long long getSemaphoresWorkUnits()
+{
+    return (unsigned long long)getLessonParameter(LESSON_PARAM_THREADS, BINARY_SEM_THREADS) * getLessonParameter(LESSON_PARAM_ITERATIONS, MAX_ITERATIONS_NUMBER);
+}
+
 /**************************************/
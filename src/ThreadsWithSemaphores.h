@@ -4,6 +4,7 @@
 /********* Function prototypes ********/
 
 void threadsWithSemaphores();
+unsigned long long getSemaphoresWorkUnits();
 
 /**************************************/
 
@@ -40,6 +40,7 @@ Note that such function may not be available in every environment. If so, try to
 #include <stdio.h>
 #include "ThreadColors.h"
 #include "ThreadCreationStatus.h"
+#include "VirtualTime.h"
 #include "ThreadsWithTimedMutex.h"
 
 /**************************************/
@@ -82,7 +83,7 @@ static void* threadBRoutine(void* arg);
 
 static int lockTimedMutex(pthread_mutex_t* mutex, struct timespec* timeout)
 {
-    int ret = pthread_mutex_timedlock(mutex, timeout);
+    int ret = virtualTimeMutexTimedLock(mutex, timeout);
 
     if(ret == 0)
         printf("%sTimed mutex (addr: %p) succesfully locked.%s\r\n",
@@ -112,14 +113,13 @@ static void* generalThreadRoutine(void* arg)
             shared_mutexes->m_1     ,
             PRINT_COLOR_RESET       );
 
-    m_1_timeout.tv_nsec = 0;
-    m_1_timeout.tv_sec  = time(NULL) + shared_mutexes->time_offset;
+    virtualTimeGetDeadline(&m_1_timeout, shared_mutexes->time_offset);
 
     if(lockTimedMutex(shared_mutexes->m_1, &m_1_timeout))
         return NULL;
 
     // Simulate some work to be done so that deadlock happens ...
-    sleep(shared_mutexes->work_time);
+    virtualTimeSleep(shared_mutexes->work_time);
 
     // Try to lock mutex 2 (mutex 1 for B thread's routine).
     printf("%sThread with ID: %lu trying to lock mutex in address %p.%s\r\n",
@@ -128,8 +128,7 @@ static void* generalThreadRoutine(void* arg)
             shared_mutexes->m_2     ,
             PRINT_COLOR_RESET       );
     
-    m_2_timeout.tv_nsec = 0;
-    m_2_timeout.tv_sec  = time(NULL) + shared_mutexes->time_offset;
+    virtualTimeGetDeadline(&m_2_timeout, shared_mutexes->time_offset);
 
     if(lockTimedMutex(shared_mutexes->m_2, &m_2_timeout))
     {
@@ -192,17 +191,17 @@ void functionUsingThreadWithTimedMutex()
     shared_mutexes.work_time = SIMULATED_WORK_TIME;
 
     // Run each thread now.
-    if(checkThreadCreationStatus( pthread_create(&t_A, NULL, threadARoutine, &shared_mutexes) ))
+    if(checkThreadCreationStatus( virtualTimeThreadCreate(&t_A, NULL, threadARoutine, &shared_mutexes) ))
         return;
 
-    if(checkThreadCreationStatus( pthread_create(&t_B, NULL, threadBRoutine, &shared_mutexes) ))
+    if(checkThreadCreationStatus( virtualTimeThreadCreate(&t_B, NULL, threadBRoutine, &shared_mutexes) ))
     {
-        pthread_join(t_A, NULL);
+        virtualTimeThreadJoin(t_A, NULL);
         return;
     }
 
-    pthread_join(t_A, NULL);
-    pthread_join(t_B, NULL);
+    virtualTimeThreadJoin(t_A, NULL);
+    virtualTimeThreadJoin(t_B, NULL);
 
     pthread_mutex_destroy(shared_mutexes.m_1);
     pthread_mutex_destroy(shared_mutexes.m_2);
@@ -31,6 +31,7 @@ will decide how thread A behaves afterwards.
 #include <errno.h>
 #include "ThreadColors.h"
 #include "ThreadCreationStatus.h"
+#include "VirtualTime.h"
 #include "ThreadsWithTimedWait.h"
 
 /**************************************/
@@ -85,8 +86,7 @@ static void* workerThreadRoutine(void* arg)
 
     struct timespec timeout;
 
-    timeout.tv_nsec = 0;
-    timeout.tv_sec  = time(NULL) + *(worker_data->p_wait_offset);
+    virtualTimeGetDeadline(&timeout, *(worker_data->p_wait_offset));
 
     // Lock the mutex first.
     pthread_mutex_lock(worker_data->p_common_data->p_mutex);
@@ -97,7 +97,7 @@ static void* workerThreadRoutine(void* arg)
             PRINT_COLOR_RESET   );
     
     // Release mutex and wait for signaled condition to be met again.
-    int ret = pthread_cond_timedwait(   worker_data->p_common_data->p_condition ,
+    int ret = virtualTimeCondTimedWait( worker_data->p_common_data->p_condition ,
                                         worker_data->p_common_data->p_mutex     ,
                                         &timeout                                );
 
@@ -129,13 +129,13 @@ static void* signalerThreadRoutine(void* arg)
     SIGNALER_DATA* signaler_data = (SIGNALER_DATA*)arg;
 
     // Forcefully delay thread's execution routine.
-    sleep(*(signaler_data->p_initial_delay));
+    virtualTimeSleep(*(signaler_data->p_initial_delay));
 
     // Lock mutex.
     pthread_mutex_lock(signaler_data->p_common_data->p_mutex);
 
     // Signal condition.
-    pthread_cond_signal(signaler_data->p_common_data->p_condition);
+    virtualTimeCondSignal(signaler_data->p_common_data->p_condition);
 
     // Unlock mutex.
     pthread_mutex_unlock(signaler_data->p_common_data->p_mutex);
@@ -183,18 +183,18 @@ static void timedWaitTestCase(unsigned long worker_time_offset, unsigned long si
     };
 
     // Initialize worker (t_0) and signaler (t_1) threads.
-    if(checkThreadCreationStatus( pthread_create(&t_0, NULL, workerThreadRoutine, &worker_data) ))
+    if(checkThreadCreationStatus( virtualTimeThreadCreate(&t_0, NULL, workerThreadRoutine, &worker_data) ))
         return;
     
-    if(checkThreadCreationStatus( pthread_create(&t_1, NULL, signalerThreadRoutine, &signaler_data) ))
+    if(checkThreadCreationStatus( virtualTimeThreadCreate(&t_1, NULL, signalerThreadRoutine, &signaler_data) ))
     {
-        pthread_join(t_0, NULL);
+        virtualTimeThreadJoin(t_0, NULL);
         return;
     }
 
     // Wait for both threads to join main thread again.
-    pthread_join(t_0, NULL);
-    pthread_join(t_1, NULL);
+    virtualTimeThreadJoin(t_0, NULL);
+    virtualTimeThreadJoin(t_1, NULL);
 
     // Destroy mutex and condition variables.
     pthread_mutex_destroy(&mutex);
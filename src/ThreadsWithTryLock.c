@@ -27,6 +27,7 @@ consequence if such lockage is not possible.
 #include <unistd.h>
 #include "ThreadColors.h"
 #include "ThreadCreationStatus.h"
+#include "VirtualTime.h"
 #include "ThreadsWithTryLock.h"
 
 /**************************************/
@@ -76,7 +77,7 @@ static void* threadsWithTryLockRoutine(void* arg)
             PRINT_COLOR_RESET   );
 
     // If target mutex gets locked by current thread, simulate some work, then release the mutex.
-    sleep(DEFAULT_WORK_TIME);
+    virtualTimeSleep(DEFAULT_WORK_TIME);
 
     // Finally, unlock the mutex and exit the function.
     pthread_mutex_unlock(p_mutex);
@@ -96,17 +97,17 @@ void threadsWithTryLock()
     pthread_mutex_init(&mutex, NULL);
 
     // Initialize threads, passing shared mutex as input parameter for both.
-    if(checkThreadCreationStatus( pthread_create(&t_0, NULL, threadsWithTryLockRoutine, &mutex) ))
+    if(checkThreadCreationStatus( virtualTimeThreadCreate(&t_0, NULL, threadsWithTryLockRoutine, &mutex) ))
         return;
     
-    if(checkThreadCreationStatus( pthread_create(&t_1, NULL, threadsWithTryLockRoutine, &mutex) ))
+    if(checkThreadCreationStatus( virtualTimeThreadCreate(&t_1, NULL, threadsWithTryLockRoutine, &mutex) ))
     {
-        pthread_join(t_0, NULL);
+        virtualTimeThreadJoin(t_0, NULL);
         return;
     }
 
-    pthread_join(t_0, NULL);
-    pthread_join(t_1, NULL);
+    virtualTimeThreadJoin(t_0, NULL);
+    virtualTimeThreadJoin(t_1, NULL);
 
     pthread_mutex_destroy(&mutex);
 }
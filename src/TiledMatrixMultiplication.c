@@ -0,0 +1,299 @@
+/*
+MatrixMultiplication.c creates a thread per element of the resulting matrix, and every thread takes the next pending element, so
+consecutive elements computed by a thread hardly ever share any data. Here the same product is worked out by a thread pool (see
+ThreadPool.c) instead, with the work laid out so that caches are reused:
+    ·Matrices are stored as single row-major arrays, so rows are contiguous in memory.
+    ·C is split into square tiles (tile-dim x tile-dim elements, 32 by default), and each tile is a task. Computing a tile reads a
+    band of rows of A and a band of columns of B, which stay in cache for the whole tile.
+    ·Each band of tile rows of C is owned by one of the workers' CPUs. The lesson submits a task per band, hinted with its owner's
+    CPU, and each band task submits the tiles in its band from its worker. These go to the worker's own queue, so the band's rows of
+    A are reused from its caches tile after tile.
+    ·Workers running out of tiles steal them from other workers, nearest ones first.
+
+Locality hit rates (how many tasks were run by the worker they were meant for) and steals are printed once the product is done.
+Setting --tile-dim to the matrix dimension turns the whole product into a single task, while --tile-dim=1 makes tasks as small as
+in MatrixMultiplication.c, where handing them out costs more than computing them.
+*/
+
+/********* Include statements *********/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <time.h>
+#include "ThreadColors.h"
+#include "ThreadPool.h"
+#include "LessonParameters.h"
+#include "WorkSpan.h"
+#include "TiledMatrixMultiplication.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define DEFAULT_MAT_DIM     128
+#define DEFAULT_TILE_DIM    32
+#define MIN_MAT_VAL         0
+#define MAX_MAT_VAL         10
+#define SPOT_CHECKS_NUM     16      // Elements of C checked against a plain row by column product.
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+typedef struct
+{
+    const int*      mat_A           ;
+    const int*      mat_B           ;
+    int*            mat_C           ;
+    unsigned int    dim             ;
+    unsigned int    tile_dim        ;
+    unsigned int    tiles_per_row   ;
+    THREAD_POOL*    pool            ;
+    WORK_SPAN_JOB*  job             ;
+} TILED_MATRIX_COMMON_DATA;
+
+typedef struct
+{
+    const TILED_MATRIX_COMMON_DATA* common      ;
+    unsigned int                    tile_row    ;
+    unsigned int                    tile_col    ;
+} TILE_TASK_DATA;
+
+typedef struct
+{
+    const TILED_MATRIX_COMMON_DATA* common      ;
+    TILE_TASK_DATA*                 tiles       ;   // The band's tiles, one per tile column.
+} BAND_TASK_DATA;
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static int*         createRandomValuesMatrix(unsigned int dim);
+static void         multiplyTile(void* arg);
+static void         submitBandTiles(void* arg);
+static int          spotCheckResult(const int* mat_A, const int* mat_B, const int* mat_C, unsigned int dim);
+static unsigned int getAvailableCPUs();
+
+/**************************************/
+
+/******** Function definitions ********/
+
+static int* createRandomValuesMatrix(unsigned int dim)
+{
+    int* mat = (int*)malloc((size_t)dim * dim * sizeof(int));
+
+    if(mat == NULL)
+        return NULL;
+
+    for(size_t element_idx = 0; element_idx < (size_t)dim * dim; element_idx++)
+        mat[element_idx] = rand() % (MAX_MAT_VAL - MIN_MAT_VAL + 1) + MIN_MAT_VAL;
+
+    return mat;
+}
+
+// Rows of the tile are accumulated in i-k-j order, so that the innermost loop walks rows of B and C sequentially.
+static void multiplyTile(void* arg)
+{
+    TILE_TASK_DATA* tile = (TILE_TASK_DATA*)arg;
+    const TILED_MATRIX_COMMON_DATA* common = tile->common;
+
+    WORK_SPAN_TASK task;
+    workSpanTaskBegin(&task);
+
+    unsigned int dim = common->dim;
+    unsigned int first_row = tile->tile_row * common->tile_dim;
+    unsigned int first_col = tile->tile_col * common->tile_dim;
+    unsigned int last_row = (first_row + common->tile_dim < dim ? first_row + common->tile_dim : dim);
+    unsigned int last_col = (first_col + common->tile_dim < dim ? first_col + common->tile_dim : dim);
+
+    for(unsigned int row = first_row; row < last_row; row++)
+    {
+        int* row_C = &common->mat_C[(size_t)row * dim];
+
+        for(unsigned int col = first_col; col < last_col; col++)
+            row_C[col] = 0;
+
+        for(unsigned int k = 0; k < dim; k++)
+        {
+            int value_A = common->mat_A[(size_t)row * dim + k];
+            const int* row_B = &common->mat_B[(size_t)k * dim];
+
+            for(unsigned int col = first_col; col < last_col; col++)
+                row_C[col] += value_A * row_B[col];
+        }
+    }
+
+    workSpanTaskEnd(common->job, &task);
+}
+
+// Run by the worker owning the band, so that its tiles go to that worker's own queue.
+static void submitBandTiles(void* arg)
+{
+    BAND_TASK_DATA* band = (BAND_TASK_DATA*)arg;
+
+    WORK_SPAN_TASK task;
+    workSpanTaskBegin(&task);
+
+    for(unsigned int tile_col = 0; tile_col < band->common->tiles_per_row; tile_col++)
+        if(threadPoolSubmit(band->common->pool, multiplyTile, &band->tiles[tile_col], THREAD_POOL_NO_HINT) < 0)
+            multiplyTile(&band->tiles[tile_col]);
+
+    workSpanTaskEnd(band->common->job, &task);
+}
+
+// Returns the number of spot-checked elements which turned out to be wrong.
+static int spotCheckResult(const int* mat_A, const int* mat_B, const int* mat_C, unsigned int dim)
+{
+    int wrong_num = 0;
+
+    for(unsigned int check_idx = 0; check_idx < SPOT_CHECKS_NUM; check_idx++)
+    {
+        unsigned int row = (unsigned int)rand() % dim;
+        unsigned int col = (unsigned int)rand() % dim;
+        int expected = 0;
+
+        for(unsigned int k = 0; k < dim; k++)
+            expected += mat_A[(size_t)row * dim + k] * mat_B[(size_t)k * dim + col];
+
+        if(mat_C[(size_t)row * dim + col] != expected)
+            ++wrong_num;
+    }
+
+    return wrong_num;
+}
+
+static unsigned int getAvailableCPUs()
+{
+    cpu_set_t cpu_set;
+
+    if(sched_getaffinity(0, sizeof(cpu_set), &cpu_set) < 0)
+        return 1;
+
+    int cpus_num = CPU_COUNT(&cpu_set);
+
+    return (cpus_num > 0 ? (unsigned int)cpus_num : 1);
+}
+
+void exampleTiledMatrixMultiplication()
+{
+    WORK_SPAN_JOB job;
+    workSpanJobBegin(&job, "matrix-tiled");
+
+    srand(time(NULL));
+
+    // Matrices are square. Both their dimension and the tiles' one can be given as lesson parameters (see LessonParameters.c), as
+    // well as the number of workers, which is one per available CPU otherwise.
+    unsigned int dim = (unsigned int)getLessonParameter(LESSON_PARAM_MAT_DIM, DEFAULT_MAT_DIM);
+    unsigned int tile_dim = (unsigned int)getLessonParameter(LESSON_PARAM_TILE_DIM, DEFAULT_TILE_DIM);
+    unsigned int workers_num = (unsigned int)getLessonParameter(LESSON_PARAM_THREADS, getAvailableCPUs());
+
+    if(tile_dim > dim)
+        tile_dim = dim;
+
+    unsigned int tiles_per_row = (dim + tile_dim - 1) / tile_dim;
+
+    int* mat_A = createRandomValuesMatrix(dim);
+    int* mat_B = createRandomValuesMatrix(dim);
+    int* mat_C = (int*)malloc((size_t)dim * dim * sizeof(int));
+    TILE_TASK_DATA* tiles = (TILE_TASK_DATA*)malloc((size_t)tiles_per_row * tiles_per_row * sizeof(TILE_TASK_DATA));
+    BAND_TASK_DATA* bands = (BAND_TASK_DATA*)malloc(tiles_per_row * sizeof(BAND_TASK_DATA));
+    THREAD_POOL* pool = threadPoolCreate(workers_num);
+
+    if(mat_A == NULL || mat_B == NULL || mat_C == NULL || tiles == NULL || bands == NULL || pool == NULL)
+    {
+        printf("%sCould not allocate matrices, tasks or the thread pool, so the procedure cannot go on.%s\r\n",
+                PRINT_COLOR_RED     ,
+                PRINT_COLOR_RESET   );
+
+        threadPoolDestroy(pool);
+        free(bands);
+        free(tiles);
+        free(mat_C);
+        free(mat_B);
+        free(mat_A);
+        return;
+    }
+
+    TILED_MATRIX_COMMON_DATA common_data =
+    {
+        .mat_A          = mat_A         ,
+        .mat_B          = mat_B         ,
+        .mat_C          = mat_C         ,
+        .dim            = dim           ,
+        .tile_dim       = tile_dim      ,
+        .tiles_per_row  = tiles_per_row ,
+        .pool           = pool          ,
+        .job            = &job          ,
+    };
+
+    for(unsigned int tile_row = 0; tile_row < tiles_per_row; tile_row++)
+    {
+        bands[tile_row].common  = &common_data                          ;
+        bands[tile_row].tiles   = &tiles[tile_row * tiles_per_row]      ;
+
+        for(unsigned int tile_col = 0; tile_col < tiles_per_row; tile_col++)
+        {
+            TILE_TASK_DATA* tile = &bands[tile_row].tiles[tile_col];
+
+            tile->common    = &common_data  ;
+            tile->tile_row  = tile_row      ;
+            tile->tile_col  = tile_col      ;
+        }
+    }
+
+    workSpanParallelBegin(&job);
+
+    // Bands are dealt out to the workers' CPUs in turn.
+    unsigned int pool_workers_num = threadPoolGetWorkersNum(pool);
+
+    for(unsigned int tile_row = 0; tile_row < tiles_per_row; tile_row++)
+    {
+        int owner_cpu = (pool_workers_num > 0 ? threadPoolGetWorkerCPU(pool, tile_row % pool_workers_num) : THREAD_POOL_NO_HINT);
+
+        if(threadPoolSubmit(pool, submitBandTiles, &bands[tile_row], owner_cpu) < 0)
+            submitBandTiles(&bands[tile_row]);
+    }
+
+    threadPoolWait(pool);
+
+    workSpanParallelEnd(&job);
+    workSpanJobEnd(&job);
+
+    int wrong_num = spotCheckResult(mat_A, mat_B, mat_C, dim);
+
+    printf("%sMultiplied two %ux%u matrices in %u tile(s) of %ux%u using %u worker(s).%s\r\n",
+            (wrong_num == 0 ? PRINT_COLOR_GREEN : PRINT_COLOR_RED)  ,
+            dim                                                     ,
+            dim                                                     ,
+            tiles_per_row * tiles_per_row                           ,
+            tile_dim                                                ,
+            tile_dim                                                ,
+            pool_workers_num                                        ,
+            PRINT_COLOR_RESET                                       );
+
+    if(wrong_num > 0)
+        printf("%s%d of %d spot-checked element(s) are wrong!%s\r\n", PRINT_COLOR_RED, wrong_num, SPOT_CHECKS_NUM, PRINT_COLOR_RESET);
+
+    threadPoolPrintStats(pool);
+    threadPoolDestroy(pool);
+
+    free(bands);
+    free(tiles);
+    free(mat_C);
+    free(mat_B);
+    free(mat_A);
+}
+
+// Multiply-adds done by a single run of the lesson, used to report its throughput when benchmarked.
+unsigned long long getTiledMatrixMultiplicationWorkUnits()
+{
+    unsigned long long dim = getLessonParameter(LESSON_PARAM_MAT_DIM, DEFAULT_MAT_DIM);
+
+    return dim * dim * dim;
+}
+
+/**************************************/
@@ -0,0 +1,11 @@
+#ifndef TILED_MATRIX_MULTIPLICATION_H
+#define TILED_MATRIX_MULTIPLICATION_H
+
+/********* Function prototypes ********/
+
+void exampleTiledMatrixMultiplication();
+unsigned long long getTiledMatrixMultiplicationWorkUnits();
+
+/**************************************/
+
+#endif
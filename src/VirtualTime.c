@@ -0,0 +1,620 @@
+/*
+Many lessons pace themselves with sleep() or timeouts, so most of the time they take is spent idle. Virtual time replaces the real
+clock with a simulated one, which only moves forward once every thread taking part in a lesson is blocked on something that can
+only end as time goes by. Then, the clock jumps straight to the earliest deadline, waking the threads waiting for it up. Thus,
+sleeps and timeouts take no real time at all, while threads still get woken up in the very same order they would be with the real
+clock.
+
+Lessons use the functions below instead of the pthread ones they replace. When virtual time is disabled (the default), they just
+call the original functions, so lessons behave exactly as before:
+    ·virtualTimeSleep, virtualTimeSleepUntil: sleep().
+    ·virtualTimeGetTime, virtualTimeGetDeadline: time(NULL), and the absolute timeouts built from it.
+    ·virtualTimeMutexTimedLock, virtualTimeCondWait, virtualTimeCondTimedWait, virtualTimeSemWait: their pthread and semaphore
+    counterparts, with deadlines given in virtual time.
+    ·virtualTimeCondSignal, virtualTimeCondBroadcast: pthread_cond_signal and pthread_cond_broadcast.
+    ·virtualTimeThreadCreate, virtualTimeThreadJoin: pthread_create and pthread_join.
+
+Threads taking part in virtual time ("participants") are the ones created through virtualTimeThreadCreate plus the thread running
+the lesson (see virtualTimeRunAsParticipant, or virtualTimeRunOnThread to run it on a thread of its own). The clock knows whether each of them is running or blocked:
+    ·Sleeping threads and threads waiting on a condition variable wait for the clock itself, or for a signal given through
+    virtualTimeCondSignal, so their state is always known.
+    ·Threads waiting on a mutex, a semaphore or another thread to end cannot be told about unlocks, posts or exits, so they keep
+    on trying every millisecond (of real time). The clock does not move forward until each of them has tried again after the last
+    change in any participant's state, so a resource released just before its owner blocked is never missed.
+*/
+
+/********* Include statements *********/
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include "VirtualTime.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define POLL_TICK_NS    1000000L
+#define NS_PER_SECOND   1000000000L
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+typedef enum
+{
+    VIRTUAL_TIME_WAITER_SLEEP   ,   // Woken up by the clock.
+    VIRTUAL_TIME_WAITER_COND    ,   // Woken up by the clock or by a signal.
+    VIRTUAL_TIME_WAITER_POLL    ,   // Keeps on trying, acknowledging every change in participants' state.
+} VIRTUAL_TIME_WAITER_TYPE;
+
+typedef struct VIRTUAL_TIME_WAITER
+{
+    VIRTUAL_TIME_WAITER_TYPE    type        ;
+    const struct timespec*      deadline    ;   // NULL if the waiter can only be woken up by other threads.
+    pthread_cond_t*             cond        ;
+    pthread_mutex_t*            mutex       ;
+    int                         blocked     ;
+    int                         signaled    ;
+    int                         temporary   ;   // Set if the thread is a participant just while waiting.
+    int                         acked       ;
+    unsigned long               acked_epoch ;
+    struct VIRTUAL_TIME_WAITER* next        ;
+} VIRTUAL_TIME_WAITER;
+
+typedef struct
+{
+    void*   (*start_routine)(void*) ;
+    void*   arg                     ;
+} VIRTUAL_TIME_THREAD_START;
+
+typedef struct
+{
+    pthread_t   thread  ;
+    void**      retval  ;
+} VIRTUAL_TIME_JOIN;
+
+/**************************************/
+
+/********* Private variables **********/
+
+static int                  vt_enabled          = 0;
+static pthread_mutex_t      vt_mutex            = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t       vt_cond             = PTHREAD_COND_INITIALIZER;
+static struct timespec      vt_now              = { 0, 0 };
+static unsigned long        vt_epoch            = 0;   // Increased on every change in participants' state.
+static unsigned int         participants_num    = 0;
+static unsigned int         blocked_num         = 0;
+static VIRTUAL_TIME_WAITER* waiters_head        = NULL;
+static VIRTUAL_TIME_WAITER* waiters_tail        = NULL;
+
+static _Thread_local int    is_participant      = 0;
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static int      compareTimes(const struct timespec* a, const struct timespec* b);
+static void     getPollTick(struct timespec* tick);
+static void     tryAdvance();
+static void     addWaiter(VIRTUAL_TIME_WAITER* waiter);
+static void     removeWaiter(VIRTUAL_TIME_WAITER* waiter);
+static void     wakeWaiter(VIRTUAL_TIME_WAITER* waiter);
+static void     removeWaiterCleanup(void* arg);
+static void     removeLockedWaiterCleanup(void* arg);
+static void     condWaitCleanup(void* arg);
+static void     leaveCleanup(void* arg);
+static void*    participantRoutine(void* arg);
+static void*    runnerRoutine(void* arg);
+static int      pollUntil(int (*attempt)(void*, const struct timespec*), void* object, const struct timespec* deadline);
+static int      attemptMutexLock(void* object, const struct timespec* tick);
+static int      attemptSemWait(void* object, const struct timespec* tick);
+static int      attemptThreadJoin(void* object, const struct timespec* tick);
+static int      condWait(pthread_cond_t* cond, pthread_mutex_t* mutex, const struct timespec* deadline);
+static int      condWake(pthread_cond_t* cond, int wake_all);
+
+/**************************************/
+
+/******** Function definitions ********/
+
+static int compareTimes(const struct timespec* a, const struct timespec* b)
+{
+    if(a->tv_sec != b->tv_sec)
+        return (a->tv_sec < b->tv_sec ? -1 : 1);
+
+    return (a->tv_nsec < b->tv_nsec ? -1 : (a->tv_nsec > b->tv_nsec ? 1 : 0));
+}
+
+// Polling attempts block for a single tick of real time. Timed pthread functions expect CLOCK_REALTIME deadlines.
+static void getPollTick(struct timespec* tick)
+{
+    clock_gettime(CLOCK_REALTIME, tick);
+
+    tick->tv_nsec += POLL_TICK_NS;
+
+    if(tick->tv_nsec >= NS_PER_SECOND)
+    {
+        tick->tv_nsec -= NS_PER_SECOND;
+        ++tick->tv_sec;
+    }
+}
+
+// Must be called with vt_mutex locked. The clock moves forward just if every participant is blocked, every polling waiter has
+// tried again since the last change, and someone is waiting for a deadline.
+static void tryAdvance()
+{
+    if(participants_num == 0 || blocked_num < participants_num)
+        return;
+
+    const struct timespec* earliest = NULL;
+
+    for(VIRTUAL_TIME_WAITER* waiter = waiters_head; waiter != NULL; waiter = waiter->next)
+    {
+        if(!waiter->blocked)
+            continue;
+
+        if(waiter->type == VIRTUAL_TIME_WAITER_POLL && (!waiter->acked || waiter->acked_epoch != vt_epoch))
+            return;
+
+        if(waiter->deadline != NULL && (earliest == NULL || compareTimes(waiter->deadline, earliest) < 0))
+            earliest = waiter->deadline;
+    }
+
+    if(earliest == NULL || compareTimes(earliest, &vt_now) <= 0)
+        return;
+
+    vt_now = *earliest;
+    ++vt_epoch;
+
+    pthread_cond_broadcast(&vt_cond);
+}
+
+// Must be called with vt_mutex locked. Threads which are not participants become so while waiting.
+static void addWaiter(VIRTUAL_TIME_WAITER* waiter)
+{
+    if(!is_participant)
+    {
+        waiter->temporary = 1;
+        ++participants_num;
+    }
+
+    waiter->blocked = 1;
+    waiter->next = NULL;
+
+    if(waiters_tail != NULL)
+        waiters_tail->next = waiter;
+    else
+        waiters_head = waiter;
+
+    waiters_tail = waiter;
+
+    ++blocked_num;
+    ++vt_epoch;
+}
+
+// Must be called with vt_mutex locked.
+static void removeWaiter(VIRTUAL_TIME_WAITER* waiter)
+{
+    VIRTUAL_TIME_WAITER* previous = NULL;
+
+    for(VIRTUAL_TIME_WAITER* current = waiters_head; current != NULL; previous = current, current = current->next)
+    {
+        if(current != waiter)
+            continue;
+
+        if(previous != NULL)
+            previous->next = current->next;
+        else
+            waiters_head = current->next;
+
+        if(waiters_tail == current)
+            waiters_tail = previous;
+
+        break;
+    }
+
+    if(waiter->blocked)
+        --blocked_num;
+
+    if(waiter->temporary)
+        --participants_num;
+
+    waiter->blocked = 0;
+    ++vt_epoch;
+
+    tryAdvance();
+}
+
+// Must be called with vt_mutex locked. A signaled waiter is running from now on, even if it has not been scheduled yet.
+static void wakeWaiter(VIRTUAL_TIME_WAITER* waiter)
+{
+    waiter->signaled = 1;
+    waiter->blocked = 0;
+
+    --blocked_num;
+    ++vt_epoch;
+
+    pthread_cond_broadcast(&vt_cond);
+}
+
+static void removeWaiterCleanup(void* arg)
+{
+    pthread_mutex_lock(&vt_mutex);
+    removeWaiter((VIRTUAL_TIME_WAITER*)arg);
+    pthread_mutex_unlock(&vt_mutex);
+}
+
+// Cancelled waits on vt_cond get vt_mutex locked again before cleanup handlers are run.
+static void removeLockedWaiterCleanup(void* arg)
+{
+    removeWaiter((VIRTUAL_TIME_WAITER*)arg);
+    pthread_mutex_unlock(&vt_mutex);
+}
+
+// Same as pthread_cond_wait, the caller's mutex must be locked again before the caller's cleanup handlers are run.
+static void condWaitCleanup(void* arg)
+{
+    removeLockedWaiterCleanup(arg);
+    pthread_mutex_lock(((VIRTUAL_TIME_WAITER*)arg)->mutex);
+}
+
+static void leaveCleanup(void* arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&vt_mutex);
+
+    is_participant = 0;
+    --participants_num;
+    ++vt_epoch;
+
+    tryAdvance();
+
+    pthread_mutex_unlock(&vt_mutex);
+}
+
+static void* participantRoutine(void* arg)
+{
+    VIRTUAL_TIME_THREAD_START start = *((VIRTUAL_TIME_THREAD_START*)arg);
+    free(arg);
+
+    void* ret = NULL;
+
+    // The thread was counted as a participant by its creator already, so that the clock cannot move forward before it starts.
+    is_participant = 1;
+
+    // Cleanup handlers are run whether the routine returns, calls pthread_exit or gets cancelled.
+    pthread_cleanup_push(leaveCleanup, NULL);
+    ret = start.start_routine(start.arg);
+    pthread_cleanup_pop(1);
+
+    return ret;
+}
+
+// Keeps on calling "attempt" (which blocks for a tick at most) until it succeeds or the deadline in virtual time is reached.
+static int pollUntil(int (*attempt)(void*, const struct timespec*), void* object, const struct timespec* deadline)
+{
+    VIRTUAL_TIME_WAITER waiter = { .type = VIRTUAL_TIME_WAITER_POLL, .deadline = deadline };
+    int ret = ETIMEDOUT;
+
+    pthread_mutex_lock(&vt_mutex);
+    addWaiter(&waiter);
+    pthread_mutex_unlock(&vt_mutex);
+
+    pthread_cleanup_push(removeWaiterCleanup, &waiter);
+
+    for(;;)
+    {
+        pthread_mutex_lock(&vt_mutex);
+        unsigned long epoch = vt_epoch;
+        int expired = (deadline != NULL && compareTimes(&vt_now, deadline) >= 0);
+        pthread_mutex_unlock(&vt_mutex);
+
+        struct timespec tick;
+        getPollTick(&tick);
+
+        // An attempt is made even if the deadline has been reached, as timed functions do not fail if they do not have to wait.
+        ret = attempt(object, &tick);
+
+        if(ret != ETIMEDOUT || expired)
+            break;
+
+        // The attempt started after the epoch was read, so any change up to then has been seen.
+        pthread_mutex_lock(&vt_mutex);
+        waiter.acked = 1;
+        waiter.acked_epoch = epoch;
+        tryAdvance();
+        pthread_mutex_unlock(&vt_mutex);
+    }
+
+    pthread_cleanup_pop(1);
+
+    return ret;
+}
+
+static int attemptMutexLock(void* object, const struct timespec* tick)
+{
+    return pthread_mutex_timedlock((pthread_mutex_t*)object, tick);
+}
+
+static int attemptSemWait(void* object, const struct timespec* tick)
+{
+    if(sem_timedwait((sem_t*)object, tick) == 0)
+        return 0;
+
+    return (errno == EINTR ? ETIMEDOUT : errno);
+}
+
+static int attemptThreadJoin(void* object, const struct timespec* tick)
+{
+    VIRTUAL_TIME_JOIN* join = (VIRTUAL_TIME_JOIN*)object;
+
+    return pthread_timedjoin_np(join->thread, join->retval, tick);
+}
+
+static int condWait(pthread_cond_t* cond, pthread_mutex_t* mutex, const struct timespec* deadline)
+{
+    VIRTUAL_TIME_WAITER waiter = { .type = VIRTUAL_TIME_WAITER_COND, .cond = cond, .mutex = mutex, .deadline = deadline };
+    int ret;
+
+    // The waiter is registered before the mutex is released, so that a signal given right after cannot be missed.
+    pthread_mutex_lock(&vt_mutex);
+    addWaiter(&waiter);
+    pthread_mutex_unlock(mutex);
+    tryAdvance();
+
+    pthread_cleanup_push(condWaitCleanup, &waiter);
+
+    while(!waiter.signaled && (deadline == NULL || compareTimes(&vt_now, deadline) < 0))
+        pthread_cond_wait(&vt_cond, &vt_mutex);
+
+    pthread_cleanup_pop(0);
+
+    ret = (waiter.signaled ? 0 : ETIMEDOUT);
+
+    removeWaiter(&waiter);
+    pthread_mutex_unlock(&vt_mutex);
+
+    // The mutex may be held by a sleeping thread, so it must be waited for in virtual time as well.
+    pollUntil(attemptMutexLock, mutex, NULL);
+
+    return ret;
+}
+
+static int condWake(pthread_cond_t* cond, int wake_all)
+{
+    pthread_mutex_lock(&vt_mutex);
+
+    // Waiters are woken up in the same order they started waiting.
+    for(VIRTUAL_TIME_WAITER* waiter = waiters_head; waiter != NULL; waiter = waiter->next)
+    {
+        if(waiter->type != VIRTUAL_TIME_WAITER_COND || waiter->cond != cond || waiter->signaled || !waiter->blocked)
+            continue;
+
+        wakeWaiter(waiter);
+
+        if(!wake_all)
+            break;
+    }
+
+    pthread_mutex_unlock(&vt_mutex);
+
+    // Threads waiting on the condition without virtual time are woken up as usual.
+    return (wake_all ? pthread_cond_broadcast(cond) : pthread_cond_signal(cond));
+}
+
+// Must be called before any lesson is run.
+void virtualTimeEnable(int enabled)
+{
+    vt_enabled = enabled;
+}
+
+int virtualTimeIsEnabled()
+{
+    return vt_enabled;
+}
+
+void virtualTimeGetTime(struct timespec* now)
+{
+    if(!vt_enabled)
+    {
+        clock_gettime(CLOCK_REALTIME, now);
+        return;
+    }
+
+    pthread_mutex_lock(&vt_mutex);
+    *now = vt_now;
+    pthread_mutex_unlock(&vt_mutex);
+}
+
+// Builds an absolute timeout, as the ones expected by timed locks and waits, "seconds" away from now.
+void virtualTimeGetDeadline(struct timespec* deadline, unsigned int seconds)
+{
+    virtualTimeGetTime(deadline);
+    deadline->tv_sec += seconds;
+}
+
+unsigned int virtualTimeSleep(unsigned int seconds)
+{
+    if(!vt_enabled)
+        return sleep(seconds);
+
+    struct timespec deadline;
+    virtualTimeGetDeadline(&deadline, seconds);
+    virtualTimeSleepUntil(&deadline);
+
+    return 0;
+}
+
+int virtualTimeSleepUntil(const struct timespec* deadline)
+{
+    if(!vt_enabled)
+        return clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, deadline, NULL);
+
+    VIRTUAL_TIME_WAITER waiter = { .type = VIRTUAL_TIME_WAITER_SLEEP, .deadline = deadline };
+
+    pthread_mutex_lock(&vt_mutex);
+
+    addWaiter(&waiter);
+    tryAdvance();
+
+    pthread_cleanup_push(removeLockedWaiterCleanup, &waiter);
+
+    while(compareTimes(&vt_now, deadline) < 0)
+        pthread_cond_wait(&vt_cond, &vt_mutex);
+
+    pthread_cleanup_pop(0);
+
+    removeWaiter(&waiter);
+
+    pthread_mutex_unlock(&vt_mutex);
+
+    return 0;
+}
+
+int virtualTimeThreadCreate(pthread_t* thread, const pthread_attr_t* attr, void* (*start_routine)(void*), void* arg)
+{
+    if(!vt_enabled)
+        return pthread_create(thread, attr, start_routine, arg);
+
+    VIRTUAL_TIME_THREAD_START* start = (VIRTUAL_TIME_THREAD_START*)malloc(sizeof(VIRTUAL_TIME_THREAD_START));
+
+    if(start == NULL)
+        return EAGAIN;
+
+    start->start_routine = start_routine;
+    start->arg = arg;
+
+    pthread_mutex_lock(&vt_mutex);
+    ++participants_num;
+    ++vt_epoch;
+    pthread_mutex_unlock(&vt_mutex);
+
+    int ret = pthread_create(thread, attr, participantRoutine, start);
+
+    if(ret != 0)
+    {
+        free(start);
+
+        pthread_mutex_lock(&vt_mutex);
+        --participants_num;
+        ++vt_epoch;
+        tryAdvance();
+        pthread_mutex_unlock(&vt_mutex);
+    }
+
+    return ret;
+}
+
+int virtualTimeThreadJoin(pthread_t thread, void** retval)
+{
+    if(!vt_enabled)
+        return pthread_join(thread, retval);
+
+    VIRTUAL_TIME_JOIN join = { .thread = thread, .retval = retval };
+
+    return pollUntil(attemptThreadJoin, &join, NULL);
+}
+
+// Runs "function" as a participant, so that the clock does not move forward while it is running. The thread stops being a
+// participant even if the function calls pthread_exit.
+void virtualTimeRunAsParticipant(void (*function)(void))
+{
+    if(!vt_enabled || is_participant)
+    {
+        function();
+        return;
+    }
+
+    pthread_mutex_lock(&vt_mutex);
+    is_participant = 1;
+    ++participants_num;
+    ++vt_epoch;
+    pthread_mutex_unlock(&vt_mutex);
+
+    pthread_cleanup_push(leaveCleanup, NULL);
+    function();
+    pthread_cleanup_pop(1);
+}
+
+static void* runnerRoutine(void* arg)
+{
+    void (*function)(void) = *((void (**)(void))arg);
+
+    virtualTimeRunAsParticipant(function);
+
+    return NULL;
+}
+
+// Runs "function" as a participant within a dedicated thread and waits for it to end, so that functions calling pthread_exit (such
+// as ThreadsDetachment.c) end that thread rather than the caller. Returns pthread_create's error code if the thread was not created.
+int virtualTimeRunOnThread(void (*function)(void))
+{
+    pthread_t runner;
+    int ret = pthread_create(&runner, NULL, runnerRoutine, &function);
+
+    if(ret == 0)
+        pthread_join(runner, NULL);
+
+    return ret;
+}
+
+int virtualTimeMutexTimedLock(pthread_mutex_t* mutex, const struct timespec* deadline)
+{
+    if(!vt_enabled)
+        return pthread_mutex_timedlock(mutex, deadline);
+
+    return pollUntil(attemptMutexLock, mutex, deadline);
+}
+
+int virtualTimeCondWait(pthread_cond_t* cond, pthread_mutex_t* mutex)
+{
+    if(!vt_enabled)
+        return pthread_cond_wait(cond, mutex);
+
+    return condWait(cond, mutex, NULL);
+}
+
+int virtualTimeCondTimedWait(pthread_cond_t* cond, pthread_mutex_t* mutex, const struct timespec* deadline)
+{
+    if(!vt_enabled)
+        return pthread_cond_timedwait(cond, mutex, deadline);
+
+    return condWait(cond, mutex, deadline);
+}
+
+int virtualTimeCondSignal(pthread_cond_t* cond)
+{
+    if(!vt_enabled)
+        return pthread_cond_signal(cond);
+
+    return condWake(cond, 0);
+}
+
+int virtualTimeCondBroadcast(pthread_cond_t* cond)
+{
+    if(!vt_enabled)
+        return pthread_cond_broadcast(cond);
+
+    return condWake(cond, 1);
+}
+
+// Same as sem_wait, returns -1 and sets errno on failure.
+int virtualTimeSemWait(sem_t* semaphore)
+{
+    if(!vt_enabled)
+        return sem_wait(semaphore);
+
+    int ret = pollUntil(attemptSemWait, semaphore, NULL);
+
+    if(ret == 0)
+        return 0;
+
+    errno = ret;
+
+    return -1;
+}
+
+/**************************************/
@@ -0,0 +1,33 @@
+#ifndef VIRTUAL_TIME_H
+#define VIRTUAL_TIME_H
+
+/********* Include statements *********/
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+
+/**************************************/
+
+/********* Function prototypes ********/
+
+void            virtualTimeEnable(int enabled);
+int             virtualTimeIsEnabled();
+void            virtualTimeGetTime(struct timespec* now);
+void            virtualTimeGetDeadline(struct timespec* deadline, unsigned int seconds);
+unsigned int    virtualTimeSleep(unsigned int seconds);
+int             virtualTimeSleepUntil(const struct timespec* deadline);
+int             virtualTimeThreadCreate(pthread_t* thread, const pthread_attr_t* attr, void* (*start_routine)(void*), void* arg);
+int             virtualTimeThreadJoin(pthread_t thread, void** retval);
+void            virtualTimeRunAsParticipant(void (*function)(void));
+int             virtualTimeRunOnThread(void (*function)(void));
+int             virtualTimeMutexTimedLock(pthread_mutex_t* mutex, const struct timespec* deadline);
+int             virtualTimeCondWait(pthread_cond_t* cond, pthread_mutex_t* mutex);
+int             virtualTimeCondTimedWait(pthread_cond_t* cond, pthread_mutex_t* mutex, const struct timespec* deadline);
+int             virtualTimeCondSignal(pthread_cond_t* cond);
+int             virtualTimeCondBroadcast(pthread_cond_t* cond);
+int             virtualTimeSemWait(sem_t* semaphore);
+
+/**************************************/
+
+#endif
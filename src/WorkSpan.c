@@ -0,0 +1,300 @@
+/*
+How much faster can a job get by adding CPUs? The work/span model answers it for fork-join jobs, the ones made of serial parts and
+parallel sections of independent tasks (such as computing each element in MatrixMultiplication.c):
+    ·Work (T1): time it takes to run every part of the job on a single CPU, that is, the sum of the time of every part.
+    ·Span (Tinf): time it would take with infinitely many CPUs, that is, the length of the critical path: serial parts take as long
+    as ever, while a parallel section takes as long as its longest task.
+
+Then, whatever the number of CPUs P, the job cannot take less than T1 / P (there is just so much work to share) nor less than Tinf
+(the critical path has to be walked one step after another). Parallelism T1 / Tinf is the greatest speedup the job's structure
+allows. Comparing it with the observed speedup (T1 divided by the wall time the job actually took) tells what to do next:
+    ·Parallelism below the number of CPUs: adding cores does not help. The algorithm has to be restructured, so that serial parts
+    get shorter or parallel sections get more (or more balanced) tasks.
+    ·Parallelism above the number of CPUs, and observed speedup close to the number of CPUs: the job uses its CPUs well, so adding
+    cores would help.
+    ·Observed speedup well below both: the job is held back by overheads which do not show up as work, such as creating threads,
+    waiting for locks or handing out tasks. Tasks may be too small to be worth it.
+
+Work is measured as CPU time (CLOCK_THREAD_CPUTIME_ID of the thread running each part), so time spent preempted or waiting does not
+count as work. Tasks can be nested jobs themselves (as in recursive algorithms): a nested job's work and span are added to the
+parent's parallel section as a single task through workSpanAddTask.
+
+Measuring costs a couple of clock reads per task, so it is only done when enabled through workSpanEnable. Finished jobs are summed
+up by name, so that each job's averages can be printed once lessons are done, however many times they were run.
+*/
+
+/********* Include statements *********/
+
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include "WorkSpan.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define NS_PER_SEC                  1000000000ULL
+#define NS_PER_MSEC                 1e6
+#define MAX_JOB_NAMES               32
+#define WELL_USED_CPUS_FRACTION     0.8     // Observed speedups above this fraction of the achievable one mean CPUs are well used.
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+typedef struct
+{
+    const char*         name                ;
+    unsigned long       runs                ;
+    unsigned long long  work_ns             ;   // Summed over every run.
+    unsigned long long  span_ns             ;
+    unsigned long long  wall_ns             ;
+    unsigned long long  tasks               ;
+    unsigned long       parallel_sections   ;
+} WORK_SPAN_SUMMARY;
+
+/**************************************/
+
+/********* Private variables **********/
+
+static atomic_int           work_span_enabled;
+static pthread_mutex_t      summaries_lock = PTHREAD_MUTEX_INITIALIZER;
+static WORK_SPAN_SUMMARY    summaries[MAX_JOB_NAMES];
+static unsigned int         summaries_num;
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static unsigned long long   getClockTimeNs(clockid_t clock_id);
+static void                 closeSerialStrand(WORK_SPAN_JOB* job);
+static void                 addSummary(const WORK_SPAN_JOB* job);
+static unsigned int         getAvailableCPUs();
+
+/**************************************/
+
+/******** Function definitions ********/
+
+static unsigned long long getClockTimeNs(clockid_t clock_id)
+{
+    struct timespec now;
+    clock_gettime(clock_id, &now);
+
+    return ((unsigned long long)now.tv_sec * NS_PER_SEC + (unsigned long long)now.tv_nsec);
+}
+
+// The serial strand run by the owning thread since it started counts fully towards both work and span.
+static void closeSerialStrand(WORK_SPAN_JOB* job)
+{
+    unsigned long long strand_ns = getClockTimeNs(CLOCK_THREAD_CPUTIME_ID) - job->strand_start_ns;
+
+    job->work_ns += strand_ns;
+    job->span_ns += strand_ns;
+}
+
+static void addSummary(const WORK_SPAN_JOB* job)
+{
+    pthread_mutex_lock(&summaries_lock);
+
+    WORK_SPAN_SUMMARY* summary = NULL;
+
+    for(unsigned int summary_idx = 0; summary_idx < summaries_num && summary == NULL; summary_idx++)
+        if(strcmp(summaries[summary_idx].name, job->name) == 0)
+            summary = &summaries[summary_idx];
+
+    if(summary == NULL && summaries_num < MAX_JOB_NAMES)
+    {
+        summary = &summaries[summaries_num++];
+        memset(summary, 0, sizeof(WORK_SPAN_SUMMARY));
+        summary->name = job->name;
+    }
+
+    if(summary != NULL)
+    {
+        ++summary->runs;
+        summary->work_ns            += job->work_ns             ;
+        summary->span_ns            += job->span_ns             ;
+        summary->wall_ns            += job->wall_ns             ;
+        summary->tasks              += job->tasks               ;
+        summary->parallel_sections  += job->parallel_sections   ;
+    }
+
+    pthread_mutex_unlock(&summaries_lock);
+}
+
+static unsigned int getAvailableCPUs()
+{
+    cpu_set_t cpu_set;
+
+    if(sched_getaffinity(0, sizeof(cpu_set), &cpu_set) < 0)
+        return 1;
+
+    int cpus_num = CPU_COUNT(&cpu_set);
+
+    return (cpus_num > 0 ? (unsigned int)cpus_num : 1);
+}
+
+void workSpanEnable(int enabled)
+{
+    atomic_store(&work_span_enabled, (enabled ? 1 : 0));
+}
+
+int workSpanIsEnabled()
+{
+    return atomic_load(&work_span_enabled);
+}
+
+// Must be called by the thread owning the job, which runs its serial strands. "name" must outlive the job's summary.
+void workSpanJobBegin(WORK_SPAN_JOB* job, const char* name)
+{
+    if(job == NULL)
+        return;
+
+    memset(job, 0, sizeof(WORK_SPAN_JOB));
+    job->name = name;
+
+    if(!workSpanIsEnabled())
+        return;
+
+    job->start_time_ns      = getClockTimeNs(CLOCK_MONOTONIC)           ;
+    job->strand_start_ns    = getClockTimeNs(CLOCK_THREAD_CPUTIME_ID)   ;
+}
+
+// Tasks may be run from now on, by any thread. The owning thread's own time within the section (such as creating and joining
+// threads) is not work: it is an overhead, showing up just in the observed speedup.
+void workSpanParallelBegin(WORK_SPAN_JOB* job)
+{
+    if(job == NULL || !workSpanIsEnabled() || job->in_parallel_section)
+        return;
+
+    closeSerialStrand(job);
+
+    atomic_store(&job->section_work_ns  , 0);
+    atomic_store(&job->section_span_ns  , 0);
+    atomic_store(&job->section_tasks    , 0);
+
+    job->in_parallel_section = 1;
+}
+
+void workSpanTaskBegin(WORK_SPAN_TASK* task)
+{
+    if(task == NULL || !workSpanIsEnabled())
+        return;
+
+    task->start_ns = getClockTimeNs(CLOCK_THREAD_CPUTIME_ID);
+}
+
+// Must be called by the same thread which began the task.
+void workSpanTaskEnd(WORK_SPAN_JOB* job, const WORK_SPAN_TASK* task)
+{
+    if(job == NULL || task == NULL || !workSpanIsEnabled())
+        return;
+
+    unsigned long long task_ns = getClockTimeNs(CLOCK_THREAD_CPUTIME_ID) - task->start_ns;
+
+    workSpanAddTask(job, task_ns, task_ns);
+}
+
+// Adds a task to the current parallel section. A plain task's span is its work, while a nested job's span is shorter.
+void workSpanAddTask(WORK_SPAN_JOB* job, unsigned long long work_ns, unsigned long long span_ns)
+{
+    if(job == NULL || !workSpanIsEnabled())
+        return;
+
+    atomic_fetch_add_explicit(&job->section_work_ns, work_ns, memory_order_relaxed);
+    atomic_fetch_add_explicit(&job->section_tasks, 1, memory_order_relaxed);
+
+    unsigned long long section_span = atomic_load_explicit(&job->section_span_ns, memory_order_relaxed);
+
+    while(span_ns > section_span && !atomic_compare_exchange_weak_explicit(&job->section_span_ns, &section_span, span_ns, memory_order_relaxed, memory_order_relaxed))
+        ;
+}
+
+// Must be called once every task in the section has ended (such as after joining the threads running them).
+void workSpanParallelEnd(WORK_SPAN_JOB* job)
+{
+    if(job == NULL || !workSpanIsEnabled() || !job->in_parallel_section)
+        return;
+
+    job->work_ns    += atomic_load(&job->section_work_ns)   ;
+    job->span_ns    += atomic_load(&job->section_span_ns)   ;
+    job->tasks      += atomic_load(&job->section_tasks)     ;
+    ++job->parallel_sections;
+
+    job->in_parallel_section = 0;
+    job->strand_start_ns = getClockTimeNs(CLOCK_THREAD_CPUTIME_ID);
+}
+
+// Closes the last serial strand and adds the job to its name's summary.
+void workSpanJobEnd(WORK_SPAN_JOB* job)
+{
+    if(job == NULL || !workSpanIsEnabled())
+        return;
+
+    workSpanParallelEnd(job);
+    closeSerialStrand(job);
+
+    job->wall_ns = getClockTimeNs(CLOCK_MONOTONIC) - job->start_time_ns;
+
+    addSummary(job);
+}
+
+double workSpanGetParallelism(const WORK_SPAN_JOB* job)
+{
+    return (job != NULL && job->span_ns > 0 ? (double)job->work_ns / job->span_ns : 0.0);
+}
+
+double workSpanGetSpeedup(const WORK_SPAN_JOB* job)
+{
+    return (job != NULL && job->wall_ns > 0 ? (double)job->work_ns / job->wall_ns : 0.0);
+}
+
+// Averages per run of every job, along with what limits it given the CPUs available to the process.
+void workSpanPrintJobs(FILE* stream)
+{
+    if(stream == NULL)
+        return;
+
+    unsigned int cpus_num = getAvailableCPUs();
+
+    pthread_mutex_lock(&summaries_lock);
+
+    for(unsigned int summary_idx = 0; summary_idx < summaries_num; summary_idx++)
+    {
+        const WORK_SPAN_SUMMARY* summary = &summaries[summary_idx];
+        double parallelism = (summary->span_ns > 0 ? (double)summary->work_ns / summary->span_ns : 0.0);
+        double speedup = (summary->wall_ns > 0 ? (double)summary->work_ns / summary->wall_ns : 0.0);
+        double achievable_speedup = (parallelism < cpus_num ? parallelism : cpus_num);
+        const char* verdict;
+
+        if(parallelism < cpus_num)
+            verdict = "not enough parallelism, restructure the algorithm";
+        else if(speedup >= WELL_USED_CPUS_FRACTION * achievable_speedup)
+            verdict = "CPUs are well used, more cores would help";
+        else
+            verdict = "overheads dominate, make tasks coarser or cheaper to hand out";
+
+        fprintf(stream, "%s: %lu run(s), %.1f task(s) in %.1f parallel section(s) per run\r\n",
+                summary->name                                           ,
+                summary->runs                                           ,
+                (double)summary->tasks / summary->runs                  ,
+                (double)summary->parallel_sections / summary->runs      );
+
+        fprintf(stream, "    work %.3f ms, span %.3f ms, wall %.3f ms, parallelism %.2f, observed speedup %.2f on %u CPU(s): %s.\r\n",
+                summary->work_ns / NS_PER_MSEC / summary->runs  ,
+                summary->span_ns / NS_PER_MSEC / summary->runs  ,
+                summary->wall_ns / NS_PER_MSEC / summary->runs  ,
+                parallelism                                     ,
+                speedup                                         ,
+                cpus_num                                        ,
+                verdict                                         );
+    }
+
+    pthread_mutex_unlock(&summaries_lock);
+}
+
+/**************************************/
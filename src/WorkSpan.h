@@ -0,0 +1,54 @@
+#ifndef WORK_SPAN_H
+#define WORK_SPAN_H
+
+/********* Include statements *********/
+
+#include <stdio.h>
+#include <stdatomic.h>
+
+/**************************************/
+
+/********** Type definitions **********/
+
+// A fork-join job: serial strands run by the thread owning the job, alternating with parallel sections made of independent tasks.
+typedef struct
+{
+    const char*         name                ;
+    int                 in_parallel_section ;
+    unsigned long long  start_time_ns       ;   // Wall time, CLOCK_MONOTONIC.
+    unsigned long long  strand_start_ns     ;   // CPU time of the owning thread when its current serial strand started.
+    unsigned long long  work_ns             ;   // Filled in by workSpanJobEnd.
+    unsigned long long  span_ns             ;
+    unsigned long long  wall_ns             ;
+    unsigned long long  tasks               ;
+    unsigned int        parallel_sections   ;
+    atomic_ullong       section_work_ns     ;   // Running totals of the current parallel section, updated by its tasks.
+    atomic_ullong       section_span_ns     ;
+    atomic_ullong       section_tasks       ;
+} WORK_SPAN_JOB;
+
+typedef struct
+{
+    unsigned long long  start_ns    ;   // CPU time of the thread running the task when it started.
+} WORK_SPAN_TASK;
+
+/**************************************/
+
+/********* Function prototypes ********/
+
+void    workSpanEnable(int enabled);
+int     workSpanIsEnabled();
+void    workSpanJobBegin(WORK_SPAN_JOB* job, const char* name);
+void    workSpanParallelBegin(WORK_SPAN_JOB* job);
+void    workSpanTaskBegin(WORK_SPAN_TASK* task);
+void    workSpanTaskEnd(WORK_SPAN_JOB* job, const WORK_SPAN_TASK* task);
+void    workSpanAddTask(WORK_SPAN_JOB* job, unsigned long long work_ns, unsigned long long span_ns);
+void    workSpanParallelEnd(WORK_SPAN_JOB* job);
+void    workSpanJobEnd(WORK_SPAN_JOB* job);
+double  workSpanGetParallelism(const WORK_SPAN_JOB* job);
+double  workSpanGetSpeedup(const WORK_SPAN_JOB* job);
+void    workSpanPrintJobs(FILE* stream);
+
+/**************************************/
+
+#endif
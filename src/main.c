@@ -8,11 +8,106 @@ commands as a reference (provided repo directory has been entered first):
 // gcc -g -Wall -lpthread -D_XOPEN_SOURCE=700 src/*.c -o exe/main 
 // sudo ./exe/main
 
+/*
+Lessons can be selected by name (run ./exe/main --list to display them), and measured instead of just executed:
+
+./exe/main --bench=20 --warmup=3 mutex semaphores
+
+In benchmark mode, each selected lesson is run "warmup" times first, then "bench" times while being measured. Lessons' output is
+suppressed and a JSON report (see Benchmark.c) is printed once every lesson has been measured.
+
+Workload sizes and thread counts are lesson parameters (see LessonParameters.c), given as options or environment variables. Lessons
+can be selected through the environment as well, as a comma-separated list:
+
+THREADS_TUTORIAL_LESSONS=mutex,matrix THREADS_TUTORIAL_MAT_DIM=64 ./exe/main --threads=4
+
+Finally, a sweep runs every selected lesson once per combination of the swept parameters' values, so that scaling studies can be
+done in a single run:
+
+./exe/main --bench=5 --sweep=threads=1,2,4,8 --sweep=mat-dim=32,64 matrix
+
+Add --perf to the benchmark so that hardware and software performance counters (see PerfCounters.c) are reported along with timings.
+
+For comparisons to be meaningful, lessons can be pinned to some CPUs and measured until the median's 95% confidence interval is
+within a target (+-2% below), then saved as a baseline. Later runs given that baseline flag lessons that got significantly slower
+(by more than 5% by default), and exit with status 2 if any did:
+
+./exe/main --bench=10 --pin=2 --target-ci=2 --max-iterations=200 --save-baseline=baseline.txt mutex matrix
+./exe/main --bench=10 --pin=2 --target-ci=2 --baseline=baseline.txt --regression-threshold=5 mutex matrix
+
+Lessons reporting the work they do (mutex, semaphores and matrix, the latter given a fixed dimension) get their throughput measured.
+If the number of threads is swept (including 1), Amdahl's law and the Universal Scalability Law are fitted to each throughput curve
+(see ScalabilityModel.c), telling whether contention or coherency is what limits the lesson, and where throughput peaks:
+
+./exe/main --bench=5 --sweep=threads=1,2,4,8 --mat-dim=64 mutex matrix
+
+Lessons can also be run in processes of their own (see ProcessRunner.c), concurrently as long as they fit within a CPU budget
+(the number of online CPUs by default). Each lesson's output is printed once it is done, along with how it ended:
+
+./exe/main --parallel=4 --timeout=30
+
+If built with the tracer (see ThreadTracer.c), --trace writes a timeline of every thread, lock, barrier, condition variable and
+semaphore in the Chrome trace event format, viewable at chrome://tracing or https://ui.perfetto.dev:
+
+./exe/main --trace=trace.json mutex barrier
+
+The same build can measure how long threads waited for and held locks, waited on barriers, condition variables and semaphores, and
+how long threads and lessons ran: --latency prints the percentiles of each (see LatencyHistogram.c), and writes every histogram as
+CSV if a file is given:
+
+./exe/main --latency=latencies.csv mutex semaphores
+
+Where CPU time goes within lessons is told by the sampling profiler (see SamplingProfiler.c), which needs no special build: every
+thread is sampled --profile-frequency times per CPU second (997 by default), and its stacks are written as folded stacks, the input
+of flame graph tools:
+
+./exe/main --profile=profile.folded --mat-dim=256 mutex matrix
+
+Add --allocations to count the allocations made by each lesson and each thread (see AllocationTracker.c): calls, requested bytes and
+peak live bytes are printed once each lesson is done, or added to every sample of the benchmark report. It needs
+-DALLOCATION_TRACKING=1 to be added to the gcc command above:
+
+./exe/main --bench=5 --allocations matrix
+
+--thread-states starts a monitor thread reading every thread's state and scheduling times from /proc (see ThreadStateSampler.c)
+every --thread-states-period milliseconds (10 by default), and prints how long each thread spent on a CPU, waiting for one and
+blocked. A timeline of every period is written as CSV if a file is given:
+
+./exe/main --thread-states=states.csv barrier semaphores
+
+For fork-join lessons (matrix), --work-span measures each job's total work and critical path length (see WorkSpan.c), and prints
+the parallelism they allow next to the speedup actually observed, telling whether more cores would help:
+
+./exe/main --work-span --mat-dim=128 matrix
+
+Live metrics (thread slots in use and waiting, traced mutex contention, items in the condition variables lesson's buffer, latency
+percentiles...) are served in the Prometheus text format by --metrics (see MetricsExporter.c), on a UNIX socket if given a path, or
+on a loopback TCP port if given a number. They can be polled from another terminal while lessons run:
+
+./exe/main --metrics=/tmp/threads.sock --bench=50 condition-variables
+curl --unix-socket /tmp/threads.sock http://localhost/metrics
+
+Lessons spend most of their time sleeping. With --virtual-time (or THREADS_TUTORIAL_VIRTUAL_TIME=1), sleeps and timeouts are
+measured by a simulated clock instead (see VirtualTime.c), so they take no real time while threads are still woken up in order.
+*/
+
 /********* Include statements *********/
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include "Benchmark.h"
+#include "BenchmarkBaseline.h"
+#include "ProcessRunner.h"
+#include "VirtualTime.h"
+#include "ThreadTracer.h"
+#include "SamplingProfiler.h"
+#include "AllocationTracker.h"
+#include "ThreadStateSampler.h"
+#include "WorkSpan.h"
+#include "MetricsExporter.h"
+#include "LessonParameters.h"
 #include "BasicThreads.h"
 #include "ThreadsWithInputParameters.h"
 #include "ThreadsWithMutex.h"
@@ -27,6 +122,18 @@ commands as a reference (provided repo directory has been entered first):
 #include "ThreadsWithLocalStorage.h"
 #include "ThreadsDetachment.h"
 #include "MatrixMultiplication.h"
+#include "TiledMatrixMultiplication.h"
+#include "ThreadPoolPriorities.h"
+#include "ThreadPoolDeadlines.h"
+#include "MatrixTaskGraph.h"
+#include "ConcurrentHashMapBenchmark.h"
+#include "LockFreeStructures.h"
+#include "QueueBenchmark.h"
+#include "InterProcessQueues.h"
+#include "DistributedMatrixMultiplication.h"
+#include "EpollServerBenchmark.h"
+#include "ThreadColors.h"
+#include "ThreadCreationStatus.h"
 
 /**************************************/
 
@@ -47,10 +154,180 @@ commands as a reference (provided repo directory has been entered first):
 #define MSG_TEST_THREADS_WITH_LOCAL_STORAGE         "Testing threads with local storage."
 #define MSG_TEST_THREADS_DETACH                     "Testing detached threads."
 #define MSG_TEST_EXAMPLE_MATRIX_MULTIPLICATION      "Example: matrix multiplication using multiple threads."
+#define MSG_TEST_EXAMPLE_TILED_MATRIX               "Example: tiled matrix multiplication on a thread pool."
+#define MSG_TEST_EXAMPLE_POOL_PRIORITIES            "Example: prioritized tasks on a thread pool."
+#define MSG_TEST_EXAMPLE_POOL_DEADLINES             "Example: tasks with deadlines on a thread pool."
+#define MSG_TEST_EXAMPLE_TASK_GRAPH                 "Example: matrix operations as a task graph."
+#define MSG_TEST_EXAMPLE_HASH_MAP                   "Example: concurrent hash map against a global mutex."
+#define MSG_TEST_EXAMPLE_LOCK_FREE                  "Example: lock-free stack and queue against mutex-protected ones."
+#define MSG_TEST_EXAMPLE_QUEUE_BENCH                "Example: producer and consumer queues measured side by side."
+#define MSG_TEST_EXAMPLE_IPC_QUEUES                 "Example: producer and consumer processes over shared memory, pipes and sockets."
+#define MSG_TEST_EXAMPLE_SUMMA                      "Example: matrix multiplication distributed across node processes (SUMMA)."
+#define MSG_TEST_EXAMPLE_EPOLL_SERVER               "Example: epoll server with a worker pool and admission control under load."
 #define MSG_TEST_FOOTER_CHAR                        '-'
 
 #define TIME_BETWEEN_FUNCTION_CALLS                 1
 
+#define DEFAULT_BENCHMARK_ITERATIONS                10
+#define DEFAULT_BENCHMARK_WARMUP                    2
+#define DEFAULT_MAX_ITERATIONS                      100
+#define DEFAULT_REGRESSION_THRESHOLD                5.0     // Percentage.
+#define EXIT_STATUS_REGRESSION                      2
+
+#define MAX_SELECTED_LESSONS                        64
+#define MAX_SWEEP_VALUES                            32
+
+#define DEFAULT_LESSON_TIMEOUT                      120
+
+#define OPTION_BENCHMARK                            "--bench"
+#define OPTION_WARMUP                               "--warmup="
+#define OPTION_PERF_COUNTERS                        "--perf"
+#define OPTION_PIN                                  "--pin"
+#define OPTION_TARGET_CI                            "--target-ci="
+#define OPTION_MAX_ITERATIONS                       "--max-iterations="
+#define OPTION_BASELINE                             "--baseline="
+#define OPTION_SAVE_BASELINE                        "--save-baseline="
+#define OPTION_REGRESSION_THRESHOLD                 "--regression-threshold="
+#define OPTION_SWEEP                                "--sweep="
+#define OPTION_PARALLEL                             "--parallel"
+#define OPTION_TIMEOUT                              "--timeout="
+#define OPTION_VIRTUAL_TIME                         "--virtual-time"
+#define OPTION_TRACE                                "--trace="
+#define OPTION_LATENCY                              "--latency"
+#define OPTION_PROFILE                              "--profile="
+#define OPTION_PROFILE_FREQUENCY                    "--profile-frequency="
+#define OPTION_ALLOCATIONS                          "--allocations"
+#define OPTION_THREAD_STATES                        "--thread-states"
+#define OPTION_THREAD_STATES_PERIOD                 "--thread-states-period="
+#define OPTION_WORK_SPAN                            "--work-span"
+#define OPTION_METRICS                              "--metrics="
+#define OPTION_LIST                                 "--list"
+#define OPTION_HELP                                 "--help"
+#define OPTION_PREFIX                               "--"
+
+#define ENV_SELECTED_LESSONS                        "THREADS_TUTORIAL_LESSONS"
+#define ENV_VIRTUAL_TIME                            "THREADS_TUTORIAL_VIRTUAL_TIME"
+#define LESSON_LIST_SEPARATORS                      ", "
+#define SWEEP_VALUES_SEPARATOR                      ","
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+typedef struct
+{
+    const char*     name                ;
+    const char*     test_text           ;
+    void            (*test_function)(void);
+    unsigned int    cpu_weight          ;   // CPUs kept busy by the lesson (0 if it mostly sleeps or waits).
+    unsigned long long (*work_units)(void);   // Work done by each run, so that throughput can be reported. NULL if unknown.
+} LESSON;
+
+typedef struct
+{
+    LESSON_PARAM_ID param_id                    ;
+    unsigned int    values_num                  ;
+    unsigned long   values[MAX_SWEEP_VALUES]    ;
+} SWEEP_AXIS;
+
+typedef struct
+{
+    int             benchmark                       ;
+    int             perf_counters                   ;
+    int             pin                             ;
+    const char*     pinned_cpus                     ;   // NULL to pin to the current CPU.
+    double          target_ci                       ;   // Percentage. 0 to run the requested iterations only.
+    unsigned int    max_iterations                  ;
+    const char*     baseline_path                   ;
+    const char*     save_baseline_path              ;
+    double          regression_threshold            ;   // Percentage.
+    int             parallel                        ;
+    unsigned int    cpu_budget                      ;
+    unsigned int    timeout_s                       ;
+    const char*     trace_path                      ;   // NULL unless tracing.
+    int             latency                         ;
+    const char*     latency_csv_path                ;   // NULL to print latencies just as text.
+    const char*     profile_path                    ;   // NULL unless profiling.
+    unsigned int    profile_frequency               ;
+    int             allocations                     ;
+    int             thread_states                   ;
+    const char*     thread_states_path              ;   // NULL to print just the summary.
+    unsigned int    thread_states_period_ms         ;
+    int             work_span                       ;
+    const char*     metrics_address                 ;   // NULL unless exporting metrics.
+    unsigned int    iterations                      ;
+    unsigned int    warmup                          ;
+    unsigned int    selected_num                    ;
+    const LESSON*   selected[MAX_SELECTED_LESSONS]  ;
+    unsigned int    sweeps_num                      ;
+    SWEEP_AXIS      sweeps[LESSON_PARAMS_NUM]       ;
+} RUN_OPTIONS;
+
+/**************************************/
+
+/********* Private variables **********/
+
+static const LESSON lessons[] =
+{
+    { "basic"               , MSG_TEST_BASIC_THREADS                    , basicThreadUsingFunction               ,  1 , NULL                                  },
+    { "input-parameters"    , MSG_TEST_THREADS_WITH_INPUT_PARAMETERS    , functionUsingThreadWithParameters      ,  2 , NULL                                  },
+    { "mutex"               , MSG_TEST_THREADS_WITH_MUTEX               , functionUsingThreadWithoutMutex        ,  7 , getMutexWorkUnits                     },
+    { "trylock"             , MSG_TEST_THREADS_WITH_TRYLOCK             , threadsWithTryLock                     ,  0 , NULL                                  },
+    { "timed-mutex"         , MSG_TEST_THREADS_WITH_TIMED_MUTEX         , functionUsingThreadWithTimedMutex      ,  0 , NULL                                  },
+    { "cancellation"        , MSG_TEST_THREADS_CANCELLATION             , threadsCancellation                    ,  0 , NULL                                  },
+    { "barrier"             , MSG_TEST_THREADS_WITH_BARRIER             , threadsWithBarrier                     ,  3 , NULL                                  },
+    { "condition-variables" , MSG_TEST_THREADS_WITH_CONDITION_VARIABLES , threadsWithConditionVariables          ,  0 , NULL                                  },
+    { "timed-wait"          , MSG_TEST_THREADS_WITH_TIMED_WAIT          , functionUsingThreadWithTimedWait       ,  0 , NULL                                  },
+    { "semaphores"          , MSG_TEST_THREADS_WITH_SEMAPHORES          , threadsWithSemaphores                  ,  2 , getSemaphoresWorkUnits                },
+    { "attributes"          , MSG_TEST_THREADS_WITH_ATTRIBUTES          , threadsWithAttributes                  , 10 , NULL                                  },
+    { "local-storage"       , MSG_TEST_THREADS_WITH_LOCAL_STORAGE       , threadsWithLocalStorage                ,  0 , NULL                                  },
+    { "detach"              , MSG_TEST_THREADS_DETACH                   , threadsDetachment                      ,  0 , NULL                                  },
+    { "matrix"              , MSG_TEST_EXAMPLE_MATRIX_MULTIPLICATION    , exampleMatrixMultiplication            ,  1 , getMatrixMultiplicationWorkUnits      },
+    { "matrix-tiled"        , MSG_TEST_EXAMPLE_TILED_MATRIX             , exampleTiledMatrixMultiplication       ,  1 , getTiledMatrixMultiplicationWorkUnits },
+    { "pool-priorities"     , MSG_TEST_EXAMPLE_POOL_PRIORITIES          , exampleThreadPoolPriorities            ,  1 , NULL                                  },
+    { "pool-deadlines"      , MSG_TEST_EXAMPLE_POOL_DEADLINES           , exampleThreadPoolDeadlines             ,  1 , NULL                                  },
+    { "task-graph"          , MSG_TEST_EXAMPLE_TASK_GRAPH               , exampleMatrixTaskGraph                 ,  1 , NULL                                  },
+    { "hash-map"            , MSG_TEST_EXAMPLE_HASH_MAP                 , exampleConcurrentHashMap               ,  1 , NULL                                  },
+    { "lock-free"           , MSG_TEST_EXAMPLE_LOCK_FREE                , exampleLockFreeStructures              ,  1 , NULL                                  },
+    { "queue-bench"         , MSG_TEST_EXAMPLE_QUEUE_BENCH              , exampleQueueBenchmark                  ,  1 , NULL                                  },
+    { "ipc-queues"          , MSG_TEST_EXAMPLE_IPC_QUEUES               , exampleInterProcessQueues              ,  1 , NULL                                  },
+    { "summa"               , MSG_TEST_EXAMPLE_SUMMA                    , exampleDistributedMatrixMultiplication ,  1 , NULL                                  },
+    { "epoll-server"        , MSG_TEST_EXAMPLE_EPOLL_SERVER             , exampleEpollServerBenchmark            ,  1 , NULL                                  },
+};
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static void             printTestHeader(const char* test_text);
+static void             executeTestFunction(const char* test_text, void(*test_function)(void));
+static const LESSON*    findLesson(const char* name);
+static void             setCurrentLesson(const LESSON* lesson);
+static void             printUsage(const char* program_name);
+static int              parseUnsignedOption(const char* text, unsigned int* value);
+static int              parsePercentageOption(const char* text, double* value);
+static int              parseBenchmarkOption(RUN_OPTIONS* options, const char* arg);
+static int              selectLesson(RUN_OPTIONS* options, const char* name);
+static int              selectLessonsFromEnvironment(RUN_OPTIONS* options);
+static int              parseSweepOption(RUN_OPTIONS* options, const char* text);
+static int              parseParameterOption(const char* arg);
+static int              parseRunOptions(int argc, char** argv, RUN_OPTIONS* options);
+static unsigned int     getSweepPointsNum(const RUN_OPTIONS* options);
+static void             applySweepPoint(const RUN_OPTIONS* options, unsigned int point_idx);
+static void             printSweepPoint(const RUN_OPTIONS* options);
+static int              runBenchmark(RUN_OPTIONS* options);
+static int              compareWithBaseline(const RUN_OPTIONS* options, BENCHMARK_RESULT* results, unsigned int results_num);
+static void             printScalability(const BENCHMARK_SCALABILITY* scalability, unsigned int scalability_num);
+static void             runLessons(RUN_OPTIONS* options);
+static void             printLessonOutcome(const LESSON* lesson, const PROCESS_RUNNER_RESULT* result);
+static int              runParallelLessons(RUN_OPTIONS* options);
+static int              writeTrace(const RUN_OPTIONS* options);
+static int              printLatencies(const RUN_OPTIONS* options);
+static int              writeProfile(const RUN_OPTIONS* options);
+static void             printThreadAllocations(const RUN_OPTIONS* options);
+static int              printThreadStates(const RUN_OPTIONS* options);
+static void             printWorkSpan(const RUN_OPTIONS* options);
+
 /**************************************/
 
 /******** Function definitions ********/
@@ -71,32 +348,984 @@ static void printTestHeader(const char* test_text)
     printf("%s\r\n%s\r\n%s\r\n", test_header, test_text, test_footer);
 }
 
+// Each lesson is run within a dedicated thread, so that lessons calling pthread_exit (such as ThreadsDetachment.c) end that thread
+// rather than the main one, and the lessons after them are still run.
 static void executeTestFunction(const char* test_text, void(*test_function)(void))
 {
     printTestHeader(test_text);
-    test_function();
+    THREAD_TRACE_SPAN_BEGIN(THREAD_TRACE_CATEGORY_LESSON, test_text);
+
+    checkThreadCreationStatus( virtualTimeRunOnThread(test_function) );
+
+    THREAD_TRACE_SPAN_END(THREAD_TRACE_CATEGORY_LESSON, test_text);
     printf("\r\n");
-    sleep(TIME_BETWEEN_FUNCTION_CALLS);
-}
-
-int main()
-{
-    executeTestFunction(MSG_TEST_BASIC_THREADS                      , basicThreadUsingFunction          );
-    executeTestFunction(MSG_TEST_THREADS_WITH_INPUT_PARAMETERS      , functionUsingThreadWithParameters );
-    executeTestFunction(MSG_TEST_THREADS_WITH_MUTEX                 , functionUsingThreadWithoutMutex   );
-    executeTestFunction(MSG_TEST_THREADS_WITH_TRYLOCK               , threadsWithTryLock                );
-    executeTestFunction(MSG_TEST_THREADS_WITH_TIMED_MUTEX           , functionUsingThreadWithTimedMutex );
-    executeTestFunction(MSG_TEST_THREADS_CANCELLATION               , threadsCancellation               );
-    executeTestFunction(MSG_TEST_THREADS_WITH_BARRIER               , threadsWithBarrier                );
-    executeTestFunction(MSG_TEST_THREADS_WITH_CONDITION_VARIABLES   , threadsWithConditionVariables     );
-    executeTestFunction(MSG_TEST_THREADS_WITH_TIMED_WAIT            , functionUsingThreadWithTimedWait  );
-    executeTestFunction(MSG_TEST_THREADS_WITH_SEMAPHORES            , threadsWithSemaphores             );
-    executeTestFunction(MSG_TEST_THREADS_WITH_ATTRIBUTES            , threadsWithAttributes             );
-    executeTestFunction(MSG_TEST_THREADS_WITH_LOCAL_STORAGE         , threadsWithLocalStorage           );
-    executeTestFunction(MSG_TEST_THREADS_DETACH                     , threadsDetachment                 );
-    executeTestFunction(MSG_TEST_EXAMPLE_MATRIX_MULTIPLICATION      , exampleMatrixMultiplication       );
+    virtualTimeSleep(TIME_BETWEEN_FUNCTION_CALLS);
+}
+
+static const LESSON* findLesson(const char* name)
+{
+    for(unsigned int i = 0; i < sizeof(lessons) / sizeof(lessons[0]); i++)
+        if(strcmp(lessons[i].name, name) == 0)
+            return &lessons[i];
+
+    return NULL;
+}
+
+// Tells every monitor which lesson their measurements belong to.
+static void setCurrentLesson(const LESSON* lesson)
+{
+    samplingProfilerSetLabel(lesson->name);
+    allocationTrackerSetLabel(lesson->name);
+    threadStateSamplerSetLabel(lesson->name);
+}
+
+static void printUsage(const char* program_name)
+{
+    printf("Usage: %s [%s[=ITERATIONS]] [%sRUNS] [%s] [%s[=CPUS]] [%sPCT] [%sN] [%sFILE] [%sFILE] [%sPCT] [%s[=CPUS]] [%sSECONDS] [%s] [%sFILE] [%s[=CSV_FILE]] [%sFILE] [%sHZ] [%s] [%s[=CSV_FILE]] [%sMS] [%s] [%sADDRESS] [--PARAMETER=VALUE ...] [%sPARAMETER=V1,V2,... ...] [%s] [%s] [LESSON ...]\r\n\r\nLessons:\r\n",
+            program_name                    ,
+            OPTION_BENCHMARK                ,
+            OPTION_WARMUP                   ,
+            OPTION_PERF_COUNTERS            ,
+            OPTION_PIN                      ,
+            OPTION_TARGET_CI                ,
+            OPTION_MAX_ITERATIONS           ,
+            OPTION_BASELINE                 ,
+            OPTION_SAVE_BASELINE            ,
+            OPTION_REGRESSION_THRESHOLD     ,
+            OPTION_PARALLEL                 ,
+            OPTION_TIMEOUT                  ,
+            OPTION_VIRTUAL_TIME             ,
+            OPTION_TRACE                    ,
+            OPTION_LATENCY                  ,
+            OPTION_PROFILE                  ,
+            OPTION_PROFILE_FREQUENCY        ,
+            OPTION_ALLOCATIONS              ,
+            OPTION_THREAD_STATES            ,
+            OPTION_THREAD_STATES_PERIOD     ,
+            OPTION_WORK_SPAN                ,
+            OPTION_METRICS                  ,
+            OPTION_SWEEP                    ,
+            OPTION_LIST                     ,
+            OPTION_HELP                     );
+
+    for(unsigned int i = 0; i < sizeof(lessons) / sizeof(lessons[0]); i++)
+        printf("    %-20s%s\r\n", lessons[i].name, lessons[i].test_text);
+
+    printf("\r\nParameters:\r\n");
+
+    for(int param_id = 0; param_id < LESSON_PARAMS_NUM; param_id++)
+        printf("    %-20s%s\r\n", getLessonParameterName((LESSON_PARAM_ID)param_id), getLessonParameterDescription((LESSON_PARAM_ID)param_id));
+}
+
+static int parseUnsignedOption(const char* text, unsigned int* value)
+{
+    char* end;
+    unsigned long parsed = strtoul(text, &end, 10);
+
+    if(*text == 0 || *end != 0 || parsed > 0xFFFFFFFFUL)
+        return -1;
+
+    *value = (unsigned int)parsed;
+
+    return 0;
+}
+
+static int parsePercentageOption(const char* text, double* value)
+{
+    char* end;
+    double parsed = strtod(text, &end);
+
+    if(*text == 0 || *end != 0 || !(parsed > 0.0 && parsed < 100.0))
+        return -1;
+
+    *value = parsed;
+
+    return 0;
+}
+
+// Options refining the benchmark mode, which they enable as well. Returns 1 if the argument is none of them.
+static int parseBenchmarkOption(RUN_OPTIONS* options, const char* arg)
+{
+    int ret = 0;
+
+    if(strcmp(arg, OPTION_PIN) == 0)
+        options->pin = 1;
+    else if(strncmp(arg, OPTION_PIN "=", strlen(OPTION_PIN "=")) == 0 && arg[strlen(OPTION_PIN "=")] != 0)
+    {
+        options->pin = 1;
+        options->pinned_cpus = arg + strlen(OPTION_PIN "=");
+    }
+    else if(strncmp(arg, OPTION_TARGET_CI, strlen(OPTION_TARGET_CI)) == 0)
+        ret = parsePercentageOption(arg + strlen(OPTION_TARGET_CI), &options->target_ci);
+    else if(strncmp(arg, OPTION_MAX_ITERATIONS, strlen(OPTION_MAX_ITERATIONS)) == 0)
+        ret = (parseUnsignedOption(arg + strlen(OPTION_MAX_ITERATIONS), &options->max_iterations) == 0 && options->max_iterations > 0 ? 0 : -1);
+    else if(strncmp(arg, OPTION_BASELINE, strlen(OPTION_BASELINE)) == 0 && arg[strlen(OPTION_BASELINE)] != 0)
+        options->baseline_path = arg + strlen(OPTION_BASELINE);
+    else if(strncmp(arg, OPTION_SAVE_BASELINE, strlen(OPTION_SAVE_BASELINE)) == 0 && arg[strlen(OPTION_SAVE_BASELINE)] != 0)
+        options->save_baseline_path = arg + strlen(OPTION_SAVE_BASELINE);
+    else if(strncmp(arg, OPTION_REGRESSION_THRESHOLD, strlen(OPTION_REGRESSION_THRESHOLD)) == 0)
+        ret = parsePercentageOption(arg + strlen(OPTION_REGRESSION_THRESHOLD), &options->regression_threshold);
+    else
+        return 1;
+
+    if(ret == 0)
+        options->benchmark = 1;
+
+    return ret;
+}
+
+static int selectLesson(RUN_OPTIONS* options, const char* name)
+{
+    const LESSON* lesson = findLesson(name);
+
+    if(lesson == NULL)
+    {
+        printf("Unknown lesson or option: %s\r\n", name);
+        return -1;
+    }
+
+    if(options->selected_num >= MAX_SELECTED_LESSONS)
+    {
+        printf("Too many lessons selected.\r\n");
+        return -1;
+    }
+
+    options->selected[options->selected_num++] = lesson;
+
+    return 0;
+}
+
+static int selectLessonsFromEnvironment(RUN_OPTIONS* options)
+{
+    const char* env_lessons = getenv(ENV_SELECTED_LESSONS);
+
+    if(env_lessons == NULL)
+        return 0;
+
+    char lesson_list[strlen(env_lessons) + 1];
+    strcpy(lesson_list, env_lessons);
+
+    char* save_ptr;
+
+    for(char* name = strtok_r(lesson_list, LESSON_LIST_SEPARATORS, &save_ptr); name != NULL; name = strtok_r(NULL, LESSON_LIST_SEPARATORS, &save_ptr))
+        if(selectLesson(options, name) < 0)
+            return -1;
+
+    return 0;
+}
+
+// Sweeps are given as --sweep=PARAMETER=V1,V2,... Each parameter can be swept just once.
+static int parseSweepOption(RUN_OPTIONS* options, const char* text)
+{
+    const char* values = strchr(text, '=');
+
+    if(values == NULL)
+        return -1;
+
+    char param_name[values - text + 1];
+    memcpy(param_name, text, values - text);
+    param_name[values - text] = 0;
+
+    int param_id = findLessonParameter(param_name);
+
+    if(param_id < 0)
+        return -1;
+
+    for(unsigned int sweep_idx = 0; sweep_idx < options->sweeps_num; sweep_idx++)
+        if((int)options->sweeps[sweep_idx].param_id == param_id)
+            return -1;
+
+    SWEEP_AXIS* sweep = &options->sweeps[options->sweeps_num];
+    sweep->param_id = (LESSON_PARAM_ID)param_id;
+    sweep->values_num = 0;
+
+    char value_list[strlen(values + 1) + 1];
+    strcpy(value_list, values + 1);
+
+    char* save_ptr;
+
+    for(char* value = strtok_r(value_list, SWEEP_VALUES_SEPARATOR, &save_ptr); value != NULL; value = strtok_r(NULL, SWEEP_VALUES_SEPARATOR, &save_ptr))
+    {
+        if(sweep->values_num >= MAX_SWEEP_VALUES || setLessonParameterFromText(param_name, value) < 0)
+            return -1;
+
+        sweep->values[sweep->values_num++] = getLessonParameter((LESSON_PARAM_ID)param_id, 0);
+    }
+
+    clearLessonParameter((LESSON_PARAM_ID)param_id);
+
+    if(sweep->values_num == 0)
+        return -1;
+
+    ++options->sweeps_num;
+
+    return 0;
+}
+
+// Lesson parameters are given as --PARAMETER=VALUE. Returns 1 if the argument is not a parameter at all.
+static int parseParameterOption(const char* arg)
+{
+    const char* value = strchr(arg, '=');
+
+    if(strncmp(arg, OPTION_PREFIX, strlen(OPTION_PREFIX)) != 0 || value == NULL)
+        return 1;
+
+    char param_name[value - arg + 1];
+    memcpy(param_name, arg + strlen(OPTION_PREFIX), value - arg - strlen(OPTION_PREFIX));
+    param_name[value - arg - strlen(OPTION_PREFIX)] = 0;
+
+    if(findLessonParameter(param_name) < 0)
+        return 1;
+
+    return (setLessonParameterFromText(param_name, value + 1) < 0 ? -1 : 0);
+}
+
+static int parseRunOptions(int argc, char** argv, RUN_OPTIONS* options)
+{
+    // Environment values are loaded first, so that command line options take precedence.
+    if(loadLessonParametersFromEnvironment() < 0)
+        return -1;
+
+    const char* env_virtual_time = getenv(ENV_VIRTUAL_TIME);
+
+    if(env_virtual_time != NULL && *env_virtual_time != 0 && strcmp(env_virtual_time, "0") != 0)
+        virtualTimeEnable(1);
+
+    for(int arg_idx = 1; arg_idx < argc; arg_idx++)
+    {
+        const char* arg = argv[arg_idx];
+
+        if(strcmp(arg, OPTION_HELP) == 0 || strcmp(arg, OPTION_LIST) == 0)
+        {
+            printUsage(argv[0]);
+            return 1;
+        }
+
+        if(strncmp(arg, OPTION_BENCHMARK, strlen(OPTION_BENCHMARK)) == 0)
+        {
+            const char* value = arg + strlen(OPTION_BENCHMARK);
+
+            options->benchmark = 1;
+
+            if(*value == 0)
+                continue;
+
+            if(*value == '=' && parseUnsignedOption(value + 1, &options->iterations) == 0 && options->iterations > 0)
+                continue;
+
+            printf("Invalid benchmark iterations: %s\r\n", arg);
+            return -1;
+        }
+
+        if(strncmp(arg, OPTION_WARMUP, strlen(OPTION_WARMUP)) == 0)
+        {
+            if(parseUnsignedOption(arg + strlen(OPTION_WARMUP), &options->warmup) == 0)
+                continue;
+
+            printf("Invalid warm-up runs: %s\r\n", arg);
+            return -1;
+        }
+
+        if(strcmp(arg, OPTION_PERF_COUNTERS) == 0)
+        {
+            options->perf_counters = 1;
+            continue;
+        }
+
+        int benchmark_status = parseBenchmarkOption(options, arg);
+
+        if(benchmark_status == 0)
+            continue;
+
+        if(benchmark_status < 0)
+        {
+            printf("Invalid benchmark option: %s\r\n", arg);
+            return -1;
+        }
+
+        if(strncmp(arg, OPTION_PARALLEL, strlen(OPTION_PARALLEL)) == 0)
+        {
+            const char* value = arg + strlen(OPTION_PARALLEL);
+
+            options->parallel = 1;
+
+            if(*value == 0)
+                continue;
+
+            if(*value == '=' && parseUnsignedOption(value + 1, &options->cpu_budget) == 0 && options->cpu_budget > 0)
+                continue;
+
+            printf("Invalid CPU budget: %s\r\n", arg);
+            return -1;
+        }
+
+        if(strncmp(arg, OPTION_TIMEOUT, strlen(OPTION_TIMEOUT)) == 0)
+        {
+            if(parseUnsignedOption(arg + strlen(OPTION_TIMEOUT), &options->timeout_s) == 0)
+                continue;
+
+            printf("Invalid timeout: %s\r\n", arg);
+            return -1;
+        }
+
+        if(strcmp(arg, OPTION_VIRTUAL_TIME) == 0)
+        {
+            virtualTimeEnable(1);
+            continue;
+        }
+
+        if(strncmp(arg, OPTION_TRACE, strlen(OPTION_TRACE)) == 0 && arg[strlen(OPTION_TRACE)] != 0)
+        {
+            options->trace_path = arg + strlen(OPTION_TRACE);
+            continue;
+        }
+
+        if(strncmp(arg, OPTION_LATENCY, strlen(OPTION_LATENCY)) == 0)
+        {
+            const char* value = arg + strlen(OPTION_LATENCY);
+
+            options->latency = 1;
+
+            if(*value == 0)
+                continue;
+
+            if(*value == '=' && value[1] != 0)
+            {
+                options->latency_csv_path = value + 1;
+                continue;
+            }
+
+            printf("Invalid latency option: %s\r\n", arg);
+            return -1;
+        }
+
+        if(strncmp(arg, OPTION_PROFILE, strlen(OPTION_PROFILE)) == 0 && arg[strlen(OPTION_PROFILE)] != 0)
+        {
+            options->profile_path = arg + strlen(OPTION_PROFILE);
+            continue;
+        }
+
+        if(strncmp(arg, OPTION_PROFILE_FREQUENCY, strlen(OPTION_PROFILE_FREQUENCY)) == 0)
+        {
+            if(parseUnsignedOption(arg + strlen(OPTION_PROFILE_FREQUENCY), &options->profile_frequency) == 0 && options->profile_frequency > 0)
+                continue;
+
+            printf("Invalid profiling frequency: %s\r\n", arg);
+            return -1;
+        }
+
+        if(strcmp(arg, OPTION_ALLOCATIONS) == 0)
+        {
+            options->allocations = 1;
+            continue;
+        }
+
+        if(strncmp(arg, OPTION_THREAD_STATES_PERIOD, strlen(OPTION_THREAD_STATES_PERIOD)) == 0)
+        {
+            if(parseUnsignedOption(arg + strlen(OPTION_THREAD_STATES_PERIOD), &options->thread_states_period_ms) == 0 && options->thread_states_period_ms > 0)
+                continue;
+
+            printf("Invalid thread states period: %s\r\n", arg);
+            return -1;
+        }
+
+        if(strncmp(arg, OPTION_THREAD_STATES, strlen(OPTION_THREAD_STATES)) == 0)
+        {
+            const char* value = arg + strlen(OPTION_THREAD_STATES);
+
+            options->thread_states = 1;
+
+            if(*value == 0)
+                continue;
+
+            if(*value == '=' && value[1] != 0)
+            {
+                options->thread_states_path = value + 1;
+                continue;
+            }
+
+            printf("Invalid thread states option: %s\r\n", arg);
+            return -1;
+        }
+
+        if(strcmp(arg, OPTION_WORK_SPAN) == 0)
+        {
+            options->work_span = 1;
+            continue;
+        }
+
+        if(strncmp(arg, OPTION_METRICS, strlen(OPTION_METRICS)) == 0)
+        {
+            options->metrics_address = arg + strlen(OPTION_METRICS);
+
+            if(*options->metrics_address != 0)
+                continue;
+
+            printf("Invalid metrics address: %s\r\n", arg);
+            return -1;
+        }
+
+        if(strncmp(arg, OPTION_SWEEP, strlen(OPTION_SWEEP)) == 0)
+        {
+            if(parseSweepOption(options, arg + strlen(OPTION_SWEEP)) == 0)
+                continue;
+
+            printf("Invalid sweep: %s\r\n", arg);
+            return -1;
+        }
+
+        int param_status = parseParameterOption(arg);
+
+        if(param_status == 0)
+            continue;
+
+        if(param_status < 0)
+        {
+            printf("Invalid parameter value: %s\r\n", arg);
+            return -1;
+        }
+
+        if(selectLesson(options, arg) < 0)
+        {
+            printUsage(argv[0]);
+            return -1;
+        }
+    }
+
+    if(options->benchmark && options->parallel)
+    {
+        printf("Lessons cannot be run in parallel while being benchmarked.\r\n");
+        return -1;
+    }
+
+    // Lessons run in parallel do so in processes of their own, out of reach of the tracer, the profiler and the monitors.
+    if((options->trace_path != NULL || options->latency || options->profile_path != NULL || options->allocations || options->thread_states || options->work_span || options->metrics_address != NULL) && options->parallel)
+    {
+        printf("Lessons cannot be traced, profiled nor monitored while being run in parallel.\r\n");
+        return -1;
+    }
+
+    // Lessons given in the command line take precedence over the ones in the environment. If no lesson has been explicitly
+    // selected at all, run all of them.
+    if(options->selected_num == 0 && selectLessonsFromEnvironment(options) < 0)
+        return -1;
+
+    if(options->selected_num == 0)
+        for(unsigned int i = 0; i < sizeof(lessons) / sizeof(lessons[0]); i++)
+            options->selected[options->selected_num++] = &lessons[i];
+
+    return 0;
+}
+
+static unsigned int getSweepPointsNum(const RUN_OPTIONS* options)
+{
+    unsigned int points_num = 1;
+
+    for(unsigned int sweep_idx = 0; sweep_idx < options->sweeps_num; sweep_idx++)
+        points_num *= options->sweeps[sweep_idx].values_num;
+
+    return points_num;
+}
+
+// Sweep points are numbered as in a mixed-radix number, the last sweep given being the fastest-changing one.
+static void applySweepPoint(const RUN_OPTIONS* options, unsigned int point_idx)
+{
+    for(int sweep_idx = (int)options->sweeps_num - 1; sweep_idx >= 0; sweep_idx--)
+    {
+        const SWEEP_AXIS* sweep = &options->sweeps[sweep_idx];
+
+        setLessonParameter(sweep->param_id, sweep->values[point_idx % sweep->values_num]);
+        point_idx /= sweep->values_num;
+    }
+}
+
+static void printSweepPoint(const RUN_OPTIONS* options)
+{
+    if(options->sweeps_num == 0)
+        return;
+
+    printf("%sSweep point:", PRINT_COLOR_YELLOW);
+
+    for(unsigned int sweep_idx = 0; sweep_idx < options->sweeps_num; sweep_idx++)
+        printf(" %s=%lu", getLessonParameterName(options->sweeps[sweep_idx].param_id), getLessonParameter(options->sweeps[sweep_idx].param_id, 0));
+
+    printf("%s\r\n\r\n", PRINT_COLOR_RESET);
+}
+
+static int runBenchmark(RUN_OPTIONS* options)
+{
+    unsigned int points_num = getSweepPointsNum(options);
+    BENCHMARK_RESULT* results = (BENCHMARK_RESULT*)calloc(points_num * options->selected_num, sizeof(BENCHMARK_RESULT));
+    unsigned int results_num = 0;
+    int ret = 0;
+
+    if(results == NULL)
+    {
+        printf("Could not allocate benchmark results.\r\n");
+        return -1;
+    }
+
+    if(benchmarkSuppressOutput() < 0)
+    {
+        printf("Could not suppress lessons' output.\r\n");
+        free(results);
+        return -1;
+    }
+
+    benchmarkEnablePerfCounters(options->perf_counters);
+    benchmarkSetAdaptiveRepetitions(options->target_ci / 100.0, options->max_iterations);
+
+    // Pinning is applied to the whole process, so every lesson's threads inherit it.
+    if(options->pin && benchmarkPinCPUs(options->pinned_cpus) < 0)
+    {
+        fprintf(stderr, "Could not pin the process to CPUs: %s\r\n", (options->pinned_cpus ? options->pinned_cpus : "current"));
+        free(results);
+        return -1;
+    }
+
+    for(unsigned int point_idx = 0; point_idx < points_num; point_idx++)
+    {
+        applySweepPoint(options, point_idx);
+
+        for(unsigned int lesson_idx = 0; lesson_idx < options->selected_num; lesson_idx++)
+        {
+            const LESSON* lesson = options->selected[lesson_idx];
+
+            setCurrentLesson(lesson);
+
+            if(benchmarkRunLesson(lesson->name, lesson->test_text, lesson->test_function, options->warmup, options->iterations, &results[results_num]) < 0)
+            {
+                fprintf(stderr, "Could not benchmark lesson \"%s\".\r\n", lesson->name);
+                benchmarkFreeResult(&results[results_num]);
+                ret = -1;
+                continue;
+            }
+
+            // Work units depend on the lesson parameters, which are still the ones of the current sweep point.
+            results[results_num].work_units = (lesson->work_units ? lesson->work_units() : 0);
+
+            ++results_num;
+        }
+    }
+
+    int regressions_num = compareWithBaseline(options, results, results_num);
+
+    if(regressions_num < 0)
+        ret = -1;
+
+    // Throughput curves are fitted whenever the number of threads has been swept (or given) for lessons reporting their work.
+    BENCHMARK_SCALABILITY* scalability = NULL;
+    int scalability_num = benchmarkFitScalability(results, results_num, &scalability);
+
+    if(scalability_num < 0)
+    {
+        fprintf(stderr, "Could not fit scalability models.\r\n");
+        scalability_num = 0;
+        ret = -1;
+    }
+
+    printScalability(scalability, scalability_num);
+
+    benchmarkPrintJSON(benchmarkGetReportStream(), results, results_num, scalability, scalability_num);
+    benchmarkFreeScalability(scalability, scalability_num);
+
+    if(options->save_baseline_path != NULL && benchmarkBaselineSave(options->save_baseline_path, results, results_num) < 0)
+    {
+        fprintf(stderr, "Could not save baseline to %s.\r\n", options->save_baseline_path);
+        ret = -1;
+    }
+
+    for(unsigned int result_idx = 0; result_idx < results_num; result_idx++)
+        benchmarkFreeResult(&results[result_idx]);
+
+    free(results);
+
+    // Output is not restored, so that threads outliving any lesson (such as detached ones) cannot pollute the report.
+    return (ret == 0 && regressions_num > 0 ? 1 : ret);
+}
+
+// Regressions and improvements are reported on stderr as well, so that they are seen without parsing the report. Returns the
+// number of regressions, or -1 if the baseline could not be read.
+static int compareWithBaseline(const RUN_OPTIONS* options, BENCHMARK_RESULT* results, unsigned int results_num)
+{
+    if(options->baseline_path == NULL)
+        return 0;
+
+    BENCHMARK_BASELINE baseline;
+
+    if(benchmarkBaselineLoad(options->baseline_path, &baseline) < 0)
+    {
+        fprintf(stderr, "Could not load baseline from %s.\r\n", options->baseline_path);
+        return -1;
+    }
+
+    int regressions_num = benchmarkBaselineCompare(&baseline, results, results_num, options->regression_threshold / 100.0);
+
+    for(unsigned int result_idx = 0; result_idx < results_num; result_idx++)
+    {
+        const BENCHMARK_COMPARISON* comparison = &results[result_idx].comparison;
+        char key[BENCHMARK_BASELINE_KEY_MAX_SIZE];
+
+        benchmarkBaselineGetKey(&results[result_idx], key, sizeof(key));
+
+        if(!comparison->available)
+            fprintf(stderr, "%s: not found in baseline.\r\n", key);
+        else if(comparison->regression || comparison->improvement)
+            fprintf(stderr, "%s%s: %s, median %+.1f%% (z = %.2f).%s\r\n",
+                    (comparison->regression ? PRINT_COLOR_RED : PRINT_COLOR_GREEN)  ,
+                    key                                                             ,
+                    (comparison->regression ? "regression" : "improvement")         ,
+                    100.0 * comparison->change_ratio                                ,
+                    comparison->z_score                                             ,
+                    PRINT_COLOR_RESET                                               );
+    }
+
+    benchmarkBaselineFree(&baseline);
+
+    return regressions_num;
+}
+
+// A summary of each fitted curve is printed on stderr, so that it is seen without parsing the report.
+static void printScalability(const BENCHMARK_SCALABILITY* scalability, unsigned int scalability_num)
+{
+    for(unsigned int curve_idx = 0; curve_idx < scalability_num; curve_idx++)
+    {
+        const BENCHMARK_SCALABILITY* curve = &scalability[curve_idx];
+        const SCALABILITY_FIT* fit = &curve->fit;
+
+        fprintf(stderr, "%s", curve->name);
+
+        for(int param_id = 0; param_id < LESSON_PARAMS_NUM; param_id++)
+            if(curve->parameters.set_mask & (1U << param_id))
+                fprintf(stderr, " %s=%lu", getLessonParameterName((LESSON_PARAM_ID)param_id), curve->parameters.values[param_id]);
+
+        if(!fit->amdahl.available)
+        {
+            fprintf(stderr, ": cannot fit scalability models, the threads sweep must include 1.\r\n");
+            continue;
+        }
+
+        fprintf(stderr, ": Amdahl sigma = %.4f (R^2 = %.3f)", fit->amdahl.sigma, fit->amdahl.r_squared);
+
+        if(fit->usl.available)
+        {
+            fprintf(stderr, ", USL sigma = %.4f, kappa = %.6f (R^2 = %.3f)", fit->usl.sigma, fit->usl.kappa, fit->usl.r_squared);
+
+            if(fit->peak_concurrency > 0.0)
+                fprintf(stderr, ", peak at %.1f threads", fit->peak_concurrency);
+        }
+
+        fprintf(stderr, ", limited by %s.\r\n", scalabilityModelGetLimitName(fit->limit));
+    }
+}
+
+static void runLessons(RUN_OPTIONS* options)
+{
+    unsigned int points_num = getSweepPointsNum(options);
+
+    for(unsigned int point_idx = 0; point_idx < points_num; point_idx++)
+    {
+        applySweepPoint(options, point_idx);
+        printSweepPoint(options);
+
+        for(unsigned int lesson_idx = 0; lesson_idx < options->selected_num; lesson_idx++)
+        {
+            const LESSON* lesson = options->selected[lesson_idx];
+            ALLOCATION_STATS allocations_before, allocations_after, allocations;
+
+            setCurrentLesson(lesson);
+
+            allocationTrackerGetTotals(&allocations_before);
+            allocationTrackerResetPeak();
+
+            executeTestFunction(lesson->test_text, lesson->test_function);
+
+            // Printed on stderr, so that it can be told apart from the lesson's own output.
+            if(options->allocations)
+            {
+                allocationTrackerGetTotals(&allocations_after);
+                allocationTrackerGetDifference(&allocations_before, &allocations_after, &allocations);
+                allocationTrackerPrint(stderr, lesson->name, &allocations);
+            }
+        }
+    }
+}
+
+static void printLessonOutcome(const LESSON* lesson, const PROCESS_RUNNER_RESULT* result)
+{
+    const char* color = (result->status == PROCESS_RUNNER_STATUS_OK ? PRINT_COLOR_GREEN : PRINT_COLOR_RED);
+
+    printf("%s%s: %s", color, lesson->name, processRunnerGetStatusName(result->status));
+
+    if(result->status == PROCESS_RUNNER_STATUS_FAILED)
+        printf(" (exit code %d)", result->exit_code);
+
+    if(result->status == PROCESS_RUNNER_STATUS_CRASHED)
+        printf(" (%s)", strsignal(result->signal_number));
+
+    printf(" after %.3f s%s\r\n\r\n", result->wall_time_ns / 1e9, PRINT_COLOR_RESET);
+}
+
+// Every lesson is run in a process of its own, so no lesson can affect the rest. Returns -1 if any lesson did not succeed.
+static int runParallelLessons(RUN_OPTIONS* options)
+{
+    unsigned int points_num = getSweepPointsNum(options);
+    PROCESS_RUNNER_JOB jobs[options->selected_num];
+    PROCESS_RUNNER_RESULT results[options->selected_num];
+    unsigned int failed_num = 0;
+
+    if(options->cpu_budget == 0)
+    {
+        long online_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        options->cpu_budget = (online_cpus > 0 ? (unsigned int)online_cpus : 1);
+    }
+
+    for(unsigned int lesson_idx = 0; lesson_idx < options->selected_num; lesson_idx++)
+    {
+        jobs[lesson_idx].name       = options->selected[lesson_idx]->name;
+        jobs[lesson_idx].function   = options->selected[lesson_idx]->test_function;
+        jobs[lesson_idx].cpu_weight = options->selected[lesson_idx]->cpu_weight;
+    }
+
+    for(unsigned int point_idx = 0; point_idx < points_num; point_idx++)
+    {
+        applySweepPoint(options, point_idx);
+        printSweepPoint(options);
+
+        // Children inherit the lesson parameters in use when they are forked.
+        if(processRunnerRun(jobs, options->selected_num, options->cpu_budget, options->timeout_s, results) < 0)
+        {
+            printf("Could not run lessons.\r\n");
+            return -1;
+        }
+
+        for(unsigned int lesson_idx = 0; lesson_idx < options->selected_num; lesson_idx++)
+        {
+            printTestHeader(options->selected[lesson_idx]->test_text);
+
+            if(results[lesson_idx].output_size > 0)
+                fwrite(results[lesson_idx].output, 1, results[lesson_idx].output_size, stdout);
+
+            printf("\r\n");
+            printLessonOutcome(options->selected[lesson_idx], &results[lesson_idx]);
+
+            if(results[lesson_idx].status != PROCESS_RUNNER_STATUS_OK)
+                ++failed_num;
+        }
+
+        processRunnerFreeResults(results, options->selected_num);
+    }
+
+    return (failed_num > 0 ? -1 : 0);
+}
+
+// Messages are printed on stderr, as standard output is redirected while benchmarking. Returns -1 if the trace could not be written.
+static int writeTrace(const RUN_OPTIONS* options)
+{
+    if(options->trace_path == NULL)
+        return 0;
+
+    threadTracerStop();
+
+    if(threadTracerWriteJSON(options->trace_path) < 0)
+    {
+        fprintf(stderr, "Could not write trace to %s.\r\n", options->trace_path);
+        return -1;
+    }
+
+    if(threadTracerGetDroppedEvents() > 0)
+        fprintf(stderr, "Trace buffers were full, %lu event(s) dropped.\r\n", threadTracerGetDroppedEvents());
 
     return 0;
 }
 
+// Printed on stderr as well, for the same reason. Returns -1 if latencies could not be printed or written.
+static int printLatencies(const RUN_OPTIONS* options)
+{
+    if(!options->latency)
+        return 0;
+
+    threadTracerStop();
+
+    fprintf(stderr, "\r\nLatencies:\r\n");
+
+    if(threadTracerPrintLatencies(stderr) < 0)
+    {
+        fprintf(stderr, "Could not merge latency histograms.\r\n");
+        return -1;
+    }
+
+    if(options->latency_csv_path != NULL && threadTracerWriteLatenciesCSV(options->latency_csv_path) < 0)
+    {
+        fprintf(stderr, "Could not write latencies to %s.\r\n", options->latency_csv_path);
+        return -1;
+    }
+
+    return 0;
+}
+
+// Printed on stderr as well. Returns -1 if the profile could not be written.
+static int writeProfile(const RUN_OPTIONS* options)
+{
+    if(options->profile_path == NULL)
+        return 0;
+
+    samplingProfilerStop();
+
+    if(samplingProfilerWriteFolded(options->profile_path) < 0)
+    {
+        fprintf(stderr, "Could not write profile to %s.\r\n", options->profile_path);
+        return -1;
+    }
+
+    fprintf(stderr, "%lu sample(s) written to %s", samplingProfilerGetSamples(), options->profile_path);
+
+    if(samplingProfilerGetDroppedSamples() > 0)
+        fprintf(stderr, ", %lu more dropped as the sample pool was full", samplingProfilerGetDroppedSamples());
+
+    fprintf(stderr, ".\r\n");
+
+    return 0;
+}
+
+// Printed on stderr as well.
+static void printThreadAllocations(const RUN_OPTIONS* options)
+{
+    if(!options->allocations)
+        return;
+
+    allocationTrackerEnable(0);
+
+    fprintf(stderr, "\r\nAllocations per thread (named after the lesson running when each thread first allocated):\r\n");
+    allocationTrackerPrintThreads(stderr);
+}
+
+// Printed on stderr as well. Returns -1 if the timeline could not be written.
+static int printThreadStates(const RUN_OPTIONS* options)
+{
+    if(!options->thread_states)
+        return 0;
+
+    if(threadStateSamplerStop() < 0)
+    {
+        fprintf(stderr, "Could not write thread states to %s.\r\n", options->thread_states_path);
+        return -1;
+    }
+
+    fprintf(stderr, "\r\nThread states (share of the time each thread was seen):\r\n");
+    threadStateSamplerPrintSummary(stderr);
+
+    return 0;
+}
+
+// Printed on stderr as well.
+static void printWorkSpan(const RUN_OPTIONS* options)
+{
+    if(!options->work_span)
+        return;
+
+    fprintf(stderr, "\r\nWork and span (averages per run):\r\n");
+    workSpanPrintJobs(stderr);
+}
+
+int main(int argc, char** argv)
+{
+    RUN_OPTIONS options =
+    {
+        .benchmark              = 0                             ,
+        .perf_counters          = 0                             ,
+        .pin                    = 0                             ,
+        .pinned_cpus            = NULL                          ,
+        .target_ci              = 0.0                           ,
+        .max_iterations         = DEFAULT_MAX_ITERATIONS        ,
+        .baseline_path          = NULL                          ,
+        .save_baseline_path     = NULL                          ,
+        .regression_threshold   = DEFAULT_REGRESSION_THRESHOLD  ,
+        .parallel               = 0                             ,
+        .cpu_budget             = 0                             ,
+        .timeout_s              = DEFAULT_LESSON_TIMEOUT        ,
+        .trace_path             = NULL                          ,
+        .latency                = 0                             ,
+        .latency_csv_path       = NULL                          ,
+        .profile_path           = NULL                          ,
+        .profile_frequency      = SAMPLING_PROFILER_DEFAULT_FREQUENCY,
+        .allocations            = 0                             ,
+        .thread_states          = 0                             ,
+        .thread_states_path     = NULL                          ,
+        .thread_states_period_ms= THREAD_STATE_SAMPLER_DEFAULT_PERIOD_MS,
+        .work_span              = 0                             ,
+        .metrics_address        = NULL                          ,
+        .iterations             = DEFAULT_BENCHMARK_ITERATIONS  ,
+        .warmup                 = DEFAULT_BENCHMARK_WARMUP      ,
+        .selected_num           = 0                             ,
+        .sweeps_num             = 0                             ,
+    };
+
+    int parse_status = parseRunOptions(argc, argv, &options);
+
+    if(parse_status != 0)
+        return (parse_status < 0 ? 1 : 0);
+
+    if((options.trace_path != NULL || options.latency) && threadTracerStart(options.trace_path != NULL, options.latency) < 0)
+    {
+        printf("Tracing has not been compiled in, build with -DTHREAD_TRACE_LEVEL=%d.\r\n", THREAD_TRACE_LEVEL_SYNC);
+        return 1;
+    }
+
+    if(options.profile_path != NULL && samplingProfilerStart(options.profile_frequency) < 0)
+    {
+        printf("Could not start the sampling profiler.\r\n");
+        return 1;
+    }
+
+    if(options.thread_states && threadStateSamplerStart(options.thread_states_period_ms, options.thread_states_path) < 0)
+    {
+        printf("Could not start sampling thread states.\r\n");
+        return 1;
+    }
+
+    if(options.metrics_address != NULL && metricsExporterStart(options.metrics_address) < 0)
+    {
+        printf("Could not export metrics on %s.\r\n", options.metrics_address);
+        return 1;
+    }
+
+    if(allocationTrackerEnable(options.allocations) < 0)
+    {
+        printf("Allocation tracking has not been compiled in, build with -DALLOCATION_TRACKING=1.\r\n");
+        return 1;
+    }
+
+    workSpanEnable(options.work_span);
+
+    int exit_status = 0;
+
+    if(options.benchmark)
+    {
+        int benchmark_status = runBenchmark(&options);
+        exit_status = (benchmark_status < 0 ? 1 : (benchmark_status > 0 ? EXIT_STATUS_REGRESSION : 0));
+    }
+    else if(options.parallel)
+        exit_status = (runParallelLessons(&options) < 0 ? 1 : 0);
+    else
+        runLessons(&options);
+
+    metricsExporterStop();
+    printThreadAllocations(&options);
+    printWorkSpan(&options);
+
+    if(printThreadStates(&options) < 0)
+        exit_status = 1;
+
+    // Every output is attempted even if an earlier one failed, so that a bad trace path does not cost the profile as well.
+    int trace_status    = writeTrace(&options);
+    int latency_status  = printLatencies(&options);
+    int profile_status  = writeProfile(&options);
+
+    if(trace_status < 0 || latency_status < 0 || profile_status < 0)
+        exit_status = 1;
+
+    return exit_status;
+}
+
 /**************************************/
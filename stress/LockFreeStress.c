@@ -0,0 +1,588 @@
+/*
+A program of its own hammering LockFreeStack.c, LockFreeQueue.c, ConcurrentHashMap.c and HazardPointers.c, meant to be built with
+a sanitizer. The lock-free and hash-map lessons measure the structures, and check little more than sums; this driver does not care
+about speed, but about catching whatever the structures could get wrong:
+    ·Values lost or popped more than once: every value is unique, and is marked as seen when popped. Once threads are done and the
+    structure drained, every value must have been seen exactly once.
+    ·Values dequeued out of order: values queued by the same thread are increasing, so every thread dequeuing must find each
+    producer's values in increasing order as well.
+    ·Keys lost by the hash map while its tables are being replaced, removed keys found again, or keys found with another key's
+    value: every key's value is derived from the key, and every thread adds keys of its own, looks them up right away and removes
+    every other one. Once threads are done, the map must hold exactly the keys which were not removed.
+    ·Nodes used after being freed, or freed twice: reported by AddressSanitizer.
+    ·Data races, such as a node's fields being read without the ordering the algorithms rely on: reported by ThreadSanitizer.
+
+Each structure is run in two ways. In the mixed one, every thread pushes and pops a value over and over, as the lesson does. In the
+split one, half the threads just push and the other half just pop, so that nodes are retired and freed while others are still
+being pushed, which is when a node freed too early and reused would show up (the ABA problem). For the hash map, which starts
+small so that its tables keep being replaced, threads which would pop just look up the other threads' keys.
+
+It is built apart from the lessons, as just the structures, the hazard pointers and this file are needed, and to keep the lessons'
+own interposers away from the sanitizers. From the repo directory:
+
+gcc -g -O1 -fsanitize=thread -D_XOPEN_SOURCE=700 -Isrc stress/LockFreeStress.c src/LockFreeStack.c src/LockFreeQueue.c
+    src/ConcurrentHashMap.c src/HazardPointers.c src/ThreadCreationStatus.c -o exe/lock_free_stress_tsan -lpthread
+./exe/lock_free_stress_tsan 8 50000
+
+Replacing -fsanitize=thread with -fsanitize=address checks for nodes used after being freed instead. The first argument is the
+number of threads (8 by default) and the second one the number of values (or keys) each thread pushes (50000 by default). The exit
+status is 0 if every check passed, and 1 otherwise.
+*/
+
+/********* Include statements *********/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include "ThreadColors.h"
+#include "ThreadCreationStatus.h"
+#include "HazardPointers.h"
+#include "LockFreeStack.h"
+#include "LockFreeQueue.h"
+#include "ConcurrentHashMap.h"
+
+/**************************************/
+
+/********** Define statements *********/
+
+#define DEFAULT_THREADS             8
+#define DEFAULT_VALUES_PER_THREAD   50000
+#define MAX_STRESS_THREADS          64
+#define MAP_INITIAL_CAPACITY        16
+#define MAP_VALUE_MULTIPLIER        2654435761ULL   // Each key's value is the key times this, so that values are never keys.
+
+/**************************************/
+
+/****** Private type definitions ******/
+
+typedef enum
+{
+    STRESS_MODE_MIXED = 0   ,   // Every thread pushes and pops.
+    STRESS_MODE_SPLIT       ,   // Half the threads push, the other half pop.
+} STRESS_MODE;
+
+typedef struct
+{
+    const char* name                                    ;
+    void*       (*create)()                             ;
+    void        (*destroy)(void* structure)             ;
+    int         (*push)(void* structure, void* value)   ;
+    int         (*pop)(void* structure, void** value)   ;
+    int         fifo                                    ;   // Whether each producer's values must come out in order.
+} STRESS_STRUCTURE;
+
+typedef struct
+{
+    const STRESS_STRUCTURE* structure_operations    ;
+    void*                   structure               ;
+    atomic_int*             start                   ;
+    atomic_uchar*           seen                    ;   // Times each value was popped.
+    atomic_ulong*           popped_num              ;   // Values popped by every thread so far.
+    unsigned long           expected_num            ;   // Values to be popped in split mode before popping threads stop.
+    unsigned int            producer_idx            ;   // Values pushed go from producer_idx * values_num + 1 onwards.
+    unsigned int            producers_num           ;
+    unsigned long           values_num              ;
+    int                     pushes                  ;
+    int                     pops                    ;
+    uintptr_t               last_seen[MAX_STRESS_THREADS];  // Last value popped from each producer.
+    unsigned long           duplicates              ;
+    unsigned long           out_of_order            ;
+    unsigned long           failed_pushes           ;
+    unsigned long           lost                    ;   // Hash map keys not found right after being added.
+    unsigned long           wrong_values            ;   // Hash map keys found with another key's value.
+    unsigned long           removed_found           ;   // Hash map keys found right after being removed.
+} STRESS_THREAD_DATA;
+
+/**************************************/
+
+/**** Private function prototypes *****/
+
+static void*        lockFreeStackCreateAny();
+static void         lockFreeStackDestroyAny(void* structure);
+static int          lockFreeStackPushAny(void* structure, void* value);
+static int          lockFreeStackPopAny(void* structure, void** value);
+static void*        lockFreeQueueCreateAny();
+static void         lockFreeQueueDestroyAny(void* structure);
+static int          lockFreeQueueEnqueueAny(void* structure, void* value);
+static int          lockFreeQueueDequeueAny(void* structure, void** value);
+static void         checkPopped(STRESS_THREAD_DATA* data, uintptr_t value);
+static void*        stressRoutine(void* arg);
+static void         checkMapValue(STRESS_THREAD_DATA* data, unsigned long long key);
+static void*        mapStressRoutine(void* arg);
+static int          runThreads(STRESS_THREAD_DATA* threads_data, unsigned int threads_num, atomic_int* start, void* (*routine)(void*));
+static int          checkValues(const STRESS_STRUCTURE* structure_operations, STRESS_MODE mode, void* structure, STRESS_THREAD_DATA* threads_data, unsigned int threads_num, atomic_uchar* seen, unsigned long total_values);
+static int          checkMapKeys(STRESS_MODE mode, CONCURRENT_HASH_MAP* map, STRESS_THREAD_DATA* threads_data, unsigned int threads_num, unsigned int producers_num, unsigned long values_num);
+static int          runStress(const STRESS_STRUCTURE* structure_operations, STRESS_MODE mode, unsigned int threads_num, unsigned long values_num);
+static int          runMapStress(STRESS_MODE mode, unsigned int threads_num, unsigned long values_num);
+static int          parseArgument(const char* text, unsigned long* value);
+
+/**************************************/
+
+/********* Private variables **********/
+
+static const STRESS_STRUCTURE structures[] =
+{
+    { "Treiber stack"   , lockFreeStackCreateAny    , lockFreeStackDestroyAny   , lockFreeStackPushAny      , lockFreeStackPopAny       , 0 },
+    { "M-S queue"       , lockFreeQueueCreateAny    , lockFreeQueueDestroyAny   , lockFreeQueueEnqueueAny   , lockFreeQueueDequeueAny   , 1 },
+};
+
+/**************************************/
+
+/******** Function definitions ********/
+
+static void* lockFreeStackCreateAny()
+{
+    return lockFreeStackCreate();
+}
+
+static void lockFreeStackDestroyAny(void* structure)
+{
+    lockFreeStackDestroy((LOCK_FREE_STACK*)structure);
+}
+
+static int lockFreeStackPushAny(void* structure, void* value)
+{
+    return lockFreeStackPush((LOCK_FREE_STACK*)structure, value);
+}
+
+static int lockFreeStackPopAny(void* structure, void** value)
+{
+    return lockFreeStackPop((LOCK_FREE_STACK*)structure, value);
+}
+
+static void* lockFreeQueueCreateAny()
+{
+    return lockFreeQueueCreate();
+}
+
+static void lockFreeQueueDestroyAny(void* structure)
+{
+    lockFreeQueueDestroy((LOCK_FREE_QUEUE*)structure);
+}
+
+static int lockFreeQueueEnqueueAny(void* structure, void* value)
+{
+    return lockFreeQueueEnqueue((LOCK_FREE_QUEUE*)structure, value);
+}
+
+static int lockFreeQueueDequeueAny(void* structure, void** value)
+{
+    return lockFreeQueueDequeue((LOCK_FREE_QUEUE*)structure, value);
+}
+
+static void checkPopped(STRESS_THREAD_DATA* data, uintptr_t value)
+{
+    if(atomic_fetch_add(&data->seen[value], 1) != 0)
+        data->duplicates++;
+
+    unsigned int producer_idx = (unsigned int)((value - 1) / data->values_num);
+
+    if(data->structure_operations->fifo && producer_idx < data->producers_num)
+    {
+        if(value <= data->last_seen[producer_idx])
+            data->out_of_order++;
+
+        data->last_seen[producer_idx] = value;
+    }
+
+    atomic_fetch_add(data->popped_num, 1);
+}
+
+static void* stressRoutine(void* arg)
+{
+    STRESS_THREAD_DATA* data = (STRESS_THREAD_DATA*)arg;
+    uintptr_t first_value = (uintptr_t)data->producer_idx * data->values_num + 1;
+    void* value;
+
+    while(!atomic_load(data->start))
+        sched_yield();
+
+    if(data->pushes && data->pops)
+    {
+        for(unsigned long value_idx = 0; value_idx < data->values_num; value_idx++)
+        {
+            if(data->structure_operations->push(data->structure, (void*)(first_value + value_idx)) != 0)
+                data->failed_pushes++;
+
+            if(data->structure_operations->pop(data->structure, &value))
+                checkPopped(data, (uintptr_t)value);
+        }
+    }
+    else if(data->pushes)
+    {
+        // A value which could not be pushed is counted as popped, so that popping threads do not wait for it.
+        for(unsigned long value_idx = 0; value_idx < data->values_num; value_idx++)
+        {
+            if(data->structure_operations->push(data->structure, (void*)(first_value + value_idx)) != 0)
+            {
+                data->failed_pushes++;
+                atomic_fetch_add(data->popped_num, 1);
+            }
+        }
+    }
+    else
+    {
+        // Popping threads go on until every value pushed has been popped, by them or by any other popping thread.
+        while(atomic_load(data->popped_num) < data->expected_num)
+        {
+            if(data->structure_operations->pop(data->structure, &value))
+                checkPopped(data, (uintptr_t)value);
+            else
+                sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+// Looks the key up, which may be present or not, and counts it if it holds anything but its own value.
+static void checkMapValue(STRESS_THREAD_DATA* data, unsigned long long key)
+{
+    unsigned long long value;
+
+    if(concurrentHashMapGet((CONCURRENT_HASH_MAP*)data->structure, key, &value) == 1 && value != key * MAP_VALUE_MULTIPLIER)
+        data->wrong_values++;
+}
+
+// Writing threads add their own keys one by one, looking each up right away and removing every other one, while reading threads
+// look up the keys of every writing thread until they are all done. "popped_num" counts the keys written so far.
+static void* mapStressRoutine(void* arg)
+{
+    STRESS_THREAD_DATA* data = (STRESS_THREAD_DATA*)arg;
+    CONCURRENT_HASH_MAP* map = (CONCURRENT_HASH_MAP*)data->structure;
+    unsigned long long first_key = (unsigned long long)data->producer_idx * data->values_num + 1;
+    unsigned long long value;
+
+    while(!atomic_load(data->start))
+        sched_yield();
+
+    if(data->pushes)
+    {
+        for(unsigned long key_idx = 0; key_idx < data->values_num; key_idx++)
+        {
+            unsigned long long key = first_key + key_idx;
+
+            if(concurrentHashMapPut(map, key, key * MAP_VALUE_MULTIPLIER) != 0)
+            {
+                data->failed_pushes++;
+                atomic_fetch_add(data->popped_num, 1);
+                continue;
+            }
+
+            if(concurrentHashMapGet(map, key, &value) != 1)
+                data->lost++;
+            else if(value != key * MAP_VALUE_MULTIPLIER)
+                data->wrong_values++;
+
+            if(key_idx % 2 == 1)
+            {
+                if(concurrentHashMapRemove(map, key) != 1)
+                    data->lost++;
+
+                if(concurrentHashMapGet(map, key, NULL) != 0)
+                    data->removed_found++;
+            }
+
+            // Another writing thread's key, which may or may not have been added yet.
+            if(data->pops)
+                checkMapValue(data, (key - 1 + data->values_num) % ((unsigned long long)data->producers_num * data->values_num) + 1);
+
+            atomic_fetch_add(data->popped_num, 1);
+        }
+    }
+    else
+    {
+        for(unsigned long long key = 1; atomic_load(data->popped_num) < data->expected_num; key = key % data->expected_num + 1)
+            checkMapValue(data, key);
+    }
+
+    return NULL;
+}
+
+// Returns -1 if not every thread could be created, in which case the ones which were are let go with nothing to do.
+static int runThreads(STRESS_THREAD_DATA* threads_data, unsigned int threads_num, atomic_int* start, void* (*routine)(void*))
+{
+    pthread_t threads[MAX_STRESS_THREADS];
+    unsigned int created_num = 0;
+
+    for(; created_num < threads_num; created_num++)
+        if(checkThreadCreationStatus( pthread_create(&threads[created_num], NULL, routine, &threads_data[created_num]) ))
+            break;
+
+    if(created_num < threads_num)
+    {
+        for(unsigned int thread_idx = 0; thread_idx < created_num; thread_idx++)
+        {
+            threads_data[thread_idx].values_num     = 0;
+            threads_data[thread_idx].expected_num   = 0;
+        }
+    }
+
+    atomic_store(start, 1);
+
+    for(unsigned int thread_idx = 0; thread_idx < created_num; thread_idx++)
+        pthread_join(threads[thread_idx], NULL);
+
+    return (created_num < threads_num ? -1 : 0);
+}
+
+// Drains whatever is left as one more popping thread would, and returns 0 if every check passed or 1 otherwise.
+static int checkValues(const STRESS_STRUCTURE* structure_operations, STRESS_MODE mode, void* structure, STRESS_THREAD_DATA* threads_data, unsigned int threads_num, atomic_uchar* seen, unsigned long total_values)
+{
+    STRESS_THREAD_DATA drain_data = threads_data[0];
+    void* value;
+
+    for(unsigned int producer_idx = 0; producer_idx < MAX_STRESS_THREADS; producer_idx++)
+        drain_data.last_seen[producer_idx] = 0;
+
+    drain_data.duplicates   = 0;
+    drain_data.out_of_order = 0;
+
+    while(structure_operations->pop(structure, &value))
+        checkPopped(&drain_data, (uintptr_t)value);
+
+    unsigned long duplicates = drain_data.duplicates;
+    unsigned long out_of_order = drain_data.out_of_order;
+    unsigned long failed_pushes = 0;
+    unsigned long lost = 0;
+
+    for(unsigned int thread_idx = 0; thread_idx < threads_num; thread_idx++)
+    {
+        duplicates      += threads_data[thread_idx].duplicates      ;
+        out_of_order    += threads_data[thread_idx].out_of_order    ;
+        failed_pushes   += threads_data[thread_idx].failed_pushes   ;
+    }
+
+    for(unsigned long value_idx = 1; value_idx <= total_values; value_idx++)
+        if(atomic_load(&seen[value_idx]) == 0)
+            lost++;
+
+    int status = (duplicates == 0 && out_of_order == 0 && lost == failed_pushes ? 0 : 1);
+
+    printf("%s%-14s %-6s %lu value(s): %lu lost, %lu popped more than once, %lu out of order, %lu failed push(es).%s\r\n",
+            (status == 0 ? PRINT_COLOR_GREEN : PRINT_COLOR_RED)     ,
+            structure_operations->name                              ,
+            (mode == STRESS_MODE_SPLIT ? "split" : "mixed")         ,
+            total_values                                            ,
+            lost - failed_pushes                                    ,
+            duplicates                                              ,
+            out_of_order                                            ,
+            failed_pushes                                           ,
+            PRINT_COLOR_RESET                                       );
+
+    return status;
+}
+
+// Returns 0 if every check passed, 1 if any failed and -1 if the run could not be done.
+static int runStress(const STRESS_STRUCTURE* structure_operations, STRESS_MODE mode, unsigned int threads_num, unsigned long values_num)
+{
+    STRESS_THREAD_DATA* threads_data = (STRESS_THREAD_DATA*)calloc(threads_num, sizeof(STRESS_THREAD_DATA));
+    unsigned int producers_num = (mode == STRESS_MODE_SPLIT ? threads_num / 2 : threads_num);
+    unsigned long total_values = producers_num * values_num;
+    atomic_uchar* seen = (atomic_uchar*)calloc(total_values + 1, sizeof(atomic_uchar));
+    void* structure = structure_operations->create();
+    atomic_int start = 0;
+    atomic_ulong popped_num = 0;
+    int status = -1;
+
+    if(threads_data != NULL && seen != NULL && structure != NULL)
+    {
+        for(unsigned int thread_idx = 0; thread_idx < threads_num; thread_idx++)
+        {
+            int pushes = (mode == STRESS_MODE_MIXED || thread_idx < producers_num);
+
+            threads_data[thread_idx] = (STRESS_THREAD_DATA)
+            {
+                .structure_operations   = structure_operations                      ,
+                .structure              = structure                                 ,
+                .start                  = &start                                    ,
+                .seen                   = seen                                      ,
+                .popped_num             = &popped_num                               ,
+                .expected_num           = total_values                              ,
+                .producer_idx           = thread_idx                                ,
+                .producers_num          = producers_num                             ,
+                .values_num             = values_num                                ,
+                .pushes                 = pushes                                    ,
+                .pops                   = (mode == STRESS_MODE_MIXED || !pushes)    ,
+            };
+        }
+
+        if(runThreads(threads_data, threads_num, &start, stressRoutine) == 0)
+            status = checkValues(structure_operations, mode, structure, threads_data, threads_num, seen, total_values);
+    }
+
+    if(structure != NULL)
+        structure_operations->destroy(structure);
+
+    // Every thread has been joined, so nodes still waiting for a scan can be freed right away.
+    hazardPointerReclaimAll();
+
+    free(seen);
+    free(threads_data);
+
+    return status;
+}
+
+// Every key left must be present with its own value, and every removed one absent. Returns 0 if every check passed or 1 otherwise.
+static int checkMapKeys(STRESS_MODE mode, CONCURRENT_HASH_MAP* map, STRESS_THREAD_DATA* threads_data, unsigned int threads_num, unsigned int producers_num, unsigned long values_num)
+{
+    unsigned long failed_puts = 0;
+    unsigned long lost = 0;
+    unsigned long removed_found = 0;
+    unsigned long wrong_values = 0;
+    unsigned long long present_num = 0;
+    unsigned long long value;
+
+    for(unsigned long long key = 1; key <= (unsigned long long)producers_num * values_num; key++)
+    {
+        int removed = ((key - 1) % values_num % 2 == 1);
+        int found = concurrentHashMapGet(map, key, &value);
+
+        if(found == 1)
+        {
+            present_num++;
+
+            if(removed)
+                removed_found++;
+            else if(value != key * MAP_VALUE_MULTIPLIER)
+                wrong_values++;
+        }
+        else if(!removed)
+            lost++;
+    }
+
+    for(unsigned int thread_idx = 0; thread_idx < threads_num; thread_idx++)
+    {
+        failed_puts     += threads_data[thread_idx].failed_pushes   ;
+        lost            += threads_data[thread_idx].lost            ;
+        removed_found   += threads_data[thread_idx].removed_found   ;
+        wrong_values    += threads_data[thread_idx].wrong_values    ;
+    }
+
+    // A key which could not be put is missing from the map just as a lost one would be, unless it was to be removed anyway.
+    lost = (lost > failed_puts ? lost - failed_puts : 0);
+
+    int status = (  lost == 0 && removed_found == 0 && wrong_values == 0    &&
+                    concurrentHashMapGetSize(map) == present_num            ? 0 : 1);
+
+    printf("%s%-14s %-6s %lu key(s): %lu lost, %lu removed but found, %lu wrong value(s), %u resize(s), %lu failed put(s).%s\r\n",
+            (status == 0 ? PRINT_COLOR_GREEN : PRINT_COLOR_RED)     ,
+            "Hash map"                                              ,
+            (mode == STRESS_MODE_SPLIT ? "split" : "mixed")         ,
+            producers_num * values_num                              ,
+            lost                                                    ,
+            removed_found                                           ,
+            wrong_values                                            ,
+            concurrentHashMapGetResizes(map)                        ,
+            failed_puts                                             ,
+            PRINT_COLOR_RESET                                       );
+
+    return status;
+}
+
+// Returns 0 if every check passed, 1 if any failed and -1 if the run could not be done.
+static int runMapStress(STRESS_MODE mode, unsigned int threads_num, unsigned long values_num)
+{
+    STRESS_THREAD_DATA* threads_data = (STRESS_THREAD_DATA*)calloc(threads_num, sizeof(STRESS_THREAD_DATA));
+    unsigned int producers_num = (mode == STRESS_MODE_SPLIT ? threads_num / 2 : threads_num);
+    CONCURRENT_HASH_MAP* map = concurrentHashMapCreate(MAP_INITIAL_CAPACITY);
+    atomic_int start = 0;
+    atomic_ulong written_num = 0;
+    int status = -1;
+
+    if(threads_data != NULL && map != NULL)
+    {
+        for(unsigned int thread_idx = 0; thread_idx < threads_num; thread_idx++)
+        {
+            int pushes = (mode == STRESS_MODE_MIXED || thread_idx < producers_num);
+
+            threads_data[thread_idx] = (STRESS_THREAD_DATA)
+            {
+                .structure              = map                                       ,
+                .start                  = &start                                    ,
+                .popped_num             = &written_num                              ,
+                .expected_num           = producers_num * values_num                ,
+                .producer_idx           = thread_idx                                ,
+                .producers_num          = producers_num                             ,
+                .values_num             = values_num                                ,
+                .pushes                 = pushes                                    ,
+                .pops                   = (mode == STRESS_MODE_MIXED || !pushes)    ,
+            };
+        }
+
+        if(runThreads(threads_data, threads_num, &start, mapStressRoutine) == 0)
+            status = checkMapKeys(mode, map, threads_data, threads_num, producers_num, values_num);
+    }
+
+    // The map frees the tables it replaced itself, so there is nothing left for the hazard pointers to reclaim.
+    concurrentHashMapDestroy(map);
+    free(threads_data);
+
+    return status;
+}
+
+static int parseArgument(const char* text, unsigned long* value)
+{
+    char* end;
+    unsigned long parsed = strtoul(text, &end, 10);
+
+    if(*text == '\0' || *end != '\0' || parsed == 0)
+        return -1;
+
+    *value = parsed;
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned long threads_num = DEFAULT_THREADS;
+    unsigned long values_num = DEFAULT_VALUES_PER_THREAD;
+
+    if( argc > 3                                                    ||
+        (argc > 1 && parseArgument(argv[1], &threads_num) < 0)      ||
+        (argc > 2 && parseArgument(argv[2], &values_num) < 0)       ||
+        threads_num < 2 || threads_num > MAX_STRESS_THREADS         )
+    {
+        printf("Usage: %s [THREADS (2 to %d)] [VALUES_PER_THREAD]\r\n", argv[0], MAX_STRESS_THREADS);
+        return 1;
+    }
+
+    unsigned int structures_num = sizeof(structures) / sizeof(structures[0]);
+    int failed = 0;
+
+    // The last runs are the hash map's, whose operations do not fit the structures' ones.
+    for(unsigned int structure_idx = 0; structure_idx <= structures_num; structure_idx++)
+    {
+        for(STRESS_MODE mode = STRESS_MODE_MIXED; mode <= STRESS_MODE_SPLIT; mode++)
+        {
+            int status = (  structure_idx < structures_num                                                  ?
+                            runStress(&structures[structure_idx], mode, (unsigned int)threads_num, values_num)  :
+                            runMapStress(mode, (unsigned int)threads_num, values_num)                           );
+
+            if(status < 0)
+            {
+                printf("%sCould not run the stress test, so the procedure cannot go on.%s\r\n", PRINT_COLOR_RED, PRINT_COLOR_RESET);
+                return 1;
+            }
+
+            failed |= status;
+        }
+    }
+
+    HAZARD_POINTER_STATS stats;
+    hazardPointerGetStats(&stats);
+
+    printf("Hazard pointers: %llu node(s) retired, %llu freed, in %llu scan(s) by %u thread record(s).\r\n",
+            stats.retired   ,
+            stats.reclaimed ,
+            stats.scans     ,
+            stats.records   );
+
+    return (failed ? 1 : 0);
+}
+
+/**************************************/